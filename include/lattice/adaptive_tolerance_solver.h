@@ -0,0 +1,136 @@
+/*
+ * adaptive_tolerance_solver.h
+ */
+
+#ifndef INCLUDE_LATTICE_ADAPTIVE_TOLERANCE_SOLVER_H_
+#define INCLUDE_LATTICE_ADAPTIVE_TOLERANCE_SOLVER_H_
+
+#include "MG_config.h"
+#include "lattice/solver.h"
+#include "lattice/spinor_set.h"
+#include "utils/print_utils.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace MG {
+
+/** AdaptiveToleranceSolver
+ *
+ *  Runs the coarse solve of a cycle to a target set from the residual of the outer
+ *  flexible solver, rather than to a fixed RsdTarget. FGMRES tells its preconditioner
+ *  its current || r ||/|| b || before each application (SetOuterResidual), the cycle
+ *  passes it on to its coarse solver, and this sets the target of the next solves to
+ *
+ *      safety_factor * || r ||/|| b ||,  clamped to [ min_rsd_target, max_rsd_target ]
+ *
+ *  with the wrapped solver's SetRsdTarget(). So the first outer iterations get cheap,
+ *  loose coarse solves and only the last ones the full min_rsd_target accuracy. FGMRES
+ *  is flexible, so a preconditioner which changes between iterations is fine. Until the
+ *  outer solver sets a residual the target is min_rsd_target.
+ *
+ *  The solver counts its solves and their iterations, for LogStats(): against a run with
+ *  the fixed target this gives the iterations saved on the level.
+ */
+template<typename Spinor, typename Gauge>
+class AdaptiveToleranceSolver : public LinearSolver<Spinor,Gauge>
+{
+public:
+	AdaptiveToleranceSolver(const std::shared_ptr<const LinearSolver<Spinor,Gauge>>& solver,
+			int level,
+			double safety_factor,
+			double min_rsd_target,
+			double max_rsd_target,
+			bool VerboseP = false) : _solver(solver), _level(level), _safety_factor(safety_factor),
+					_min_rsd_target(min_rsd_target), _max_rsd_target(max_rsd_target), _VerboseP(VerboseP),
+					_outer_resid(-1), _rsd_target(min_rsd_target)
+	{
+		if( _safety_factor <= 0 ) {
+			MasterLog(ERROR, "AdaptiveToleranceSolver: level=%d Invalid Value: safety_factor <= 0", _level);
+		}
+		if( _min_rsd_target <= 0 || _max_rsd_target < _min_rsd_target ) {
+			MasterLog(ERROR, "AdaptiveToleranceSolver: level=%d Invalid Value: need 0 < min_rsd_target=%g <= max_rsd_target=%g",
+					_level, _min_rsd_target, _max_rsd_target);
+		}
+		ResetStats();
+	}
+
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_outer_resid = rel_resid;
+		_rsd_target = std::min( std::max(_safety_factor*rel_resid, _min_rsd_target), _max_rsd_target );
+	}
+
+	LinearSolverResults operator()(Spinor& out, const Spinor& in, ResiduumType resid_type = RELATIVE ) const override
+	{
+		_solver->SetRsdTarget(_rsd_target);
+		LinearSolverResults res = (*_solver)(out, in, resid_type);
+		count(res.n_count, 1);
+		return res;
+	}
+
+	std::vector<LinearSolverResults> MultiSolve(SpinorSet<Spinor>& out, const SpinorSet<Spinor>& in,
+			int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+	{
+		_solver->SetRsdTarget(_rsd_target);
+		std::vector<LinearSolverResults> res = _solver->MultiSolve(out, in, n_vecs, resid_type);
+		int n_iters = 0;
+		for(int i=0; i < n_vecs; ++i) {
+			n_iters += res[i].n_count;
+		}
+		count(n_iters, n_vecs);
+		return res;
+	}
+
+	inline
+	double GetRsdTarget() const { return _rsd_target; }
+
+	inline
+	long GetNumSolves() const { return _n_solves; }
+
+	inline
+	long GetNumIters() const { return _n_iters; }
+
+	void ResetStats() const
+	{
+		_n_solves = 0;
+		_n_iters = 0;
+		_sum_rsd_target = 0;
+	}
+
+	void LogStats() const
+	{
+		const double n_solves = _n_solves > 0 ? static_cast<double>(_n_solves) : 1.0;
+		MasterLog(INFO, "ADAPTIVE TOLERANCE: level=%d solves=%ld iters=%ld iters/solve=%8.2f mean target=%10.3e fixed target=%10.3e",
+				_level, _n_solves, _n_iters, _n_iters/n_solves, _sum_rsd_target/n_solves, _min_rsd_target);
+	}
+
+private:
+	void count(int n_iters, int n_solves) const
+	{
+		if( _VerboseP ) {
+			MasterLog(INFO, "ADAPTIVE TOLERANCE: level=%d outer || r ||/|| b ||=%16.8e target=%16.8e iters=%d",
+					_level, _outer_resid, _rsd_target, n_iters);
+		}
+		_n_solves += n_solves;
+		_n_iters += n_iters;
+		_sum_rsd_target += n_solves*_rsd_target;
+	}
+
+	const std::shared_ptr<const LinearSolver<Spinor,Gauge>> _solver;
+	const int _level;
+	const double _safety_factor;
+	const double _min_rsd_target;
+	const double _max_rsd_target;
+	const bool _VerboseP;
+
+	mutable double _outer_resid;
+	mutable double _rsd_target;
+	mutable long _n_solves;
+	mutable long _n_iters;
+	mutable double _sum_rsd_target;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_ADAPTIVE_TOLERANCE_SOLVER_H_ */
@@ -0,0 +1,94 @@
+/*
+ * block_fgmres_dense.h
+ */
+
+#ifndef INCLUDE_LATTICE_BLOCK_FGMRES_DENSE_H_
+#define INCLUDE_LATTICE_BLOCK_FGMRES_DENSE_H_
+
+#include <complex>
+#include <vector>
+
+namespace MG {
+
+	/*! Orthonormalize a block of vectors from its Gram matrix (SVQB)
+	 *
+	 *  Given G = W^H W for a block W of n vectors, with G = U L U^H, returns
+	 *
+	 *      T = U L^{-1/2}   so that  Q = W T  has orthonormal columns
+	 *      R = L^{1/2} U^H  so that  W = Q R
+	 *
+	 *  Directions with eigenvalues below drop_tol * max(L) are numerically dependent:
+	 *  their columns of T and rows of R are zeroed, so Q has zero columns there and
+	 *  W = Q R holds up to the dropped part. Unlike a Cholesky based QR this does not
+	 *  break down when a block becomes rank deficient, e.g. when some of the right hand
+	 *  sides of a block solve have converged and others have not.
+	 *
+	 *  R is not triangular. All matrices are n x n, column major.
+	 *
+	 *  \param G          the Gram matrix (Read)
+	 *  \param n          the block size
+	 *  \param drop_tol   relative eigenvalue cutoff
+	 *  \param T          the transformation to the orthonormal block (Write)
+	 *  \param R          the coefficients of W in the new block (Write)
+	 *  \param cond       if not null, max(L) / min(L) over the kept directions (Write).
+	 *                    Q is only orthonormal to about epsilon * cond of the vectors.
+	 *
+	 *  \return the number of directions kept
+	 */
+	int BlockOrthonormalizeGram(const std::complex<double>* G, int n, double drop_tol,
+			std::complex<double>* T, std::complex<double>* R, double* cond = nullptr);
+
+	/*! Block least squares problem of block FGMRES
+	 *
+	 *  Solves  min_Y || E - H Y ||_F  for the n_rows x n_cols block Hessenberg H and the
+	 *  n_rows x n_rhs right hand side E (= e_1 S). Each column of Y is the minimum norm
+	 *  solution, so rank deficient H (dropped directions) is fine.
+	 *
+	 *  All matrices are column major with the given leading dimensions.
+	 *
+	 *  \param H             the block Hessenberg matrix (Read)
+	 *  \param ld_H          its leading dimension
+	 *  \param E             the right hand sides (Read)
+	 *  \param ld_E          its leading dimension
+	 *  \param Y             n_cols x n_rhs, the solution (Write), leading dimension n_cols
+	 *  \param resid_norms   n_rhs residual norms || E_c - H Y_c || (Write)
+	 */
+	void BlockLeastSquares(const std::complex<double>* H, int ld_H, int n_rows, int n_cols,
+			const std::complex<double>* E, int ld_E, int n_rhs,
+			std::complex<double>* Y, double* resid_norms);
+
+	/*! Residual norms of the block FGMRES least squares problem, one block step at a time
+	 *
+	 *  Keeps a Householder QR of the block Hessenberg matrix H: a new block column is
+	 *  brought up to date with the reflectors of the previous ones, and then its 2p x p
+	 *  block on and below the diagonal is factored. The same reflectors applied to
+	 *  E = e_1 S give the residual norms of all the right hand sides, for O(j p^3)
+	 *  work in step j rather than a new O((j p)^3) factorization.
+	 *
+	 *  If H is rank deficient (dropped directions) the norms can be too small, and
+	 *  there is no solution to be had from the triangular factor: use
+	 *  BlockLeastSquares() for Y at the end of the cycle.
+	 */
+	class BlockHessenbergQR {
+	public:
+		BlockHessenbergQR() : _p(0), _n_blocks(0) {}
+
+		//! Start a cycle, for the p x p block S of E (column major)
+		void reset(const std::complex<double>* S, int p);
+
+		/*! Add the next block column of H (its first (j+2)p rows, from H_col with
+		 *  leading dimension ld_H) and get the p residual norms || E_c - H Y_c ||
+		 */
+		void addBlockColumn(const std::complex<double>* H_col, int ld_H, double* resid_norms);
+
+	private:
+		int _p;
+		int _n_blocks;
+		std::vector< std::vector<std::complex<double>> > _reflectors;  // the 2p x p packed QRs
+		std::vector< std::vector<std::complex<double>> > _coeffs;      // and their coefficients
+		std::vector<std::complex<double>> _QE;                         // Q^H E, p columns
+	};
+
+}
+
+#endif /* INCLUDE_LATTICE_BLOCK_FGMRES_DENSE_H_ */
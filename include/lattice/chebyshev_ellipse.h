@@ -0,0 +1,39 @@
+/*
+ * chebyshev_ellipse.h
+ */
+
+#ifndef INCLUDE_LATTICE_CHEBYSHEV_ELLIPSE_H_
+#define INCLUDE_LATTICE_CHEBYSHEV_ELLIPSE_H_
+
+#include <complex>
+
+namespace MG {
+
+	/*! The ellipse for a Chebyshev smoother from a short Arnoldi run
+	 *
+	 *  Computes the Ritz values of the m x m upper Hessenberg matrix H and fits the ellipse,
+	 *  symmetric about the real axis, on which the Chebyshev polynomial is built:
+	 *
+	 *      lambda_max = safety * max Re(theta),   lambda_min = lambda_max / lambda_ratio
+	 *      center     = (lambda_max + lambda_min)/2
+	 *      real semi axis a = (lambda_max - lambda_min)/2,  imaginary semi axis b = safety * max | Im(theta) |
+	 *
+	 *  and returns center and c2 = a^2 - b^2, the squared focal distance, which is negative
+	 *  when the ellipse is taller than it is wide. H is column major.
+	 *
+	 *  \param H             the Hessenberg matrix (Read)
+	 *  \param ld_H          its leading dimension
+	 *  \param m             its size
+	 *  \param lambda_ratio  lambda_max / lambda_min
+	 *  \param safety        factor by which the Ritz value extents are widened
+	 *  \param center        center of the ellipse (Write)
+	 *  \param c2            squared focal distance (Write)
+	 *  \param lambda_max    right end of the ellipse on the real axis (Write)
+	 */
+	void ChebyshevEllipse(const std::complex<double>* H, int ld_H, int m,
+			double lambda_ratio, double safety,
+			double& center, double& c2, double& lambda_max);
+
+}
+
+#endif /* INCLUDE_LATTICE_CHEBYSHEV_ELLIPSE_H_ */
@@ -0,0 +1,35 @@
+/*
+ * cholesky_qr.h
+ */
+
+#ifndef INCLUDE_LATTICE_CHOLESKY_QR_H_
+#define INCLUDE_LATTICE_CHOLESKY_QR_H_
+
+#include <complex>
+
+namespace MG {
+
+	/*! Orthonormalize the columns of a small dense matrix in place
+	 *
+	 *  V is n_rows x n_cols, column major. Uses CholeskyQR2: form G = V^H V,
+	 *  Cholesky factor G = R^H R and set V <- V R^{-1}, twice. This is two
+	 *  GEMM-like passes instead of n_cols^2 dot/axpy pairs.
+	 *
+	 *  The result is the same Q as Gram-Schmidt would give (R has a real
+	 *  positive diagonal). If the Cholesky breaks down (V too ill conditioned)
+	 *  we fall back to Householder QR with the phases fixed up to match.
+	 *
+	 *  Is serial: meant to be called by one thread per block.
+	 *
+	 *  \param V       the matrix (Read/Write)
+	 *  \param n_rows  number of rows
+	 *  \param n_cols  number of columns
+	 *
+	 *  \return true if CholeskyQR2 succeeded, false if the fallback was used.
+	 */
+	bool CholeskyQR2(std::complex<double>* V, int n_rows, int n_cols);
+
+}
+
+
+#endif /* INCLUDE_LATTICE_CHOLESKY_QR_H_ */
@@ -9,6 +9,7 @@
 #define INCLUDE_LATTICE_COARSE_AGGREGATE_BLOCK_COARSE_H_
 
 #include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_spinor_set.h"
 #include "lattice/coarse/coarse_op.h"
 #include "lattice/coarse/block.h"
 #include <vector>
@@ -45,8 +46,14 @@ void extractAggregate(CoarseSpinor& target, const CoarseSpinor& src, int aggr );
 //      This is because std::vector<> and multi1d need things which have default constructors. However, objects
 // 		such as CoarseSpinor need to take a reference to a LatticeInfo in construction. Is there a best practice/pattern
 // 		for creating containers of such objects.
+//
+//  Each (block, aggregate) is orthonormalized with CholeskyQR2 (see cholesky_qr.h),
+//  which is stable enough that a single call suffices.
 void orthonormalizeBlockAggregates(std::vector<std::shared_ptr<CoarseSpinor> >& vecs, const std::vector<Block>& block_list);
 
+//! Orthonormalize the vectors of a CoarseSpinorSet over the spin aggregates within the blocks
+void orthonormalizeBlockAggregates(CoarseSpinorSet& vecs, const std::vector<Block>& block_list);
+
 
 //! 'Restrict' a QDP++ spinor to a CoarseSpinor with the same geometry
 void restrictSpinor( const std::vector<Block>& blocklist, const std::vector<std::shared_ptr<CoarseSpinor > >& v, const CoarseSpinor& ferm_in, CoarseSpinor& out);
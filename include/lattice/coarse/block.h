@@ -65,6 +65,16 @@ public:
 		return _not_face[dir];
 	}
 
+	inline
+	const IndexArray& getOrigin(void) const {
+		return _origin;
+	}
+
+	inline
+	const IndexArray& getDimensions(void) const {
+		return _dimensions;
+	}
+
 	inline
 	bool isCreated(void) {
 		return _created;
@@ -106,6 +116,15 @@ void CreateBlockList(std::vector<Block>& blocklist,
 					const IndexArray& block_dimensions,
 					const IndexArray& local_lattice_origin);
 
+/** The in-block neighbours of the sites of a block
+ *
+ *  neighbors[8*i + mu] is the index in block.getCBSiteList() of the neighbour of site i
+ *  in direction mu (ordered X+, X-, Y+, Y-, Z+, Z-, T+, T- as the Dslash links), or -1
+ *  if the neighbour is outside the block. The local lattice boundary is never wrapped,
+ *  so a block restricted operator built on this needs no communication.
+ */
+void CreateBlockNeighborTable(const Block& block, std::vector<int>& neighbors);
+
 }
 
 
@@ -0,0 +1,87 @@
+/*
+ * coarse_correction.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_COARSE_CORRECTION_H_
+#define INCLUDE_LATTICE_COARSE_COARSE_CORRECTION_H_
+
+#include "lattice/solver.h"
+#include "lattice/gcr_common.h"
+#include "lattice/fine_qdpxx/mg_params_qdpxx.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
+#include "lattice/coarse/coarse_eo_wilson_clover_linear_operator.h"
+#include "lattice/coarse/invgcr_coarse.h"
+#include "lattice/coarse/invrichardson_coarse.h"
+#include "utils/print_utils.h"
+#include <memory>
+
+namespace MG {
+
+/** MakeCoarseCorrectionT
+ *
+ *  The coarse correction solver of a cycle, for the W- and K-cycle shapes in
+ *  VCycleParams::cycle_shape. M is the operator of the coarse level and next_cycle the
+ *  cycle from there to the next level down. For CYCLE_V this returns nullptr: the
+ *  recursive V-cycles then make their FGMRES bottom solver as before.
+ *
+ *  Cost per correction: a W-cycle does w_cycle_gamma next cycles and coarse operator
+ *  applications. A K-cycle does one or two next cycles, with the coarse operator
+ *  applications and reductions of two GCR steps at most. The V-cycle default does as many
+ *  as its FGMRES takes iterations, at least one.
+ */
+template<typename WSolverT, typename KSolverT, typename LinOpT>
+std::shared_ptr<const LinearSolver<CoarseSpinor,CoarseGauge>>
+MakeCoarseCorrectionT(const std::shared_ptr<const LinOpT>& M,
+		const VCycleParams& p,
+		const LinearSolver<CoarseSpinor,CoarseGauge>* next_cycle)
+{
+	const int level = M->GetLevel();
+
+	switch( p.cycle_shape ) {
+	case CYCLE_W:
+	{
+		LinearSolverParamsBase w_params;
+		w_params.MaxIter = p.w_cycle_gamma;
+		w_params.RsdTarget = 0;
+		w_params.VerboseP = p.bottom_solver_params.VerboseP;
+		MasterLog(INFO, "Coarse correction on level %d: W-cycle with gamma=%d", level, p.w_cycle_gamma);
+		return std::make_shared<const WSolverT>(M, w_params, next_cycle);
+	}
+	case CYCLE_K:
+	{
+		GCRParams k_params;
+		k_params.NKrylov = 2;
+		k_params.MaxIter = 2;
+		k_params.RsdTarget = p.k_cycle_rsd_target;
+		k_params.VerboseP = p.bottom_solver_params.VerboseP;
+		MasterLog(INFO, "Coarse correction on level %d: K-cycle with target=%g", level, p.k_cycle_rsd_target);
+		return std::make_shared<const KSolverT>(M, k_params, next_cycle);
+	}
+	default:
+		return nullptr;
+	}
+}
+
+inline
+std::shared_ptr<const LinearSolver<CoarseSpinor,CoarseGauge>>
+MakeCoarseCorrection(const std::shared_ptr<const CoarseWilsonCloverLinearOperator>& M,
+		const VCycleParams& p,
+		const LinearSolver<CoarseSpinor,CoarseGauge>* next_cycle)
+{
+	return MakeCoarseCorrectionT<RichardsonSolverCoarse,GCRSolverCoarse>(M, p, next_cycle);
+}
+
+// Even-odd levels solve the unpreconditioned system, like UnprecFGMRESSolverCoarseWrapper
+inline
+std::shared_ptr<const LinearSolver<CoarseSpinor,CoarseGauge>>
+MakeCoarseCorrection(const std::shared_ptr<const CoarseEOWilsonCloverLinearOperator>& M,
+		const VCycleParams& p,
+		const LinearSolver<CoarseSpinor,CoarseGauge>* next_cycle)
+{
+	return MakeCoarseCorrectionT<UnprecRichardsonSolverCoarseWrapper,UnprecGCRSolverCoarseWrapper>(M, p, next_cycle);
+}
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_COARSE_CORRECTION_H_ */
@@ -136,6 +136,11 @@ public:
 	const LatticeInfo& GetInfo(void) const override{
 		return _u->GetInfo();
 	}
+
+	// E.g. to assemble the unpreconditioned operator in the direct solver
+	const CoarseGauge& GetGauge(void) const {
+		return *_u;
+	}
 private:
 	const std::shared_ptr<Gauge> _u;
 	const CoarseDiracOp _the_op;
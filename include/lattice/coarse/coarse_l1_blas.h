@@ -10,11 +10,20 @@
 
 #include <complex>
 #include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_spinor_set.h"
 #include "lattice/coarse/subset.h"
 using namespace MG;
 
 namespace MG {
 
+namespace GlobalComm {
+	// Sums over the nodes, in place. Nothing to do on a single node.
+	void GlobalSum( double& my_summand );
+	void GlobalSum( double* array, int array_length );
+}
+
+class ThreadPartition;
+
 // x = x - y; followed by || x ||
 double XmyNorm2Vec(CoarseSpinor& x, const CoarseSpinor& y, const CBSubset& subset=SUBSET_ALL);
 double Norm2Vec(const CoarseSpinor& x, const CBSubset& subset = SUBSET_ALL);
@@ -22,6 +31,8 @@ std::complex<double> InnerProductVec(const CoarseSpinor& x, const CoarseSpinor&
 
 void ZeroVec(CoarseSpinor& x, const CBSubset& subset=SUBSET_ALL);
 void CopyVec(CoarseSpinor& x, const CoarseSpinor& y, const CBSubset& subset=SUBSET_ALL);
+//! There is only one coarse precision, so this is a copy. For generic mixed precision code.
+void ConvertSpinor(const CoarseSpinor& in, CoarseSpinor& out, const CBSubset& subset=SUBSET_ALL);
 void ScaleVec(const float alpha, CoarseSpinor& x, const CBSubset& subset=SUBSET_ALL);
 void ScaleVec(const std::complex<float>& alpha, CoarseSpinor& x, const CBSubset& subset=SUBSET_ALL);
 void AxpyVec(const std::complex<float>& alpha, const CoarseSpinor& x, CoarseSpinor& y, const CBSubset& subset=SUBSET_ALL);
@@ -44,6 +55,107 @@ void BiCGStabXUpdate(const std::complex<float>& omega,
 					 const CoarseSpinor& p,
 					 CoarseSpinor& x, const CBSubset& subset=SUBSET_ALL);
 
+/* The fused steps of pipelined BiCGStab, each one sweep and one global reduction:
+ *
+ * PipeBiCGStabDirUpdate:
+ *   p = r + beta (p - omega s),  s = w + beta (s - omega z),  z = t + beta (z - omega v)
+ *   q = r - alpha s,  y = w - alpha z,  and returns < y | q > and || y ||^2
+ *
+ * PipeBiCGStabSolUpdate:
+ *   x += alpha p + omega q,  r = q - omega y,  w = y - omega (t - alpha v)
+ *   and returns r0_dots[] = { < r0 | r >, < r0 | w >, < r0 | s >, < r0 | z > } and || r ||^2
+ */
+void PipeBiCGStabDirUpdate(const std::complex<double>& alpha,
+					 const std::complex<double>& beta,
+					 const std::complex<double>& omega,
+					 const CoarseSpinor& r, const CoarseSpinor& w,
+					 const CoarseSpinor& t, const CoarseSpinor& v,
+					 CoarseSpinor& p, CoarseSpinor& s, CoarseSpinor& z,
+					 CoarseSpinor& q, CoarseSpinor& y,
+					 std::complex<double>& y_dot_q, double& y_norm2,
+					 const CBSubset& subset=SUBSET_ALL);
+
+void PipeBiCGStabSolUpdate(const std::complex<double>& alpha,
+					 const std::complex<double>& omega,
+					 const CoarseSpinor& p, const CoarseSpinor& q, const CoarseSpinor& y,
+					 const CoarseSpinor& t, const CoarseSpinor& v,
+					 const CoarseSpinor& r0, const CoarseSpinor& s, const CoarseSpinor& z,
+					 CoarseSpinor& x, CoarseSpinor& r, CoarseSpinor& w,
+					 std::complex<double>* r0_dots, double& r_norm2,
+					 const CBSubset& subset=SUBSET_ALL);
+
+/* The fused step of the Chebyshev smoother, one sweep and no reductions:
+ *   x += d,  r -= Ad,  d = a d + b r
+ */
+void ChebyshevUpdate(const double a, const double b,
+					 const CoarseSpinor& Ad,
+					 CoarseSpinor& d, CoarseSpinor& r, CoarseSpinor& x,
+					 const CBSubset& subset=SUBSET_ALL);
+
+/* Kernels for persistent parallel regions (see SpinTeam in thread_team.h).
+ * Every thread of the team calls them with the same arguments, and each works on its
+ * own sites in partition, like the kernels above, but without opening a parallel region.
+ * They do not synchronise: the reductions return the part of the calling thread, for
+ * SpinTeam::Sum, and the caller puts in a SpinTeam::Barrier where a thread needs sites
+ * another one wrote. Look the partition up with GetThreadPartition() before the region.
+ */
+void ZeroVecInTeam(const ThreadPartition& partition, CoarseSpinor& x, const CBSubset& subset=SUBSET_ALL);
+void CopyVecInTeam(const ThreadPartition& partition, CoarseSpinor& x, const CoarseSpinor& y,
+					const CBSubset& subset=SUBSET_ALL);
+void AxpyVecInTeam(const ThreadPartition& partition, const std::complex<float>& alpha,
+					const CoarseSpinor& x, CoarseSpinor& y, const CBSubset& subset=SUBSET_ALL);
+//! The part of || x ||^2 on the sites of the calling thread
+double Norm2VecInTeam(const ThreadPartition& partition, const CoarseSpinor& x, const CBSubset& subset=SUBSET_ALL);
+//! The parts of < x | y > and of || x ||^2 on the sites of the calling thread
+std::complex<double> InnerProductNorm2VecInTeam(const ThreadPartition& partition,
+					const CoarseSpinor& x, const CoarseSpinor& y, double& norm2_x,
+					const CBSubset& subset=SUBSET_ALL);
+
+/* Block BLAS on the first n_vecs vectors of a CoarseSpinorSet.
+ * These do one sweep over the slab and one global reduction,
+ * rather than n_vecs separate level 1 calls.
+ */
+
+//! iprods[j] = < x_j | y >
+void InnerProductMultiVec(const CoarseSpinorSet& x, int n_vecs, const CoarseSpinor& y,
+					std::complex<double>* iprods, const CBSubset& subset=SUBSET_ALL);
+
+//! iprods[j] = < x_j | y > and norm2_y = || y ||^2 in a single global reduction
+void InnerProductNorm2MultiVec(const CoarseSpinorSet& x, int n_vecs, const CoarseSpinor& y,
+					std::complex<double>* iprods, double& norm2_y, const CBSubset& subset=SUBSET_ALL);
+
+//! y += sum_j alpha[j] x_j
+void AxpyMultiVec(const std::complex<double>* alpha, const CoarseSpinorSet& x, int n_vecs,
+					CoarseSpinor& y, const CBSubset& subset=SUBSET_ALL);
+
+//! iprods[i + n_x*j] = < x_i | y_j > (column major), in a single global reduction
+void InnerProductBlockVec(const CoarseSpinorSet& x, int n_x, const CoarseSpinorSet& y, int n_y,
+					std::complex<double>* iprods, const CBSubset& subset=SUBSET_ALL);
+
+//! y_j += sum_i alpha[i + n_x*j] x_i
+void AxpyBlockVec(const std::complex<double>* alpha, const CoarseSpinorSet& x, int n_x,
+					CoarseSpinorSet& y, int n_y, const CBSubset& subset=SUBSET_ALL);
+
+//! G[i + n_vecs*j] = < x_i | x_j > (column major)
+void GramMatrix(const CoarseSpinorSet& x, int n_vecs, std::complex<double>* G,
+					const CBSubset& subset=SUBSET_ALL);
+
+/* Per vector BLAS on the first n_vecs vectors of sets holding one right hand side
+ * each, e.g. in the multi right hand side V-cycle: vector j of x goes with vector j
+ * of y, and has its own scalar. One sweep and one global reduction for all of them.
+ */
+
+//! norm2[j] = || x_j ||^2
+void Norm2EachVec(const CoarseSpinorSet& x, int n_vecs, double* norm2,
+					const CBSubset& subset=SUBSET_ALL);
+
+//! iprods[j] = < x_j | y_j > and norm2_x[j] = || x_j ||^2
+void InnerProductNorm2EachVec(const CoarseSpinorSet& x, const CoarseSpinorSet& y, int n_vecs,
+					std::complex<double>* iprods, double* norm2_x, const CBSubset& subset=SUBSET_ALL);
+
+//! y_j += alpha[j] x_j
+void AxpyEachVec(const std::complex<double>* alpha, const CoarseSpinorSet& x,
+					CoarseSpinorSet& y, int n_vecs, const CBSubset& subset=SUBSET_ALL);
 
 }
 
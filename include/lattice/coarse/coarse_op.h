@@ -13,9 +13,12 @@
 #include "lattice/cmat_mult.h"
 #include "lattice/coarse/coarse_types.h"
 #include "lattice/coarse/thread_limits.h"
+#include "lattice/coarse/thread_partition.h"
+#include "lattice/coarse/block.h"
 #include "lattice/halo.h"
 #include "coarse_l1_blas.h"
 #include <omp.h>
+#include <vector>
 namespace MG {
 
 
@@ -25,7 +28,7 @@ public:
 	CoarseDiracOp(const LatticeInfo& l_info, IndexType n_smt = 1);
 
 
-	~CoarseDiracOp() {}
+	~CoarseDiracOp();
 
 
 
@@ -60,6 +63,32 @@ public:
 			const IndexType dagger,
 			const IndexType tid) const ;
 
+	// unprecOp on the first n_vecs vectors of a set. Each site is visited once:
+	// its links are loaded (and expanded, if stored in 16 bits) once and each
+	// element is applied to a tile of 8 vectors at a time
+	void unprecOpMulti(CoarseSpinorSet& spinor_out,
+			const CoarseGauge& gauge_clov_in,
+			const CoarseSpinorSet& spinor_in,
+			const int n_vecs,
+			const IndexType target_cb,
+			const IndexType dagger,
+			const IndexType tid) const ;
+
+	/** The operator restricted to one block, with zero (Dirichlet) boundaries
+	 *
+	 *  block_in and block_out hold the sites of the block in the order of sites
+	 *  (a Block's getCBSiteList()), n_complex*n_colorspin floats each, and
+	 *  neighbors is the block's table from CreateBlockNeighborTable(). The couplings
+	 *  to sites outside the block are dropped, so there is no halo exchange.
+	 *  This is called by one thread per block and is not itself threaded.
+	 */
+	void blockUnprecOp(float* block_out,
+			const CoarseGauge& gauge_clov_in,
+			const float* block_in,
+			const std::vector<CBSite>& sites,
+			const std::vector<int>& neighbors,
+			const IndexType dagger) const;
+
 	// Apply Diagonal part with U, or apply M_ee/oo
 	void M_diag(CoarseSpinor& spinor_out,
 			const CoarseGauge& gauge_clov_in,
@@ -291,6 +320,13 @@ public:
 						  const float* input,
 						  const IndexType dagger) const ;
 
+	// outputs[v] = clover input[v][0] + sum_mu link_mu input[v][mu+1], for n_vecs <= 8 vectors
+	void siteApplyMulti( float* const outputs[],
+						  const float* const matrices[9],
+						  const float* const inputs[][9],
+						  const int n_vecs,
+						  const IndexType dagger) const ;
+
 
 	void DslashDir(CoarseSpinor& spinor_out,
 						const CoarseGauge& gauge_in,
@@ -332,6 +368,22 @@ public:
 
 
 private:
+	/* The sites of thread tid. In a team of another size than the one at construction,
+	 * e.g. a nested subteam of AdditiveVCycleCoarse, the sites are split over that team.
+	 */
+	inline
+	void getSiteRange(IndexType tid, IndexType& min_site, IndexType& max_site) const
+	{
+		const int n_threads = omp_get_num_threads();
+		if( n_threads == _n_threads ) {
+			min_site = _thread_limits[tid].min_site;
+			max_site = _thread_limits[tid].max_site;
+		}
+		else {
+			ThreadPartition::SplitSites(_lattice_info.GetNumCBSites(), n_threads, tid, min_site, max_site);
+		}
+	}
+
 	const LatticeInfo& _lattice_info;
 	const IndexType _n_color;
 	const IndexType _n_spin;
@@ -353,6 +405,7 @@ private:
 
 	mutable  SpinorHaloCB _halo;
 	mutable CoarseSpinor _tmpvec;
+	float* _zero_site;
 
 };
 
@@ -0,0 +1,38 @@
+/*
+ * coarse_precision.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_COARSE_PRECISION_H_
+#define INCLUDE_LATTICE_COARSE_COARSE_PRECISION_H_
+
+#include "lattice/constants.h"
+#include <cstdint>
+
+namespace MG {
+
+	/** Storage precision of the links of a coarse level
+	 *
+	 *  COARSE_PREC_FP32 - single precision, as computed
+	 *  COARSE_PREC_FP16 - IEEE half precision: 11 bit mantissa, range up to 65504
+	 *  COARSE_PREC_BF16 - bfloat16: 8 bit mantissa, the range of FP32
+	 *
+	 *  The 16 bit formats halve the memory traffic for the links, which dominates
+	 *  the coarse operator. The arithmetic is always done in FP32.
+	 */
+	enum CoarsePrecision { COARSE_PREC_FP32=0, COARSE_PREC_FP16, COARSE_PREC_BF16 };
+
+	const char* CoarsePrecisionName(CoarsePrecision prec);
+
+	/** Convert n floats to 16 bit numbers of precision prec (FP16 or BF16), with round
+	 *  to nearest even. FP16 overflows to +/-inf above 65504.
+	 */
+	void ConvertToHalf(uint16_t* out, const float* in, IndexType n, CoarsePrecision prec);
+
+	/** Convert n 16 bit numbers of precision prec (FP16 or BF16) to floats. This is exact.
+	 *  Uses the F16C instructions for FP16 if they are enabled in the compiler.
+	 */
+	void ConvertFromHalf(float* out, const uint16_t* in, IndexType n, CoarsePrecision prec);
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_COARSE_PRECISION_H_ */
@@ -0,0 +1,132 @@
+/*
+ * coarse_spinor_set.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_COARSE_SPINOR_SET_H_
+#define INCLUDE_LATTICE_COARSE_COARSE_SPINOR_SET_H_
+
+#include "lattice/constants.h"
+#include "lattice/lattice_info.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/thread_partition.h"
+#include "lattice/spinor_set.h"
+#include "utils/memory.h"
+#include <vector>
+#include <memory>
+
+namespace MG {
+
+	/** CoarseSpinorSet
+	 *  \param LatticeInfo
+	 *  \param n_vecs
+	 *
+	 *  Holds n_vecs CoarseSpinors in a single allocation. The layout is vector major:
+	 *  vector j starts GetVecStride()*j floats into the slab and is laid out exactly
+	 *  like a stand-alone CoarseSpinor (checkerboards, padding and all). So operator[]
+	 *  hands out CoarseSpinor views which work with every existing CoarseSpinor
+	 *  routine, while the block BLAS in coarse_l1_blas.h sweeps the slab directly.
+	 *
+	 *  Destruction frees memory. Views must not outlive the set.
+	 */
+	template<>
+	class SpinorSet<CoarseSpinor> {
+	public:
+		SpinorSet(const LatticeInfo& info, int n_vecs) : _info(info), _n_vecs(n_vecs),
+				_vec_stride(CoarseSpinor::GetNumFloatsAllocated(info)), _data(nullptr), _vecs(n_vecs)
+		{
+			if( n_vecs <= 0 ) {
+				MasterLog(ERROR, "Attempting to create CoarseSpinorSet with n_vecs=%d", n_vecs);
+			}
+
+			_data = (float *)MG::MemoryAllocate(_n_vecs*_vec_stride*sizeof(float), MG::REGULAR);
+
+			for(int i=0; i < _n_vecs; ++i) {
+				_vecs[i].reset( new CoarseSpinor(info, _data + i*_vec_stride) );
+			}
+
+			// First touch with the ThreadPartition, as for a stand alone CoarseSpinor
+			const ThreadPartition& partition = GetThreadPartition(info);
+			const IndexType n_floats_per_site = n_complex*_vecs[0]->GetNumColorSpin();
+#pragma omp parallel
+			{
+				IndexType min_site, max_site;
+				partition.GetMySiteRange(min_site, max_site);
+				const IndexType num_floats = (max_site - min_site)*n_floats_per_site;
+				for(int i=0; i < _n_vecs; ++i) {
+					for(int cb=0; cb < n_checkerboard; ++cb) {
+						float* cb_data = _vecs[i]->GetCBDataPtr(cb) + min_site*n_floats_per_site;
+#pragma omp simd
+						for(IndexType j=0; j < num_floats; ++j) {
+							cb_data[j] = 0;
+						}
+					}
+				}
+			}
+		}
+
+		SpinorSet(const SpinorSet<CoarseSpinor>&) = delete;
+		SpinorSet<CoarseSpinor>& operator=(const SpinorSet<CoarseSpinor>&) = delete;
+
+		~SpinorSet()
+		{
+			_vecs.clear();
+			MemoryFree(_data);
+			_data = nullptr;
+		}
+
+		inline
+		CoarseSpinor& operator[](int i) { return *(_vecs[i]); }
+
+		inline
+		const CoarseSpinor& operator[](int i) const { return *(_vecs[i]); }
+
+		inline
+		int GetNumVecs() const { return _n_vecs; }
+
+		inline
+		const LatticeInfo& GetInfo() const { return _info; }
+
+		/** GetVecStride
+		 *
+		 *  The distance in floats between the starts of consecutive vectors
+		 */
+		inline
+		IndexType GetVecStride() const { return _vec_stride; }
+
+		inline
+		float* GetVecDataPtr(int i) { return _data + i*_vec_stride; }
+
+		inline
+		const float* GetVecDataPtr(int i) const { return _data + i*_vec_stride; }
+
+	private:
+		const LatticeInfo& _info;
+		const int _n_vecs;
+		const IndexType _vec_stride;
+		float* _data;
+		std::vector<std::unique_ptr<CoarseSpinor>> _vecs;
+	};
+
+	using CoarseSpinorSet = SpinorSet<CoarseSpinor>;
+
+	/** GetScratchSet
+	 *
+	 *  Returns a set of at least n_vecs vectors held in set, for scratch space that
+	 *  is kept between calls (e.g. by the MultiSolve of a solver). The set is only
+	 *  reallocated when it is missing or too small, so callers must only use its
+	 *  first n_vecs vectors.
+	 */
+	inline
+	CoarseSpinorSet& GetScratchSet(std::unique_ptr<CoarseSpinorSet>& set, const LatticeInfo& info, int n_vecs)
+	{
+		if( !set || set->GetNumVecs() < n_vecs ) {
+			set.reset( new CoarseSpinorSet(info, n_vecs) );
+		}
+		return *set;
+	}
+
+}
+
+
+
+#endif /* INCLUDE_LATTICE_COARSE_COARSE_SPINOR_SET_H_ */
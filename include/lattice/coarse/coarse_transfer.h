@@ -18,10 +18,13 @@
 #include "MG_config.h"
 #include <lattice/qphix/qphix_veclen.h>
 #include <lattice/coarse/coarse_types.h>
+#include <lattice/coarse/coarse_spinor_set.h>
+#include <lattice/coarse/thread_partition.h>
 #include "lattice/qphix/qphix_types.h"
 #include <lattice/coarse/block.h>
 #include <utils/print_utils.h>
 
+#include <algorithm>
 #include <vector>
 #include <memory>
 
@@ -38,9 +41,43 @@ public:
 
 	CoarseTransfer(const std::vector<Block>& blocklist,
 			const std::vector<std::shared_ptr<CoarseSpinor> >& vectors, int r_threads_per_block = 1)
-	  	  	  	  	  : _n_blocks(blocklist.size()),  _n_vecs(vectors.size()), _blocklist(blocklist), _vecs(vectors),
+	  	  	  	  	  : _n_blocks(blocklist.size()),  _n_vecs(vectors.size()), _blocklist(blocklist),
 						_r_threads_per_block(r_threads_per_block) {
 
+		if( _n_vecs == 0 ) {
+			MasterLog(ERROR, "Attempting to create transfer operator without any vectors.");
+		}
+
+		ImportVectors(vectors[0]->GetInfo(), [&vectors](int v, const CBSite& s) {
+			return vectors[v]->GetSiteDataPtr(s.cb, s.site);
+		});
+	}
+
+	/** Construct from a CoarseSpinorSet
+	 *
+	 *  The vectors are read straight out of the slab, so for a given fine site
+	 *  the import walks the set with a fixed stride rather than chasing pointers.
+	 */
+	CoarseTransfer(const std::vector<Block>& blocklist,
+			const CoarseSpinorSet& vectors, int r_threads_per_block = 1)
+	  	  	  	  	  : _n_blocks(blocklist.size()),  _n_vecs(vectors.GetNumVecs()), _blocklist(blocklist),
+						_r_threads_per_block(r_threads_per_block) {
+
+		const IndexType vec_stride = vectors.GetVecStride();
+		const CoarseSpinor& v0 = vectors[0];
+		ImportVectors(vectors.GetInfo(), [&v0,vec_stride](int v, const CBSite& s) {
+			return v0.GetSiteDataPtr(s.cb, s.site) + v*vec_stride;
+		});
+	}
+
+private:
+	/* Copy the vectors into _data and set up the reverse maps.
+	 * site_ptr(v, cbsite) must return the site data of vector v
+	 */
+	template<typename SitePtrFunc>
+	void ImportVectors(const LatticeInfo& fine_info, const SitePtrFunc& site_ptr)
+	{
+		const std::vector<Block>& blocklist = _blocklist;
 
 		if ( blocklist.size() > 0 ) {
 			_sites_per_block = blocklist[0].getNumSites();
@@ -50,11 +87,6 @@ public:
 		}
 
 
-		if( _vecs.size() == 0 ) {
-			MasterLog(ERROR, "Attempting to create transfer operator without any vectors.");
-		}
-
-		const LatticeInfo& fine_info = vectors[0]->GetInfo();
 
 		num_fine_color = fine_info.GetNumColors();
 		int num_coarse_color = _n_vecs;
@@ -92,7 +124,7 @@ public:
 					// Copy components  into  (n_num_fine_color x num_coarse_colorspin )
 					for(int v=0; v < _n_vecs; ++v) {
 
-						const float* vsite = vectors[v]->GetSiteDataPtr(fine_cbsite.cb, fine_cbsite.site);
+						const float* vsite = site_ptr(v, fine_cbsite);
 
 
 
@@ -154,6 +186,7 @@ public:
 		}
 	}
 
+public:
 	inline
 	float& index(int block, int blocksite,  int color, int chiral, int vec, int REIM)
 	{
@@ -195,10 +228,16 @@ public:
 	  assert( _n_vecs == num_coarse_color );
 	  assert( num_coarse_cbsites == _n_blocks/2);
 
-	  // This will be a loop over blocks
-#pragma omp parallel for collapse(2)
+	  // This will be a loop over blocks: each thread takes the coarse sites
+	  // it owns in the ThreadPartition of the coarse lattice
+	  const ThreadPartition& partition = GetThreadPartition(out.GetInfo());
+#pragma omp parallel
+	  {
+	  IndexType min_site, max_site;
+	  partition.GetMySiteRange(min_site, max_site);
+
 	  for(int block_cb = 0; block_cb < n_checkerboard; ++block_cb ) {
-	    for(int block_cbsite = 0 ; block_cbsite < num_coarse_cbsites; ++block_cbsite) {
+	    for(int block_cbsite = min_site ; block_cbsite < max_site; ++block_cbsite) {
 
 	      // Identify the current block.
 	      int block_idx = block_cbsite + block_cb*num_coarse_cbsites;
@@ -268,6 +307,7 @@ public:
 	      }
 	    }// block CBSITE
 	  } // block CB
+	  } // omp parallel
 	}
 
 
@@ -288,10 +328,16 @@ public:
 	  assert( _n_vecs == num_coarse_color );
 	  assert( num_coarse_cbsites == _n_blocks/2);
 
-	  // This will be a loop over blocks
-#pragma omp parallel for collapse(2)
+	  // This will be a loop over blocks: each thread takes the coarse sites
+	  // it owns in the ThreadPartition of the coarse lattice
+	  const ThreadPartition& partition = GetThreadPartition(out.GetInfo());
+#pragma omp parallel
+	  {
+	  IndexType min_site, max_site;
+	  partition.GetMySiteRange(min_site, max_site);
+
 	  for(int block_cb = 0; block_cb < n_checkerboard; ++block_cb ) {
-		  for(int block_cbsite = 0 ; block_cbsite < num_coarse_cbsites; ++block_cbsite) {
+		  for(int block_cbsite = min_site ; block_cbsite < max_site; ++block_cbsite) {
 
 			  // Identify the current block.
 			  int block_idx = block_cbsite + block_cb*num_coarse_cbsites;
@@ -362,6 +408,7 @@ public:
 			  }
 		  }// block CBSITE
 	  } // block CB
+	  } // omp parallel
   }
 #else
   template<int num_coarse_color>
@@ -384,16 +431,20 @@ public:
     assert( num_coarse_cbsites == _n_blocks/2);
     
     
+    // The team of the parallel regions below: this may be a level team smaller than
+    // the one at construction (see ThreadTeamScope)
+    int r_block_threads = std::max(omp_get_max_threads() / _r_threads_per_block, 1);
+    const int n_threads = r_block_threads*_r_threads_per_block;
+
     // Threasd can accumulate in here
-    float site_accum[ n_floats*_n_threads] __attribute__((aligned(64)));
+    float site_accum[ n_floats*n_threads] __attribute__((aligned(64)));
 
-    int r_block_threads = _n_threads / _r_threads_per_block;
     int n_steps = _n_blocks / r_block_threads;
     if ( _n_blocks % r_block_threads != 0  ) n_steps++; // Round steps to ceiling 
 
     for(int step = 0; step < n_steps; ++step) {
 
-#pragma omp parallel shared(site_accum, r_block_threads)
+#pragma omp parallel shared(site_accum, r_block_threads) num_threads(n_threads)
       {
 	int tid = omp_get_thread_num();
 
@@ -478,7 +529,7 @@ public:
       } // Parallel region -- implied barrier
 
 #if 0
-#pragma omp parallel shared(site_accum,r_block_threads)
+#pragma omp parallel shared(site_accum,r_block_threads) num_threads(n_threads)
       {
 	int tid = omp_get_thread_num();
 	int block_tid = tid / _r_threads_per_block;
@@ -560,16 +611,19 @@ public:
 	  assert( num_coarse_cbsites == _n_blocks/2);
 
 
+	  // The team of the parallel regions below, as above
+	  int r_block_threads = std::max(omp_get_max_threads() / _r_threads_per_block, 1);
+	  const int n_threads = r_block_threads*_r_threads_per_block;
+
 	  // Threasd can accumulate in here
-	  float site_accum[ n_floats*_n_threads] __attribute__((aligned(64)));
+	  float site_accum[ n_floats*n_threads] __attribute__((aligned(64)));
 
-	  int r_block_threads = _n_threads / _r_threads_per_block;
 	  int n_steps = _n_blocks / r_block_threads;
 	  if ( _n_blocks % r_block_threads != 0  ) n_steps++; // Round steps to ceiling
 
 	  for(int step = 0; step < n_steps; ++step) {
 
-#pragma omp parallel shared(site_accum, r_block_threads)
+#pragma omp parallel shared(site_accum, r_block_threads) num_threads(n_threads)
 		  {
 			  int tid = omp_get_thread_num();
 
@@ -657,7 +711,7 @@ public:
 		  } // Parallel region -- implied barrier
 
 #if 0
-#pragma omp parallel shared(site_accum,r_block_threads)
+#pragma omp parallel shared(site_accum,r_block_threads) num_threads(n_threads)
 		  {
 			  int tid = omp_get_thread_num();
 			  int block_tid = tid / _r_threads_per_block;
@@ -799,11 +853,16 @@ public:
     assert( num_coarse_color == coarse_info.GetNumColors());
     assert( num_fine_color == fine_info.GetNumColors());
 
-    const int num_fine_cbsites = fine_info.GetNumCBSites();
+    // Each thread takes the fine sites it owns in the ThreadPartition of the fine lattice
+    const ThreadPartition& partition = GetThreadPartition(fine_info);
+
+#pragma omp parallel
+    {
+    IndexType min_site, max_site;
+    partition.GetMySiteRange(min_site, max_site);
 
-#pragma omp parallel for collapse(2)
     for(int cb =0; cb < n_checkerboard; ++cb) {
-    	for(int fsite=0; fsite < num_fine_cbsites; ++fsite) {
+    	for(int fsite=min_site; fsite < max_site; ++fsite) {
 
 
 
@@ -845,6 +904,7 @@ public:
     	} // fsite
 
     }  // cb
+    } // omp parallel
   } // function
 
   template<int num_coarse_color>
@@ -857,12 +917,17 @@ public:
      assert( num_coarse_color == coarse_info.GetNumColors());
      assert( num_fine_color == fine_info.GetNumColors());
 
-     const int num_fine_cbsites = fine_info.GetNumCBSites();
-
      int cb=target_cb;
 
-#pragma omp parallel for
-     	for(int fsite=0; fsite < num_fine_cbsites; ++fsite) {
+     // Each thread takes the fine sites it owns in the ThreadPartition of the fine lattice
+     const ThreadPartition& partition = GetThreadPartition(fine_info);
+
+#pragma omp parallel
+     {
+     	IndexType min_site, max_site;
+     	partition.GetMySiteRange(min_site, max_site);
+
+     	for(int fsite=min_site; fsite < max_site; ++fsite) {
 
 
 
@@ -902,6 +967,7 @@ public:
 
      		} // fcolor
      	} // fsite
+     } // omp parallel
    } // function
 
 
@@ -1221,6 +1287,132 @@ public:
   	  return;
     }
 
+  /** RMulti
+   *
+   *  R on the first n_rhs vectors of fine_in, into those of out. For each fine site and
+   *  color the row of transfer vectors is read once and applied to all the right hand
+   *  sides, so the vectors are streamed once per batch instead of once per vector.
+   *  The accumulators of a coarse site are n_rhs x 2 x num_coarse_color complexes.
+   */
+  void RMulti(const CoarseSpinorSet& fine_in, int n_rhs, CoarseSpinorSet& out) const
+  {
+	  const int num_coarse_color = out.GetInfo().GetNumColors();
+	  const int num_coarse_cbsites = out.GetInfo().GetNumCBSites();
+	  const int num_coarse_colorspin = 2*num_coarse_color;
+
+	  assert( _n_vecs == num_coarse_color );
+	  assert( num_coarse_cbsites == _n_blocks/2);
+
+	  const ThreadPartition& partition = GetThreadPartition(out.GetInfo());
+#pragma omp parallel
+	  {
+	  IndexType min_site, max_site;
+	  partition.GetMySiteRange(min_site, max_site);
+
+	  std::vector<std::complex<float>> accum(n_rhs*num_coarse_colorspin);
+
+	  for(int block_cb = 0; block_cb < n_checkerboard; ++block_cb ) {
+	    for(int block_cbsite = min_site ; block_cbsite < max_site; ++block_cbsite) {
+
+	      int block_idx = block_cbsite + block_cb*num_coarse_cbsites;
+	      const Block& block = _blocklist[block_idx];
+	      auto block_sitelist = block.getCBSiteList();
+	      auto num_sites_in_block = block_sitelist.size();
+
+	      for(int i=0; i < n_rhs*num_coarse_colorspin; ++i) {
+	    	  accum[i] = 0;
+	      }
+
+	      for( IndexType fine_site_idx = 0; fine_site_idx < static_cast<IndexType>(num_sites_in_block); fine_site_idx++ ) {
+	    	  const CBSite& fine_cbsite = block_sitelist[fine_site_idx];
+
+	    	  for(int f_color=0; f_color < num_fine_color; ++f_color) {
+	    		  const std::complex<float>* v = reinterpret_cast<const std::complex<float>*>((*this).indexPtr(block_idx, fine_site_idx,f_color));
+
+	    		  for(int rhs=0; rhs < n_rhs; ++rhs) {
+	    			  const std::complex<float>* fine_cbsite_data = reinterpret_cast<const std::complex<float>*>(
+	    					  fine_in[rhs].GetSiteDataPtr(fine_cbsite.cb, fine_cbsite.site));
+	    			  const std::complex<float> psi_upper(fine_cbsite_data[f_color]);
+	    			  const std::complex<float> psi_lower(fine_cbsite_data[f_color + num_fine_color]);
+	    			  std::complex<float>* site_accum = accum.data() + rhs*num_coarse_colorspin;
+
+#pragma omp simd
+	    			  for(int c_color=0; c_color < num_coarse_color; c_color++) {
+	    				  site_accum[c_color] += v[c_color]*psi_upper;
+	    			  }
+#pragma omp simd
+	    			  for(int c_color=0; c_color < num_coarse_color; c_color++) {
+	    				  site_accum[c_color+num_coarse_color] += v[c_color+num_coarse_color]*psi_lower;
+	    			  }
+	    		  } // rhs
+	    	  } // f_color
+	      } // fine sites in block
+
+	      for(int rhs=0; rhs < n_rhs; ++rhs) {
+	    	  std::complex<float>* coarse_site_spinor = reinterpret_cast<std::complex<float>*>(out[rhs].GetSiteDataPtr(block_cb,block_cbsite));
+	    	  const std::complex<float>* site_accum = accum.data() + rhs*num_coarse_colorspin;
+	    	  for(int colorspin=0; colorspin < num_coarse_colorspin; ++colorspin) {
+	    		  coarse_site_spinor[colorspin] = site_accum[colorspin];
+	    	  }
+	      }
+	    } // block_cbsite
+	  } // block_cb
+	  } // omp parallel
+  }
+
+  /** PMulti
+   *
+   *  P on the first n_rhs vectors of coarse_in, into those of fine_out, reading each
+   *  row of transfer vectors once for all the right hand sides (see RMulti).
+   */
+  void PMulti(const CoarseSpinorSet& coarse_in, int n_rhs, CoarseSpinorSet& fine_out) const
+  {
+	  const LatticeInfo& fine_info = fine_out.GetInfo();
+	  const LatticeInfo& coarse_info = coarse_in.GetInfo();
+	  const int num_coarse_color = coarse_info.GetNumColors();
+
+	  assert( num_fine_color == fine_info.GetNumColors());
+
+	  const ThreadPartition& partition = GetThreadPartition(fine_info);
+#pragma omp parallel
+	  {
+	  IndexType min_site, max_site;
+	  partition.GetMySiteRange(min_site, max_site);
+
+	  for(int cb =0; cb < n_checkerboard; ++cb) {
+		  for(int fsite=min_site; fsite < max_site; ++fsite) {
+			  int block_cb = reverse_map[cb][fsite].cb;
+			  int block_cbsite = reverse_map[cb][fsite].site;
+			  int block_idx = block_cbsite + block_cb * coarse_info.GetNumCBSites();
+			  int fine_site_idx = reverse_transfer_row[cb][fsite];
+
+			  for(int fcolor=0; fcolor < num_fine_color; ++fcolor ) {
+				  const std::complex<float>* v =
+						  reinterpret_cast<const std::complex<float>*>((*this).indexPtr(block_idx, fine_site_idx,fcolor));
+
+				  for(int rhs=0; rhs < n_rhs; ++rhs) {
+					  const std::complex<float>* coarse_site_spinor =
+							  reinterpret_cast<const std::complex<float>*>(coarse_in[rhs].GetSiteDataPtr(block_cb,block_cbsite));
+					  std::complex<float>* fine_site_data = reinterpret_cast<std::complex<float>*>(fine_out[rhs].GetSiteDataPtr(cb,fsite));
+
+					  std::complex<float> reduce_upper(0,0);
+					  std::complex<float> reduce_lower(0,0);
+					  for(int i=0; i < num_coarse_color; ++i) {
+						  reduce_upper += conj( v[i]) * coarse_site_spinor[i];
+					  }
+					  for(int i=0; i < num_coarse_color; ++i) {
+						  reduce_lower += conj(v[i+num_coarse_color]) * coarse_site_spinor[i+num_coarse_color];
+					  }
+
+					  fine_site_data[fcolor] = reduce_upper;
+					  fine_site_data[fcolor+num_fine_color] = reduce_lower;
+				  } // rhs
+			  } // fcolor
+		  } // fsite
+	  } // cb
+	  } // omp parallel
+  }
+
 	~CoarseTransfer()
 	{
 		MemoryFree(_data);
@@ -1237,7 +1429,6 @@ private:
   std::vector<CBSite> reverse_map[2];
   std::vector<int> reverse_transfer_row[2];
   float* _data;
-  const std::vector<std::shared_ptr<CoarseSpinor> >& _vecs;
   int _n_threads;
   int _r_threads_per_block;
 };
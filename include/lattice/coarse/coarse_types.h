@@ -10,6 +10,9 @@
 
 #include "lattice/constants.h"
 #include "lattice/lattice_info.h"
+#include "lattice/coarse/subset.h"
+#include "lattice/coarse/coarse_precision.h"
+#include "lattice/coarse/thread_partition.h"
 #include "utils/memory.h"
 #include "utils/print_utils.h"
 
@@ -23,7 +26,11 @@ namespace MG {
 	 *  \param LatticeInfo
 	 *
 	 *  Basic Coarse Spinor. Holds memory for two checkerboards of sites
-	 *  The checheckerboards are contiguous for now.
+	 *  The checkerboards live in a single allocation. The odd checkerboard starts
+	 *  at an offset of GetCBOffset() floats from the even one, which is the size of
+	 *  a checkerboard rounded up to the memory alignment. The padding between the
+	 *  checkerboards is zeroed on construction.
+	 *
 	 *  Regular site ordering: ie <cb><sites>< Nspin*Ncolor >< n_complex = fastest >
 	 *
 	 *
@@ -32,7 +39,17 @@ namespace MG {
 	 */
 	class CoarseSpinor {
 	public:
-		CoarseSpinor(const LatticeInfo& lattice_info) : _lattice_info(lattice_info), data{nullptr,nullptr},
+		CoarseSpinor(const LatticeInfo& lattice_info) : CoarseSpinor(lattice_info, nullptr) {}
+
+		/** Construct a CoarseSpinor
+		 *  \param lattice_info
+		 *  \param external_data
+		 *
+		 *  If external_data is not null, the spinor is a view onto it (e.g. one vector
+		 *  of a CoarseSpinorSet): it must point to GetNumFloatsAllocated(lattice_info)
+		 *  suitably aligned floats and is not freed on destruction.
+		 */
+		CoarseSpinor(const LatticeInfo& lattice_info, float* external_data) : _lattice_info(lattice_info), data{nullptr,nullptr},
 				_n_color(lattice_info.GetNumColors()),
 				_n_spin(lattice_info.GetNumSpins()),
 				_n_colorspin(lattice_info.GetNumColors()*lattice_info.GetNumSpins()),
@@ -41,7 +58,10 @@ namespace MG {
 				_n_x( lattice_info.GetLatticeDimensions()[0] ),
 				_n_y( lattice_info.GetLatticeDimensions()[1] ),
 				_n_z( lattice_info.GetLatticeDimensions()[2] ),
-				_n_t( lattice_info.GetLatticeDimensions()[3] )
+				_n_t( lattice_info.GetLatticeDimensions()[3] ),
+				_n_floats_per_cb( lattice_info.GetNumCBSites()*_n_site_offset ),
+				_cb_offset( PaddedCBOffset(_n_floats_per_cb) ),
+				_owns_data( external_data == nullptr )
 		{
 #if 1
 			// Check That we have 2 spins
@@ -50,15 +70,54 @@ namespace MG {
 			}
 #endif
 
-			// Allocate Data
-			IndexType num_floats_per_cb = _lattice_info.GetNumCBSites()*_n_site_offset;
-
-			/* Non-Contiguout allocation */
-			data[0] = (float *)MG::MemoryAllocate(num_floats_per_cb*sizeof(float), MG::REGULAR);
-			data[1] = (float *)MG::MemoryAllocate(num_floats_per_cb*sizeof(float), MG::REGULAR);
+			/* Contiguous allocation: one block for both checkerboards */
+			if( _owns_data ) {
+				data[0] = (float *)MG::MemoryAllocate(n_checkerboard*_cb_offset*sizeof(float), MG::REGULAR);
+			}
+			else {
+				data[0] = external_data;
+			}
 
 			/* Offset the checkerboard */
-			//data[1] = (data[0] + num_floats_per_cb);
+			data[1] = data[0] + _cb_offset;
+
+			/* First touch: each thread zeroes the sites it owns in the ThreadPartition,
+			 * so the pages end up near the thread which will work on them */
+			if( _owns_data ) {
+				const ThreadPartition& partition = GetThreadPartition(lattice_info);
+#pragma omp parallel
+				{
+					IndexType min_site, max_site;
+					partition.GetMySiteRange(min_site, max_site);
+					for(int cb=0; cb < n_checkerboard; ++cb) {
+						float* cb_data = data[cb] + min_site*_n_site_offset;
+						const IndexType num_floats = (max_site - min_site)*_n_site_offset;
+#pragma omp simd
+						for(IndexType i=0; i < num_floats; ++i) {
+							cb_data[i] = 0;
+						}
+					}
+				}
+			}
+
+			/* Zero the padding too, so no part of the allocation is left uninitialized */
+			for(IndexType i=_n_floats_per_cb; i < _cb_offset; ++i) {
+				data[0][i] = 0;
+				data[1][i] = 0;
+			}
+		}
+
+		/** GetNumFloatsAllocated
+		 *
+		 *  The number of floats a CoarseSpinor on lattice_info occupies,
+		 *  including the checkerboard padding. Always a multiple of the
+		 *  memory alignment.
+		 */
+		static
+		IndexType GetNumFloatsAllocated(const LatticeInfo& lattice_info)
+		{
+			return n_checkerboard*PaddedCBOffset(lattice_info.GetNumCBSites()*n_complex
+					*lattice_info.GetNumColors()*lattice_info.GetNumSpins());
 		}
 
 		/** GetCBData
@@ -71,6 +130,12 @@ namespace MG {
 			return data[cb];
 		}
 
+		inline
+		const float* GetCBDataPtr(IndexType cb) const
+		{
+			return data[cb];
+		}
+
 		/** GetSiteData
 		 *
 		 *  Returns a pointer to the data for a site in a cb
@@ -91,8 +156,9 @@ namespace MG {
 
 		~CoarseSpinor()
 		{
-			MemoryFree(data[0]);
-			MemoryFree(data[1]);
+			if( _owns_data ) {
+				MemoryFree(data[0]);
+			}
 			data[0] = nullptr;
 			data[1] = nullptr;
 		}
@@ -132,9 +198,25 @@ namespace MG {
 		inline
 		const IndexType& GetNt() const { return _n_t; }
 
+		/** GetCBOffset
+		 *
+		 *  Returns the distance in floats between the start of the
+		 *  even and the odd checkerboard
+		 */
+		inline
+		IndexType GetCBOffset() const { return _cb_offset; }
+
 	private:
+		/* Round the checkerboard size up to a whole number of aligned chunks */
+		static IndexType PaddedCBOffset(IndexType n_floats)
+		{
+			IndexType align_floats = static_cast<IndexType>(MG::GetMemoryAlignment()/sizeof(float));
+			if( align_floats < n_complex ) align_floats = n_complex;
+			return ((n_floats + align_floats - 1)/align_floats)*align_floats;
+		}
+
 		const LatticeInfo& _lattice_info;
-		float* data[2];  // Even and odd checkerboards
+		float* data[2];  // Even and odd checkerboards, data[1] points into data[0]'s allocation
 
 		const IndexType _n_color;
 		const IndexType _n_spin;
@@ -145,8 +227,9 @@ namespace MG {
 		const IndexType _n_y;
 		const IndexType _n_z;
 		const IndexType _n_t;
-
-
+		const IndexType _n_floats_per_cb;
+		const IndexType _cb_offset;
+		const bool _owns_data;
 	};
 
 
@@ -156,6 +239,8 @@ namespace MG {
 	public:
 		CoarseGauge(const LatticeInfo& lattice_info) : _lattice_info(lattice_info), data{nullptr,nullptr}, diag_data{nullptr,nullptr},
 		invdiag_data{nullptr,nullptr}, AD_data{nullptr,nullptr}, DA_data{nullptr,nullptr},
+		half_data{nullptr,nullptr}, half_AD_data{nullptr,nullptr}, half_DA_data{nullptr,nullptr},
+		_link_prec(COARSE_PREC_FP32),
 				_n_color(lattice_info.GetNumColors()),
 				_n_spin(lattice_info.GetNumSpins()),
 				_n_colorspin(lattice_info.GetNumColors()*lattice_info.GetNumSpins()),
@@ -195,6 +280,30 @@ namespace MG {
 			DA_data[0] = (float *)MG::MemoryAllocate(offdiag_num_floats_per_cb*sizeof(float), MG::REGULAR);
 			DA_data[1] = (float *)MG::MemoryAllocate(offdiag_num_floats_per_cb*sizeof(float), MG::REGULAR);
 
+			/* First touch, site by site from the ThreadPartition as for CoarseSpinor */
+			const ThreadPartition& partition = GetThreadPartition(lattice_info);
+#pragma omp parallel
+			{
+				IndexType min_site, max_site;
+				partition.GetMySiteRange(min_site, max_site);
+				for(int cb=0; cb < n_checkerboard; ++cb) {
+					const IndexType diag_begin = min_site*_n_link_offset;
+					const IndexType diag_end = max_site*_n_link_offset;
+					for(IndexType i=diag_begin; i < diag_end; ++i) {
+						diag_data[cb][i] = 0;
+						invdiag_data[cb][i] = 0;
+					}
+
+					const IndexType offdiag_begin = min_site*_n_site_offset;
+					const IndexType offdiag_end = max_site*_n_site_offset;
+					for(IndexType i=offdiag_begin; i < offdiag_end; ++i) {
+						data[cb][i] = 0;
+						AD_data[cb][i] = 0;
+						DA_data[cb][i] = 0;
+					}
+				}
+			}
+
 		}
 
 #if 0
@@ -361,8 +470,71 @@ namespace MG {
 		}
 
 
+		/** SetLinkPrecision
+		 *
+		 *  Keeps a copy of the off diagonal links (D, AD and DA) in precision prec as well.
+		 *  With FP16 or BF16 the coarse operator reads the links from the 16 bit copy and
+		 *  expands them site by site (see CoarseDiracOp), halving the link traffic. The FP32
+		 *  links stay: the setup of the next level and the transfer operators use them.
+		 *  Call it once the links are final, i.e. after generateCoarse() and the set up of
+		 *  the AD and DA links, and again if they change. COARSE_PREC_FP32 drops the copy.
+		 */
+		void SetLinkPrecision(CoarsePrecision prec)
+		{
+			freeHalfLinks();
+			_link_prec = prec;
+			if( prec == COARSE_PREC_FP32 ) return;
+
+			IndexType offdiag_num_halfs_per_cb = _lattice_info.GetNumCBSites()*_n_site_offset;
+			for(int cb=0; cb < n_checkerboard; ++cb) {
+				half_data[cb] = (uint16_t *)MG::MemoryAllocate(offdiag_num_halfs_per_cb*sizeof(uint16_t), MG::REGULAR);
+				half_AD_data[cb] = (uint16_t *)MG::MemoryAllocate(offdiag_num_halfs_per_cb*sizeof(uint16_t), MG::REGULAR);
+				half_DA_data[cb] = (uint16_t *)MG::MemoryAllocate(offdiag_num_halfs_per_cb*sizeof(uint16_t), MG::REGULAR);
+			}
+
+			/* Convert (and first touch) site by site from the ThreadPartition */
+			const ThreadPartition& partition = GetThreadPartition(_lattice_info);
+#pragma omp parallel
+			{
+				IndexType min_site, max_site;
+				partition.GetMySiteRange(min_site, max_site);
+				const IndexType begin = min_site*_n_site_offset;
+				const IndexType n = (max_site - min_site)*_n_site_offset;
+				for(int cb=0; cb < n_checkerboard; ++cb) {
+					ConvertToHalf(half_data[cb]+begin, data[cb]+begin, n, prec);
+					ConvertToHalf(half_AD_data[cb]+begin, AD_data[cb]+begin, n, prec);
+					ConvertToHalf(half_DA_data[cb]+begin, DA_data[cb]+begin, n, prec);
+				}
+			}
+		}
+
+		inline
+		CoarsePrecision GetLinkPrecision() const { return _link_prec; }
+
+		/** The 16 bit copies of the links of SetLinkPrecision(), laid out as the FP32 ones.
+		 *  Only valid if GetLinkPrecision() is not COARSE_PREC_FP32.
+		 */
+		inline
+		const uint16_t *GetSiteDirHalfDataPtr(IndexType cb, IndexType site, IndexType mu) const
+		{
+			return &half_data[cb][site*_n_site_offset + mu*_n_link_offset];
+		}
+
+		inline
+		const uint16_t *GetSiteDirHalfADDataPtr(IndexType cb, IndexType site, IndexType mu) const
+		{
+			return &half_AD_data[cb][site*_n_site_offset + mu*_n_link_offset];
+		}
+
+		inline
+		const uint16_t *GetSiteDirHalfDADataPtr(IndexType cb, IndexType site, IndexType mu) const
+		{
+			return &half_DA_data[cb][site*_n_site_offset + mu*_n_link_offset];
+		}
+
 		~CoarseGauge()
 		{
+			freeHalfLinks();
 			MemoryFree(data[0]);
 			MemoryFree(data[1]);
 			MemoryFree(diag_data[0]);
@@ -432,12 +604,28 @@ namespace MG {
 		const IndexType& GetNt() const { return _n_t; }
 
 	private:
+		void freeHalfLinks()
+		{
+			for(int cb=0; cb < n_checkerboard; ++cb) {
+				if( half_data[cb] != nullptr ) MemoryFree(half_data[cb]);
+				if( half_AD_data[cb] != nullptr ) MemoryFree(half_AD_data[cb]);
+				if( half_DA_data[cb] != nullptr ) MemoryFree(half_DA_data[cb]);
+				half_data[cb] = nullptr;
+				half_AD_data[cb] = nullptr;
+				half_DA_data[cb] = nullptr;
+			}
+		}
+
 		const LatticeInfo& _lattice_info;
 		float* data[2];        // Even and odd checkerboards off diagonal data (D)
 		float* diag_data[2];   // Diagonal data (Clov, or A)
 		float* invdiag_data[2]; // Inverse Clover (A^{-1})
 		float* AD_data[2]; // holds A^{-1}_oo D_oe and A^{-1}_ee D_eo (AD)
 		float* DA_data[2]; // holds D_oe A^{-1}_ee and D_eo A^{-1}_oo (DA)
+		uint16_t* half_data[2];    // D, AD and DA in _link_prec, if that is not FP32
+		uint16_t* half_AD_data[2];
+		uint16_t* half_DA_data[2];
+		CoarsePrecision _link_prec;
 
 
 		const IndexType _n_color;
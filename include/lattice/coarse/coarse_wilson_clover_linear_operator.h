@@ -45,14 +45,36 @@ public:
 		{
 
 			int tid=omp_get_thread_num();
+			ApplyInTeam(out, in, type, tid);
+		}
+	}
+
+	/* The work of thread tid in operator(), for solvers which keep one parallel region
+	 * open over many applications (see SpinTeam). Every thread of the team calls it. The
+	 * thread writes the sites of out it owns in the ThreadPartition, and reads in on
+	 * the neighbouring sites too: those must have been written before a barrier.
+	 */
+	void ApplyInTeam(Spinor& out, const Spinor& in, IndexType type, int tid) const {
+		for(int cb=0; cb < n_checkerboard; ++cb) {
+			_the_op.unprecOp(out,      // Output Spinor
+							(*_u),    // Gauge Field
+							in,
+							cb,
+							type,
+							tid);
+		}
+	}
+
+	// All vectors in one sweep over the sites and links
+	void MultiApply(SpinorSet<Spinor>& out, const SpinorSet<Spinor>& in, int n_vecs,
+			IndexType type = LINOP_OP) const override {
+
+#pragma omp parallel
+		{
+			int tid=omp_get_thread_num();
 
 			for(int cb=0; cb < n_checkerboard; ++cb) {
-				_the_op.unprecOp(out,      // Output Spinor
-								(*_u),    // Gauge Field
-								in,
-								cb,
-								type,
-								tid);
+				_the_op.unprecOpMulti(out, (*_u), in, n_vecs, cb, type, tid);
 			}
 		}
 	}
@@ -90,6 +112,15 @@ public:
 	const LatticeInfo& GetInfo(void) const override{
 		return _u->GetInfo();
 	}
+
+	// For operators restricted to parts of the lattice, e.g. the SAP blocks
+	const CoarseGauge& GetGauge(void) const {
+		return *_u;
+	}
+
+	const CoarseDiracOp& GetDiracOp(void) const {
+		return _the_op;
+	}
 private:
 	const std::shared_ptr<Gauge> _u;
 	const std::shared_ptr<Gauge> _clovInvU;
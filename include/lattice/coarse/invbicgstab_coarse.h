@@ -10,6 +10,8 @@
 #include "lattice/linear_operator.h"
 #include "lattice/solver.h"
 #include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/invpipebicgstab_generic.h"
 #include <memory>
 
 namespace MG {
@@ -31,6 +33,11 @@ public:
 
 using UnprecBiCGStabSolverCoarseWrapper = UnprecLinearSolverWrapper<CoarseSpinor,CoarseGauge, BiCGStabSolverCoarse>;
 
+// Pipelined BiCGStab: two fused global reductions per iteration
+using PipeBiCGStabSolverCoarse = PipeBiCGStabSolverGeneric<CoarseSpinor,CoarseGauge>;
+
+using UnprecPipeBiCGStabSolverCoarseWrapper = UnprecLinearSolverWrapper<CoarseSpinor,CoarseGauge, PipeBiCGStabSolverCoarse>;
+
 }  // end namespace MGTEsting
 
 #endif /* TEST_QDPXX_INVBICGSTAB_H_ */
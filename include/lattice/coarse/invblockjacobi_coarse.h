@@ -0,0 +1,56 @@
+/*
+ * invblockjacobi_coarse.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_INVBLOCKJACOBI_COARSE_H_
+#define INCLUDE_LATTICE_COARSE_INVBLOCKJACOBI_COARSE_H_
+
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/mr_params.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
+#include "lattice/coarse/thread_partition.h"
+#include "lattice/spinor_workspace.h"
+#include <memory>
+
+namespace MG {
+
+/** BlockJacobiSmootherCoarse
+ *
+ *  Red-black block Gauss-Seidel on the site blocks A of the coarse operator M = A + D.
+ *  A sweep updates the even and then the odd sites,
+ *
+ *      x_cb <- (1-omega) x_cb + omega A^{-1}( b_cb - D x_{1-cb} )
+ *
+ *  with the precomputed A^{-1} (invdiag) and A^{-1} D (AD) links of the CoarseGauge:
+ *  A^{-1} b is made once per call and each half sweep is one CoarseDiracOp::M_AD_xpayz().
+ *  So a sweep costs one application of the operator, with its halo exchanges, and no
+ *  global reductions. The parameters are MRSolverParams, to fit in VCycleParams:
+ *  MaxIter is the number of sweeps and Omega the relaxation weight. RsdTarget is not used,
+ *  and VerboseP logs the residual after the sweeps (which does take a reduction).
+ *
+ *  out is the initial guess, and it is updated. Only the unpreconditioned operator is
+ *  supported.
+ */
+class BlockJacobiSmootherCoarse : public Smoother<CoarseSpinor,CoarseGauge> {
+public:
+	BlockJacobiSmootherCoarse(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
+			const LinearSolverParamsBase& params);
+
+	BlockJacobiSmootherCoarse(const std::shared_ptr<const LinearOperator<CoarseSpinor,CoarseGauge>> M_ptr,
+			const LinearSolverParamsBase& params);
+
+	void operator()(CoarseSpinor& out, const CoarseSpinor& in) const override;
+
+private:
+	const CoarseWilsonCloverLinearOperator& _M;
+	const MRSolverParams& _params;
+	const ThreadPartition& _partition;
+	mutable SpinorWorkspace<CoarseSpinor> _work;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_INVBLOCKJACOBI_COARSE_H_ */
@@ -0,0 +1,82 @@
+/*
+ * invdirect_coarse.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_INVDIRECT_COARSE_H_
+#define INCLUDE_LATTICE_COARSE_INVDIRECT_COARSE_H_
+
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
+#include "lattice/coarse/coarse_eo_wilson_clover_linear_operator.h"
+#include <vector>
+#include <memory>
+
+namespace MG {
+
+/** CoarseDirectSolver
+ *
+ *  Direct solve of the unpreconditioned coarse operator, for the coarsest level.
+ *  At construction the clover term and the 8 links of the CoarseGauge are assembled
+ *  into a sparse matrix over the global lattice, in double precision, and factorized
+ *  with a sparse LU (Eigen's SparseLU). A solve is then one forward and one back
+ *  substitution: the cost is fixed and there are no global reductions.
+ *
+ *  With several nodes the gauge field is all-gathered and every node factorizes the
+ *  global matrix itself. Each solve all-gathers the right hand side, every node does the
+ *  same substitutions and keeps its own part of the solution. So this is only for
+ *  small lattices: the factors of the global matrix are kept on every node.
+ *
+ *  The constructors take the arguments of the iterative bottom solvers so it can replace
+ *  them. The params are only used for VerboseP and the preconditioner is ignored. For the
+ *  even-odd operator the unpreconditioned system is solved, as in
+ *  UnprecFGMRESSolverCoarseWrapper. The initial guess in out is not used. The returned
+ *  residual is that of the double precision solution, computed redundantly on each node.
+ */
+class CoarseDirectSolver : public LinearSolver<CoarseSpinor,CoarseGauge> {
+public:
+	CoarseDirectSolver(const CoarseWilsonCloverLinearOperator& M,
+			const LinearSolverParamsBase& params,
+			const LinearSolver<CoarseSpinor,CoarseGauge>* M_prec=nullptr);
+
+	CoarseDirectSolver(const std::shared_ptr<const CoarseWilsonCloverLinearOperator> M_ptr,
+			const LinearSolverParamsBase& params,
+			const LinearSolver<CoarseSpinor,CoarseGauge>* M_prec=nullptr);
+
+	CoarseDirectSolver(const std::shared_ptr<const CoarseEOWilsonCloverLinearOperator> M_ptr,
+			const LinearSolverParamsBase& params,
+			const LinearSolver<CoarseSpinor,CoarseGauge>* M_prec=nullptr);
+
+	~CoarseDirectSolver();
+
+	LinearSolverResults operator()(CoarseSpinor& out, const CoarseSpinor& in, ResiduumType resid_type = RELATIVE) const override;
+
+	// The dimension of the global matrix
+	int GetGlobalSize() const {
+		return _n_global_sites*_info.GetNumColorSpins();
+	}
+
+private:
+	void factorize(const CoarseGauge& u);
+
+	// All-gather of a site field with n_per_site doubles per site, ordered by global site
+	void allGather(const std::vector<double>& local, int n_per_site, std::vector<double>& global) const;
+
+	const LatticeInfo& _info;
+	const LinearSolverParamsBase _params;
+	const int _level;
+
+	// Global (lexicographic) site index of each local site, indexed by cb*num_cb_sites + site
+	std::vector<int> _global_site;
+	int _n_global_sites;
+
+	// The matrix and its factors. Defined in the .cpp, so the header does not need Eigen
+	struct Factorization;
+	std::unique_ptr<Factorization> _lu;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_INVDIRECT_COARSE_H_ */
@@ -11,10 +11,12 @@
 #include  "lattice/coarse/coarse_types.h"
 #include "lattice/coarse/coarse_l1_blas.h"
 #include  "lattice/invfgmres_generic.h"
+#include  "lattice/invblockfgmres_generic.h"
 #include  "lattice/unprec_solver_wrappers.h"
 namespace MG {
 
   using FGMRESSolverCoarse = FGMRESGeneric::FGMRESSolverGeneric<CoarseSpinor,CoarseGauge>;
+  using BlockFGMRESSolverCoarse = FGMRESGeneric::BlockFGMRESSolverGeneric<CoarseSpinor,CoarseGauge>;
 
   using UnprecFGMRESSolverCoarseWrapper =  UnprecLinearSolverWrapper<CoarseSpinor,CoarseGauge,
 		  	  	  	  	  	  	  	  	  	  	  	  	  FGMRESGeneric::FGMRESSolverGeneric<CoarseSpinor,CoarseGauge>>;
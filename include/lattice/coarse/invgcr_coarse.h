@@ -0,0 +1,22 @@
+/*
+ * invgcr_coarse.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_INVGCR_COARSE_H_
+#define INCLUDE_LATTICE_COARSE_INVGCR_COARSE_H_
+
+#include  "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/coarse/coarse_spinor_set.h"
+#include  "lattice/invgcr_generic.h"
+#include  "lattice/unprec_solver_wrappers.h"
+namespace MG {
+
+  using GCRSolverCoarse = GCRGeneric::GCRSolverGeneric<CoarseSpinor,CoarseGauge>;
+
+  using UnprecGCRSolverCoarseWrapper =  UnprecLinearSolverWrapper<CoarseSpinor,CoarseGauge,
+		  	  	  	  	  	  	  	  	  	  	  	  	  GCRGeneric::GCRSolverGeneric<CoarseSpinor,CoarseGauge>>;
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_INVGCR_COARSE_H_ */
@@ -10,6 +10,13 @@
 #include "lattice/solver.h"
 #include "lattice/mr_params.h"
 #include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/invchebyshev_generic.h"
+#include "lattice/spinor_workspace.h"
+#include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
+#include "lattice/coarse/thread_team.h"
+#include "lattice/coarse/thread_partition.h"
+#include <memory>
 
 #include "lattice/unprec_solver_wrappers.h"
 
@@ -44,13 +51,61 @@ namespace MG  {
 
 	  void operator()(CoarseSpinor& out, const CoarseSpinor& in) const;
 
+	  // MR updates r as it iterates: return it rather than have the caller recompute it
+	  bool SmoothAndUpdateResidual(CoarseSpinor& out, CoarseSpinor& r) const override;
+
+	  // The right hand sides together: one MultiApply() and one reduction per iteration,
+	  // with the MR step of each vector its own
+	  void MultiSmooth(CoarseSpinorSet& out, const CoarseSpinorSet& in, int n_vecs) const override;
+
+	  bool MultiSmoothAndUpdateResidual(CoarseSpinorSet& out, CoarseSpinorSet& r, int n_vecs) const override;
+
   private:
 	  const LinearOperator<CoarseSpinor,CoarseGauge>& _M;
 	  const MRSolverParams& _params;
 
+	  // Scratch for MultiSmooth(), kept between calls and regrown when n_vecs grows
+	  mutable std::unique_ptr<CoarseSpinorSet> _multi_r;
+	  mutable std::unique_ptr<CoarseSpinorSet> _multi_Mr;
   };
   using UnprecMRSmootherCoarseWrapper = UnprecSmootherWrapper<CoarseSpinor,CoarseGauge,MRSmootherCoarse>;
 
+  /** PersistentMRSmootherCoarse
+   *
+   *  The MR smoother of MRSmootherCoarse, with all its iterations in one parallel region.
+   *  The threads apply the operator with ApplyInTeam() and use the ...InTeam BLAS, and
+   *  synchronise with a SpinTeam: each iteration has a spin barrier before the operator
+   *  and one in the reduction, instead of a fork and join in each of five kernels. For
+   *  the latency bound coarse levels, where those cost as much as the work.
+   *  The operator must be a CoarseWilsonCloverLinearOperator.
+   */
+  class PersistentMRSmootherCoarse : public Smoother<CoarseSpinor,CoarseGauge> {
+  public:
+	  PersistentMRSmootherCoarse(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
+			  	  	  	  	     const MG::LinearSolverParamsBase& params);
+
+	  PersistentMRSmootherCoarse(const std::shared_ptr<const LinearOperator<CoarseSpinor,CoarseGauge>> M_ptr,
+			  	  	  	  	     const MG::LinearSolverParamsBase& params);
+
+	  void operator()(CoarseSpinor& out, const CoarseSpinor& in) const override;
+
+	  bool SmoothAndUpdateResidual(CoarseSpinor& out, CoarseSpinor& r) const override;
+
+  private:
+	  // out += MR iterations on r, which must be the residual of out. Updates r.
+	  void smooth(CoarseSpinor& out, CoarseSpinor& r) const;
+
+	  const CoarseWilsonCloverLinearOperator& _M;
+	  const MRSolverParams& _params;
+	  const ThreadPartition& _partition;
+	  mutable SpinorWorkspace<CoarseSpinor> _work;
+	  mutable std::unique_ptr<SpinTeam> _team;
+  };
+
+  // Chebyshev smoother: no global reductions after the setup (see invchebyshev_generic.h)
+  using ChebyshevSmootherCoarse = ChebyshevSmootherGeneric<CoarseSpinor,CoarseGauge>;
+  using UnprecChebyshevSmootherCoarseWrapper = UnprecSmootherWrapper<CoarseSpinor,CoarseGauge,ChebyshevSmootherCoarse>;
+
 }
 
 #endif /* TEST_QDPXX_INVMR_COARSE_H_ */
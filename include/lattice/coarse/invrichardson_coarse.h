@@ -0,0 +1,21 @@
+/*
+ * invrichardson_coarse.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_INVRICHARDSON_COARSE_H_
+#define INCLUDE_LATTICE_COARSE_INVRICHARDSON_COARSE_H_
+
+#include  "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include  "lattice/invrichardson_generic.h"
+#include  "lattice/unprec_solver_wrappers.h"
+namespace MG {
+
+  using RichardsonSolverCoarse = RichardsonSolverGeneric<CoarseSpinor,CoarseGauge>;
+
+  using UnprecRichardsonSolverCoarseWrapper =  UnprecLinearSolverWrapper<CoarseSpinor,CoarseGauge,
+		  	  	  	  	  	  	  	  	  	  	  	  	  RichardsonSolverGeneric<CoarseSpinor,CoarseGauge>>;
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_INVRICHARDSON_COARSE_H_ */
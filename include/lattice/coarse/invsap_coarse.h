@@ -0,0 +1,100 @@
+/*
+ * invsap_coarse.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_INVSAP_COARSE_H_
+#define INCLUDE_LATTICE_COARSE_INVSAP_COARSE_H_
+
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/block.h"
+#include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
+#include <vector>
+#include <memory>
+
+namespace MG {
+
+/** Parameters for the SAP smoother
+ *
+ *  MaxIter is the number of SAP cycles. RsdTarget is not used.
+ *  BlockDims are the dimensions of the Schwarz blocks, which must divide the
+ *  local lattice, and BlockMRIters are the MR iterations of each block solve,
+ *  with overrelaxation BlockOmega.
+ */
+class SAPSmootherParams : public LinearSolverParamsBase {
+public:
+	IndexArray BlockDims;
+	int BlockMRIters;
+	double BlockOmega;
+
+	SAPSmootherParams() {
+		MaxIter = 1;
+		BlockDims = {{2,2,2,2}};
+		BlockMRIters = 4;
+		BlockOmega = 1.0;
+	}
+};
+
+/** SAPSmootherCoarse
+ *
+ *  Schwarz Alternating Procedure (Luescher). The local lattice is cut into blocks
+ *  with CreateBlockList() and the blocks are coloured red-black by the parity of their
+ *  global block coordinates. A cycle is
+ *
+ *      for colour = red, black
+ *          for each block B of the colour:  x_B += M_B^{-1} r_B   (approximately)
+ *          r = b - M x
+ *
+ *  M_B is M restricted to B with zero boundaries (CoarseDiracOp::blockUnprecOp()),
+ *  inverted with BlockMRIters MR iterations. A block solve touches only the block's
+ *  sites, so it runs from cache with block-local inner products: no halo exchange and
+ *  no global reductions. Blocks of one colour are solved in parallel, one block per
+ *  thread. The only communication is the halo exchange of the residual update between
+ *  the colours.
+ *
+ *  out is the initial guess, and it is updated. Only the unpreconditioned operator is
+ *  supported: the blocks are blocks of the full lattice.
+ */
+class SAPSmootherCoarse : public Smoother<CoarseSpinor,CoarseGauge> {
+public:
+	SAPSmootherCoarse(const CoarseWilsonCloverLinearOperator& M,
+			const LinearSolverParamsBase& params);
+
+	SAPSmootherCoarse(const std::shared_ptr<const CoarseWilsonCloverLinearOperator> M_ptr,
+			const LinearSolverParamsBase& params);
+
+	~SAPSmootherCoarse();
+
+	void operator()(CoarseSpinor& out, const CoarseSpinor& in) const override;
+
+	inline
+	int GetNumBlocks(int colour) const {
+		return _colour_blocks[colour].size();
+	}
+
+private:
+	void init();
+
+	// MR on one block: out_B += M_B^{-1} r_B, with the work arrays of thread tid
+	void blockSolve(int block_idx, const CoarseSpinor& r, CoarseSpinor& out, int tid) const;
+
+	const CoarseWilsonCloverLinearOperator& _M;
+	const SAPSmootherParams _params;
+
+	std::vector<Block> _blocklist;
+	std::vector< std::vector<int> > _neighbors;
+	std::vector<int> _colour_blocks[2];
+
+	// Per thread block work arrays: residual, solution and M_B residual
+	int _n_threads;
+	int _block_floats;
+	std::vector<float*> _block_r;
+	std::vector<float*> _block_x;
+	std::vector<float*> _block_Mr;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_INVSAP_COARSE_H_ */
@@ -0,0 +1,115 @@
+/*
+ * thread_partition.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_THREAD_PARTITION_H_
+#define INCLUDE_LATTICE_COARSE_THREAD_PARTITION_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/lattice_info.h"
+#include "lattice/coarse/thread_limits.h"
+#include <vector>
+#include <omp.h>
+
+namespace MG {
+
+	/** ThreadPartition
+	 *
+	 *  Assigns the checkerboarded sites of a lattice to the threads of the OpenMP team.
+	 *  Thread tid owns sites [min_site, max_site) on BOTH checkerboards. The ranges are
+	 *  contiguous and ordered by tid so the sites of the SMT threads of a core
+	 *  (tid = smt_id + n_smt*core_id) form one contiguous range too.
+	 *
+	 *  Every coarse kernel (the Dirac operator, the BLAS, the transfer operators,
+	 *  halo packing and first touch on allocation) takes its site loop limits from here,
+	 *  so a thread always works on the same part of a vector and that part stays in the
+	 *  thread's cache and NUMA domain from one kernel to the next.
+	 *
+	 *  Use GetThreadPartition() to get the shared instance for a lattice.
+	 */
+	class ThreadPartition {
+	public:
+		ThreadPartition(IndexType num_cbsites, int n_threads);
+
+		ThreadPartition(const ThreadPartition&) = delete;
+		ThreadPartition& operator=(const ThreadPartition&) = delete;
+
+		inline
+		int GetNumThreads() const { return _n_threads; }
+
+		inline
+		IndexType GetNumCBSites() const { return _num_cbsites; }
+
+		inline
+		const ThreadLimits& GetThreadLimits(int tid) const { return _thread_limits[tid]; }
+
+		/** GetSiteRange
+		 *
+		 *  The sites of thread tid in a team of GetNumThreads() threads
+		 */
+		inline
+		void GetSiteRange(int tid, IndexType& min_site, IndexType& max_site) const
+		{
+			min_site = _thread_limits[tid].min_site;
+			max_site = _thread_limits[tid].max_site;
+		}
+
+		/** GetCoreSiteRange
+		 *
+		 *  The sites shared by the n_smt SMT threads of the core of thread tid
+		 */
+		void GetCoreSiteRange(int tid, int n_smt, IndexType& min_site, IndexType& max_site) const;
+
+		/** GetMySiteRange
+		 *
+		 *  The sites of the calling thread in the current team. Call inside a parallel region.
+		 *  If the team is not the size of the partition (e.g. we are in a nested
+		 *  region or running serially) the sites are split over the team in the same way.
+		 */
+		inline
+		void GetMySiteRange(IndexType& min_site, IndexType& max_site) const
+		{
+			const int n_threads = omp_get_num_threads();
+			const int tid = omp_get_thread_num();
+			if( n_threads == _n_threads ) {
+				GetSiteRange(tid, min_site, max_site);
+			}
+			else {
+				SplitSites(_num_cbsites, n_threads, tid, min_site, max_site);
+			}
+		}
+
+		//! The even split of num_sites into n_parts contiguous parts
+		static
+		inline
+		void SplitSites(IndexType num_sites, int n_parts, int part, IndexType& min_site, IndexType& max_site)
+		{
+			min_site = (num_sites*part)/n_parts;
+			max_site = (num_sites*(part+1))/n_parts;
+		}
+
+	private:
+		const IndexType _num_cbsites;
+		const int _n_threads;
+		std::vector<ThreadLimits> _thread_limits;
+	};
+
+	/** GetThreadPartition
+	 *
+	 *  Returns the partition of info's sites over omp_get_max_threads() threads.
+	 *  Partitions are created on first use and shared by all lattices with the
+	 *  same number of checkerboarded sites, so all kernels on them agree.
+	 *  It is safe to call inside a parallel region: a named critical section guards the
+	 *  creation of partitions, and each thread caches the ones it has seen, so repeat
+	 *  lookups take no lock. In a parallel region omp_get_max_threads() is the size of
+	 *  a nested team, so a kernel called from an outer team (e.g. a level of the
+	 *  additive V-cycle) gets the partition of the team it will open.
+	 */
+	const ThreadPartition& GetThreadPartition(const LatticeInfo& info);
+
+}
+
+
+
+#endif /* INCLUDE_LATTICE_COARSE_THREAD_PARTITION_H_ */
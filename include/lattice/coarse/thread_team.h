@@ -0,0 +1,204 @@
+/*
+ * thread_team.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_THREAD_TEAM_H_
+#define INCLUDE_LATTICE_COARSE_THREAD_TEAM_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/lattice_info.h"
+#include "lattice/solver.h"
+#include "lattice/spinor_set.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <omp.h>
+
+namespace MG {
+
+	/** The least work a thread should get in one coarse operator application, in units
+	 *  of site x N_colorspin^2 (one site matrix). Below this the fork and barrier of the
+	 *  parallel region cost more than the thread saves.
+	 */
+	constexpr IndexType MinCoarseWorkPerThread = 4096;
+
+	/** GetAutoNumThreads
+	 *
+	 *  The number of threads for the work on a lattice: enough that each gets at least
+	 *  MinCoarseWorkPerThread, given the local volume and the number of colorspins, and
+	 *  at most omp_get_max_threads(). E.g. a 2^4 lattice with 48 colorspins gets 9 threads.
+	 */
+	int GetAutoNumThreads(const LatticeInfo& info);
+
+	/** ThreadTeamScope
+	 *
+	 *  Sets the team size of the parallel regions started by the calling thread for the
+	 *  lifetime of the object, and restores the previous one after. All the coarse kernels
+	 *  (the Dirac operator, the BLAS, the transfer operators and the halo packing) split
+	 *  their sites over the team they run in, so everything called inside the scope runs
+	 *  on n_threads threads. n_threads <= 0 leaves the team size alone.
+	 *
+	 *  Inside a parallel region, e.g. a subteam of AdditiveVCycleCoarse, the team can only
+	 *  shrink, so as not to oversubscribe the cores of the other subteams.
+	 *
+	 *  Which cores a team runs on is up to OMP_PLACES and OMP_PROC_BIND: with
+	 *  OMP_PROC_BIND=close a team of n threads is packed onto the first n places.
+	 */
+	class ThreadTeamScope {
+	public:
+		explicit ThreadTeamScope(int n_threads) : _saved_n_threads(omp_get_max_threads())
+		{
+			if( n_threads <= 0 ) return;
+			if( omp_get_active_level() > 0 && n_threads > _saved_n_threads ) {
+				n_threads = _saved_n_threads;
+			}
+			omp_set_num_threads(n_threads);
+		}
+
+		~ThreadTeamScope()
+		{
+			omp_set_num_threads(_saved_n_threads);
+		}
+
+		ThreadTeamScope(const ThreadTeamScope&) = delete;
+		ThreadTeamScope& operator=(const ThreadTeamScope&) = delete;
+
+	private:
+		const int _saved_n_threads;
+	};
+
+	/** AlignedAllocator
+	 *
+	 *  Allocates at alignof(T). Before C++17 neither new nor std::allocator honour
+	 *  the alignment of an over-aligned type, e.g. the alignas(64) slots of SpinTeam.
+	 */
+	template<typename T>
+	struct AlignedAllocator {
+		using value_type = T;
+
+		AlignedAllocator() {}
+		template<typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+		T* allocate(std::size_t n)
+		{
+			void* ptr = nullptr;
+			const std::size_t alignment = alignof(T) > sizeof(void*) ? alignof(T) : sizeof(void*);
+			if( posix_memalign(&ptr, alignment, n*sizeof(T)) != 0 ) throw std::bad_alloc();
+			return static_cast<T*>(ptr);
+		}
+
+		void deallocate(T* ptr, std::size_t) { std::free(ptr); }
+	};
+
+	template<typename T, typename U>
+	bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return true; }
+
+	template<typename T, typename U>
+	bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return false; }
+
+	/** SpinTeam
+	 *
+	 *  Synchronisation for a team of n_threads threads which keeps one parallel region
+	 *  open over a whole solve, instead of forking and joining in every kernel (see the
+	 *  ...InTeam kernels in coarse_l1_blas.h and PersistentMRSmootherCoarse). Every thread
+	 *  of the team calls each method with its thread id, in the same order.
+	 *
+	 *  Barrier() is a sense-reversing barrier which spins on a flag in its own cache line.
+	 *  That is much cheaper than a fork/join. After a few microseconds of spinning a waiting
+	 *  thread yields its core, in case the team has more threads than there are cores.
+	 *
+	 *  Sum() adds up the values of all the threads, and over the nodes, with one barrier.
+	 *  Every thread gets the same result, summed in thread order.
+	 */
+	class SpinTeam {
+	public:
+		//! The most values one Sum() can add up
+		static constexpr int MaxSumLength = 4;
+
+		explicit SpinTeam(int n_threads);
+
+		SpinTeam(const SpinTeam&) = delete;
+		SpinTeam& operator=(const SpinTeam&) = delete;
+
+		// On the heap at the alignment of the padded members, see AlignedAllocator
+		static void* operator new(std::size_t size)
+		{
+			void* ptr = nullptr;
+			if( posix_memalign(&ptr, alignof(SpinTeam), size) != 0 ) throw std::bad_alloc();
+			return ptr;
+		}
+		static void operator delete(void* ptr) { std::free(ptr); }
+
+		inline
+		int GetNumThreads() const { return _n_threads; }
+
+		void Barrier(int tid);
+
+		//! values[0..n-1] <- their sum over the team and the nodes, n <= MaxSumLength
+		void Sum(int tid, double* values, int n);
+
+	private:
+		// One per cache line, so threads do not share lines they write to
+		struct alignas(64) PaddedBool { bool value; };
+		struct alignas(64) PaddedCount { std::atomic<int> count; };
+		struct alignas(64) PaddedFlag { std::atomic<bool> sense; };
+		struct alignas(64) PaddedValues { double values[MaxSumLength]; };
+
+		const int _n_threads;
+		const int _num_nodes;
+		PaddedCount _count;
+		PaddedFlag _sense;
+		std::vector<PaddedBool, AlignedAllocator<PaddedBool>> _my_sense;
+		std::vector<PaddedBool, AlignedAllocator<PaddedBool>> _my_phase;
+
+		// Two sets of slots, alternating between calls, so a Sum() can fill one while
+		// slow threads still read the other: this saves a second barrier
+		std::vector<PaddedValues, AlignedAllocator<PaddedValues>> _slots[2];
+		PaddedValues _node_sum[2];
+	};
+
+	/** ThreadTeamSolver
+	 *
+	 *  Runs a solver in a ThreadTeamScope of n_threads threads. The recursive V-cycles wrap
+	 *  the solver of each coarse level in one, so the level, its smoothers and its cycle run
+	 *  on the team of the level and the levels below switch to theirs.
+	 */
+	template<typename Spinor, typename Gauge>
+	class ThreadTeamSolver : public LinearSolver<Spinor,Gauge> {
+	public:
+		ThreadTeamSolver(const std::shared_ptr<const LinearSolver<Spinor,Gauge>>& solver, int n_threads) :
+			_solver(solver), _n_threads(n_threads) {}
+
+		LinearSolverResults operator()(Spinor& out, const Spinor& in, ResiduumType resid_type = RELATIVE ) const override
+		{
+			ThreadTeamScope team(_n_threads);
+			return (*_solver)(out, in, resid_type);
+		}
+
+		std::vector<LinearSolverResults> MultiSolve(SpinorSet<Spinor>& out, const SpinorSet<Spinor>& in,
+				int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+		{
+			ThreadTeamScope team(_n_threads);
+			return _solver->MultiSolve(out, in, n_vecs, resid_type);
+		}
+
+		void SetOuterResidual(double rel_resid) const override
+		{
+			_solver->SetOuterResidual(rel_resid);
+		}
+
+		void SetRsdTarget(double rsd_target) const override
+		{
+			_solver->SetRsdTarget(rsd_target);
+		}
+
+	private:
+		const std::shared_ptr<const LinearSolver<Spinor,Gauge>> _solver;
+		const int _n_threads;
+	};
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_THREAD_TEAM_H_ */
@@ -0,0 +1,222 @@
+/*
+ * vcycle_additive_coarse.h
+ */
+
+#ifndef INCLUDE_LATTICE_COARSE_VCYCLE_ADDITIVE_COARSE_H_
+#define INCLUDE_LATTICE_COARSE_VCYCLE_ADDITIVE_COARSE_H_
+
+#include "MG_config.h"
+
+#include "lattice/constants.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/coarse/aggregate_block_coarse.h"
+#include "lattice/coarse/coarse_transfer.h"
+#include "lattice/spinor_workspace.h"
+#include "utils/print_utils.h"
+#include <algorithm>
+#include <omp.h>
+
+#ifdef MG_ENABLE_TIMERS
+#include "utils/timer.h"
+#endif
+
+namespace MG {
+
+/** AdditiveVCycleCoarse
+ *
+ *  Additive variant of VCycleCoarse. Each iteration computes the smoothing and the
+ *  coarse correction from the same residual r,
+ *
+ *      out += S r + P A_c^{-1} R r,    r = in - M_fine out
+ *
+ *  so the two do not depend on each other and run concurrently, on two disjoint
+ *  subteams of the OpenMP threads. On the coarse levels there are far fewer sites
+ *  than threads, so the smoother alone cannot keep all the cores busy: here the idle
+ *  ones work on the correction from the level below instead. The preconditioner is
+ *  weaker than the multiplicative cycle, so an outer FGMRES may take a few more
+ *  iterations, but each application should take less wall-clock time. It costs one
+ *  M_fine application per iteration, for the residual.
+ *
+ *  The smoothing subteam has n_smoother_threads threads (half of them if 0) and the
+ *  coarse correction the rest. The subteams are opened with proc_bind(spread), so with
+ *  e.g. OMP_PLACES=cores OMP_PROC_BIND=spread,close each gets its own contiguous set of
+ *  cores. Nested parallelism is enabled for the duration of the call.
+ *
+ *  The constructor matches that of VCycleCoarse so it can be used in the recursive
+ *  V-cycles. There is a single smoothing, with the pre-smoother: the post-smoother is
+ *  not used. With more than one node the two parts run one after the other, since their
+ *  halo exchanges and global sums must be issued in the same order on every node.
+ */
+class AdditiveVCycleCoarse : public LinearSolver<CoarseSpinor,CoarseGauge>
+{
+public:
+	LinearSolverResults operator()(CoarseSpinor& out, const CoarseSpinor& in, ResiduumType resid_type = RELATIVE ) const
+	{
+		const int level = _M_fine.GetLevel();
+#ifdef MG_ENABLE_TIMERS
+		timerAPI->startTimer("AdditiveVCycleCoarse/operator()/level"+std::to_string(level));
+#endif
+		const LatticeInfo& info = _M_fine.GetInfo();
+		AssertCompatible(out.GetInfo(), info);
+		AssertCompatible(in.GetInfo(), info);
+
+		LinearSolverResults res;
+		res.resid_type = resid_type;
+
+		// All the temporaries are taken here, as the workspace must not be used from
+		// inside the parallel region
+		auto r_scratch = _work.Get(info);
+		auto tmp_scratch = _work.Get(info);
+		auto delta_s_scratch = _work.Get(info);
+		auto delta_c_scratch = _work.Get(info);
+		auto coarse_in_scratch = _work.Get(_coarse_info);
+		auto coarse_delta_scratch = _work.Get(_coarse_info);
+		CoarseSpinor& r = *r_scratch;
+		CoarseSpinor& tmp = *tmp_scratch;
+		CoarseSpinor& delta_s = *delta_s_scratch;
+		CoarseSpinor& delta_c = *delta_c_scratch;
+		CoarseSpinor& coarse_in = *coarse_in_scratch;
+		CoarseSpinor& coarse_delta = *coarse_delta_scratch;
+
+		ZeroVec(out);
+		CopyVec(r,in);
+		double norm_r = sqrt(Norm2Vec(r));
+		const double norm_in = norm_r;
+
+		double target = _param.RsdTarget;
+		if( resid_type == RELATIVE ) {
+			target *= norm_r;
+		}
+
+		int iter = 0;
+		bool continueP = ( norm_r > target ) && ( _param.MaxIter > 0 );
+		while( continueP ) {
+			++iter;
+
+			ZeroVec(delta_s);
+			ZeroVec(coarse_delta);
+			smoothAndCorrect(r, delta_s, coarse_in, coarse_delta, delta_c);
+
+			// delta_s += delta_c; out += delta_s; r -= M_fine delta_s
+			YpeqxVec(delta_c,delta_s);
+			YpeqxVec(delta_s,out);
+			_M_fine(tmp, delta_s, LINOP_OP);
+			norm_r = sqrt(XmyNorm2Vec(r,tmp));
+
+			if( _param.VerboseP ) {
+				MasterLog(INFO, "ADDITIVE VCYCLE (COARSE->COARSE): level=%d iter=%d || r ||=%16.8e Target=%16.8e",
+						level, iter, norm_r, target);
+			}
+			continueP = ( iter < _param.MaxIter ) && ( norm_r > target );
+		}
+
+		res.n_count = iter;
+		res.resid = norm_r;
+		if( resid_type == RELATIVE && norm_in > 0 ) {
+			res.resid /= norm_in;
+		}
+#ifdef MG_ENABLE_TIMERS
+		timerAPI->stopTimer("AdditiveVCycleCoarse/operator()/level"+std::to_string(level));
+#endif
+		return res;
+	}
+
+	AdditiveVCycleCoarse(const LatticeInfo& coarse_info,
+			const std::vector<Block>& my_blocks,
+			const std::vector<std::shared_ptr<CoarseSpinor> >& vecs,
+			const LinearOperator<CoarseSpinor, CoarseGauge>& M_fine,
+			const Smoother<CoarseSpinor,CoarseGauge>& pre_smoother,
+			const Smoother<CoarseSpinor,CoarseGauge>& post_smoother,
+			const LinearSolver<CoarseSpinor,CoarseGauge>& bottom_solver,
+			const LinearSolverParamsBase& param,
+			int n_smoother_threads = 0) : _coarse_info(coarse_info),
+					_M_fine(M_fine),
+					_smoother(pre_smoother),
+					_bottom_solver(bottom_solver),
+					_param(param),
+					_n_smoother_threads(n_smoother_threads),
+					_num_nodes(NodeInfo().NumNodes()),
+					_Transfer(my_blocks,vecs)
+	{
+		if( _n_smoother_threads < 0 ) {
+			MasterLog(ERROR, "AdditiveVCycleCoarse: level=%d Invalid Value: n_smoother_threads < 0", _M_fine.GetLevel());
+		}
+#ifdef MG_ENABLE_TIMERS
+		timerAPI = MG::Timer::TimerAPI::getInstance();
+		timerAPI->addTimer("AdditiveVCycleCoarse/operator()/level"+std::to_string(_M_fine.GetLevel()));
+#endif
+	}
+
+	// Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_bottom_solver.SetOuterResidual(rel_resid);
+	}
+
+private:
+	// delta_s = S r on one subteam, delta_c = P A_c^{-1} R r on the other
+	void smoothAndCorrect(const CoarseSpinor& r, CoarseSpinor& delta_s,
+			CoarseSpinor& coarse_in, CoarseSpinor& coarse_delta, CoarseSpinor& delta_c) const
+	{
+		const int n_threads = omp_get_max_threads();
+		const bool concurrentP = ( n_threads > 1 ) && ( _num_nodes == 1 );
+
+		if( !concurrentP ) {
+			_smoother(delta_s, r);
+			coarseCorrection(r, coarse_in, coarse_delta, delta_c);
+			return;
+		}
+
+		int n_smoother_threads = ( _n_smoother_threads > 0 ) ? _n_smoother_threads : n_threads/2;
+		n_smoother_threads = std::min(std::max(n_smoother_threads, 1), n_threads-1);
+		const int n_coarse_threads = n_threads - n_smoother_threads;
+
+		// The subteams are nested one level below the current one
+		const int saved_max_active_levels = omp_get_max_active_levels();
+		omp_set_max_active_levels( std::max(saved_max_active_levels, omp_get_active_level()+2) );
+
+#pragma omp parallel num_threads(2) proc_bind(spread)
+		{
+			// Sets the team size of the kernels this thread starts. It is local to this
+			// implicit task, so it is gone after the region
+			if( omp_get_thread_num() == 0 ) {
+				omp_set_num_threads(n_smoother_threads);
+				_smoother(delta_s, r);
+			}
+			else {
+				omp_set_num_threads(n_coarse_threads);
+				coarseCorrection(r, coarse_in, coarse_delta, delta_c);
+			}
+		}
+
+		omp_set_max_active_levels(saved_max_active_levels);
+	}
+
+	void coarseCorrection(const CoarseSpinor& r, CoarseSpinor& coarse_in,
+			CoarseSpinor& coarse_delta, CoarseSpinor& delta_c) const
+	{
+		_Transfer.R(r,coarse_in);
+		_bottom_solver(coarse_delta,coarse_in);
+		_Transfer.P(coarse_delta,delta_c);
+	}
+
+	const LatticeInfo& _coarse_info;
+	const LinearOperator< CoarseSpinor, CoarseGauge>& _M_fine;
+	const Smoother<CoarseSpinor,CoarseGauge>& _smoother;
+	const LinearSolver<CoarseSpinor,CoarseGauge>& _bottom_solver;
+	const LinearSolverParamsBase& _param;
+	const int _n_smoother_threads;
+	const int _num_nodes;
+	const CoarseTransfer _Transfer;
+	mutable SpinorWorkspace<CoarseSpinor> _work;
+#ifdef MG_ENABLE_TIMERS
+	std::shared_ptr<Timer::TimerAPI> timerAPI;
+#endif
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_COARSE_VCYCLE_ADDITIVE_COARSE_H_ */
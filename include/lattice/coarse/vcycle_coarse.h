@@ -21,6 +21,8 @@
 #include "lattice/coarse/coarse_transfer.h"
 #include "utils/print_utils.h"
 #include "lattice/coarse/subset.h"
+#include "lattice/spinor_workspace.h"
+#include "lattice/coarse/coarse_spinor_set.h"
 
 #ifdef MG_ENABLE_TIMERS
 #include "utils/timer.h"
@@ -44,8 +46,12 @@ public:
 
 		LinearSolverResults res;
 
-		CoarseSpinor tmp(info);  // Use these to compute residua
-		CoarseSpinor r(info);    //
+		// Use these to compute residua. The temporaries come from the workspace, so only
+		// the first call allocates them
+		auto tmp_scratch = _work.Get(_M_fine.GetInfo());
+		auto r_scratch = _work.Get(_M_fine.GetInfo());
+		CoarseSpinor& tmp = *tmp_scratch;
+		CoarseSpinor& r = *r_scratch;
 
 		int level = _M_fine.GetLevel();
 
@@ -97,22 +103,25 @@ public:
 			++iter;
 
 
-			CoarseSpinor delta(info);
+			auto delta_scratch = _work.Get(_M_fine.GetInfo());
+			CoarseSpinor& delta = *delta_scratch;
 			ZeroVec(delta);
 
-			// Smoother does not compute a residuum
-			_pre_smoother(delta,r);
+			// Take the residuum from the smoother if it has it, else recompute it
+			if( !_pre_smoother.SmoothAndUpdateResidual(delta,r) ) {
+				_pre_smoother(delta,r);
+
+				// Update residuum
+				_M_fine(tmp,delta, LINOP_OP);
+
+				// r -= tmp;
+				YmeqxVec(tmp,r);
+			}
 
 			// Update solution
 			// out += delta;
 			YpeqxVec(delta,out);
 
-			// Update residuum
-			_M_fine(tmp,delta, LINOP_OP);
-
-			// r -= tmp;
-			YmeqxVec(tmp,r);
-
 			if ( _param.VerboseP ) {
 				double norm_pre_presmooth=sqrt(Norm2Vec(r));
 				if( resid_type == RELATIVE ) {
@@ -127,12 +136,14 @@ public:
 				}
 			}
 
-			CoarseSpinor coarse_in(_coarse_info);
+			auto coarse_in_scratch = _work.Get(_coarse_info);
+			CoarseSpinor& coarse_in = *coarse_in_scratch;
 
 			// Coarsen r
 			_Transfer.R(r,coarse_in);
 
-			CoarseSpinor coarse_delta(_coarse_info);
+			auto coarse_delta_scratch = _work.Get(_coarse_info);
+			CoarseSpinor& coarse_delta = *coarse_delta_scratch;
 			ZeroVec(coarse_delta);
 			LinearSolverResults coarse_res =_bottom_solver(coarse_delta,coarse_in);
 
@@ -164,14 +175,16 @@ public:
 
 			// delta = zero;
 			ZeroVec(delta);
-			_post_smoother(delta,r);
+			if( !_post_smoother.SmoothAndUpdateResidual(delta,r) ) {
+				_post_smoother(delta,r);
+				_M_fine(tmp,delta,LINOP_OP);
+				//r -= tmp;
+				YmeqxVec(tmp,r);
+			}
 
 			// Update full solution
 			// out += delta;
 			YpeqxVec(delta,out);
-			_M_fine(tmp,delta,LINOP_OP);
-			//r -= tmp;
-			YmeqxVec(tmp,r);
 			norm_r = sqrt(Norm2Vec(r));
 
 			if( _param.VerboseP ) {
@@ -217,6 +230,135 @@ public:
 															_param(param),
 															_Transfer(my_blocks,vecs){}
 
+	/** MultiSolve
+	 *
+	 *  The cycle on the first n_vecs right hand sides together: the smoothers, the
+	 *  residual updates, the restriction and prolongation (RMulti, PMulti) and the coarse
+	 *  solve each work on the whole batch, so the links and the transfer vectors of the
+	 *  level are streamed once per batch rather than once per vector, and the reductions
+	 *  of the vectors are done together. With the MR smoother and a coarse solver which
+	 *  overrides MultiSolve (e.g. BlockFGMRESSolverCoarse, or the cycle of the next level)
+	 *  the batch goes all the way down. The cycle runs until every vector has met the
+	 *  target, so n_count is the same for all of them.
+	 */
+	std::vector<LinearSolverResults> MultiSolve(CoarseSpinorSet& out, const CoarseSpinorSet& in,
+			int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+	{
+		const LatticeInfo& info = _M_fine.GetInfo();
+		AssertCompatible(info, out.GetInfo());
+		AssertCompatible(info, in.GetInfo());
+
+		CoarseSpinorSet& r = GetScratchSet(_multi_r, info, n_vecs);
+		CoarseSpinorSet& tmp = GetScratchSet(_multi_tmp, info, n_vecs);
+		CoarseSpinorSet& delta = GetScratchSet(_multi_delta, info, n_vecs);
+		CoarseSpinorSet& coarse_in = GetScratchSet(_multi_coarse_in, _coarse_info, n_vecs);
+		CoarseSpinorSet& coarse_delta = GetScratchSet(_multi_coarse_delta, _coarse_info, n_vecs);
+
+		const int level = _M_fine.GetLevel();
+		const std::vector<std::complex<double>> one(n_vecs, 1.0);
+		const std::vector<std::complex<double>> minus_one(n_vecs, -1.0);
+
+		// Initialize: zero initial guesses
+		for(int j=0; j < n_vecs; ++j) {
+			ZeroVec(out[j]);
+			CopyVec(r[j],in[j]);
+		}
+		std::vector<double> norm2_r(n_vecs);
+		Norm2EachVec(r, n_vecs, norm2_r.data());
+
+		std::vector<double> norm_in(n_vecs);
+		std::vector<double> target(n_vecs);
+		bool continueP = false;
+		for(int j=0; j < n_vecs; ++j) {
+			norm_in[j] = sqrt(norm2_r[j]);
+			target[j] = _param.RsdTarget;
+			if( resid_type == RELATIVE ) {
+				target[j] *= norm_in[j];
+			}
+			continueP = continueP || ( norm_in[j] > target[j] );
+		}
+		continueP = continueP && ( _param.MaxIter > 0 );
+
+		int iter = 0;
+		while ( continueP ) {
+			++iter;
+
+			// Pre-smooth, taking the residua from the smoother if it has them
+			for(int j=0; j < n_vecs; ++j) {
+				ZeroVec(delta[j]);
+			}
+			if( !_pre_smoother.MultiSmoothAndUpdateResidual(delta, r, n_vecs) ) {
+				_pre_smoother.MultiSmooth(delta, r, n_vecs);
+				_M_fine.MultiApply(tmp, delta, n_vecs, LINOP_OP);
+				AxpyEachVec(minus_one.data(), tmp, r, n_vecs);
+			}
+			AxpyEachVec(one.data(), delta, out, n_vecs);
+
+			// Coarse correction
+			_Transfer.RMulti(r, n_vecs, coarse_in);
+			for(int j=0; j < n_vecs; ++j) {
+				ZeroVec(coarse_delta[j]);
+			}
+			_bottom_solver.MultiSolve(coarse_delta, coarse_in, n_vecs);
+			_Transfer.PMulti(coarse_delta, n_vecs, delta);
+
+			AxpyEachVec(one.data(), delta, out, n_vecs);
+			_M_fine.MultiApply(tmp, delta, n_vecs, LINOP_OP);
+			AxpyEachVec(minus_one.data(), tmp, r, n_vecs);
+
+			// Post-smooth
+			for(int j=0; j < n_vecs; ++j) {
+				ZeroVec(delta[j]);
+			}
+			if( !_post_smoother.MultiSmoothAndUpdateResidual(delta, r, n_vecs) ) {
+				_post_smoother.MultiSmooth(delta, r, n_vecs);
+				_M_fine.MultiApply(tmp, delta, n_vecs, LINOP_OP);
+				AxpyEachVec(minus_one.data(), tmp, r, n_vecs);
+			}
+			AxpyEachVec(one.data(), delta, out, n_vecs);
+
+			Norm2EachVec(r, n_vecs, norm2_r.data());
+
+			bool convergedP = true;
+			for(int j=0; j < n_vecs; ++j) {
+				const double norm_r = sqrt(norm2_r[j]);
+				convergedP = convergedP && ( norm_r <= target[j] );
+
+				if( _param.VerboseP ) {
+					if( resid_type == RELATIVE ) {
+						MasterLog(INFO, "VCYCLE (COARSE->COARSE, MULTI): level=%d iter=%d rhs=%d "
+								"|| r ||/|| b ||=%16.8e Target=%16.8e",
+								level, iter, j, norm_r/norm_in[j], _param.RsdTarget);
+					}
+					else {
+						MasterLog(INFO, "VCYCLE (COARSE->COARSE, MULTI): level=%d iter=%d rhs=%d "
+								"|| r ||=%16.8e Target=%16.8e",
+								level, iter, j, norm_r, _param.RsdTarget);
+					}
+				}
+			}
+
+			// Check convergence
+			continueP = ( iter < _param.MaxIter ) && !convergedP;
+		}
+
+		std::vector<LinearSolverResults> res(n_vecs);
+		for(int j=0; j < n_vecs; ++j) {
+			res[j].resid_type = resid_type;
+			res[j].n_count = iter;
+			res[j].resid = sqrt(norm2_r[j]);
+			if( resid_type == RELATIVE ) {
+				res[j].resid = ( norm_in[j] > 0 ) ? res[j].resid/norm_in[j] : 0;
+			}
+		}
+		return res;
+	}
+
+	// Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_bottom_solver.SetOuterResidual(rel_resid);
+	}
 
 private:
 	const LatticeInfo& _coarse_info;
@@ -228,6 +370,13 @@ private:
 	const LinearSolver<CoarseSpinor,CoarseGauge>& _bottom_solver;
 	const LinearSolverParamsBase& _param;
 	const CoarseTransfer _Transfer;
+	mutable SpinorWorkspace<CoarseSpinor> _work;
+	// Scratch sets for MultiSolve, reallocated only for a bigger batch
+	mutable std::unique_ptr<CoarseSpinorSet> _multi_r;
+	mutable std::unique_ptr<CoarseSpinorSet> _multi_tmp;
+	mutable std::unique_ptr<CoarseSpinorSet> _multi_delta;
+	mutable std::unique_ptr<CoarseSpinorSet> _multi_coarse_in;
+	mutable std::unique_ptr<CoarseSpinorSet> _multi_coarse_delta;
 };
 
 class VCycleCoarseEO : public LinearSolver<CoarseSpinor,CoarseGauge>
@@ -246,8 +395,12 @@ public:
 
 		LinearSolverResults res;
 
-		CoarseSpinor tmp(info);  // Use these to compute residua
-		CoarseSpinor r(info);    //
+		// Use these to compute residua. The temporaries come from the workspace, so only
+		// the first call allocates them
+		auto tmp_scratch = _work.Get(_M_fine.GetInfo());
+		auto r_scratch = _work.Get(_M_fine.GetInfo());
+		CoarseSpinor& tmp = *tmp_scratch;
+		CoarseSpinor& r = *r_scratch;
 
 		int level = _M_fine.GetLevel();
 		const CBSubset& subset = _M_fine.GetSubset();
@@ -313,7 +466,8 @@ public:
 			++iter;
 
 
-			CoarseSpinor delta(info);
+			auto delta_scratch = _work.Get(_M_fine.GetInfo());
+			CoarseSpinor& delta = *delta_scratch;
 			ZeroVec(delta);
 
 			// Smoother does not compute a residuum
@@ -344,12 +498,14 @@ public:
 				}
 			}
 
-			CoarseSpinor coarse_in(_coarse_info);
+			auto coarse_in_scratch = _work.Get(_coarse_info);
+			CoarseSpinor& coarse_in = *coarse_in_scratch;
 
 			// Coarsen r
 			_Transfer.R(r,coarse_in);
 
-			CoarseSpinor coarse_delta(_coarse_info);
+			auto coarse_delta_scratch = _work.Get(_coarse_info);
+			CoarseSpinor& coarse_delta = *coarse_delta_scratch;
 			ZeroVec(coarse_delta);
 
 			// Again, this is an unprec solve, tho it may be a wrapped even-odd
@@ -438,6 +594,11 @@ public:
 															_param(param),
 															_Transfer(my_blocks,vecs){}
 
+	// Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_bottom_solver.SetOuterResidual(rel_resid);
+	}
 
 private:
 	const LatticeInfo& _coarse_info;
@@ -449,6 +610,7 @@ private:
 	const LinearSolver<CoarseSpinor,CoarseGauge>& _bottom_solver;
 	const LinearSolverParamsBase& _param;
 	const CoarseTransfer _Transfer;
+	mutable SpinorWorkspace<CoarseSpinor> _work;
 };
 
 class VCycleCoarseEO2 : public LinearSolver<CoarseSpinor,CoarseGauge>
@@ -471,8 +633,12 @@ public:
 
 		LinearSolverResults res;
 
-		CoarseSpinor tmp(info);  // Use these to compute residua
-		CoarseSpinor r(info);    //
+		// Use these to compute residua. The temporaries come from the workspace, so only
+		// the first call allocates them
+		auto tmp_scratch = _work.Get(_M_fine.GetInfo());
+		auto r_scratch = _work.Get(_M_fine.GetInfo());
+		CoarseSpinor& tmp = *tmp_scratch;
+		CoarseSpinor& r = *r_scratch;
 
 
 		const CBSubset& subset = _M_fine.GetSubset();
@@ -538,14 +704,18 @@ public:
 			++iter;
 
 
-			CoarseSpinor delta(info);
+			auto delta_scratch = _work.Get(_M_fine.GetInfo());
+			CoarseSpinor& delta = *delta_scratch;
 #ifdef MG_ENABLE_TIMERS
             timerAPI->startTimer("VCycleCoarseEO2/presmooth/level"+std::to_string(level));
 #endif
 			ZeroVec(delta,subset);
-			// Smoother does not compute a residuum
-			// It is an 'unprec' smoother tho it may use internally a wrapped even-odd
-			_pre_smoother(delta,r);
+			// The smoother works on the odd subset with M_fine. If it returns the
+			// residuum there is no need to recompute it below
+			const bool pre_updated_r = _pre_smoother.SmoothAndUpdateResidual(delta,r);
+			if( !pre_updated_r ) {
+				_pre_smoother(delta,r);
+			}
 #ifdef MG_ENABLE_TIMERS
             timerAPI->stopTimer("VCycleCoarseEO2/presmooth/level"+std::to_string(level));
 #endif
@@ -557,10 +727,12 @@ public:
 			// Update solution
 			// out += delta;
 			YpeqxVec(delta,out,subset);
-			// Update prec residuum
-			_M_fine(tmp,delta, LINOP_OP);
-			// r -= tmp;
-			YmeqxVec(tmp,r,subset);
+			if( !pre_updated_r ) {
+				// Update prec residuum
+				_M_fine(tmp,delta, LINOP_OP);
+				// r -= tmp;
+				YmeqxVec(tmp,r,subset);
+			}
 #ifdef MG_ENABLE_TIMERS
             timerAPI->stopTimer("VCycleCoarseEO2/update/level"+std::to_string(level));
 #endif
@@ -581,12 +753,14 @@ public:
 #ifdef MG_ENABLE_TIMERS
 			 timerAPI->startTimer("VCycleCoarseEO2/restrictFrom/level"+std::to_string(level));
 #endif
-			CoarseSpinor coarse_in(_coarse_info);
+			auto coarse_in_scratch = _work.Get(_coarse_info);
+			CoarseSpinor& coarse_in = *coarse_in_scratch;
 			_Transfer.R(r,ODD,coarse_in);
 #ifdef MG_ENABLE_TIMERS
 			 timerAPI->stopTimer("VCycleCoarseEO2/restrictFrom/level"+std::to_string(level));
 #endif
-			CoarseSpinor coarse_delta(_coarse_info);
+			auto coarse_delta_scratch = _work.Get(_coarse_info);
+			CoarseSpinor& coarse_delta = *coarse_delta_scratch;
             
 #ifdef MG_ENABLE_TIMERS
       timerAPI->startTimer("VCycleCoarseEO2/bottom_solve/level"+std::to_string(level));
@@ -640,7 +814,10 @@ public:
 #endif
 			// delta = zero;
 			ZeroVec(delta,subset);
-			_post_smoother(delta,r);
+			const bool post_updated_r = _post_smoother.SmoothAndUpdateResidual(delta,r);
+			if( !post_updated_r ) {
+				_post_smoother(delta,r);
+			}
 #ifdef MG_ENABLE_TIMERS
             timerAPI->stopTimer("VCycleCoarseEO2/postsmooth/level"+std::to_string(level));
 #endif
@@ -651,9 +828,11 @@ public:
 			// Update full solution
 			// out += delta;
 			YpeqxVec(delta,out,subset);
-			_M_fine(tmp,delta,LINOP_OP);
-			//r -= tmp;
-			YmeqxVec(tmp,r,subset);
+			if( !post_updated_r ) {
+				_M_fine(tmp,delta,LINOP_OP);
+				//r -= tmp;
+				YmeqxVec(tmp,r,subset);
+			}
 			norm_r = sqrt(Norm2Vec(r,subset));
 #ifdef MG_ENABLE_TIMERS
             timerAPI->stopTimer("VCycleCoarseEO2/update/level"+std::to_string(level));
@@ -719,6 +898,11 @@ public:
 #endif
 					}
 
+	// Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_bottom_solver.SetOuterResidual(rel_resid);
+	}
 
 private:
 	const LatticeInfo& _coarse_info;
@@ -730,6 +914,7 @@ private:
 	const LinearSolver<CoarseSpinor,CoarseGauge>& _bottom_solver;
 	const LinearSolverParamsBase& _param;
 	const CoarseTransfer _Transfer;
+	mutable SpinorWorkspace<CoarseSpinor> _work;
 #ifdef MG_ENABLE_TIMERS
     std::shared_ptr<Timer::TimerAPI> timerAPI;
 #endif
@@ -19,6 +19,20 @@ namespace MG {
  struct FGMRESParams : public MG::LinearSolverParamsBase {
  public:
 	 int NKrylov;
+
+	 /*! Use the pipelined (single reduction) Arnoldi process of FGMRESSolverGeneric,
+	  *  which needs one global reduction per Krylov vector instead of three,
+	  *  at the cost of keeping a third basis A Z. */
+	 bool Pipelined;
+
+	 /*! Number of harmonic Ritz vectors kept across restarts (FGMRES-DR).
+	  *  0 gives plain restarted FGMRES. Must be less than NKrylov. */
+	 int NDefl;
+
+	 FGMRESParams() {
+		 Pipelined = false;
+		 NDefl = 0;
+	 }
  };
 
 
@@ -0,0 +1,52 @@
+/*
+ * fgmresdr_restart.h
+ */
+
+#ifndef INCLUDE_LATTICE_FGMRESDR_RESTART_H_
+#define INCLUDE_LATTICE_FGMRESDR_RESTART_H_
+
+#include <complex>
+
+namespace MG {
+
+	/*! The small dense part of a deflated restart of FGMRES-DR (Morgan; Frommer et. al.)
+	 *
+	 *  At the end of a cycle of m columns we have A Z_m = V_{m+1} Hbar, with Hbar (m+1) x m,
+	 *  and the residual is V_{m+1} s with s = c - Hbar eta. Take the k harmonic Ritz vectors
+	 *  g_i of smallest magnitude, the eigenvectors of
+	 *
+	 *      H_m + |h_{m+1,m}|^2 H_m^{-H} e_m e_m^H
+	 *
+	 *  and orthonormalize P_{k+1} = [ [g_1 .. g_k ; 0 ] , s ]. Then
+	 *
+	 *      A ( Z_m P_k ) = ( V_{m+1} P_{k+1} ) P_{k+1}^H Hbar P_k
+	 *
+	 *  The (k+1) x k matrix on the right is factored as Q [ R ; 0 ], with the diagonal of R
+	 *  real and positive, and Q is absorbed into the V basis. The restarted cycle then
+	 *  starts from an upper triangular H, for which the Givens rotations are the identity.
+	 *
+	 *  All matrices are column major.
+	 *
+	 *  \param Hbar    the (m+1) x m matrix of the cycle (Read)
+	 *  \param s       the residual vector in the V basis, length m+1 (Read)
+	 *  \param m       the number of columns
+	 *  \param k       the number of harmonic Ritz vectors to keep, k < m
+	 *  \param Pz      m x k:  Z_new = Z_m Pz  (Write)
+	 *  \param Pv      (m+1) x (k+1):  V_new = V_{m+1} Pv (Write)
+	 *  \param R       (k+1) x k:  A Z_new = V_new R, upper triangular (Write)
+	 *
+	 *  \return k, or 0 if the restart could not be computed (e.g. H_m singular).
+	 *          In that case the caller should restart from scratch.
+	 */
+	int FGMRESDRRestart(const std::complex<double>* Hbar,
+			const std::complex<double>* s,
+			int m,
+			int k,
+			std::complex<double>* Pz,
+			std::complex<double>* Pv,
+			std::complex<double>* R);
+
+}
+
+
+#endif /* INCLUDE_LATTICE_FGMRESDR_RESTART_H_ */
@@ -12,15 +12,57 @@
 #include "lattice/solver.h"
 #include "lattice/mr_params.h"
 #include "lattice/fgmres_common.h"
+#include "lattice/coarse/coarse_precision.h"
 
 namespace MG {
 
+/* Shape of the coarse correction of a cycle, see MakeCoarseCorrection() */
+enum CycleShape { CYCLE_V, CYCLE_W, CYCLE_K };
+
 struct VCycleParams {
 	// Pre Smoother Params
 	MRSolverParams pre_smoother_params;
 	FGMRESParams bottom_solver_params;
 	MRSolverParams post_smoother_params;
 	LinearSolverParamsBase cycle_params;
+
+	// On the coarsest level: replace the bottom solver with a sparse LU
+	// factorization (CoarseDirectSolver). Only VerboseP of bottom_solver_params is used.
+	bool bottom_solver_direct = false;
+
+	// The coarse correction of this cycle when the next level is not the coarsest.
+	// CYCLE_V: FGMRES with bottom_solver_params, preconditioned by the next cycle.
+	// CYCLE_W: w_cycle_gamma Richardson steps of the next cycle.
+	// CYCLE_K: up to two GCR steps preconditioned by the next cycle, the second one
+	// only if the first left || r ||/|| b || above k_cycle_rsd_target.
+	CycleShape cycle_shape = CYCLE_V;
+	int w_cycle_gamma = 2;
+	double k_cycle_rsd_target = 0.25;
+
+	// Coarse-to-coarse cycles: run the smoothing and the coarse correction of this
+	// cycle concurrently (AdditiveVCycleCoarse), with additive_smoother_threads threads
+	// for the smoothing (0: half of them). Only for unpreconditioned coarse levels.
+	bool additive_cycle = false;
+	int additive_smoother_threads = 0;
+
+	// Coarse levels: run the MR smoothers of this cycle with all their iterations in one
+	// parallel region (PersistentMRSmootherCoarse). Only for unpreconditioned coarse levels.
+	bool persistent_smoother = false;
+
+	// Coarse levels: smooth with red-black block Gauss-Seidel sweeps instead of MR
+	// (BlockJacobiSmootherCoarse), which take no global reductions. MaxIter of the smoother
+	// params is the number of sweeps and Omega the relaxation weight. Only for
+	// unpreconditioned coarse levels. Takes precedence over persistent_smoother.
+	bool block_jacobi_smoother = false;
+
+	// Adaptive inner tolerance: before each application of this cycle, set the RsdTarget
+	// of its coarse solve to adaptive_safety_factor * || r ||/|| b || of the flexible
+	// solver the cycle preconditions, between bottom_solver_params.RsdTarget and
+	// adaptive_max_rsd_target (AdaptiveToleranceSolver). Only an FGMRES bottom solver,
+	// i.e. not a direct solver, W- or K-cycle, takes the target.
+	bool adaptive_tolerance = false;
+	double adaptive_safety_factor = 0.5;
+	double adaptive_max_rsd_target = 0.5;
 };
 
 struct SetupParams {
@@ -31,6 +73,14 @@ struct SetupParams {
 	std::vector< double > null_solver_rsd_target;
 	std::vector< bool > null_solver_verboseP;
 
+	// Threads for the work on each coarse level, indexed by level like n_vecs: entry 0,
+	// the fine level, is not used. 0 or no entry: GetAutoNumThreads() for the level.
+	std::vector< int > level_threads;
+
+	// Storage precision of the links of each coarse level, indexed by level like
+	// level_threads (entry 0 is not used). No entry: COARSE_PREC_FP32. The spinors,
+	// the null vectors and the arithmetic stay FP32, see CoarseGauge::SetLinkPrecision().
+	std::vector< CoarsePrecision > level_link_precision;
 
 };
 
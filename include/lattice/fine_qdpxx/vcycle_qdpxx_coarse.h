@@ -194,6 +194,11 @@ public:
 															_bottom_solver(bottom_solver),
 															_param(param) {}
 
+	// Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_bottom_solver.SetOuterResidual(rel_resid);
+	}
 
 private:
 	const LatticeInfo& _coarse_info;
@@ -12,6 +12,7 @@
 #include <memory>
 #include "lattice/solver.h"
 #include "lattice/fine_qdpxx/vcycle_qdpxx_coarse.h"
+#include "lattice/adaptive_tolerance_solver.h"
 
 using namespace QDP;
 
@@ -26,6 +27,11 @@ public:
 
 	LinearSolverResults operator()(LatticeFermion& out, const LatticeFermion& in, ResiduumType resid_type = RELATIVE ) const;
 
+	void SetOuterResidual(double rel_resid) const override;
+
+	//! Solves and iterations on each level with an adaptive tolerance, see AdaptiveToleranceSolver
+	void LogAdaptiveToleranceStats() const;
+
 private:
 
 	const std::vector<VCycleParams> _vcycle_params;
@@ -39,6 +45,7 @@ private:
 	std::vector< std::shared_ptr< const Smoother< CoarseSpinor, CoarseGauge > > >       _coarse_postsmoother;
 	std::vector< std::shared_ptr< const LinearSolver< CoarseSpinor, CoarseGauge > > >   _coarse_vcycle;
 	std::vector< std::shared_ptr< const LinearSolver< CoarseSpinor, CoarseGauge > > >   _bottom_solver;
+	std::vector< std::shared_ptr< const AdaptiveToleranceSolver< CoarseSpinor, CoarseGauge > > > _adaptive_solver;
 
 };
 
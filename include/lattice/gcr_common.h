@@ -0,0 +1,38 @@
+/*
+ * gcr_common.h
+ */
+
+#ifndef INCLUDE_LATTICE_GCR_COMMON_H_
+#define INCLUDE_LATTICE_GCR_COMMON_H_
+
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+
+namespace MG {
+
+//! Params for the flexible GCR inverter
+ /*! \ingroup invert */
+ struct GCRParams : public MG::LinearSolverParamsBase {
+ public:
+	 //! Directions per cycle. The residual is recomputed and the directions dropped at each restart
+	 int NKrylov;
+
+	 /*! Truncation: the number of previous directions each new one is orthogonalized
+	  *  against (and kept in memory). Values < 1 or >= NKrylov mean all directions
+	  *  of the cycle (plain restarted GCR). */
+	 int NTrunc;
+
+	 /*! Size of the recycle space U (GCRO-DR). The space is kept in the solver between
+	  *  calls and refined at every restart. 0 switches recycling off. */
+	 int NRecycle;
+
+	 GCRParams() {
+		 NTrunc = 0;
+		 NRecycle = 0;
+	 }
+ };
+
+}
+
+#endif /* INCLUDE_LATTICE_GCR_COMMON_H_ */
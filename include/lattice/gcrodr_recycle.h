@@ -0,0 +1,35 @@
+/*
+ * gcrodr_recycle.h
+ */
+
+#ifndef INCLUDE_LATTICE_GCRODR_RECYCLE_H_
+#define INCLUDE_LATTICE_GCRODR_RECYCLE_H_
+
+#include <complex>
+
+namespace MG {
+
+	/*! The small dense part of the recycle space update of GCRO-DR
+	 *
+	 *  Given W = [ U, Z ] with A W = C, C having orthonormal columns, the harmonic Ritz
+	 *  vectors of A in span(W) are W g with
+	 *
+	 *      (A W)^H ( A W g - theta W g ) = 0   <=>   M g = (1/theta) g,   M = C^H W
+	 *
+	 *  This picks the k of them with the smallest |theta| and orthonormalizes the g's,
+	 *  so that U_new = W G and C_new = C G = A U_new again has orthonormal columns.
+	 *
+	 *  All matrices are column major.
+	 *
+	 *  \param M   the n x n matrix C^H W (Read)
+	 *  \param n   the number of columns of W
+	 *  \param k   the number of vectors to keep, k <= n
+	 *  \param G   n x k, the new basis in terms of the old (Write)
+	 *
+	 *  \return k, or 0 if the update could not be computed.
+	 */
+	int GCRODRRecycle(const std::complex<double>* M, int n, int k, std::complex<double>* G);
+
+}
+
+#endif /* INCLUDE_LATTICE_GCRODR_RECYCLE_H_ */
@@ -9,6 +9,7 @@ blbl * lattice_utils.h
 #define INCLUDE_LATTICE_GEOMETRY_UTILS_H_
 
 #include <vector>
+#include <algorithm>
 #include "lattice/constants.h"
 #include "utils/print_utils.h"
 
@@ -142,6 +143,48 @@ namespace MG {
 		coords[0] += (cb + coords[1]+coords[2]+coords[3]+origin[0]+origin[1]+origin[2]+origin[3])&1;
 
 	}
+	/** A site in the face of a halo and the body site it is packed from */
+	struct HaloFaceSite {
+		IndexType face_site;
+		IndexType body_site;
+	};
+
+	/** Compute the face sites in direction (dir, fb) of checkerboard cb and their body sites,
+	 *  sorted by body site, so the sites a thread owns in the ThreadPartition form one range.
+	 *
+	 * @param cb_dims       The checkerboarded local lattice dimensions
+	 * @param dims          The local lattice dimensions
+	 * @param local_cb      The checkerboard with the node origin taken into account
+	 */
+	inline
+	void ComputeHaloFaceSites(const IndexArray& cb_dims, const IndexArray& dims,
+			int local_cb, int dir, int fb, int num_face_sites, std::vector<HaloFaceSite>& face_sites)
+	{
+		face_sites.resize(num_face_sites);
+		IndexArray coords;
+		for(int site=0; site < num_face_sites; ++site) {
+			coords[dir]= (fb == MG_BACKWARD ) ? 0 : dims[dir]-1;
+			if( dir == X_DIR ) {
+				// X direction is special
+				IndexArray x_cb_dims(cb_dims); x_cb_dims[Y_DIR]/=2;
+
+				IndexToCoords3(site,x_cb_dims,X_DIR,coords);
+				coords[Y_DIR] *= 2;
+				coords[Y_DIR] += ((local_cb + coords[X_DIR]+coords[Z_DIR] + coords[T_DIR])&1);
+				coords[X_DIR] /=2; // Convert back to checkerboarded X_coord
+			}
+			else {
+				// The mu-th coordinate is either 0, or the last coordinate
+				IndexToCoords3(site,cb_dims,dir,coords);
+			}
+			face_sites[site].face_site = site;
+			face_sites[site].body_site = CoordsToIndex(coords,cb_dims);
+		}
+
+		std::sort(face_sites.begin(), face_sites.end(),
+				[](const HaloFaceSite& a, const HaloFaceSite& b) { return a.body_site < b.body_site; });
+	}
+
 	// Coords and Dims are uncheckerboarded.
 	inline
 	void CoordsToCBIndex(const IndexArray& coords, const IndexArray& dims, int& cb, int &cbsite)
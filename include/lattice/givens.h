@@ -15,6 +15,9 @@ namespace FGMRESGeneric {
   class Givens {
   public:
 
+    //! The identity. A placeholder, so the rotations can live in preallocated storage
+    Givens() : col_(0), s_(0,0), c_(1,0), r_(0,0) {}
+
 
     Givens(int col, const Array2d<std::complex<double>>& H);
     /*! Apply the rotation to column col of the matrix H. The
@@ -10,9 +10,12 @@
 
 #include "MG_config.h"
 #include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/thread_partition.h"
 #include "lattice/lattice_info.h"
 #include "lattice/geometry_utils.h"
 #include <omp.h>
+#include <algorithm>
+#include <vector>
 #if defined(MG_QMP_COMMS)
 #include "lattice/halo_container_qmp.h"
 #else
@@ -56,41 +59,31 @@ void
 packFace( HaloContainer<T>& halo, const T& in, IndexType cb,  IndexType dir, IndexType fb)
 {
 	const LatticeInfo& info = in.GetInfo();
-	const IndexArray& latt_dims = info.GetLatticeDimensions();
-	const IndexArray& latt_cb_dims = info.GetCBLatticeDimensions();
-	IndexArray coords;
-
-
 
 	// Grab the buffer from the Halo
 	float* buffer = halo.GetSendToDirBuf(2*dir + fb);
 
 	//int num_color_spins = info.GetNumColorSpins();
 	int buffer_site_offset = halo.GetDataTypeSize();
-	int buffer_sites = halo.NumSitesInFace(dir);
-
-	// Loop through the sites in the buffer
-#pragma omp for
-	for(int site =0; site < buffer_sites; ++site) {
-		int local_cb = (cb  + info.GetCBOrigin())&1;
-
-		// I need to convert the face site index
-		// into a body site index in the required checkerboard.
-		coords[dir]= (fb == MG_BACKWARD ) ? 0 : latt_dims[dir]-1;
-		if( dir == 0 ) {
-			// X direction is special
-			IndexArray x_cb_dims(latt_cb_dims); x_cb_dims[Y_DIR]/=2;
-
-			IndexToCoords3(site,x_cb_dims,X_DIR,coords);
-			coords[Y_DIR] *= 2;
-			coords[Y_DIR] += ((local_cb + coords[X_DIR]+coords[Z_DIR] + coords[T_DIR])&1);
-			coords[X_DIR] /=2; // Convert back to checkerboarded X_coord
-		}
-		else {
-			// The Muth coordinate is eithe 0, or the last coordinate
-			IndexToCoords3(site,latt_cb_dims,dir,coords);
-		}
-		int body_site = CoordsToIndex(coords,latt_cb_dims);
+
+	// Each thread packs the face sites whose body sites it owns in the ThreadPartition
+	// (see thread_partition.h), so the body data is read by the thread which wrote it.
+	// The halo keeps the face sites sorted by body site, so these are one range of them.
+	// Callers must put a barrier between packing and sending.
+	IndexType min_body_site, max_body_site;
+	ThreadPartition::SplitSites(info.GetNumCBSites(), omp_get_num_threads(), omp_get_thread_num(),
+			min_body_site, max_body_site);
+
+	const std::vector<HaloFaceSite>& face_sites = halo.GetFaceSites(cb, 2*dir + fb);
+	auto by_body_site = [](const HaloFaceSite& s, IndexType body_site) { return s.body_site < body_site; };
+	auto first = std::lower_bound(face_sites.begin(), face_sites.end(), min_body_site, by_body_site);
+	auto last = std::lower_bound(first, face_sites.end(), max_body_site, by_body_site);
+
+	// Loop through my sites in the buffer
+	for(auto it = first; it != last; ++it) {
+		const IndexType site = it->face_site;
+		const IndexType body_site = it->body_site;
+
 		float* buffersite = &buffer[site*buffer_site_offset];
 		// Grab the body site
 		const float* bodysite = Accessor<T>::get(in,cb,body_site,dir,fb);
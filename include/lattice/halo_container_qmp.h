@@ -11,10 +11,12 @@
 #include "utils/memory.h"
 #include "lattice/constants.h"
 #include "lattice/lattice_info.h"
+#include "lattice/geometry_utils.h"
 #include "lattice/coarse/coarse_types.h"
 #include "utils/print_utils.h"
 #include <qmp.h>
 #include <mpi.h>
+#include <vector>
 
 using namespace MG;
 
@@ -162,6 +164,19 @@ public:
 		_am_i_pt_min = (node_coords[T_DIR]==0);
 		_am_i_pt_max = (node_coords[T_DIR]==(node_dims[T_DIR]-1));
 
+		// Precompute the body sites of the faces, so packFace can go straight
+		// to the sites a thread owns
+		for(int cb=0; cb < n_checkerboard; ++cb) {
+			const int local_cb = (cb + _latt_info.GetCBOrigin())&1;
+			for(int mu=0; mu < n_dim; ++mu) {
+				if( ! _local_dir[mu] ) {
+					for(int fb=0; fb < 2; ++fb) {
+						ComputeHaloFaceSites(_latt_info.GetCBLatticeDimensions(), latt_size,
+								local_cb, mu, fb, _n_face_dir[mu], _face_sites[cb][2*mu+fb]);
+					}
+				}
+			}
+		}
 
 	}// Function
 
@@ -321,6 +336,9 @@ public:
 
 	int    NumSitesInFace(int mu) const { return _n_face_dir[mu]; }
 
+	/** The face sites of checkerboard cb to send in direction mu=2*dir+fb, sorted by body site */
+	const std::vector<HaloFaceSite>& GetFaceSites(int cb, int mu) const { return _face_sites[cb][mu]; }
+
 	const LatticeInfo& GetInfo() const {
 		return _latt_info;
 	}
@@ -363,6 +381,8 @@ private:
     bool _am_i_pt_min;
     bool _am_i_pt_max;
 
+    std::vector<HaloFaceSite> _face_sites[2][8];
+
 
 
 
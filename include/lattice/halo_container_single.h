@@ -10,6 +10,8 @@
 
 #include "lattice/constants.h"
 #include "lattice/lattice_info.h"
+#include "lattice/geometry_utils.h"
+#include <vector>
 #include "lattice/coarse/coarse_types.h"
 
 using namespace MG;
@@ -51,6 +53,7 @@ public:
 	const float* GetRecvFromDirBuf(int mu) const { return nullptr; }
 
 	int NumSitesInFace(int mu) const { return 0; }
+	const std::vector<HaloFaceSite>& GetFaceSites(int cb, int mu) const { return _face_sites; }
 	// FIXME: Ist his wrong?
 	// We can still have sites in the face just because there is no comms
 
@@ -67,6 +70,7 @@ public:
 private:
 	const LatticeInfo& _info;
 	size_t _datatype_size;
+	std::vector<HaloFaceSite> _face_sites; // Always empty
 
 }; // Halo class
 
@@ -0,0 +1,429 @@
+/*
+ * invblockfgmres_generic.h
+ */
+
+#ifndef INCLUDE_LATTICE_INVBLOCKFGMRES_GENERIC_H_
+#define INCLUDE_LATTICE_INVBLOCKFGMRES_GENERIC_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <algorithm>
+
+#include "utils/print_utils.h"
+#include "lattice/fgmres_common.h"
+#include "lattice/coarse/subset.h"
+#include "lattice/spinor_set.h"
+#include "lattice/block_fgmres_dense.h"
+
+namespace MG {
+
+namespace FGMRESGeneric {
+
+/* Block directions whose Gram matrix eigenvalue is below block_drop_tol times the
+ * largest one are treated as linearly dependent and dropped (see BlockOrthonormalizeGram).
+ * The vectors may be single precision, so this is about the square of its epsilon.
+ */
+static const double block_drop_tol = 1.0e-12;
+
+/* The second block Gram-Schmidt pass is only done when the first one left some column
+ * with less than block_reorth_tol of its squared norm (about 10% of the norm), and
+ * the second SVQB pass only when the condition number of the Gram matrix exceeds
+ * block_svqb_cond. For milder cancellations the error of a single pass is already at
+ * the precision the (possibly single precision) vectors are stored in.
+ */
+static const double block_reorth_tol = 1.0e-2;
+static const double block_svqb_cond = 1.0e2;
+
+/** BlockFGMRESSolverGeneric
+ *
+ *  Restarted block flexible GMRES for k right hand sides at once (O'Leary; Calandra et. al.
+ *  for the flexible variant). The k residuals span the first block V_0 of the basis and
+ *  each block Arnoldi step does, on the p <= k active right hand sides,
+ *
+ *      Z_j = M^{-1} V_j        one MultiSolve of the preconditioner on p vectors
+ *      W   = A Z_j             one MultiApply of the operator on p vectors
+ *      W  -= V_i (V_i^H W)     block classical Gram-Schmidt, i=0..j, repeated if needed
+ *      W   = V_{j+1} R         SVQB on the p x p Gram matrix, repeated if needed
+ *
+ *  so every operator application, halo exchange and global reduction is shared by the
+ *  p vectors, and every right hand side sees the whole (j+1)p dimensional search space.
+ *  A Householder QR of the (j+2)p x (j+1)p block Hessenberg matrix, updated every
+ *  step, gives the residual norm of each right hand side; the least squares problem
+ *  itself is solved (with Eigen) once, at the end of the cycle.
+ *
+ *  Right hand sides are dropped from the block at the restarts once their true
+ *  residuals have converged. A block which becomes rank deficient within a cycle just
+ *  loses the dependent directions (there is no breakdown).
+ *
+ *  NKrylov is the number of block steps per cycle, so the basis holds (NKrylov+1)k
+ *  vectors. MaxIter bounds the total number of block steps. n_count in the results
+ *  is the number of block steps during which that right hand side was active.
+ *  The workspace is allocated on the first solve, for the number of right hand sides.
+ */
+template<typename ST, typename GT>
+class BlockFGMRESSolverGeneric : public LinearSolver<ST,GT>
+{
+public:
+  BlockFGMRESSolverGeneric(const LinearOperator<ST,GT>& A,
+      const MG::LinearSolverParamsBase& params,
+      const LinearSolver<ST,GT>* M_prec=nullptr) : _A(A), _info(A.GetInfo()),
+      _params(static_cast<const FGMRESParams&>(params)), _M_prec(M_prec), _block_size(0)
+  {
+    if( _params.NKrylov < 1 ) {
+      MasterLog(ERROR, "BlockFGMRESSolverGeneric: NKrylov=%d must be at least 1", _params.NKrylov);
+    }
+  }
+
+  BlockFGMRESSolverGeneric(std::shared_ptr<const LinearOperator<ST,GT>> A,
+      const MG::LinearSolverParamsBase& params,
+      const LinearSolver<ST,GT>* M_prec=nullptr)  : BlockFGMRESSolverGeneric(*A,params,M_prec) {}
+
+  //! A single right hand side: a block of one
+  LinearSolverResults operator()(ST& out, const ST& in, ResiduumType resid_type = RELATIVE) const override
+  {
+    const CBSubset& subset = _A.GetSubset();
+    SpinorSet<ST> X(_info, 1);
+    SpinorSet<ST> B(_info, 1);
+    CopyVec(X[0], out, SUBSET_ALL);
+    CopyVec(B[0], in, SUBSET_ALL);
+
+    std::vector<LinearSolverResults> res = MultiSolve(X, B, 1, resid_type);
+
+    CopyVec(out, X[0], subset);
+    return res[0];
+  }
+
+  std::vector<LinearSolverResults> MultiSolve(SpinorSet<ST>& out, const SpinorSet<ST>& in,
+      int n_vecs, ResiduumType resid_type = RELATIVE) const override
+  {
+    const CBSubset& subset = _A.GetSubset();
+    const int level = _A.GetLevel();
+    const int m = _params.NKrylov;
+    const int k = n_vecs;
+
+    std::vector<LinearSolverResults> res(k);
+    if( k <= 0 ) return res;
+
+    allocate(k);
+
+    std::vector<double> norm_in(k);
+    std::vector<double> target(k);
+    for(int c=0; c < k; ++c) {
+      norm_in[c] = sqrt(Norm2Vec(in[c], subset));
+      target[c] = _params.RsdTarget;
+      if( resid_type == RELATIVE ) {
+        target[c] *= norm_in[c];
+      }
+      res[c].resid_type = resid_type;
+      res[c].n_count = 0;
+    }
+
+    // Everything is 'active' for the first residual computation
+    std::vector<int> active(k);
+    for(int c=0; c < k; ++c) active[c] = c;
+    std::vector<double> norm_r(k);
+    computeResiduals(out, in, active, norm_r);
+
+    // Dense workspace, column major, sized for the full block
+    const int ld = (m+1)*k;
+    std::vector<std::complex<double>> H(ld*m*k);
+    std::vector<std::complex<double>> E(ld*k);
+    std::vector<std::complex<double>> Y(m*k*k);
+    std::vector<std::complex<double>> R_blk(k*k);
+    std::vector<std::complex<double>> h(k*k);
+    std::vector<std::complex<double>> G(k*k);
+    std::vector<double> resid_est(k);
+    std::vector<double> resid_lsq(k);
+    BlockHessenbergQR hessenberg_qr;
+
+    int iter = 0;
+    while( iter < _params.MaxIter ) {
+
+      // Drop the converged right hand sides
+      std::vector<int> still_active;
+      for(int c : active) {
+        if( norm_r[c] > target[c] ) still_active.push_back(c);
+      }
+      active.swap(still_active);
+      if( active.empty() ) break;
+
+      const int p = active.size();
+
+      if( _params.VerboseP ) {
+        double max_rel = 0;
+        for(int c : active) max_rel = std::max(max_rel, norm_r[c]/norm_in[c]);
+        MasterLog(INFO, "BLOCK FGMRES: level=%d iter=%d active rhs=%d max || r ||/|| b ||=%16.8e",
+            level, iter, p, max_rel);
+      }
+
+      std::fill(H.begin(), H.end(), std::complex<double>(0,0));
+      std::fill(E.begin(), E.end(), std::complex<double>(0,0));
+
+      // V_0 S = R
+      for(int a=0; a < p; ++a) {
+        CopyVec((*W_)[a], (*R_)[ active[a] ], subset);
+      }
+      GramMatrix(*W_, p, G.data(), subset);
+      blockOrthonormalize(W_, V_[0], p, G.data(), R_blk.data());
+      for(int b=0; b < p; ++b) {
+        for(int a=0; a < p; ++a) {
+          E[a + ld*b] = R_blk[a + p*b];
+        }
+      }
+      hessenberg_qr.reset(R_blk.data(), p);
+
+      int n_steps = 0;
+      for(int j=0; j < m; ++j) {
+
+        // Z_j = M^{-1} V_j, for the whole block
+        if( _M_prec != nullptr ) {
+          _M_prec->MultiSolve(*Z_[j], *V_[j], p, resid_type);
+        }
+        else {
+          for(int a=0; a < p; ++a) {
+            CopyVec((*Z_[j])[a], (*V_[j])[a], subset);
+          }
+        }
+
+        // W = A Z_j
+        _A.MultiApply(*W_, *Z_[j], p, LINOP_OP);
+
+        // Block CGS against V_0..V_j, a second pass if the first cancelled too much.
+        // The Gram matrix of the result is the first one of the SVQB
+        for(int pass=0; pass < 2; ++pass) {
+          for(int i=0; i <= j; ++i) {
+            InnerProductBlockVec(*V_[i], p, *W_, p, h.data(), subset);
+            for(int b=0; b < p; ++b) {
+              for(int a=0; a < p; ++a) {
+                H[ (i*p + a) + ld*(j*p + b) ] += h[a + p*b];
+                h[a + p*b] = -h[a + p*b];
+              }
+            }
+            AxpyBlockVec(h.data(), *V_[i], p, *W_, p, subset);
+          }
+          GramMatrix(*W_, p, G.data(), subset);
+
+          if( pass > 0 || !needsReorthogonalization(&H[ ld*j*p ], ld, (j+1)*p, G.data(), p) ) break;
+        }
+
+        // W = V_{j+1} R
+        blockOrthonormalize(W_, V_[j+1], p, G.data(), R_blk.data());
+        for(int b=0; b < p; ++b) {
+          for(int a=0; a < p; ++a) {
+            H[ ((j+1)*p + a) + ld*(j*p + b) ] = R_blk[a + p*b];
+          }
+        }
+
+        ++iter;
+        n_steps = j+1;
+        for(int c : active) res[c].n_count++;
+
+        hessenberg_qr.addBlockColumn(&H[ ld*j*p ], ld, resid_est.data());
+
+        bool converged = true;
+        double max_rel = 0;
+        for(int a=0; a < p; ++a) {
+          if( resid_est[a] > target[ active[a] ] ) converged = false;
+          max_rel = std::max(max_rel, resid_est[a]/norm_in[ active[a] ]);
+        }
+
+        if( _params.VerboseP ) {
+          MasterLog(INFO, "BLOCK FGMRES: level=%d iter=%d block step=%d max || r ||/|| b || estimate=%16.8e",
+              level, iter, j, max_rel);
+        }
+
+        if( converged || iter >= _params.MaxIter ) break;
+      }
+
+      // X += Z Y, the block sum in W first
+      const int ld_Y = n_steps*p;
+      BlockLeastSquares(H.data(), ld, (n_steps+1)*p, n_steps*p, E.data(), ld, p, Y.data(), resid_lsq.data());
+      for(int a=0; a < p; ++a) {
+        ZeroVec((*W_)[a], subset);
+      }
+      for(int i=0; i < n_steps; ++i) {
+        for(int b=0; b < p; ++b) {
+          for(int a=0; a < p; ++a) {
+            h[a + p*b] = Y[ (i*p + a) + ld_Y*b ];
+          }
+        }
+        AxpyBlockVec(h.data(), *Z_[i], p, *W_, p, subset);
+      }
+      for(int a=0; a < p; ++a) {
+        AxpyVec(std::complex<float>(1,0), (*W_)[a], out[ active[a] ], subset);
+      }
+
+      // True residuals at the restart
+      computeResiduals(out, in, active, norm_r);
+    }
+
+    for(int c=0; c < k; ++c) {
+      res[c].resid = norm_r[c];
+      if( resid_type == RELATIVE ) {
+        res[c].resid /= norm_in[c];
+      }
+    }
+
+    if( _params.VerboseP ) {
+      double max_rel = 0;
+      for(int c=0; c < k; ++c) max_rel = std::max(max_rel, norm_r[c]/norm_in[c]);
+      MasterLog(INFO, "BLOCK FGMRES: level=%d Done. %d rhs, %d block steps, max || r ||/|| b ||=%16.8e",
+          level, k, iter, max_rel);
+    }
+    return res;
+  }
+
+private:
+
+  //! (Re)allocate the bases for k right hand sides
+  void allocate(int k) const
+  {
+    if( k <= _block_size ) return;
+
+    const int m = _params.NKrylov;
+    V_.resize(m+1);
+    Z_.resize(m);
+    for(int j=0; j < m+1; ++j) {
+      V_[j].reset( new SpinorSet<ST>(_info, k) );
+    }
+    for(int j=0; j < m; ++j) {
+      Z_[j].reset( new SpinorSet<ST>(_info, k) );
+    }
+    W_.reset( new SpinorSet<ST>(_info, k) );
+    R_.reset( new SpinorSet<ST>(_info, k) );
+
+    // The vectors are only ever written on the subset
+    for(int a=0; a < k; ++a) {
+      for(int j=0; j < m+1; ++j) ZeroVec((*V_[j])[a], SUBSET_ALL);
+      for(int j=0; j < m; ++j) ZeroVec((*Z_[j])[a], SUBSET_ALL);
+      ZeroVec((*W_)[a], SUBSET_ALL);
+      ZeroVec((*R_)[a], SUBSET_ALL);
+    }
+    _block_size = k;
+  }
+
+  //! R_c = b_c - A x_c and its norm for the columns c in cols
+  void computeResiduals(const SpinorSet<ST>& out, const SpinorSet<ST>& in,
+      const std::vector<int>& cols, std::vector<double>& norm_r) const
+  {
+    const CBSubset& subset = _A.GetSubset();
+    const int p = cols.size();
+
+    // Gather the solutions so the operator sees one block. Z_0 is free between cycles
+    SpinorSet<ST>& X = *Z_[0];
+    for(int a=0; a < p; ++a) {
+      CopyVec(X[a], out[ cols[a] ], subset);
+    }
+    _A.MultiApply(*W_, X, p, LINOP_OP);
+
+    for(int a=0; a < p; ++a) {
+      const int c = cols[a];
+      CopyVec((*R_)[c], in[c], subset);
+      norm_r[c] = sqrt(XmyNorm2Vec((*R_)[c], (*W_)[a], subset));
+    }
+  }
+
+  /* After one Gram-Schmidt pass, with the projections h in the p columns of
+   * H (n_rows of them, leading dimension ld_H) and the Gram matrix G of what is
+   * left: is there a column which kept less than block_reorth_tol of its squared norm?
+   * (The squared norm before the pass is || h ||^2 + what is left.)
+   */
+  static bool needsReorthogonalization(const std::complex<double>* H, int ld_H, int n_rows,
+      const std::complex<double>* G, int p)
+  {
+    for(int b=0; b < p; ++b) {
+      double norm2_h = 0;
+      for(int a=0; a < n_rows; ++a) {
+        norm2_h += std::norm( H[a + ld_H*b] );
+      }
+      const double norm2_w = std::real( G[b + p*b] );
+      if( norm2_w < block_reorth_tol*(norm2_w + norm2_h) ) return true;
+    }
+    return false;
+  }
+
+  /* dst R = src for the first p vectors, dst orthonormal (up to dropped directions).
+   * G is the Gram matrix of src, and is clobbered. SVQB on the column scaled Gram matrix
+   * so that columns of very different norms (e.g. residuals at different stages of
+   * convergence) are not mistaken for dependent ones, and a second pass if the block
+   * was too ill conditioned for the first to be orthonormal to working precision.
+   * src is clobbered too: on return dst holds the result and src holds scratch.
+   */
+  void blockOrthonormalize(std::unique_ptr<SpinorSet<ST>>& src, std::unique_ptr<SpinorSet<ST>>& dst,
+      int p, std::complex<double>* G, std::complex<double>* R) const
+  {
+    const CBSubset& subset = _A.GetSubset();
+    std::vector<std::complex<double>> T(p*p);
+    std::vector<std::complex<double>> R1(p*p);
+    std::vector<std::complex<double>> R2(p*p);
+
+    // Pass 1 on D^{-1} G D^{-1}, D = diag( || src_a || )
+    std::vector<double> d(p);
+    for(int a=0; a < p; ++a) {
+      d[a] = sqrt(std::real(G[a + p*a]));
+      if( !(d[a] > 0) ) d[a] = 1;
+    }
+    for(int b=0; b < p; ++b) {
+      for(int a=0; a < p; ++a) {
+        G[a + p*b] /= d[a]*d[b];
+      }
+    }
+    double cond = 1;
+    BlockOrthonormalizeGram(G, p, block_drop_tol, T.data(), R1.data(), &cond);
+    for(int b=0; b < p; ++b) {
+      for(int a=0; a < p; ++a) {
+        T[a + p*b] /= d[a];     // T = D^{-1} T'
+        R1[a + p*b] *= d[b];    // R = R' D
+      }
+    }
+    for(int a=0; a < p; ++a) ZeroVec((*dst)[a], subset);
+    AxpyBlockVec(T.data(), *src, p, *dst, p, subset);
+
+    if( cond <= block_svqb_cond ) {
+      std::copy(R1.begin(), R1.end(), R);
+      return;
+    }
+
+    // Pass 2 restores the orthogonality lost to rounding in pass 1
+    GramMatrix(*dst, p, G, subset);
+    BlockOrthonormalizeGram(G, p, block_drop_tol, T.data(), R2.data());
+    for(int a=0; a < p; ++a) ZeroVec((*src)[a], subset);
+    AxpyBlockVec(T.data(), *dst, p, *src, p, subset);
+    std::swap(src, dst);
+
+    // R = R2 R1
+    for(int b=0; b < p; ++b) {
+      for(int a=0; a < p; ++a) {
+        std::complex<double> sum(0,0);
+        for(int l=0; l < p; ++l) {
+          sum += R2[a + p*l]*R1[l + p*b];
+        }
+        R[a + p*b] = sum;
+      }
+    }
+  }
+
+  const LinearOperator<ST,GT>& _A;
+  const LatticeInfo& _info;
+  const FGMRESParams _params;
+  const LinearSolver<ST,GT>* _M_prec;
+
+  mutable int _block_size;
+  mutable std::vector< std::unique_ptr<SpinorSet<ST>> > V_;
+  mutable std::vector< std::unique_ptr<SpinorSet<ST>> > Z_;
+  mutable std::unique_ptr<SpinorSet<ST>> W_;
+  mutable std::unique_ptr<SpinorSet<ST>> R_;
+};
+
+} // namespace FGMRESGeneric
+
+} // namespace MG
+
+#endif /* INCLUDE_LATTICE_INVBLOCKFGMRES_GENERIC_H_ */
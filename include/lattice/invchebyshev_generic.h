@@ -0,0 +1,205 @@
+/*
+ * invchebyshev_generic.h
+ */
+
+#ifndef INCLUDE_LATTICE_INVCHEBYSHEV_GENERIC_H_
+#define INCLUDE_LATTICE_INVCHEBYSHEV_GENERIC_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/spinor_set.h"
+#include "lattice/chebyshev_ellipse.h"
+#include "lattice/coarse/subset.h"
+#include "utils/print_utils.h"
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <memory>
+
+namespace MG {
+
+/** Parameters for the Chebyshev smoother
+ *
+ *  MaxIter is the degree of the polynomial, i.e. the operator applications per
+ *  smoothing. RsdTarget is not used: the smoother never looks at the residual.
+ *
+ *  ArnoldiSteps is the length of the Arnoldi run which estimates the spectrum at
+ *  setup, from a random start. It needs to be long enough for the extreme Ritz values
+ *  to settle whatever the start: with too few steps LambdaMax comes out low, and the
+ *  modes above it grow with every smoothing. The polynomial damps [ LambdaMax/LambdaRatio, LambdaMax ] on the real axis
+ *  (see chebyshev_ellipse.h): a larger LambdaRatio reaches further down the spectrum
+ *  at the price of damping less. SafetyFactor widens the Ritz value extents.
+ */
+class ChebyshevSmootherParams : public LinearSolverParamsBase {
+public:
+	int ArnoldiSteps;
+	double LambdaRatio;
+	double SafetyFactor;
+
+	ChebyshevSmootherParams() {
+		MaxIter = 4;
+		ArnoldiSteps = 20;
+		LambdaRatio = 8;
+		SafetyFactor = 1.1;
+	}
+};
+
+/** ChebyshevSmootherGeneric
+ *
+ *  Chebyshev iteration as a smoother. The MR smoother needs an inner product and
+ *  a norm, so two global reductions, in every iteration. Here the polynomial is
+ *  fixed once the spectrum is known, so after the setup an application is just
+ *  MaxIter operator applications and fused vector updates, with no reductions.
+ *
+ *  The operator is not Hermitian, so the spectrum is estimated at construction
+ *  from the Ritz values of a short Arnoldi run and enclosed in an ellipse with
+ *  center d and squared focal distance c^2 (real, possibly negative). Those are the
+ *  only reductions. With s = c^2/d^2 the iteration is (Saad, Alg. 12.1, with
+ *  t = rho sigma, which stays real for either sign of c^2):
+ *
+ *      r = b - A x,  p = r / d,  t = 1
+ *      for k = 1 .. MaxIter
+ *         x += p,  r -= A p
+ *         t' = 1/(2 - s t),  p = s t' t p + (2 t'/d) r,  t = t'
+ *
+ *  For c^2 = 0 (a circle) this is Richardson iteration with weight 1/d.
+ *
+ *  The three updates are fused in ChebyshevUpdate(), overloaded with the level 1
+ *  BLAS for each spinor type. The smoother works on A.GetSubset() and uses out
+ *  as its initial guess. The params are copied.
+ */
+template<typename ST, typename GT>
+class ChebyshevSmootherGeneric : public Smoother<ST,GT>
+{
+public:
+	ChebyshevSmootherGeneric(const LinearOperator<ST,GT>& A,
+						const LinearSolverParamsBase& params) : _A(A),
+						_params(static_cast<const ChebyshevSmootherParams&>(params))
+	{
+		EstimateSpectrum();
+	}
+
+	ChebyshevSmootherGeneric(const std::shared_ptr<const LinearOperator<ST,GT>> A,
+						const LinearSolverParamsBase& params) : _A(*A),
+						_params(static_cast<const ChebyshevSmootherParams&>(params))
+	{
+		EstimateSpectrum();
+	}
+
+	void operator()(ST& out, const ST& in) const override
+	{
+		const CBSubset& subset = _A.GetSubset();
+		const LatticeInfo& info = _A.GetInfo();
+
+		const double s = _c2/(_center*_center);
+
+		ST r(info);
+		ST p(info);
+		ST Ap(info);
+
+		// r = b - A x,  p = r / d
+		_A(Ap, out, LINOP_OP);
+		CopyVec(r, in, subset);
+		AxpyVec(-1.0, Ap, r, subset);
+		ZeroVec(p, subset);
+		AxpyVec(1.0/_center, r, p, subset);
+
+		double t = 1;
+		for(int k=0; k < _params.MaxIter; ++k) {
+			_A(Ap, p, LINOP_OP);
+
+			const double t_next = 1.0/(2.0 - s*t);
+			ChebyshevUpdate(s*t_next*t, 2.0*t_next/_center, Ap, p, r, out, subset);
+			t = t_next;
+		}
+	}
+
+	double GetLambdaMax() const {
+		return _lambda_max;
+	}
+
+private:
+	void EstimateSpectrum()
+	{
+		using DComplex = std::complex<double>;
+
+		const CBSubset& subset = _A.GetSubset();
+		const LatticeInfo& info = _A.GetInfo();
+		const int level = _A.GetLevel();
+
+		if( _params.MaxIter <= 0 ) {
+			MasterLog(ERROR,"Chebyshev: level=%d Invalid Value: MaxIter <= 0 ",level);
+		}
+		if( _params.ArnoldiSteps <= 0 || !(_params.LambdaRatio > 1) ) {
+			MasterLog(ERROR,"Chebyshev: level=%d Invalid Value: ArnoldiSteps=%d LambdaRatio=%g",
+					level, _params.ArnoldiSteps, _params.LambdaRatio);
+		}
+
+		const int m = _params.ArnoldiSteps;
+		SpinorSet<ST> V(info, m+1);
+		std::vector<DComplex> H((m+1)*m, DComplex(0,0));
+		std::vector<DComplex> h(m);
+
+		Gaussian(V[0], subset);
+		{
+			ST w(info);
+			CopyVec(w, V[0], subset);
+			ZeroVec(V[0], subset);
+			AxpyVec(1.0/sqrt(Norm2Vec(w, subset)), w, V[0], subset);
+		}
+
+		// Arnoldi with classical Gram-Schmidt, done twice
+		int n_steps = m;
+		for(int j=0; j < m; ++j) {
+			ST& w = V[j+1];
+			_A(w, V[j], LINOP_OP);
+
+			for(int pass=0; pass < 2; ++pass) {
+				InnerProductMultiVec(V, j+1, w, h.data(), subset);
+				for(int i=0; i <= j; ++i) {
+					H[i + (m+1)*j] += h[i];
+					h[i] = -h[i];
+				}
+				AxpyMultiVec(h.data(), V, j+1, w, subset);
+			}
+
+			const double h_next = sqrt(Norm2Vec(w, subset));
+			H[j+1 + (m+1)*j] = h_next;
+
+			// Invariant subspace: the Ritz values so far are exact
+			if( h_next < 1.0e-10*std::abs(H[j + (m+1)*j]) ) {
+				n_steps = j+1;
+				break;
+			}
+
+			ST tmp(info);
+			CopyVec(tmp, w, subset);
+			ZeroVec(w, subset);
+			AxpyVec(1.0/h_next, tmp, w, subset);
+		}
+
+		ChebyshevEllipse(H.data(), m+1, n_steps, _params.LambdaRatio, _params.SafetyFactor,
+				_center, _c2, _lambda_max);
+
+		if( !(_center > 0) ) {
+			MasterLog(ERROR,"Chebyshev: level=%d No Ritz value with a positive real part",level);
+		}
+
+		if( _params.VerboseP ) {
+			MasterLog(INFO,"Chebyshev: level=%d Arnoldi steps=%d interval=[%16.8e, %16.8e] c^2=%16.8e degree=%d",
+					level, n_steps, _lambda_max/_params.LambdaRatio, _lambda_max, _c2, _params.MaxIter);
+		}
+	}
+
+	const LinearOperator<ST,GT>& _A;
+	const ChebyshevSmootherParams _params;
+	double _center;
+	double _c2;
+	double _lambda_max;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_INVCHEBYSHEV_GENERIC_H_ */
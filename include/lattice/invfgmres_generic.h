@@ -27,6 +27,9 @@
 #include "lattice/fgmres_common.h"
 #include "lattice/givens.h"
 #include "lattice/coarse/subset.h"
+#include "lattice/spinor_set.h"
+#include "lattice/spinor_workspace.h"
+#include "lattice/fgmresdr_restart.h"
 
 namespace MG {
 
@@ -37,21 +40,26 @@ template<typename ST,typename GT>
      const double& rsd_target,
      const LinearOperator<ST,GT>& A,     // Operator
      const LinearSolver<ST,GT>* M,  // Preconditioner
-     std::vector<ST*>& V,                 // Nuisance: Need constructor free way to make these. Init functions?
-     std::vector<ST*>& Z,
+     SpinorSet<ST>& V,
+     SpinorSet<ST>& Z,
 	 ST& w,
      Array2d<std::complex<double>>& H,
-     std::vector< Givens* >& givens_rots,
+     std::vector< Givens >& givens_rots,
      std::vector<std::complex<double>>& c,
+     std::vector<std::complex<double>>& h_work,  // Workspace for the coefficients, >= 3 n_krylov
      int& ndim_cycle,
      ResiduumType resid_type,
-     bool VerboseP )
+     bool VerboseP,
+     int first_col = 0,
+     Array2d<std::complex<double>>* H_unrotated = nullptr,
+     double norm_rhs = 0 )   // || b || of the solve: if set, M is told the residual (SetOuterResidual)
 
  {
 #ifdef MG_ENABLE_TIMERS
 	auto  timerAPI = MG::Timer::TimerAPI::getInstance();
 #endif
-   ndim_cycle = 0;
+   // After a deflated restart the first first_col columns are already there
+   ndim_cycle = first_col;
    int level = A.GetLevel();
    const CBSubset& subset = A.GetSubset();
 
@@ -61,7 +69,7 @@ template<typename ST,typename GT>
 
 
    // Work by columns:
-   for(int j=0; j < n_krylov; ++j) {
+   for(int j=first_col; j < n_krylov; ++j) {
 
 	   // Check convention... Z=solution, V=source
 	   // Here we have an opportunity to not precondition...
@@ -80,33 +88,47 @@ template<typename ST,typename GT>
 #ifdef MG_ENABLE_TIMERS
 		   timerAPI->startTimer("FGMRESSolverGeneric/preconditioner/level"+std::to_string(level));
 #endif
+		   // |c_j| is the residual after the first j columns
+		   if( norm_rhs > 0 ) {
+			   M->SetOuterResidual( std::abs(c[j])/norm_rhs );
+		   }
 
-		   (*M)( *Z[j], *(V[j]), resid_type );  // z_j = M^{-1} v_j
+		   (*M)( Z[j], V[j], resid_type );  // z_j = M^{-1} v_j
 
 #ifdef MG_ENABLE_TIMERS
 		   timerAPI->stopTimer("FGMRESSolverGeneric/preconditioner/level"+std::to_string(level));
 #endif
 	   }
 	   else {
-		   CopyVec(*(Z[j]), *(V[j]), subset);      // Vector assignment " copy "
+		   CopyVec(Z[j], V[j], subset);      // Vector assignment " copy "
 	   }
 
 #ifdef DEBUG_SOLVER
      {
-       MasterLog(DEBUG, "FLEXIBLE ARNOLDI: level=%d norm of Z_j = %16.8e norm of V_j = %16.8e",level, Norm2Vec(*(Z[j]),subset), Norm2Vec(*(V[j]),subset));
+       MasterLog(DEBUG, "FLEXIBLE ARNOLDI: level=%d norm of Z_j = %16.8e norm of V_j = %16.8e",level, Norm2Vec(Z[j],subset), Norm2Vec(V[j],subset));
      }
 #endif
 
-     A( w, *(Z[j]), LINOP_OP);  // w  = A z_
+     A( w, Z[j], LINOP_OP);  // w  = A z_
 
-     // Fill out column j
-     for(int i=0; i <= j ;  ++i ) {
-       H(j,i) = InnerProductVec(*(V[i]), w,subset);        //  Inner product
+     // Fill out column j: classical Gram-Schmidt, repeated once for stability (CGS2).
+     // Each pass is one multi-dot (a single global reduction) and one block AXPY
+     // over V[0..j], rather than j+1 dependent inner product / AXPY pairs.
+     std::complex<double>* h = h_work.data();
+     std::complex<double>* minus_h = h + n_krylov;
+     for(int i=0; i <= j; ++i) {
+       H(j,i) = std::complex<double>(0,0);
+     }
+
+     for(int pass=0; pass < 2; ++pass) {
+       InnerProductMultiVec(V, j+1, w, h, subset);          // h_i = < V_i | w >
 
-       // w[s] -= H(j,i)* V[i];                     // y = y - alpha x = CAXPY
-       std::complex<float> minus_Hji = std::complex<float>(-real(H(j,i)),-imag(H(j,i)));
-       AxpyVec(minus_Hji, *(V[i]), w, subset);
+       for(int i=0; i <= j; ++i) {
+         H(j,i) += h[i];
+         minus_h[i] = -h[i];
+       }
 
+       AxpyMultiVec(minus_h, V, j+1, w, subset);            // w -= sum_i h_i V_i
      }
 
      double wnorm=sqrt(Norm2Vec(w,subset));               //  NORM
@@ -116,6 +138,13 @@ template<typename ST,typename GT>
 
      H(j,j+1) = std::complex<double>(wnorm,0);
 
+     // Keep the column before the Givens rotations get to it (for deflated restarts)
+     if( H_unrotated != nullptr ) {
+       for(int i=0; i <= j+1; ++i) {
+         (*H_unrotated)(j,i) = H(j,i);
+       }
+     }
+
      // In principle I should check w_norm to be 0, and if it is I should
      // terminate: Code Smell -- get rid of 1.0e-14.
      if (  std::fabs( wnorm ) < 1.0e-14 )  {
@@ -131,21 +160,22 @@ template<typename ST,typename GT>
 
      double invwnorm = (double)1/wnorm;
      // V[j+1] = invwnorm*w;                           // SCAL
-     ZeroVec( *(V[j+1]),subset);
-     AxpyVec( invwnorm, w, *(V[j+1]),subset);
+     ZeroVec( V[j+1],subset);
+     AxpyVec( invwnorm, w, V[j+1],subset);
 
      // Apply Existing Givens Rotations to this column of H
      for(int i=0;i < j; ++i) {
-       (*givens_rots[i])(j,H);
+       givens_rots[i](j,H);
      }
 
      // Compute next Givens Rot for this column
-     givens_rots[j] = new Givens(j,H);
+     givens_rots[j] = Givens(j,H);
 
-     (*givens_rots[j])(j,H); // Apply it to H
-     (*givens_rots[j])(c);   // Apply it to the c vector
+     givens_rots[j](j,H); // Apply it to H
+     givens_rots[j](c);   // Apply it to the c vector
 
-     double accum_resid = fabs(real(c[j+1]));
+     // NB: c is complex after a deflated restart
+     double accum_resid = std::abs(c[j+1]);
 
      // j-ndeflate is the 0 based iteration count
      // j-ndeflate+1 is the 1 based human readable iteration count
@@ -167,6 +197,200 @@ template<typename ST,typename GT>
 
 
 
+/* Pipelined Arnoldi: the Pythagorean norm of the new column is trusted only
+ * while || w_new ||^2 >= pipelined_reorth_tol || w ||^2. Below that too much cancellation
+ * has taken place and the column is orthogonalized once more, explicitly.
+ */
+static const double pipelined_reorth_tol = 1.0e-2;
+
+/** PipelinedFlexibleArnoldiT
+ *
+ *  Single reduction flexible Arnoldi (after Ghysels et. al., p(1)-GMRES).
+ *
+ *  Keeps the basis W_i = A Z_i besides V and Z. Column j is built from W[j] with
+ *  one fused reduction giving h_i = < V_i | W[j] > and || W[j] ||^2, after which
+ *  || W[j] - V h ||^2 = || W[j] ||^2 - |h|^2, so no separate norm is needed.
+ *
+ *  The next direction does not wait for V[j+1]: it is built from the un-orthogonalized
+ *  W[j] as zt = M W[j], at = A zt and corrected afterwards with the same coefficients,
+ *  Z[j+1] = (zt - Z h)/beta, W[j+1] = (at - W h)/beta, so W[j+1] = A Z[j+1] still holds
+ *  exactly. The preconditioner and the operator therefore do not depend on the reduction
+ *  of the column, and with a non-blocking global sum the two would overlap. Our GlobalSum
+ *  is blocking, so for now the gain is that there is one reduction per column rather than
+ *  three (two CGS passes and the norm).
+ *
+ *  The correction of zt takes M (W[j] - V h) = M W[j] - Z h, i.e. a preconditioner which
+ *  is (close to) linear. So the outer residual is not passed on to M here: an adaptive
+ *  tolerance preconditioner (see AdaptiveToleranceSolver) wants the classical Arnoldi.
+ *
+ *  On entry V[0] holds the normalized residual. zt, at are work vectors.
+ */
+template<typename ST,typename GT>
+ void PipelinedFlexibleArnoldiT(int n_krylov,
+     const double& rsd_target,
+     const LinearOperator<ST,GT>& A,     // Operator
+     const LinearSolver<ST,GT>* M,  // Preconditioner
+     SpinorSet<ST>& V,
+     SpinorSet<ST>& Z,
+     SpinorSet<ST>& W,
+	 ST& w,
+	 ST& zt,
+	 ST& at,
+     Array2d<std::complex<double>>& H,
+     std::vector< Givens >& givens_rots,
+     std::vector<std::complex<double>>& c,
+     std::vector<std::complex<double>>& h_work,  // Workspace for the coefficients, >= 3 n_krylov
+     int& ndim_cycle,
+     ResiduumType resid_type,
+     bool VerboseP )
+
+ {
+#ifdef MG_ENABLE_TIMERS
+	auto  timerAPI = MG::Timer::TimerAPI::getInstance();
+#endif
+   ndim_cycle = 0;
+   int level = A.GetLevel();
+   const CBSubset& subset = A.GetSubset();
+
+   if( VerboseP ) {
+     MasterLog(INFO,"PIPELINED FLEXIBLE ARNOLDI: level=%d Flexible Arnoldi Cycle: ",level);
+   }
+
+   // z_0 = M^{-1} v_0, W_0 = A z_0
+   if( M != nullptr ) {
+#ifdef MG_ENABLE_TIMERS
+	   timerAPI->startTimer("FGMRESSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+	   (*M)( Z[0], V[0], resid_type );
+#ifdef MG_ENABLE_TIMERS
+	   timerAPI->stopTimer("FGMRESSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+   }
+   else {
+	   CopyVec(Z[0], V[0], subset);
+   }
+   A( W[0], Z[0], LINOP_OP);
+
+   std::complex<double>* h = h_work.data();
+   std::complex<double>* h2 = h + n_krylov;
+   std::complex<double>* minus_h = h2 + n_krylov;
+
+   // Work by columns:
+   for(int j=0; j < n_krylov; ++j) {
+
+     // The one reduction of the column: h_i = < V_i | W_j >, i=0..j and || W_j ||^2
+     double w_norm2;
+     InnerProductNorm2MultiVec(V, j+1, W[j], h, w_norm2, subset);
+
+     // Start the next direction from W_j itself. Not needed in the last column.
+     if( j+1 < n_krylov ) {
+       if( M != nullptr ) {
+#ifdef MG_ENABLE_TIMERS
+    	   timerAPI->startTimer("FGMRESSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+    	   (*M)( zt, W[j], resid_type );
+#ifdef MG_ENABLE_TIMERS
+    	   timerAPI->stopTimer("FGMRESSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+       }
+       else {
+    	   CopyVec(zt, W[j], subset);
+       }
+       A( at, zt, LINOP_OP);
+     }
+
+     // w = W_j - sum_i h_i V_i
+     double h_norm2 = 0;
+     for(int i=0; i <= j; ++i) {
+       minus_h[i] = -h[i];
+       h_norm2 += std::norm(h[i]);
+     }
+     CopyVec(w, W[j], subset);
+     AxpyMultiVec(minus_h, V, j+1, w, subset);
+
+     double wnorm2 = w_norm2 - h_norm2;
+     if( wnorm2 < pipelined_reorth_tol*w_norm2 ) {
+       // Cancellation: orthogonalize w again, with its own reduction
+       double w2_norm2;
+       InnerProductNorm2MultiVec(V, j+1, w, h2, w2_norm2, subset);
+       double h2_norm2 = 0;
+       for(int i=0; i <= j; ++i) {
+    	 h[i] += h2[i];
+    	 minus_h[i] = -h2[i];
+    	 h2_norm2 += std::norm(h2[i]);
+       }
+       AxpyMultiVec(minus_h, V, j+1, w, subset);
+       wnorm2 = w2_norm2 - h2_norm2;
+#ifdef DEBUG_SOLVER
+       MasterLog(DEBUG, "PIPELINED FLEXIBLE ARNOLDI: level=%d j=%d reorthogonalized", level, j);
+#endif
+     }
+
+     double wnorm = wnorm2 > 0 ? sqrt(wnorm2) : 0;
+#ifdef DEBUG_SOLVER
+     MasterLog(DEBUG, "PIPELINED FLEXIBLE ARNOLDI: level=%d j=%d wnorm=%16.8e\n", level, j, wnorm);
+#endif
+
+     for(int i=0; i <= j; ++i) {
+       H(j,i) = h[i];
+     }
+     H(j,j+1) = std::complex<double>(wnorm,0);
+
+     if (  std::fabs( wnorm ) < 1.0e-14 )  {
+       if( VerboseP ) {
+         MasterLog(INFO,"PIPELINED FLEXIBLE ARNOLDI: level=%d Converged at iter = %d ",level, j+1);
+       }
+       ndim_cycle = j;
+       return;
+     }
+
+     double invwnorm = (double)1/wnorm;
+     ZeroVec( V[j+1],subset);
+     AxpyVec( invwnorm, w, V[j+1],subset);
+
+     // Apply Existing Givens Rotations to this column of H
+     for(int i=0;i < j; ++i) {
+       givens_rots[i](j,H);
+     }
+
+     // Compute next Givens Rot for this column
+     givens_rots[j] = Givens(j,H);
+
+     givens_rots[j](j,H); // Apply it to H
+     givens_rots[j](c);   // Apply it to the c vector
+
+     double accum_resid = std::abs(c[j+1]);
+
+     if ( VerboseP ) {
+       MasterLog(INFO,"PIPELINED FLEXIBLE ARNOLDI: level=%d Iter=%d || r || = %16.8e Target=%16.8e",level,
+                                   j+1, accum_resid,rsd_target);
+
+     }
+     ndim_cycle = j+1;
+     if (  accum_resid <= rsd_target  ) {
+       if ( VerboseP ) {
+         MasterLog(INFO,"PIPELINED FLEXIBLE ARNOLDI: level=%d Cycle Converged at iter = %d",level, j+1);
+       }
+       return;
+     } // if
+
+     if( j+1 < n_krylov ) {
+       // Z_{j+1} = ( zt - sum_i h_i Z_i )/wnorm,  W_{j+1} = ( at - sum_i h_i W_i )/wnorm = A Z_{j+1}
+       for(int i=0; i <= j; ++i) {
+    	 minus_h[i] = -invwnorm*h[i];
+       }
+       ZeroVec( Z[j+1], subset);
+       AxpyVec( invwnorm, zt, Z[j+1], subset);
+       AxpyMultiVec(minus_h, Z, j+1, Z[j+1], subset);
+
+       ZeroVec( W[j+1], subset);
+       AxpyVec( invwnorm, at, W[j+1], subset);
+       AxpyMultiVec(minus_h, W, j+1, W[j+1], subset);
+     }
+   } // while
+ } // function
+
+
 template<typename ST, typename GT>
  class FGMRESSolverGeneric : public LinearSolver<ST,GT>
   {
@@ -180,24 +404,17 @@ template<typename ST, typename GT>
   FGMRESSolverGeneric(const LinearOperator<ST,GT>& A,
       const MG::LinearSolverParamsBase& params,
       const LinearSolver<ST,GT>* M_prec=nullptr)  : _A(A), _info(A.GetInfo()),
-      _params(static_cast<const FGMRESParams&>(params)), _M_prec(M_prec)
+      _params(static_cast<const FGMRESParams&>(params)), _M_prec(M_prec),
+      V_(A.GetInfo(), _params.NKrylov+1), Z_(A.GetInfo(), _params.NKrylov+1)
   {
 
 	const CBSubset& subset = A.GetSubset();
 
     H_.resize(_params.NKrylov, _params.NKrylov+1); // This is odd. Shouldn't it be
 
-    V_.resize(_params.NKrylov+1);
-    Z_.resize(_params.NKrylov+1);
-
-    for(int i=0; i < _params.NKrylov+1;++i) {
-      V_[i] = new ST(_info);
-      Z_[i] = new ST(_info);
-    }
-
-
     givens_rots_.resize(_params.NKrylov+1);
     c_.resize(_params.NKrylov+1);
+    h_work_.resize(3*_params.NKrylov);
     eta_.resize(_params.NKrylov);
 
 
@@ -208,10 +425,32 @@ template<typename ST, typename GT>
     }
 
     for(int row = 0; row < _params.NKrylov+1; row++) {
-      ZeroVec(*(V_[row]),SUBSET_ALL);                  // BLAS ZERO
-      ZeroVec(*(Z_[row]),SUBSET_ALL);                  // BLAS ZERO
+      ZeroVec(V_[row],SUBSET_ALL);                  // BLAS ZERO
+      ZeroVec(Z_[row],SUBSET_ALL);                  // BLAS ZERO
       c_[row] = std::complex<double>(0,0);                  // COMPLEX ZERO
-      givens_rots_[row] = nullptr;
+    }
+
+    // Deflated restarts keep the unrotated H and need k+1 vectors of workspace
+    if( _params.NDefl > 0 ) {
+      if( _params.NDefl >= _params.NKrylov ) {
+        MasterLog(ERROR, "FGMRESSolverGeneric: NDefl=%d must be less than NKrylov=%d",
+            _params.NDefl, _params.NKrylov);
+      }
+      if( _params.Pipelined ) {
+        MasterLog(ERROR, "FGMRESSolverGeneric: Deflated restarts are not implemented for the pipelined Arnoldi");
+      }
+
+      Hbar_.resize(_params.NKrylov, _params.NKrylov+1);
+      c0_.resize(_params.NKrylov+1);
+      DR_tmp_.reset( new SpinorSet<ST>(A.GetInfo(), _params.NDefl+1) );
+    }
+
+    // The pipelined Arnoldi also keeps W = A Z
+    if( _params.Pipelined ) {
+      W_.reset( new SpinorSet<ST>(A.GetInfo(), _params.NKrylov) );
+      for(int row = 0; row < _params.NKrylov; row++) {
+        ZeroVec((*W_)[row],SUBSET_ALL);
+      }
     }
 
     for(int row = 0; row < _params.NKrylov; row++) {
@@ -231,15 +470,6 @@ template<typename ST, typename GT>
         const MG::LinearSolverParamsBase& params,
         const LinearSolver<ST,GT>* M_prec=nullptr)  : FGMRESSolverGeneric(*A,params,M_prec) {}
 
-    ~FGMRESSolverGeneric()
-    {
-      for(int i=0; i < _params.NKrylov+1; ++i) {
-        delete V_[i];
-        delete Z_[i];
-        if( givens_rots_[i] != nullptr ) delete givens_rots_[i];
-      }
-    }
-
     LinearSolverResults operator()(ST& out, const ST& in, ResiduumType resid_type = RELATIVE) const override
 
     {
@@ -255,7 +485,7 @@ template<typename ST, typename GT>
       res.resid_type = resid_type;
 
       double norm_rhs = sqrt(Norm2Vec(in,subset));   //  || b ||                      BLAS: NORM2
-      double target = _params.RsdTarget;
+      double target = ( rsd_target_ > 0 ) ? rsd_target_ : _params.RsdTarget;
 
       if ( resid_type == RELATIVE) {
         target *= norm_rhs; // Target  || r || < || b || RsdTarget
@@ -267,18 +497,22 @@ template<typename ST, typename GT>
       AssertCompatible( out_info, _A.GetInfo());
 
 
-      // Temporaries - passed into flexible Arnoldi
-      ST w( in_info );
+      // Temporaries - passed into flexible Arnoldi. From the workspace, so
+      // only the first call allocates them
+      auto w_scratch = work_.Get(_info);
+      ST& w = *w_scratch;
 
       // Compute ||r||
-      ST r( in_info ); ZeroVec(r,subset);                                                     // BLAS: ZERO
+      auto r_scratch = work_.Get(_info);
+      ST& r = *r_scratch; ZeroVec(r,subset);                                                  // BLAS: ZERO
 #ifdef DEBUG_SOLVER
       {
         double tmp_norm_r = sqrt(Norm2Vec(r,subset));
         MasterLog(MG::DEBUG, "FGMRES: level=%d norm_rhs=%16.8e r_norm=%16.8e", level, norm_rhs, tmp_norm_r);
       }
 #endif
-      ST tmp(in_info ); ZeroVec(tmp,subset);                                                     // BLAS: COPY
+      auto tmp_scratch = work_.Get(_info);
+      ST& tmp = *tmp_scratch; ZeroVec(tmp,subset);                                            // BLAS: COPY
       CopyVec( r, in , subset);
 #ifdef DEBUG_SOLVER
       {
@@ -325,6 +559,10 @@ template<typename ST, typename GT>
 
       int n_cycles = 0;
 
+      // Number of harmonic Ritz vectors carried into the current cycle.
+      // The first cycle always starts from scratch.
+      int n_defl = 0;
+
       // We are done if norm is sufficiently accurate,
       bool finished = ( r_norm <= target ) ;
 
@@ -338,30 +576,45 @@ template<typename ST, typename GT>
         int dim; // dim at the end of cycle (in case we terminate in-cycle
         int n_krylov  = _params.NKrylov;
 
-        // We are either first cycle, or
-        // We have no deflation subspace ie we are regular FGMRES
-        // and we are just restarting
-        //
-        // Set up initial vector c = [ beta, 0 ... 0 ]^T
-        // In this case beta should be the r_norm, ie || r || (=|| b || for the first cycle)
-        //
-        // NB: We will have a copy of this called 'g' onto which we will
-        // apply Givens rotations to get an inline estimate of the residuum
-        for(int j=0; j < c_.size(); ++j) {
-          c_[j] = std::complex<double>(0);
+        if( n_defl == 0 ) {
+          // We are either first cycle, or
+          // We have no deflation subspace ie we are regular FGMRES
+          // and we are just restarting
+          //
+          // Set up initial vector c = [ beta, 0 ... 0 ]^T
+          // In this case beta should be the r_norm, ie || r || (=|| b || for the first cycle)
+          //
+          // NB: We will have a copy of this called 'g' onto which we will
+          // apply Givens rotations to get an inline estimate of the residuum
+          for(size_t j=0; j < c_.size(); ++j) {
+            c_[j] = std::complex<double>(0);
+          }
+          c_[0] = r_norm;
+
+          // Set up initial V[0] = rhs / || r^2 ||
+          // and since we are solving for A delta x = r
+          // the rhs is 'r'
+          //
+          double beta_inv = (double)1/r_norm;
+          //  V_[0] = beta_inv * r;                       // BLAS: VSCAL
+          ZeroVec(V_[0],subset);
+          AxpyVec(beta_inv,r,V_[0],subset);
+        }
+        else {
+          // Deflated restart: V_[0..n_defl] and Z_[0..n_defl-1] were set up by DeflatedRestart()
+          // and the residual lies in the span of V_[0..n_defl]. Take c = V^H r
+          // from the recomputed residual rather than from the recurrence.
+          for(size_t j=0; j < c_.size(); ++j) {
+            c_[j] = std::complex<double>(0);
+          }
+          InnerProductMultiVec(V_, n_defl+1, r, c_.data(), subset);
         }
-        c_[0] = r_norm;
-
-        // Set up initial V[0] = rhs / || r^2 ||
-        // and since we are solving for A delta x = r
-        // the rhs is 'r'
-        //
-        double beta_inv = (double)1/r_norm;
-        //  V_[0] = beta_inv * r;                       // BLAS: VSCAL
-        ZeroVec(*(V_[0]),subset);
-        AxpyVec(beta_inv,r,*(V_[0]),subset);
-
 
+        if( _params.NDefl > 0 ) {
+          // The Givens rotations of the first n_defl columns are the identity so this is
+          // c before any rotation
+          c0_ = c_;
+        }
 
         // Carry out Flexible Arnoldi process for the cycle
 
@@ -370,18 +623,35 @@ template<typename ST, typename GT>
         // NB: We recompute a true 'r' after every cycle
         // So in the cycle we could in principle
         // use reduced precision... TBInvestigated.
-        FlexibleArnoldi(n_krylov,
-            target,
-            V_,
-            Z_,
-			w,
-			H_,
-            givens_rots_,
-            c_,
-            dim,
-            resid_type);
-
-        int iters_this_cycle = dim;
+        if( _params.Pipelined ) {
+          // Work vectors of the pipelined Arnoldi
+          auto zt = work_.Get(_info);
+          auto at = work_.Get(_info);
+          PipelinedFlexibleArnoldiT<ST,GT>(n_krylov,
+              target,
+              _A,
+              _M_prec,
+              V_, Z_, *W_,
+              w, *zt, *at,
+              H_, givens_rots_, c_, h_work_, dim, resid_type, _params.VerboseP);
+        }
+        else {
+          FlexibleArnoldi(n_krylov,
+              target,
+              V_,
+              Z_,
+              w,
+              H_,
+              givens_rots_,
+              c_,
+              dim,
+              resid_type,
+              norm_rhs,
+              n_defl);
+        }
+
+        // The first n_defl columns were carried over from the last cycle
+        int iters_this_cycle = dim - n_defl;
         LeastSquaresSolve(H_,c_,eta_, dim); // Solve Least Squares System
 
         // Compute the correction dx = sum_j  eta_j Z_j
@@ -389,7 +659,7 @@ template<typename ST, typename GT>
         for(int j=0; j < dim; ++j) {
 
           std::complex<float> alpha = std::complex<float>( real(eta_[j]), imag(eta_[j]));
-          AxpyVec(alpha,*(Z_[j]),out,subset);                       // Y = Y + AX => BLAS AXPY
+          AxpyVec(alpha,Z_[j],out,subset);                       // Y = Y + AX => BLAS AXPY
         }
 
         // Recompute r
@@ -406,11 +676,13 @@ template<typename ST, typename GT>
         // Check if we are done either via convergence, or runnign out of iterations
         finished = ( r_norm <= target ) || (iters_total >= _params.MaxIter);
 
-        // Init matrices should've initialized this but just in case this is e.g. a second call or something.
-        for(int j=0; j < _params.NKrylov; ++j) {
-          if ( givens_rots_[j] != nullptr ) {
-            delete givens_rots_[j];
-            givens_rots_[j] = nullptr;
+        // Keep the harmonic Ritz vectors for the next cycle. Only after a full cycle:
+        // if we stopped early we have converged or broken down.
+        n_defl = 0;
+        if( !finished && _params.NDefl > 0 && dim == n_krylov ) {
+          n_defl = DeflatedRestart(dim);
+          if( _params.VerboseP ) {
+            MasterLog(INFO, "FGMRES: level=%d deflated restart with %d vectors", level, n_defl);
           }
         }
       } // Next Cycle...
@@ -439,23 +711,98 @@ template<typename ST, typename GT>
       return res;
     }
 
+    // E.g. an adaptive tolerance from the outer solve, see AdaptiveToleranceSolver
+    void SetRsdTarget(double rsd_target) const override
+    {
+      rsd_target_ = rsd_target;
+    }
+
     void FlexibleArnoldi(int n_krylov,
 			 const double rsd_target,
-			 std::vector<ST*>& V,
-			 std::vector<ST*>& Z,
+			 SpinorSet<ST>& V,
+			 SpinorSet<ST>& Z,
 			 ST& w,
 			 Array2d<std::complex<double>>& H,
-			 std::vector<Givens* >& givens_rots,
+			 std::vector<Givens >& givens_rots,
 			 std::vector<std::complex<double>>& c,
 			 int&  ndim_cycle,
-			 ResiduumType resid_type) const
+			 ResiduumType resid_type,
+			 double norm_rhs,
+			 int first_col = 0) const
     {
 
       FlexibleArnoldiT<ST,GT>(n_krylov,
             rsd_target,
             _A,
             _M_prec,
-            V,Z,w, H,givens_rots,c, ndim_cycle, resid_type, _params.VerboseP);
+            V,Z,w, H,givens_rots,c, h_work_, ndim_cycle, resid_type, _params.VerboseP,
+            first_col, _params.NDefl > 0 ? &Hbar_ : nullptr, norm_rhs);
+    }
+
+    /*! Set up the next cycle from the harmonic Ritz vectors of the one just finished
+     *  (m columns, with eta_ its least squares solution). Rewrites the first k+1 vectors of V_,
+     *  the first k of Z_ and the first k columns of H_, and sets the (identity) Givens
+     *  rotations for them.
+     *
+     *  \return the number k of vectors kept, 0 if we have to restart from scratch
+     */
+    int DeflatedRestart(int m) const
+    {
+      const CBSubset& subset = _A.GetSubset();
+      const int k_req = _params.NDefl;
+
+      // Column major copies of Hbar and of the residual s = c0 - Hbar eta
+      std::vector<std::complex<double>> Hbar((m+1)*m, std::complex<double>(0,0));
+      std::vector<std::complex<double>> s(c0_.begin(), c0_.begin()+m+1);
+      for(int col=0; col < m; ++col) {
+        for(int row=0; row <= col+1; ++row) {
+          Hbar[row + (m+1)*col] = Hbar_(col,row);
+          s[row] -= Hbar_(col,row)*eta_[col];
+        }
+      }
+
+      std::vector<std::complex<double>> Pz(m*k_req);
+      std::vector<std::complex<double>> Pv((m+1)*(k_req+1));
+      std::vector<std::complex<double>> R((k_req+1)*k_req);
+      const int k = FGMRESDRRestart(Hbar.data(), s.data(), m, k_req, Pz.data(), Pv.data(), R.data());
+      if( k == 0 ) return 0;
+
+      SpinorSet<ST>& tmp = *DR_tmp_;
+
+      // V_new = V_{m+1} Pv
+      for(int i=0; i <= k; ++i) {
+        ZeroVec(tmp[i], subset);
+        AxpyMultiVec(&Pv[(m+1)*i], V_, m+1, tmp[i], subset);
+      }
+      for(int i=0; i <= k; ++i) {
+        CopyVec(V_[i], tmp[i], subset);
+      }
+
+      // Z_new = Z_m Pz
+      for(int i=0; i < k; ++i) {
+        ZeroVec(tmp[i], subset);
+        AxpyMultiVec(&Pz[m*i], Z_, m, tmp[i], subset);
+      }
+      for(int i=0; i < k; ++i) {
+        CopyVec(Z_[i], tmp[i], subset);
+      }
+
+      // A Z_new = V_new R
+      for(int col=0; col < _params.NKrylov; ++col) {
+        for(int row=0; row <= col+1; ++row) {
+          H_(col,row) = std::complex<double>(0,0);
+          Hbar_(col,row) = std::complex<double>(0,0);
+        }
+      }
+      for(int col=0; col < k; ++col) {
+        for(int row=0; row <= col; ++row) {
+          H_(col,row) = R[row + (k+1)*col];
+          Hbar_(col,row) = R[row + (k+1)*col];
+        }
+        givens_rots_[col] = Givens(col,H_);
+      }
+
+      return k;
     }
 
 
@@ -487,9 +834,19 @@ template<typename ST, typename GT>
     // handed around
     mutable Array2d<std::complex<double>> H_; // The H matrix
     mutable Array2d<std::complex<double>> R_; // R = H diagonalized with Givens rotations
-    mutable std::vector<ST*> V_;  // K(A)
-    mutable std::vector<ST*> Z_;  // K(MA)
-    mutable std::vector< Givens* > givens_rots_;
+    mutable SpinorSet<ST> V_;  // K(A)
+    mutable SpinorSet<ST> Z_;  // K(MA)
+    mutable std::unique_ptr<SpinorSet<ST>> W_;  // A Z, pipelined Arnoldi only
+
+    // For deflated restarts (NDefl > 0)
+    mutable Array2d<std::complex<double>> Hbar_;     // H before the Givens rotations
+    mutable std::vector<std::complex<double>> c0_;   // c before the Givens rotations
+    mutable std::unique_ptr<SpinorSet<ST>> DR_tmp_;  // workspace to rotate the bases
+    mutable std::vector< Givens > givens_rots_;     // Preallocated, NKrylov+1 of them
+    mutable std::vector<std::complex<double>> h_work_; // Gram-Schmidt coefficients of the Arnoldi
+
+    // Scratch spinors: w, r, tmp and the work vectors of the pipelined Arnoldi
+    mutable SpinorWorkspace<ST> work_;
 
     // This is the c = V^H_{k+1} r vector (c is frommers Notation)
     // For regular FGMRES I need to keep only the basis transformed
@@ -506,6 +863,9 @@ template<typename ST, typename GT>
 
     mutable std::vector<std::complex<double>> c_;
     mutable std::vector<std::complex<double>> eta_;
+
+    // Set by SetRsdTarget(). If not positive the target is _params.RsdTarget
+    mutable double rsd_target_ = 0;
     
 #ifdef MG_ENABLE_TIMERS
     std::shared_ptr<Timer::TimerAPI> timerAPI;
@@ -0,0 +1,411 @@
+/*
+ * invgcr_generic.h
+ */
+
+#ifndef INCLUDE_LATTICE_INVGCR_GENERIC_H_
+#define INCLUDE_LATTICE_INVGCR_GENERIC_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <algorithm>
+
+#ifdef MG_ENABLE_TIMERS
+#include "utils/timer.h"
+#endif
+
+#include "utils/print_utils.h"
+#include "lattice/gcr_common.h"
+#include "lattice/coarse/subset.h"
+#include "lattice/spinor_set.h"
+#include "lattice/gcrodr_recycle.h"
+
+namespace MG {
+
+namespace GCRGeneric {
+
+/* The Pythagorean norm of an orthogonalized direction is trusted only while
+ * || q_new ||^2 >= reorth_tol || q ||^2. Otherwise the direction is orthogonalized
+ * once more, explicitly.
+ */
+static const double reorth_tol = 1.0e-2;
+
+/** GCRSolverGeneric
+ *
+ *  Restarted, truncated flexible GCR. Each step takes z = M^{-1} r, q = A z, orthogonalizes
+ *  q against the last NTrunc directions q_i (and z by the same combination) and updates
+ *
+ *      x += alpha z,   r -= alpha q,   alpha = < q | r >,  || q || = 1
+ *
+ *  Memory is 2 vectors per kept direction (z_i and q_i) and no Hessenberg matrix,
+ *  against 2*(NKrylov+1) vectors for FGMRES, and the truncation bounds it independently
+ *  of the cycle length.
+ *
+ *  Each step needs a single global reduction. The residual is kept next to the q_i
+ *  (slot 0 of one SpinorSet), so one multi-dot of the set against the new q gives
+ *  < r | q >, the < q_i | q > and || q ||^2 together. r is orthogonal to the kept
+ *  q_i so < q_new | r > = < q | r >, || q_new ||^2 = || q ||^2 - sum_i |< q_i | q >|^2,
+ *  and || r ||^2 goes down by |alpha|^2. The true residual is recomputed at each restart.
+ *  The multi-dot is InnerProductNorm2MultiVec, which is one reduction for the coarse
+ *  (coarse_l1_blas.h) and the QPhiX (qphix_blas_wrappers.h) spinor sets; the generic
+ *  fallback in spinor_set.h would make one per vector.
+ *
+ *  With NRecycle = k > 0 this is GCRO-DR (Parks et. al.) in its flexible GCR form:
+ *  the solver keeps U and C = A U, C orthonormal, in the k slots after r (and the k
+ *  first slots of Z_). Every restart projects the residual,  x += U C^H r, r -= C C^H r,
+ *  and the new directions are orthogonalized against C in the same single reduction
+ *  as against the q_i. At the end of each cycle U is replaced by the k harmonic Ritz
+ *  vectors of A in span[ U, z_i ] of smallest magnitude (see GCRODRRecycle).
+ *  The recycle space survives between calls, so later right hand sides with the
+ *  same operator start deflated.
+ *
+ *  The space is only valid for the operator the solver was made with. The solver holds
+ *  on to the operator (by shared pointer if constructed from one) and a changed operator
+ *  must be followed by InvalidateRecycleSpace().
+ */
+template<typename ST, typename GT>
+class GCRSolverGeneric : public LinearSolver<ST,GT>
+{
+public:
+
+	GCRSolverGeneric(const LinearOperator<ST,GT>& A,
+			const MG::LinearSolverParamsBase& params,
+			const LinearSolver<ST,GT>* M_prec=nullptr) : _A(A), _info(A.GetInfo()),
+			_params(static_cast<const GCRParams&>(params)), _M_prec(M_prec),
+			_n_dirs( (_params.NTrunc < 1 || _params.NTrunc >= _params.NKrylov) ? _params.NKrylov : _params.NTrunc ),
+			_n_recycle( _params.NRecycle > 0 ? _params.NRecycle : 0 ),
+			RQ_(A.GetInfo(), 1+_n_recycle+_n_dirs), Z_(A.GetInfo(), _n_recycle+_n_dirs),
+			_n_recycle_valid(0)
+	{
+		if( _params.NKrylov < 1 ) {
+			MasterLog(ERROR, "GCRSolverGeneric: NKrylov=%d must be at least 1", _params.NKrylov);
+		}
+
+		// Unused recycle slots must stay zero: they are inside the multi-dots
+		for(int i=0; i < _n_recycle+_n_dirs; ++i) {
+			ZeroVec(RQ_[i+1],SUBSET_ALL);
+			ZeroVec(Z_[i],SUBSET_ALL);
+		}
+		ZeroVec(RQ_[0],SUBSET_ALL);
+
+		if( _n_recycle > 0 ) {
+			recycle_tmp_.reset( new SpinorSet<ST>(A.GetInfo(), _n_recycle) );
+		}
+
+#ifdef MG_ENABLE_TIMERS
+		int level = _A.GetLevel();
+		timerAPI = MG::Timer::TimerAPI::getInstance();
+		timerAPI->addTimer("GCRSolverGeneric/operator()/level"+std::to_string(level));
+		timerAPI->addTimer("GCRSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+	}
+
+	GCRSolverGeneric(std::shared_ptr<const LinearOperator<ST,GT>> A,
+			const MG::LinearSolverParamsBase& params,
+			const LinearSolver<ST,GT>* M_prec=nullptr)  : GCRSolverGeneric(*A,params,M_prec)
+	{
+		// Keep the operator alive as long as the recycle space
+		_A_ptr = A;
+	}
+
+	/*! Drop the recycle space, e.g. when the operator has changed */
+	void InvalidateRecycleSpace() const
+	{
+		for(int i=0; i < _n_recycle; ++i) {
+			ZeroVec(RQ_[i+1],SUBSET_ALL);
+			ZeroVec(Z_[i],SUBSET_ALL);
+		}
+		_n_recycle_valid = 0;
+	}
+
+	//! The number of vectors currently in the recycle space
+	int GetNumRecycle() const { return _n_recycle_valid; }
+
+	LinearSolverResults operator()(ST& out, const ST& in, ResiduumType resid_type = RELATIVE) const override
+	{
+		int level = _A.GetLevel();
+#ifdef MG_ENABLE_TIMERS
+		timerAPI->startTimer("GCRSolverGeneric/operator()/level"+std::to_string(level));
+#endif
+		LinearSolverResults res;
+		const CBSubset& subset = _A.GetSubset();
+		res.resid_type = resid_type;
+
+		const LatticeInfo&  in_info = in.GetInfo();
+		const LatticeInfo&  out_info = out.GetInfo();
+		AssertCompatible( in_info, _A.GetInfo());
+		AssertCompatible( out_info, _A.GetInfo());
+
+		double norm_rhs = sqrt(Norm2Vec(in,subset));
+		double target = _params.RsdTarget;
+		if ( resid_type == RELATIVE) {
+			target *= norm_rhs; // Target  || r || < || b || RsdTarget
+		}
+
+		// The residual lives in slot 0 of the set, next to the directions q_i
+		ST& r = RQ_[0];
+		ST z( in_info );
+		ST q( in_info );
+		ST tmp( in_info );
+		ZeroVec(z, SUBSET_ALL);
+		ZeroVec(q, SUBSET_ALL);
+
+		// r = b - A x
+		CopyVec(r, in, subset);
+		(_A)(tmp, out, LINOP_OP);
+		double r_norm = sqrt(XmyNorm2Vec(r,tmp,subset));
+		r_norm = projectOutRecycleSpace(out, r_norm, subset);
+
+		int iters_total = 0;
+		int n_cycles = 0;
+		if ( _params.VerboseP ) {
+			MasterLog(INFO,"GCR: level=%d iters=%d || r ||=%16.8e Target || r ||=%16.8e", level, iters_total, r_norm,target);
+		}
+
+		// Directions are kept after the recycle slots
+		const int q0 = _n_recycle;
+		std::vector<std::complex<double>> iprods(1+_n_recycle+_n_dirs);
+		std::vector<std::complex<double>> minus_beta(1+_n_recycle+_n_dirs);
+
+		bool finished = ( r_norm <= target ) || ( iters_total >= _params.MaxIter );
+		while( !finished ) {
+			++n_cycles;
+
+			// Estimate of || r ||^2 from the recurrence
+			double r_norm2 = r_norm*r_norm;
+
+			// Directions kept so far in this cycle. Direction k lives in slot k % _n_dirs
+			int n_kept = 0;
+
+			for(int k=0; k < _params.NKrylov && iters_total < _params.MaxIter; ++k) {
+
+				// z = M^{-1} r,  q = A z
+				if( _M_prec != nullptr ) {
+#ifdef MG_ENABLE_TIMERS
+					timerAPI->startTimer("GCRSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+					ZeroVec(z, subset);
+					(*_M_prec)(z, r, resid_type);
+#ifdef MG_ENABLE_TIMERS
+					timerAPI->stopTimer("GCRSolverGeneric/preconditioner/level"+std::to_string(level));
+#endif
+				}
+				else {
+					CopyVec(z, r, subset);
+				}
+				(_A)(q, z, LINOP_OP);
+				++iters_total;
+
+				// The one reduction: < r | q >, < c_i | q >, < q_i | q > and || q ||^2
+				const int n_orth = q0 + n_kept;
+				double q_norm2;
+				InnerProductNorm2MultiVec(RQ_, n_orth+1, q, iprods.data(), q_norm2, subset);
+
+				std::complex<double> r_dot_q = iprods[0];
+				double qn_norm2 = q_norm2;
+				if( n_orth > 0 ) {
+					orthogonalize(n_orth, iprods, minus_beta, z, q, subset);
+					for(int i=1; i <= n_orth; ++i) {
+						qn_norm2 -= std::norm(iprods[i]);
+					}
+
+					if( qn_norm2 < reorth_tol*q_norm2 ) {
+						// Too much cancellation: once more, explicitly
+						double q2_norm2;
+						InnerProductNorm2MultiVec(RQ_, n_orth+1, q, iprods.data(), q2_norm2, subset);
+						orthogonalize(n_orth, iprods, minus_beta, z, q, subset);
+						qn_norm2 = q2_norm2;
+						for(int i=1; i <= n_orth; ++i) {
+							qn_norm2 -= std::norm(iprods[i]);
+						}
+						r_dot_q = iprods[0];
+					}
+				}
+
+				if( qn_norm2 <= 0 ) {
+					MasterLog(INFO, "GCR: level=%d new direction is linearly dependent. Restarting", level);
+					break;
+				}
+
+				// Normalize into the slot of the oldest direction (which is dropped)
+				const int slot = q0 + k % _n_dirs;
+				const double inv_qn = 1/sqrt(qn_norm2);
+				ZeroVec(RQ_[slot+1], subset);
+				AxpyVec(inv_qn, q, RQ_[slot+1], subset);
+				ZeroVec(Z_[slot], subset);
+				AxpyVec(inv_qn, z, Z_[slot], subset);
+				if( n_kept < _n_dirs ) ++n_kept;
+
+				// alpha = < q_new | r > = conj( < r | q > )/ || q_new ||
+				std::complex<double> alpha = std::conj(r_dot_q)*inv_qn;
+				std::complex<float> alpha_f( std::real(alpha), std::imag(alpha) );
+				AxpyVec(alpha_f, Z_[slot], out, subset);
+				AxpyVec(-alpha_f, RQ_[slot+1], r, subset);
+
+				r_norm2 -= std::norm(alpha);
+				double r_norm_est = r_norm2 > 0 ? sqrt(r_norm2) : 0;
+				if( _params.VerboseP ) {
+					MasterLog(INFO,"GCR: level=%d iter=%d || r ||=%16.8e (estimate) Target=%16.8e", level, iters_total, r_norm_est, target);
+				}
+
+				if( r_norm_est <= target ) break;
+			}
+
+			// Refine the recycle space with the directions of this cycle
+			if( _n_recycle > 0 && n_kept > 0 ) {
+				updateRecycleSpace(n_kept, subset);
+			}
+
+			// Restart: recompute the true residual
+			CopyVec(r, in, subset);
+			(_A)(tmp, out, LINOP_OP);
+			r_norm = sqrt(XmyNorm2Vec(r,tmp,subset));
+			r_norm = projectOutRecycleSpace(out, r_norm, subset);
+
+			if ( _params.VerboseP ) {
+				MasterLog(INFO, "GCR: level=%d iter=%d || r ||=%16.8e target=%16.8e", level, iters_total, r_norm, target);
+			}
+			finished = ( r_norm <= target ) || (iters_total >= _params.MaxIter);
+		}
+
+		res.n_count = iters_total;
+		res.resid = r_norm;
+		if( resid_type == ABSOLUTE ) {
+			if( _params.VerboseP ) {
+				MasterLog(INFO,"GCR: level=%d Done. Cycles=%d, Iters=%d || r ||=%16.8e",level,
+						n_cycles,iters_total, res.resid);
+			}
+		}
+		else {
+			res.resid /= norm_rhs;
+			if( _params.VerboseP ) {
+				MasterLog(INFO,"GCR: level=%d Done. Cycles=%d, Iters=%d || r ||/|| b ||=%16.8e",level,
+						n_cycles,iters_total, res.resid);
+			}
+		}
+#ifdef MG_ENABLE_TIMERS
+		timerAPI->stopTimer("GCRSolverGeneric/operator()/level"+std::to_string(level));
+#endif
+		return res;
+	}
+
+private:
+
+	/* q -= sum_i beta_i q_i,  z -= sum_i beta_i z_i,  beta_i = iprods[i+1] = < q_i | q >,
+	 * for the n_orth vectors held in RQ_[1..n_orth] and Z_[0..n_orth-1]
+	 * (the recycle space followed by the kept directions)
+	 */
+	void orthogonalize(int n_orth, const std::vector<std::complex<double>>& iprods,
+			std::vector<std::complex<double>>& minus_beta, ST& z, ST& q, const CBSubset& subset) const
+	{
+		// slot 0 of RQ_ is r: leave it out
+		minus_beta[0] = std::complex<double>(0,0);
+		for(int i=1; i <= n_orth; ++i) {
+			minus_beta[i] = -iprods[i];
+		}
+		AxpyMultiVec(minus_beta.data(), RQ_, n_orth+1, q, subset);
+		AxpyMultiVec(minus_beta.data()+1, Z_, n_orth, z, subset);
+	}
+
+	/* x += U C^H r,  r -= C C^H r. One reduction, which also gives the new || r || */
+	double projectOutRecycleSpace(ST& x, double r_norm, const CBSubset& subset) const
+	{
+		if( _n_recycle_valid == 0 ) return r_norm;
+
+		std::vector<std::complex<double>> c(1+_n_recycle);
+		InnerProductMultiVec(RQ_, 1+_n_recycle, RQ_[0], c.data(), subset);  // c[0] = || r ||^2
+
+		double r_norm2 = std::real(c[0]);
+		std::vector<std::complex<double>> minus_c(1+_n_recycle);
+		minus_c[0] = std::complex<double>(0,0);
+		for(int i=1; i <= _n_recycle; ++i) {
+			r_norm2 -= std::norm(c[i]);
+			minus_c[i] = -c[i];
+		}
+		AxpyMultiVec(c.data()+1, Z_, _n_recycle, x, subset);
+		AxpyMultiVec(minus_c.data(), RQ_, 1+_n_recycle, RQ_[0], subset);
+
+		return r_norm2 > 0 ? sqrt(r_norm2) : 0;
+	}
+
+	/* Replace U, C by the harmonic Ritz vectors of A in span[ U, z_0 .. z_{n_kept-1} ] */
+	void updateRecycleSpace(int n_kept, const CBSubset& subset) const
+	{
+		const int n_orth = _n_recycle + n_kept;
+
+		// W = [ U_valid, z_i ] and AW = [ C_valid, q_i ] as slot lists
+		std::vector<int> w_slots;
+		for(int i=0; i < _n_recycle_valid; ++i) w_slots.push_back(i);
+		for(int i=0; i < n_kept; ++i) w_slots.push_back(_n_recycle+i);
+		const int n = static_cast<int>(w_slots.size());
+
+		// M = (AW)^H W: one multi-dot per column
+		std::vector<std::complex<double>> M(n*n);
+		std::vector<std::complex<double>> col(1+n_orth);
+		for(int j=0; j < n; ++j) {
+			InnerProductMultiVec(RQ_, 1+n_orth, Z_[w_slots[j]], col.data(), subset);
+			for(int i=0; i < n; ++i) {
+				M[i + n*j] = col[1+w_slots[i]];
+			}
+		}
+
+		const int k = std::min(_n_recycle, n);
+		std::vector<std::complex<double>> G(n*k);
+		if( GCRODRRecycle(M.data(), n, k, G.data()) == 0 ) return;
+
+		// C_new = (AW) G, U_new = W G
+		SpinorSet<ST>& tmp = *recycle_tmp_;
+		std::vector<std::complex<double>> coeffs(1+n_orth);
+		for(int pass=0; pass < 2; ++pass) {
+			for(int j=0; j < k; ++j) {
+				for(int i=0; i <= n_orth; ++i) coeffs[i] = std::complex<double>(0,0);
+				for(int i=0; i < n; ++i) coeffs[1+w_slots[i]] = G[i + n*j];
+
+				ZeroVec(tmp[j], subset);
+				if( pass == 0 ) {
+					AxpyMultiVec(coeffs.data(), RQ_, 1+n_orth, tmp[j], subset);
+				}
+				else {
+					AxpyMultiVec(coeffs.data()+1, Z_, n_orth, tmp[j], subset);
+				}
+			}
+			for(int j=0; j < _n_recycle; ++j) {
+				ST& dest = ( pass == 0 ) ? RQ_[1+j] : Z_[j];
+				if( j < k ) {
+					CopyVec(dest, tmp[j], subset);
+				}
+				else {
+					ZeroVec(dest, subset);
+				}
+			}
+		}
+		_n_recycle_valid = k;
+	}
+
+	const LinearOperator<ST,GT>& _A;
+	std::shared_ptr<const LinearOperator<ST,GT>> _A_ptr;
+	const LatticeInfo& _info;
+	const GCRParams _params;
+	const LinearSolver<ST,GT>* _M_prec;
+	const int _n_dirs;
+	const int _n_recycle;
+
+	mutable SpinorSet<ST> RQ_;  // [ r, c_0, ..., c_{n_recycle-1}, q_0, ..., q_{n_dirs-1} ]
+	mutable SpinorSet<ST> Z_;   // [ u_0, ..., u_{n_recycle-1}, z_0, ..., z_{n_dirs-1} ], A Z_ = RQ_[1..]
+	mutable int _n_recycle_valid;
+	mutable std::unique_ptr<SpinorSet<ST>> recycle_tmp_;
+
+#ifdef MG_ENABLE_TIMERS
+	std::shared_ptr<Timer::TimerAPI> timerAPI;
+#endif
+};
+
+} // namespace GCRGeneric
+} // namespace MG
+
+#endif /* INCLUDE_LATTICE_INVGCR_GENERIC_H_ */
@@ -0,0 +1,134 @@
+/*
+ * invmixed_generic.h
+ */
+
+#ifndef INCLUDE_LATTICE_INVMIXED_GENERIC_H_
+#define INCLUDE_LATTICE_INVMIXED_GENERIC_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/coarse/subset.h"
+#include "utils/print_utils.h"
+#include <cmath>
+
+namespace MG {
+
+/** MixedPrecisionSolver
+ *
+ *  Solves A x = b to the (double) precision of ST with an inner solver that runs
+ *  on the lower precision spinor type STF, using reliable updates:
+ *
+ *     r = b - A x                    (true residual, in ST)
+ *     solve A e = r                  (inner solver, in STF, from e = 0)
+ *     x += e                         (accumulated in ST)
+ *
+ *  The inner solver (typically FGMRES on the float operator, preconditioned with
+ *  the float entry point of the VCycle) runs until it has reduced its own, iterated,
+ *  residual by its RsdTarget, which is therefore the reliable update threshold delta.
+ *  Only the true residual recomputed in ST decides convergence, so the final
+ *  tolerance can be well below what STF can represent, while all the Krylov
+ *  vector traffic is in STF.
+ *
+ *  The params are those of the outer solve: RsdTarget is the target for the true
+ *  residual and MaxIter the maximum number of reliable updates. n_count in the
+ *  results is the total number of inner iterations.
+ *
+ *  The solver works on A.GetSubset(), so it can be used on an EO operator
+ *  (and wrapped with UnprecLinearSolverWrapper).
+ */
+template<typename ST, typename GT, typename STF, typename GTF>
+class MixedPrecisionSolver : public LinearSolver<ST,GT>
+{
+public:
+	MixedPrecisionSolver(const LinearOperator<ST,GT>& A,
+						const LinearSolver<STF,GTF>& inner_solver,
+						const LinearSolverParamsBase& params) :
+							_A(A), _inner_solver(inner_solver), _params(params) {}
+
+	LinearSolverResults operator()(ST& out, const ST& in, ResiduumType resid_type = RELATIVE ) const override
+	{
+		LinearSolverResults res;
+		const CBSubset& subset = _A.GetSubset();
+		const LatticeInfo& info = _A.GetInfo();
+		const int level = _A.GetLevel();
+
+		ST r(info);
+		ST tmp(info);
+		STF r_f(info);
+		STF e_f(info);
+
+		// Parts outside the subset stay zero throughout
+		ZeroVec(r_f, SUBSET_ALL);
+		ZeroVec(tmp, SUBSET_ALL);
+
+		const double norm_in = sqrt(Norm2Vec(in, subset));
+		double target = _params.RsdTarget;
+		if( resid_type == RELATIVE ) {
+			target *= norm_in;
+		}
+
+		// r = b - A x
+		_A(tmp, out, LINOP_OP);
+		CopyVec(r, in, subset);
+		double norm_r = sqrt(XmyNorm2Vec(r, tmp, subset));
+
+		if( _params.VerboseP ) {
+			MasterLog(INFO, "MIXED PRECISION: level=%d Initial || r ||=%16.8e  Target=%16.8e",
+					level, norm_r, target);
+		}
+
+		int n_inner = 0;
+		int n_updates = 0;
+		while( norm_r > target && n_updates < _params.MaxIter ) {
+			++n_updates;
+
+			// Solve A e = r in low precision
+			ConvertSpinor(r, r_f, subset);
+			ZeroVec(e_f, SUBSET_ALL);
+			LinearSolverResults inner_res = _inner_solver(e_f, r_f, RELATIVE);
+			n_inner += inner_res.n_count;
+
+			// x += e, in high precision
+			ConvertSpinor(e_f, tmp, subset);
+			AxpyVec(1.0, tmp, out, subset);
+
+			// Reliable update: replace the iterated residual with the true one
+			_A(tmp, out, LINOP_OP);
+			CopyVec(r, in, subset);
+			norm_r = sqrt(XmyNorm2Vec(r, tmp, subset));
+
+			if( _params.VerboseP ) {
+				MasterLog(INFO, "MIXED PRECISION: level=%d update=%d inner iters=%d || r ||=%16.8e  Target=%16.8e",
+						level, n_updates, inner_res.n_count, norm_r, target);
+			}
+
+			// The inner solver could not do anything with this residual,
+			// another update will not do better
+			if( inner_res.n_count == 0 ) break;
+		}
+
+		res.resid_type = resid_type;
+		res.n_count = n_inner;
+		res.resid = norm_r;
+		if( resid_type == RELATIVE ) {
+			res.resid /= norm_in;
+		}
+
+		if( _params.VerboseP ) {
+			MasterLog(INFO, "MIXED PRECISION: level=%d Done. Updates=%d Inner iters=%d || r ||/|| b ||=%16.8e",
+					level, n_updates, n_inner, norm_r/norm_in);
+		}
+		return res;
+	}
+
+private:
+	const LinearOperator<ST,GT>& _A;
+	const LinearSolver<STF,GTF>& _inner_solver;
+	const LinearSolverParamsBase _params;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_INVMIXED_GENERIC_H_ */
@@ -0,0 +1,208 @@
+/*
+ * invpipebicgstab_generic.h
+ */
+
+#ifndef INCLUDE_LATTICE_INVPIPEBICGSTAB_GENERIC_H_
+#define INCLUDE_LATTICE_INVPIPEBICGSTAB_GENERIC_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/coarse/subset.h"
+#include "utils/print_utils.h"
+#include <complex>
+#include <cmath>
+#include <memory>
+
+namespace MG {
+
+/** PipeBiCGStabSolverGeneric
+ *
+ *  Pipelined BiCGStab (Cools and Vanroose). The plain BiCGStab iteration has four
+ *  dependent global reductions, rho, < r0 | v >, || t ||^2 and < t | r >, plus the
+ *  residual norm. Carrying the extra recurrences
+ *
+ *      s = A p,  z = A s,  w = A r,  t = A w,  v = A z
+ *
+ *  lets each iteration be written as two fused vector updates, each ending in a
+ *  single global reduction, and two operator applications:
+ *
+ *      p,s,z,q,y update      -> < y | q >, || y ||^2                          (1)
+ *      v = A z
+ *      x,r,w update          -> < r0 | r >, < r0 | w >, < r0 | s >, < r0 | z >,
+ *                               || r ||^2                                     (2)
+ *      t = A w
+ *
+ *  The operator application following each update does not depend on its
+ *  reduction, so with non-blocking reductions each could hide behind it.
+ *  The fused updates PipeBiCGStabDirUpdate() and PipeBiCGStabSolUpdate() are
+ *  overloaded for each spinor type with the level 1 BLAS.
+ *
+ *  The residual is a recurrence of recurrences and drifts further from the
+ *  true one than in plain BiCGStab, particularly in single precision. So when the
+ *  recurred residual converges the true one is computed, and if it has not
+ *  converged the iteration restarts from it. The returned residual is the true one.
+ *  MaxIter counts iterations over all restarts.
+ *
+ *  The solver works on A.GetSubset(). The params are copied.
+ */
+template<typename ST, typename GT>
+class PipeBiCGStabSolverGeneric : public LinearSolver<ST,GT>
+{
+public:
+	PipeBiCGStabSolverGeneric(const LinearOperator<ST,GT>& A,
+						const LinearSolverParamsBase& params) : _A(A), _params(params) {}
+
+	PipeBiCGStabSolverGeneric(const std::shared_ptr<const LinearOperator<ST,GT>> A,
+						const LinearSolverParamsBase& params) : _A(*A), _params(params) {}
+
+	LinearSolverResults operator()(ST& out, const ST& in, ResiduumType resid_type = RELATIVE ) const override
+	{
+		using DComplex = std::complex<double>;
+
+		LinearSolverResults ret;
+		const CBSubset& subset = _A.GetSubset();
+		const LatticeInfo& info = _A.GetInfo();
+		const int level = _A.GetLevel();
+
+		ret.resid_type = resid_type;
+
+		if( _params.MaxIter <= 0 ) {
+			MasterLog(ERROR,"PipeBiCGStab: level=%d Invalid Value: MaxIter <= 0 ",level);
+		}
+
+		const double chi_sq = Norm2Vec(in,subset);
+		double rsd_sq = _params.RsdTarget*_params.RsdTarget;
+		if( resid_type == RELATIVE ) {
+			rsd_sq *= chi_sq;
+		}
+
+		ST r(info);
+		ST r0(info);
+		ST w(info);
+		ST t(info);
+		ST p(info);
+		ST s(info);
+		ST z(info);
+		ST v(info);
+		ST q(info);
+		ST y(info);
+
+		// r = r0 = b - A x
+		_A(r, out, LINOP_OP);
+		CopyVec(r0, in, subset);
+		double r_norm = XmyNorm2Vec(r0, r, subset);
+		CopyVec(r, r0, subset);
+
+		if( _params.VerboseP ) {
+			MasterLog(INFO,"PipeBiCGStab: level=%d iter=0 || r ||^2=%16.8e Target || r ||^2=%16.8e",level,r_norm,rsd_sq);
+		}
+
+		int k = 0;
+		int n_restarts = 0;
+		while( r_norm > rsd_sq && k < _params.MaxIter ) {
+
+			// (Re)start from the residual in r: w = A r, t = A w
+			_A(w, r, LINOP_OP);
+			_A(t, w, LINOP_OP);
+
+			DComplex rho = r_norm;
+			DComplex r0_w = InnerProductVec(r0, w, subset);
+			if( std::abs(r0_w) == 0 ) {
+				MasterLog(ERROR,"PipeBiCGStab: level=%d breakdown: <r_0|A r_0> = 0",level);
+			}
+
+			DComplex alpha = rho/r0_w;
+			DComplex beta(0,0);
+			DComplex omega(1,0);
+
+			// With beta = 0 these are never read, but 0 * garbage may be NaN
+			ZeroVec(p, subset);
+			ZeroVec(s, subset);
+			ZeroVec(z, subset);
+			ZeroVec(v, subset);
+
+			while( k < _params.MaxIter ) {
+				++k;
+
+				// (1): p, s, z, q = r - alpha s, y = w - alpha z
+				DComplex y_dot_q;
+				double y_norm;
+				PipeBiCGStabDirUpdate(alpha, beta, omega, r, w, t, v, p, s, z, q, y, y_dot_q, y_norm, subset);
+
+				// v = A z
+				_A(v, z, LINOP_OP);
+
+				if( y_norm == 0 ) {
+					MasterLog(ERROR,"PipeBiCGStab: level=%d Breakdown || y || = 0 ",level);
+				}
+				omega = y_dot_q/y_norm;
+
+				// (2): x, r = q - omega y, w = y - omega (t - alpha v)
+				DComplex r0_dots[4];
+				PipeBiCGStabSolUpdate(alpha, omega, p, q, y, t, v, r0, s, z, out, r, w, r0_dots, r_norm, subset);
+
+				if( _params.VerboseP ) {
+					MasterLog(INFO,"PipeBiCGStab: level=%d iter=%d || r ||^2=%16.8e  Target || r ||^2=%16.8e",level, k, r_norm, rsd_sq);
+				}
+
+				if( r_norm < rsd_sq ) break;
+
+				// t = A w
+				_A(t, w, LINOP_OP);
+
+				const DComplex rho_next = r0_dots[0];
+				if( std::abs(rho_next) == 0 ) {
+					MasterLog(ERROR,"PipeBiCGStab: level=%d breakdown: rho = 0",level);
+				}
+
+				beta = (alpha/omega)*(rho_next/rho);
+				rho = rho_next;
+
+				// < r0 | A p > with A p = s = w + beta (s - omega z)
+				const DComplex r0_Ap = r0_dots[1] + beta*(r0_dots[2] - omega*r0_dots[3]);
+				if( std::abs(r0_Ap) == 0 ) {
+					MasterLog(ERROR,"PipeBiCGStab: level=%d breakdown: <r_0|A p> = 0",level);
+				}
+				alpha = rho/r0_Ap;
+			}
+
+			// Only the true residual can end the solve. If the recurred one has drifted
+			// away from it, restart from the true residual (with it as the new shadow)
+			_A(r, out, LINOP_OP);
+			CopyVec(r0, in, subset);
+			r_norm = XmyNorm2Vec(r0, r, subset);
+			CopyVec(r, r0, subset);
+
+			if( r_norm > rsd_sq && k < _params.MaxIter ) {
+				++n_restarts;
+				if( _params.VerboseP ) {
+					MasterLog(INFO,"PipeBiCGStab: level=%d iter=%d restarting from the true residual || r ||^2=%16.8e",
+							level, k, r_norm);
+				}
+			}
+		}
+
+		ret.n_count = k;
+		ret.resid = sqrt(r_norm);
+		if( resid_type == RELATIVE ) {
+			ret.resid /= sqrt(chi_sq);
+		}
+
+		if( _params.VerboseP ) {
+			MasterLog(INFO,"PipeBiCGStab: level=%d Done. Iters=%d Restarts=%d || r ||_actual=%16.8e (%s)",
+					level, ret.n_count, n_restarts, ret.resid, resid_type == RELATIVE ? "relative" : "absolute");
+		}
+
+		return ret;
+	}
+
+private:
+	const LinearOperator<ST,GT>& _A;
+	const LinearSolverParamsBase _params;
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_INVPIPEBICGSTAB_GENERIC_H_ */
@@ -0,0 +1,136 @@
+/*
+ * invrichardson_generic.h
+ */
+
+#ifndef INCLUDE_LATTICE_INVRICHARDSON_GENERIC_H_
+#define INCLUDE_LATTICE_INVRICHARDSON_GENERIC_H_
+
+#include "MG_config.h"
+#include "lattice/constants.h"
+#include "lattice/linear_operator.h"
+#include "lattice/solver.h"
+#include "lattice/spinor_workspace.h"
+#include "lattice/coarse/subset.h"
+#include "utils/print_utils.h"
+#include <cmath>
+#include <memory>
+
+#ifdef MG_ENABLE_TIMERS
+#include "utils/timer.h"
+#endif
+
+namespace MG {
+
+/** RichardsonSolverGeneric
+ *
+ *  Preconditioned Richardson iteration, from a zero initial guess:
+ *
+ *      r = b,  x = 0
+ *      for k = 1 .. MaxIter:   e = M^{-1} r,  x += e,  r -= A e
+ *
+ *  With M^{-1} the cycle of the next level and MaxIter = gamma this is the coarse
+ *  correction of a W-cycle (gamma = 2): the coarse level is visited gamma times, with
+ *  the residual updated on the coarse level in between. For a Galerkin coarse operator
+ *  that is the same as repeating the correction on the fine level, but without the
+ *  fine operator applications.
+ *
+ *  The residual update gives || r || in the same reduction, and the iteration stops
+ *  early if it is below RsdTarget. Set RsdTarget = 0 for a fixed number of iterations.
+ *  The returned residual is the recurred one. Without a preconditioner M = 1.
+ */
+template<typename ST, typename GT>
+class RichardsonSolverGeneric : public LinearSolver<ST,GT>
+{
+public:
+	RichardsonSolverGeneric(const LinearOperator<ST,GT>& A,
+			const LinearSolverParamsBase& params,
+			const LinearSolver<ST,GT>* M_prec=nullptr) : _A(A), _params(params), _M_prec(M_prec)
+	{
+		if( _params.MaxIter <= 0 ) {
+			MasterLog(ERROR, "Richardson: level=%d Invalid Value: MaxIter <= 0 ", _A.GetLevel());
+		}
+#ifdef MG_ENABLE_TIMERS
+		timerAPI = MG::Timer::TimerAPI::getInstance();
+		timerAPI->addTimer("RichardsonSolverGeneric/operator()/level"+std::to_string(_A.GetLevel()));
+#endif
+	}
+
+	RichardsonSolverGeneric(const std::shared_ptr<const LinearOperator<ST,GT>> A,
+			const LinearSolverParamsBase& params,
+			const LinearSolver<ST,GT>* M_prec=nullptr) : RichardsonSolverGeneric(*A, params, M_prec) {}
+
+	LinearSolverResults operator()(ST& out, const ST& in, ResiduumType resid_type = RELATIVE ) const override
+	{
+		const int level = _A.GetLevel();
+#ifdef MG_ENABLE_TIMERS
+		timerAPI->startTimer("RichardsonSolverGeneric/operator()/level"+std::to_string(level));
+#endif
+		LinearSolverResults res;
+		res.resid_type = resid_type;
+
+		const CBSubset& subset = _A.GetSubset();
+		const LatticeInfo& info = _A.GetInfo();
+		AssertCompatible(in.GetInfo(), info);
+		AssertCompatible(out.GetInfo(), info);
+
+		auto r_scratch = _work.Get(info);
+		auto e_scratch = _work.Get(info);
+		auto tmp_scratch = _work.Get(info);
+		ST& r = *r_scratch;
+		ST& e = *e_scratch;
+		ST& tmp = *tmp_scratch;
+
+		ZeroVec(out, subset);
+		CopyVec(r, in, subset);
+		const double norm_in = sqrt(Norm2Vec(r, subset));
+		double target = _params.RsdTarget;
+		if( resid_type == RELATIVE ) {
+			target *= norm_in;
+		}
+
+		double r_norm = norm_in;
+		int k = 0;
+		while( k < _params.MaxIter && r_norm > target ) {
+			++k;
+			if( _M_prec != nullptr ) {
+				ZeroVec(e, subset);
+				(*_M_prec)(e, r, resid_type);
+			}
+			else {
+				CopyVec(e, r, subset);
+			}
+			AxpyVec(1.0, e, out, subset);
+
+			_A(tmp, e, LINOP_OP);
+			r_norm = sqrt(XmyNorm2Vec(r, tmp, subset));
+
+			if( _params.VerboseP ) {
+				MasterLog(INFO, "Richardson: level=%d iter=%d || r ||=%16.8e Target || r ||=%16.8e",
+						level, k, r_norm, target);
+			}
+		}
+
+		res.n_count = k;
+		res.resid = r_norm;
+		if( resid_type == RELATIVE && norm_in > 0 ) {
+			res.resid /= norm_in;
+		}
+#ifdef MG_ENABLE_TIMERS
+		timerAPI->stopTimer("RichardsonSolverGeneric/operator()/level"+std::to_string(level));
+#endif
+		return res;
+	}
+
+private:
+	const LinearOperator<ST,GT>& _A;
+	const LinearSolverParamsBase _params;
+	const LinearSolver<ST,GT>* _M_prec;
+	mutable SpinorWorkspace<ST> _work;
+#ifdef MG_ENABLE_TIMERS
+	std::shared_ptr<Timer::TimerAPI> timerAPI;
+#endif
+};
+
+}
+
+#endif /* INCLUDE_LATTICE_INVRICHARDSON_GENERIC_H_ */
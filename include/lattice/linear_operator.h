@@ -11,6 +11,7 @@
 #include "lattice/constants.h"
 #include "lattice/lattice_info.h"
 #include "lattice/coarse/subset.h"
+#include "lattice/spinor_set.h"
 #include "utils/print_utils.h"
 namespace MG {
 
@@ -26,6 +27,21 @@ public:
 	virtual
 	void operator()(Spinor& out, const Spinor& in, IndexType type = LINOP_OP) const  = 0;
 
+	/** MultiApply
+	 *
+	 *  Apply the operator to the first n_vecs vectors of in. Operators which can
+	 *  amortize their memory traffic (links, halos) over several right hand sides
+	 *  override this. The default applies the vectors one after the other.
+	 */
+	virtual
+	void MultiApply(SpinorSet<Spinor>& out, const SpinorSet<Spinor>& in, int n_vecs,
+			IndexType type = LINOP_OP) const
+	{
+		for(int i=0; i < n_vecs; ++i) {
+			(*this)(out[i], in[i], type);
+		}
+	}
+
 
 	virtual ~LinearOperator() {}
 
@@ -11,12 +11,14 @@
 #include <lattice/coarse/invbicgstab_coarse.h>
 #include <memory>
 #include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_spinor_set.h"
 #include "lattice/coarse/block.h"
 #include "lattice/solver.h"
 #include "lattice/fine_qdpxx/mg_params_qdpxx.h"
 #include "utils/timer.h"
 #include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
 #include "lattice/coarse/coarse_eo_wilson_clover_linear_operator.h"
+#include "lattice/coarse/thread_team.h"
 
 namespace MG {
 	template<typename SolverT, typename LinOpT>
@@ -25,19 +27,40 @@ namespace MG {
 	using LinOp = LinOpT;
 	std::shared_ptr<const LatticeInfo> info;
 	std::shared_ptr<CoarseGauge> gauge;
-	std::vector<std::shared_ptr<CoarseSpinor> > null_vecs; // NULL Vectors
+	std::shared_ptr<CoarseSpinorSet> null_vec_set;          // Storage for the NULL vectors
+	std::vector<std::shared_ptr<CoarseSpinor> > null_vecs; // NULL Vectors (views into null_vec_set)
 	std::vector<Block> blocklist;
 	std::shared_ptr< const SolverT > null_solver;           // Solver for NULL on this level;
 	std::shared_ptr< const LinOpT > M;
+	int n_threads = 0;                                      // Threads working on this level, see GetLevelNumThreads()
 
 	~MGLevelCoarseT() {}
 	};
 
 	// Unpreconditioned levels
-	using MGLevelCoarse = MGLevelCoarseT<BiCGStabSolverCoarse , CoarseWilsonCloverLinearOperator>;
+	// The null solvers are pipelined BiCGStab: setup runs a fixed number of
+	// iterations per vector, and these need two global reductions each rather than five
+	using MGLevelCoarse = MGLevelCoarseT<PipeBiCGStabSolverCoarse , CoarseWilsonCloverLinearOperator>;
 
 	// Preconditioned levels
-	using MGLevelCoarseEO = MGLevelCoarseT< UnprecBiCGStabSolverCoarseWrapper , CoarseEOWilsonCloverLinearOperator>;
+	using MGLevelCoarseEO = MGLevelCoarseT< UnprecPipeBiCGStabSolverCoarseWrapper , CoarseEOWilsonCloverLinearOperator>;
+
+	/** GetLevelNumThreads
+	 *
+	 *  The team size for coarse level level_id, with lattice info: p.level_threads[level_id]
+	 *  if it is given, otherwise GetAutoNumThreads(info). Either is capped at
+	 *  omp_get_max_threads(): called during the setup of the level above, that is its team.
+	 *  The coarse operator of the level must be constructed in a ThreadTeamScope of this
+	 *  size, so its thread limits are those of the team it will run in.
+	 */
+	int GetLevelNumThreads(const SetupParams& p, int level_id, const LatticeInfo& info);
+
+	/** SetLevelLinkPrecision
+	 *
+	 *  Stores the links of coarse level level_id, whose gauge field u is set up, in
+	 *  p.level_link_precision[level_id] if there is such an entry. By the team of the level.
+	 */
+	void SetLevelLinkPrecision(const SetupParams& p, int level_id, CoarseGauge& u);
 
 	template<typename CoarseLevelT>
 	void SetupCoarseToCoarseT(const SetupParams& p,
@@ -48,6 +71,9 @@ namespace MG {
 	{
 		// Info should already be created
 
+		// The null vectors are computed by the team of the fine level
+		ThreadTeamScope fine_team(fine_level.n_threads);
+
 		// Null solver is BiCGStab. Let us make a parameter struct for it.
 		LinearSolverParamsBase params;
 		params.MaxIter = p.null_solver_max_iter[fine_level_id];
@@ -66,9 +92,12 @@ namespace MG {
 
 		// Generate the vectors
 		int num_vecs = p.n_vecs[fine_level_id];
+		fine_level.null_vec_set = std::make_shared<CoarseSpinorSet>(fine_info, num_vecs);
 		fine_level.null_vecs.resize(num_vecs);
 		for(int k=0; k < num_vecs; ++k) {
-			fine_level.null_vecs[k] = std::make_shared<CoarseSpinor>(fine_info);
+			// Aliasing constructor: the view keeps the whole set alive
+			fine_level.null_vecs[k] = std::shared_ptr<CoarseSpinor>(fine_level.null_vec_set,
+																	&((*fine_level.null_vec_set)[k]));
 
 	  		Gaussian(*(fine_level.null_vecs[k]));
 			LinearSolverResults res = (*(fine_level.null_solver))((*fine_level.null_vecs[k]),b, ABSOLUTE);
@@ -85,12 +114,9 @@ namespace MG {
 				p.block_sizes[fine_level_id],
 				fine_level.info->GetLatticeOrigin());
 
-		// Orthonormalize the vectors -- I heard once that for GS stability is improved
-		// if you do it twice.
-		orthonormalizeBlockAggregates(fine_level.null_vecs,
-											fine_level.blocklist);
-
-		orthonormalizeBlockAggregates(fine_level.null_vecs,
+		// Orthonormalize the vectors -- CholeskyQR2 already orthogonalizes twice,
+		// so a single call is enough.
+		orthonormalizeBlockAggregates(*(fine_level.null_vec_set),
 											fine_level.blocklist);
 
 
@@ -101,13 +127,23 @@ namespace MG {
 														  blocked_lattice_dims,
 														  2, num_vecs, NodeInfo());
 
-		coarse_level.gauge = std::make_shared<CoarseGauge>(*(coarse_level.info));
+		coarse_level.n_threads = GetLevelNumThreads(p, fine_level_id+1, *(coarse_level.info));
+		MasterLog(INFO, "Level %d: using %d threads", fine_level_id+1, coarse_level.n_threads);
+		{
+			// First touch by the threads of the coarse level
+			ThreadTeamScope coarse_team(coarse_level.n_threads);
+			coarse_level.gauge = std::make_shared<CoarseGauge>(*(coarse_level.info));
+		}
 
 		M_fine->generateCoarse(fine_level.blocklist, fine_level.null_vecs, *(coarse_level.gauge));
 
 		//FIXME: Insert inversion of coarse level gauge links... here?
 
-		coarse_level.M = std::make_shared<const typename CoarseLevelT::LinOp>(coarse_level.gauge,fine_level_id+1);
+		{
+			ThreadTeamScope coarse_team(coarse_level.n_threads);
+			SetLevelLinkPrecision(p, fine_level_id+1, *(coarse_level.gauge));
+			coarse_level.M = std::make_shared<const typename CoarseLevelT::LinOp>(coarse_level.gauge,fine_level_id+1);
+		}
 
 	}
 	// These need to be moved into a .cc file. Right now they are with QDPXX (shriek!!!)
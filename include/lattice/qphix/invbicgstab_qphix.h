@@ -15,6 +15,9 @@
 #include "lattice/qphix/qphix_types.h"
 #include "lattice/qphix/qphix_clover_linear_operator.h"
 #include "lattice/qphix/qphix_eo_clover_linear_operator.h"
+#include "lattice/qphix/qphix_blas_wrappers.h"
+#include "lattice/invpipebicgstab_generic.h"
+#include "lattice/unprec_solver_wrappers.h"
 #include "qphix/invbicgstab.h"
 #include <memory>
 
@@ -40,6 +43,13 @@ public:
 
 
    {}
+
+  BiCGStabSolverQPhiXT(const std::shared_ptr<QPhiXWilsonCloverLinearOperatorT<FT>>& M,
+                       const LinearSolverParamsBase& params) : BiCGStabSolverQPhiXT(*M,params) {}
+
+  BiCGStabSolverQPhiXT(const std::shared_ptr<QPhiXWilsonCloverEOLinearOperatorT<FT>>& M,
+                       const LinearSolverParamsBase& params) : BiCGStabSolverQPhiXT(*M,params) {}
+
   LinearSolverResults operator()(QPhiXSpinorT<FT>& out,
                                 const QPhiXSpinorT<FT>& in,
                                 ResiduumType resid_type = RELATIVE ) const
@@ -134,6 +144,15 @@ public:
     using BiCGStabSolverQPhiXEO = BiCGStabSolverQPhiXTEO<double>;
     using BiCGStabSolverQPhiXFEO = BiCGStabSolverQPhiXTEO<float>;
 
+    // Pipelined BiCGStab (see invpipebicgstab_generic.h), with the fused updates
+    // from qphix_blas_wrappers. These work on the subset of the operator, so on
+    // an EO operator they solve the Schur system: use the Unprec wrapper for the full one.
+    using PipeBiCGStabSolverQPhiX = PipeBiCGStabSolverGeneric<QPhiXSpinor,QPhiXGauge>;
+    using PipeBiCGStabSolverQPhiXF = PipeBiCGStabSolverGeneric<QPhiXSpinorF,QPhiXGaugeF>;
+
+    using UnprecPipeBiCGStabSolverQPhiXWrapper = UnprecLinearSolverWrapper<QPhiXSpinor,QPhiXGauge,PipeBiCGStabSolverQPhiX>;
+    using UnprecPipeBiCGStabSolverQPhiXFWrapper = UnprecLinearSolverWrapper<QPhiXSpinorF,QPhiXGaugeF,PipeBiCGStabSolverQPhiXF>;
+
 }  // end namespace MGTEsting
 
 
@@ -0,0 +1,23 @@
+/*
+ * invgcr_qphix.h
+ */
+
+#ifndef INCLUDE_LATTICE_QPHIX_INVGCR_QPHIX_H_
+#define INCLUDE_LATTICE_QPHIX_INVGCR_QPHIX_H_
+
+#include  "lattice/qphix/qphix_types.h"
+#include  "lattice/qphix/qphix_blas_wrappers.h"
+#include  "lattice/invgcr_generic.h"
+#include  "lattice/unprec_solver_wrappers.h"
+
+namespace MG {
+
+  using GCRSolverQPhiX = GCRGeneric::GCRSolverGeneric<QPhiXSpinor,QPhiXGauge>;
+  using GCRSolverQPhiXF = GCRGeneric::GCRSolverGeneric<QPhiXSpinorF,QPhiXGaugeF>;
+
+  using UnprecGCRSolverQPhiXWrapper =  UnprecLinearSolverWrapper<QPhiXSpinor,QPhiXGauge,GCRGeneric::GCRSolverGeneric<QPhiXSpinor,QPhiXGauge>>;
+  using UnprecGCRSolverQPhiXFWrapper =  UnprecLinearSolverWrapper<QPhiXSpinorF,QPhiXGaugeF,GCRGeneric::GCRSolverGeneric<QPhiXSpinorF,QPhiXGaugeF>>;
+
+}
+
+#endif /* INCLUDE_LATTICE_QPHIX_INVGCR_QPHIX_H_ */
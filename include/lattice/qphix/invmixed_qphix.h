@@ -0,0 +1,22 @@
+/*
+ * invmixed_qphix.h
+ */
+
+#ifndef INCLUDE_LATTICE_QPHIX_INVMIXED_QPHIX_H_
+#define INCLUDE_LATTICE_QPHIX_INVMIXED_QPHIX_H_
+
+#include  "lattice/qphix/qphix_types.h"
+#include  "lattice/qphix/qphix_blas_wrappers.h"
+#include  "lattice/invmixed_generic.h"
+#include  "lattice/unprec_solver_wrappers.h"
+
+namespace MG {
+
+  // Double precision solves with a single precision inner solver
+  using MixedPrecisionSolverQPhiX = MixedPrecisionSolver<QPhiXSpinor,QPhiXGauge,QPhiXSpinorF,QPhiXGaugeF>;
+
+  using UnprecMixedPrecisionSolverQPhiXWrapper = UnprecLinearSolverWrapper<QPhiXSpinor,QPhiXGauge,MixedPrecisionSolverQPhiX>;
+
+}
+
+#endif /* INCLUDE_LATTICE_QPHIX_INVMIXED_QPHIX_H_ */
@@ -15,6 +15,9 @@
 #include "lattice/qphix/qphix_clover_linear_operator.h"
 #include "lattice/qphix/qphix_eo_clover_linear_operator.h"
 #include "lattice/mr_params.h"
+#include "lattice/qphix/qphix_blas_wrappers.h"
+#include "lattice/invchebyshev_generic.h"
+#include "lattice/unprec_solver_wrappers.h"
 #include <qphix/invmr.h>
 #include <memory>
 
@@ -181,6 +184,14 @@ public:
 
   using MRSmootherQPhiXEO  = MRSmootherQPhiXTEO<double>;
    using MRSmootherQPhiXEOF = MRSmootherQPhiXTEO<float>;
+
+  // Chebyshev smoothers: no global reductions after the setup (see invchebyshev_generic.h),
+  // with the fused update ChebyshevUpdate() from qphix_blas_wrappers.h
+  using ChebyshevSmootherQPhiX = ChebyshevSmootherGeneric<QPhiXSpinor,QPhiXGauge>;
+  using ChebyshevSmootherQPhiXF = ChebyshevSmootherGeneric<QPhiXSpinorF,QPhiXGaugeF>;
+
+  using UnprecChebyshevSmootherQPhiXWrapper = UnprecSmootherWrapper<QPhiXSpinor,QPhiXGauge,ChebyshevSmootherQPhiX>;
+  using UnprecChebyshevSmootherQPhiXFWrapper = UnprecSmootherWrapper<QPhiXSpinorF,QPhiXGaugeF,ChebyshevSmootherQPhiXF>;
 }  // end namespace MGTEsting
 
 
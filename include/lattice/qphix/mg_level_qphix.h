@@ -62,13 +62,13 @@ namespace MG {
     fine_level.info = std::make_shared<LatticeInfo>((M_fine->GetInfo()).GetLatticeDimensions());
 
 
-    // Null solver is BiCGStabF. Let us make a parameter struct for it.
+    // Null solver is (pipelined) BiCGStabF. Let us make a parameter struct for it.
     LinearSolverParamsBase params;
     params.MaxIter = p.null_solver_max_iter[0];
     params.RsdTarget = p.null_solver_rsd_target[0];
     params.VerboseP = p.null_solver_verboseP[0];
 
-    fine_level.null_solver = std::make_shared<const SolverT>(*M_fine, params);
+    fine_level.null_solver = std::make_shared<const SolverT>(M_fine, params);
 
     // Zero RHS
     SpinorT b(*(fine_level.info));
@@ -115,13 +115,13 @@ namespace MG {
     }
 
     if( ! fine_level.null_solver) {
-      // Null solver is BiCGStabF. Let us make a parameter struct for it.
+      // Null solver is (pipelined) BiCGStabF. Let us make a parameter struct for it.
        LinearSolverParamsBase params;
        params.MaxIter = p.null_solver_max_iter[0];
        params.RsdTarget = p.null_solver_rsd_target[0];
        params.VerboseP = p.null_solver_verboseP[0];
 
-       fine_level.null_solver = std::make_shared<const SolverT>(*M_fine, params);
+       fine_level.null_solver = std::make_shared<const SolverT>(M_fine, params);
     }
 
     int num_vecs = p.n_vecs[0];
@@ -141,15 +141,10 @@ namespace MG {
         p.block_sizes[0],
         fine_level.info->GetLatticeOrigin());
 
-    // Orthonormalize the vectors -- I heard once that for GS stability is improved
-    // if you do it twice.
+    // Orthonormalize the vectors -- CholeskyQR2 already orthogonalizes twice,
+    // so a single call is enough.
     MasterLog(INFO, "MG Level 0: Block Orthogonalizing Aggregates");
 
-
-
-    orthonormalizeBlockAggregates(fine_level.null_vecs,
-                      fine_level.blocklist);
-
     orthonormalizeBlockAggregates(fine_level.null_vecs,
                       fine_level.blocklist);
 
@@ -163,14 +158,24 @@ namespace MG {
                               blocked_lattice_dims,
                               2, num_vecs, NodeInfo());
 
-    coarse_level.gauge = std::make_shared<CoarseGauge>(*(coarse_level.info));
+    coarse_level.n_threads = GetLevelNumThreads(p, 1, *(coarse_level.info));
+    MasterLog(INFO, "MG Level 1: using %d threads", coarse_level.n_threads);
+    {
+      // First touch by the threads of the coarse level
+      ThreadTeamScope coarse_team(coarse_level.n_threads);
+      coarse_level.gauge = std::make_shared<CoarseGauge>(*(coarse_level.info));
+    }
 
 
 
     M_fine->generateCoarse(fine_level.blocklist, fine_level.null_vecs, *(coarse_level.gauge));
 
 
-    coarse_level.M = std::make_shared< const typename CoarseLevelT::LinOp>(coarse_level.gauge,1);
+    {
+      ThreadTeamScope coarse_team(coarse_level.n_threads);
+      SetLevelLinkPrecision(p, 1, *(coarse_level.gauge));
+      coarse_level.M = std::make_shared< const typename CoarseLevelT::LinOp>(coarse_level.gauge,1);
+    }
 
   }
 
@@ -212,10 +217,10 @@ namespace MG {
 
 
    // Unpreconditioned Multigrid levels
-   using QPhiXMultigridLevels = QPhiXMultigridLevelsT<QPhiXSpinorF,BiCGStabSolverQPhiXF,QPhiXWilsonCloverLinearOperatorF, MGLevelCoarse>;
+   using QPhiXMultigridLevels = QPhiXMultigridLevelsT<QPhiXSpinorF,PipeBiCGStabSolverQPhiXF,QPhiXWilsonCloverLinearOperatorF, MGLevelCoarse>;
 
-   // Preconditioned Multigrid levels: Use BiGStabSolver (which for QPhiX is an unprec wrapper)
-   using QPhiXMultigridLevelsEO = QPhiXMultigridLevelsT<QPhiXSpinorF,BiCGStabSolverQPhiXF,QPhiXWilsonCloverEOLinearOperatorF,MGLevelCoarseEO>;
+   // Preconditioned Multigrid levels: the null solver works on the odd checkerboard, through the unprec wrapper
+   using QPhiXMultigridLevelsEO = QPhiXMultigridLevelsT<QPhiXSpinorF,UnprecPipeBiCGStabSolverQPhiXFWrapper,QPhiXWilsonCloverEOLinearOperatorF,MGLevelCoarseEO>;
 
 
    // Easy to use Overloaded Wrappers (which call templated functions beneath)
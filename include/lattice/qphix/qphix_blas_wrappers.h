@@ -10,6 +10,7 @@
 
 #include "lattice/qphix/qphix_types.h"
 #include "lattice/coarse/subset.h"
+#include "lattice/spinor_set.h"
 namespace MG
 {
 
@@ -48,6 +49,70 @@ void YmeqXVec(const QPhiXSpinorF& x, QPhiXSpinorF& y,const CBSubset& subset = SU
 void ConvertSpinor(const QPhiXSpinor& in, QPhiXSpinorF& out, const CBSubset& subset = SUBSET_ALL);
 void ConvertSpinor(const QPhiXSpinorF& in, QPhiXSpinor& out, const CBSubset& subset = SUBSET_ALL);
 
+// Same precision 'conversions' are copies. They let code templated on the
+// outer spinor type (e.g. the VCycles) take either precision
+void ConvertSpinor(const QPhiXSpinor& in, QPhiXSpinor& out, const CBSubset& subset = SUBSET_ALL);
+void ConvertSpinor(const QPhiXSpinorF& in, QPhiXSpinorF& out, const CBSubset& subset = SUBSET_ALL);
+
+// The fused steps of pipelined BiCGStab, one sweep and one global reduction each
+// (see coarse_l1_blas.h for what they compute)
+void PipeBiCGStabDirUpdate(const std::complex<double>& alpha, const std::complex<double>& beta,
+    const std::complex<double>& omega,
+    const QPhiXSpinor& r, const QPhiXSpinor& w, const QPhiXSpinor& t, const QPhiXSpinor& v,
+    QPhiXSpinor& p, QPhiXSpinor& s, QPhiXSpinor& z, QPhiXSpinor& q, QPhiXSpinor& y,
+    std::complex<double>& y_dot_q, double& y_norm2, const CBSubset& subset = SUBSET_ALL);
+
+void PipeBiCGStabDirUpdate(const std::complex<double>& alpha, const std::complex<double>& beta,
+    const std::complex<double>& omega,
+    const QPhiXSpinorF& r, const QPhiXSpinorF& w, const QPhiXSpinorF& t, const QPhiXSpinorF& v,
+    QPhiXSpinorF& p, QPhiXSpinorF& s, QPhiXSpinorF& z, QPhiXSpinorF& q, QPhiXSpinorF& y,
+    std::complex<double>& y_dot_q, double& y_norm2, const CBSubset& subset = SUBSET_ALL);
+
+void PipeBiCGStabSolUpdate(const std::complex<double>& alpha, const std::complex<double>& omega,
+    const QPhiXSpinor& p, const QPhiXSpinor& q, const QPhiXSpinor& y,
+    const QPhiXSpinor& t, const QPhiXSpinor& v,
+    const QPhiXSpinor& r0, const QPhiXSpinor& s, const QPhiXSpinor& z,
+    QPhiXSpinor& x, QPhiXSpinor& r, QPhiXSpinor& w,
+    std::complex<double>* r0_dots, double& r_norm2, const CBSubset& subset = SUBSET_ALL);
+
+void PipeBiCGStabSolUpdate(const std::complex<double>& alpha, const std::complex<double>& omega,
+    const QPhiXSpinorF& p, const QPhiXSpinorF& q, const QPhiXSpinorF& y,
+    const QPhiXSpinorF& t, const QPhiXSpinorF& v,
+    const QPhiXSpinorF& r0, const QPhiXSpinorF& s, const QPhiXSpinorF& z,
+    QPhiXSpinorF& x, QPhiXSpinorF& r, QPhiXSpinorF& w,
+    std::complex<double>* r0_dots, double& r_norm2, const CBSubset& subset = SUBSET_ALL);
+
+// The fused step of the Chebyshev smoother: x += d, r -= Ad, d = a d + b r. No reductions.
+void ChebyshevUpdate(const double a, const double b, const QPhiXSpinor& Ad,
+    QPhiXSpinor& d, QPhiXSpinor& r, QPhiXSpinor& x, const CBSubset& subset = SUBSET_ALL);
+
+void ChebyshevUpdate(const double a, const double b, const QPhiXSpinorF& Ad,
+    QPhiXSpinorF& d, QPhiXSpinorF& r, QPhiXSpinorF& x, const CBSubset& subset = SUBSET_ALL);
+
+// Block BLAS on the first n_vecs vectors of a set (see spinor_set.h), in one sweep and
+// one global reduction, instead of the generic one level 1 call per vector
+
+//! iprods[j] = < x_j | y >
+void InnerProductMultiVec(const SpinorSet<QPhiXSpinor>& x, int n_vecs, const QPhiXSpinor& y,
+    std::complex<double>* iprods, const CBSubset& subset = SUBSET_ALL);
+
+void InnerProductMultiVec(const SpinorSet<QPhiXSpinorF>& x, int n_vecs, const QPhiXSpinorF& y,
+    std::complex<double>* iprods, const CBSubset& subset = SUBSET_ALL);
+
+//! iprods[j] = < x_j | y > and norm2_y = || y ||^2 in a single global reduction
+void InnerProductNorm2MultiVec(const SpinorSet<QPhiXSpinor>& x, int n_vecs, const QPhiXSpinor& y,
+    std::complex<double>* iprods, double& norm2_y, const CBSubset& subset = SUBSET_ALL);
+
+void InnerProductNorm2MultiVec(const SpinorSet<QPhiXSpinorF>& x, int n_vecs, const QPhiXSpinorF& y,
+    std::complex<double>* iprods, double& norm2_y, const CBSubset& subset = SUBSET_ALL);
+
+//! y += sum_j alpha[j] x_j
+void AxpyMultiVec(const std::complex<double>* alpha, const SpinorSet<QPhiXSpinor>& x, int n_vecs,
+    QPhiXSpinor& y, const CBSubset& subset = SUBSET_ALL);
+
+void AxpyMultiVec(const std::complex<double>* alpha, const SpinorSet<QPhiXSpinorF>& x, int n_vecs,
+    QPhiXSpinorF& y, const CBSubset& subset = SUBSET_ALL);
+
 }
 
 
@@ -13,8 +13,10 @@
 #include <lattice/qphix/qphix_types.h>
 #include <lattice/qphix/qphix_blas_wrappers.h>
 #include <lattice/coarse/coarse_types.h>
+#include <lattice/coarse/coarse_spinor_set.h>
 #include <lattice/qphix/qphix_aggregate.h>
 #include <lattice/qphix/qphix_transfer.h>
+#include <lattice/spinor_workspace.h>
 
 #ifdef MG_ENABLE_TIMERS
 #include "utils/timer.h"
@@ -24,22 +26,173 @@ namespace MG
 {
 
 class VCycleQPhiXCoarse2 :
-    public LinearSolver<QPhiXSpinor, QPhiXGauge >
+    public LinearSolver<QPhiXSpinor, QPhiXGauge >,
+    public LinearSolver<QPhiXSpinorF, QPhiXGaugeF >
 {
 public:
   LinearSolverResults operator()(QPhiXSpinor& out,
-      const QPhiXSpinor& in, ResiduumType resid_type = RELATIVE ) const
+      const QPhiXSpinor& in, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return apply(out,in,resid_type);
+  }
+
+  // Single precision entry point: a float outer solver can use this
+  // without round tripping through double on every application
+  LinearSolverResults operator()(QPhiXSpinorF& out,
+      const QPhiXSpinorF& in, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return apply(out,in,resid_type);
+  }
+
+  /** MultiSolve
+   *
+   *  The cycle on n_vecs right hand sides together. The fine smoothers and operator
+   *  still go one vector at a time, but the restricted residua go into one coarse solve
+   *  with MultiSolve, so the coarse levels (see VCycleCoarse::MultiSolve) stream their
+   *  links and transfer vectors once per batch.
+   */
+  std::vector<LinearSolverResults> MultiSolve(SpinorSet<QPhiXSpinor>& out,
+      const SpinorSet<QPhiXSpinor>& in, int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return applyMulti(out,in,n_vecs,resid_type);
+  }
+
+  std::vector<LinearSolverResults> MultiSolve(SpinorSet<QPhiXSpinorF>& out,
+      const SpinorSet<QPhiXSpinorF>& in, int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return applyMulti(out,in,n_vecs,resid_type);
+  }
+
+  // Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+  void SetOuterResidual(double rel_resid) const override
+  {
+    _bottom_solver.SetOuterResidual(rel_resid);
+  }
+
+private:
+  template<typename OuterSpinor>
+  std::vector<LinearSolverResults> applyMulti(SpinorSet<OuterSpinor>& out,
+      const SpinorSet<OuterSpinor>& in, int n_vecs, ResiduumType resid_type) const
+  {
+    // Per vector residua and solutions, and the coarse batch. Kept between calls.
+    if( !_multi_r || _multi_r->GetNumVecs() < n_vecs ) {
+      _multi_r.reset( new SpinorSet<QPhiXSpinorF>(_fine_info, n_vecs) );
+      _multi_out.reset( new SpinorSet<QPhiXSpinorF>(_fine_info, n_vecs) );
+      _multi_coarse_in.reset( new CoarseSpinorSet(_coarse_info, n_vecs) );
+      _multi_coarse_delta.reset( new CoarseSpinorSet(_coarse_info, n_vecs) );
+    }
+    SpinorSet<QPhiXSpinorF>& r = *_multi_r;
+    SpinorSet<QPhiXSpinorF>& out_f = *_multi_out;
+    CoarseSpinorSet& coarse_in = *_multi_coarse_in;
+    CoarseSpinorSet& coarse_delta = *_multi_coarse_delta;
+
+    auto delta_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& delta = *delta_scratch;
+    auto tmp_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& tmp = *tmp_scratch;
+
+    int level = _M_fine.GetLevel();
+
+    std::vector<double> norm_in(n_vecs);
+    std::vector<double> norm_r(n_vecs);
+    std::vector<double> target(n_vecs);
+    bool continueP = false;
+    for(int j=0; j < n_vecs; ++j) {
+      ConvertSpinor(in[j],r[j]);
+      ZeroVec(out_f[j]);
+      norm_r[j] = sqrt(Norm2Vec(r[j]));
+      norm_in[j] = norm_r[j];
+      target[j] = _param.RsdTarget;
+      if( resid_type == RELATIVE ) {
+        target[j] *= norm_in[j];
+      }
+      continueP = continueP || ( norm_r[j] > target[j] );
+    }
+    continueP = continueP && ( _param.MaxIter > 0 );
+
+    int iter = 0;
+    while ( continueP ) {
+      ++iter;
+
+      // Pre-smooth and restrict each vector
+      for(int j=0; j < n_vecs; ++j) {
+        ZeroVec(delta);
+        _pre_smoother(delta,r[j]);
+        YpeqXVec(delta,out_f[j]);
+        _M_fine(tmp,delta,LINOP_OP);
+        YmeqXVec(tmp,r[j]);
+
+        _Transfer.R(r[j],coarse_in[j]);
+        ZeroVec(coarse_delta[j]);
+      }
+
+      // Coarse solve on the batch
+      _bottom_solver.MultiSolve(coarse_delta,coarse_in,n_vecs);
+
+      // Prolongate and post-smooth each vector
+      bool convergedP = true;
+      for(int j=0; j < n_vecs; ++j) {
+        _Transfer.P(coarse_delta[j],delta);
+        YpeqXVec(delta,out_f[j]);
+        _M_fine(tmp,delta,LINOP_OP);
+        YmeqXVec(tmp,r[j]);
+
+        ZeroVec(delta);
+        _post_smoother(delta,r[j]);
+        YpeqXVec(delta,out_f[j]);
+        _M_fine(tmp,delta,LINOP_OP);
+        norm_r[j] = sqrt(XmyNorm2Vec(r[j],tmp));
+        convergedP = convergedP && ( norm_r[j] <= target[j] );
+
+        if( _param.VerboseP ) {
+          if( resid_type == RELATIVE) {
+            MasterLog(INFO, "VCYCLE (QPhiX->COARSE, MULTI): level=%d iter=%d rhs=%d "
+                "|| r ||/|| b|| =%16.8e Target=%16.8e",
+                level, iter, j, norm_r[j]/norm_in[j], _param.RsdTarget);
+          }
+          else {
+            MasterLog(INFO, "VCYCLE (QPhiX->COARSE, MULTI): level=%d iter=%d rhs=%d "
+                "|| r || =%16.8e Target=%16.8e",
+                level, iter, j, norm_r[j], _param.RsdTarget);
+          }
+        }
+      }
+
+      // Check convergence
+      continueP = ( iter < _param.MaxIter ) && !convergedP;
+    }
+
+    // Convert back to the outer precision
+    std::vector<LinearSolverResults> res(n_vecs);
+    for(int j=0; j < n_vecs; ++j) {
+      ConvertSpinor(out_f[j],out[j]);
+      res[j].resid_type = resid_type;
+      res[j].n_count = iter;
+      res[j].resid = norm_r[j];
+      if( resid_type == RELATIVE ) {
+        res[j].resid = ( norm_in[j] > 0 ) ? res[j].resid/norm_in[j] : 0;
+      }
+    }
+    return res;
+  }
+
+  template<typename OuterSpinor>
+  LinearSolverResults apply(OuterSpinor& out,
+      const OuterSpinor& in, ResiduumType resid_type) const
   {
     LinearSolverResults res;
 
-    QPhiXSpinorF in_f(_fine_info);
+    auto in_f_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& in_f = *in_f_scratch;
     ConvertSpinor(in,in_f);
 
     // May want to do these in double later?
     // But this is just a preconditioner.
     // So try SP for now
-    QPhiXSpinorF r(_fine_info);
-    QPhiXSpinorF out_f(_fine_info);
+    auto r_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& r = *r_scratch;
+    auto out_f_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& out_f = *out_f_scratch;
 
     int level = _M_fine.GetLevel();
 
@@ -80,10 +233,14 @@ public:
     int iter = 0;
 
     bool continueP = true;
-    QPhiXSpinorF delta(_fine_info);
-    QPhiXSpinorF tmp(_fine_info);
-    CoarseSpinor coarse_in(_coarse_info);
-    CoarseSpinor coarse_delta(_coarse_info);
+    auto delta_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& delta = *delta_scratch;
+    auto tmp_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& tmp = *tmp_scratch;
+    auto coarse_in_scratch = _coarse_work.Get(_coarse_info);
+    CoarseSpinor& coarse_in = *coarse_in_scratch;
+    auto coarse_delta_scratch = _coarse_work.Get(_coarse_info);
+    CoarseSpinor& coarse_delta = *coarse_delta_scratch;
     double done = 1;
     double mone = -1;
 
@@ -177,7 +334,7 @@ public:
       continueP = ( iter < _param.MaxIter ) &&  toBool( norm_r > target );
     }
 
-    // Convert Back Up to DP
+    // Convert back to the outer precision
     ConvertSpinor(out_f,out);
     res.resid_type = resid_type;
     res.n_count = iter;
@@ -188,6 +345,7 @@ public:
     return res;
   }
 
+public:
   VCycleQPhiXCoarse2(const LatticeInfo& fine_info,
       const LatticeInfo& coarse_info,
       const std::vector<Block>& my_blocks,
@@ -220,6 +378,16 @@ private:
   const LinearSolverParamsBase& _param;
   const QPhiXTransfer<QPhiXSpinorF> _Transfer;
 
+  // Scratch spinors, so only the first call allocates the temporaries
+  mutable SpinorWorkspace<QPhiXSpinorF> _fine_work;
+  mutable SpinorWorkspace<CoarseSpinor> _coarse_work;
+
+  // Scratch sets for MultiSolve, reallocated only for a bigger batch
+  mutable std::unique_ptr<SpinorSet<QPhiXSpinorF>> _multi_r;
+  mutable std::unique_ptr<SpinorSet<QPhiXSpinorF>> _multi_out;
+  mutable std::unique_ptr<CoarseSpinorSet> _multi_coarse_in;
+  mutable std::unique_ptr<CoarseSpinorSet> _multi_coarse_delta;
+
 };
 
 
@@ -229,15 +397,39 @@ private:
 //
 
 class VCycleQPhiXCoarseEO2 :
-    public LinearSolver<QPhiXSpinor, QPhiXGauge >
+    public LinearSolver<QPhiXSpinor, QPhiXGauge >,
+    public LinearSolver<QPhiXSpinorF, QPhiXGaugeF >
 {
 public:
   LinearSolverResults operator()(QPhiXSpinor& out,
-      const QPhiXSpinor& in, ResiduumType resid_type = RELATIVE ) const
+      const QPhiXSpinor& in, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return apply(out,in,resid_type);
+  }
+
+  // Single precision entry point: a float outer solver can use this
+  // without round tripping through double on every application
+  LinearSolverResults operator()(QPhiXSpinorF& out,
+      const QPhiXSpinorF& in, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return apply(out,in,resid_type);
+  }
+
+  // Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+  void SetOuterResidual(double rel_resid) const override
+  {
+    _bottom_solver.SetOuterResidual(rel_resid);
+  }
+
+private:
+  template<typename OuterSpinor>
+  LinearSolverResults apply(OuterSpinor& out,
+      const OuterSpinor& in, ResiduumType resid_type) const
   {
     LinearSolverResults res;
 
-    QPhiXSpinorF in_f(_fine_info);
+    auto in_f_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& in_f = *in_f_scratch;
     ZeroVec(in_f, SUBSET_ALL);
 
     ConvertSpinor(in,in_f,_M_fine.GetSubset());
@@ -245,8 +437,10 @@ public:
     // May want to do these in double later?
     // But this is just a preconditioner.
     // So try SP for now
-    QPhiXSpinorF r(_fine_info);
-    QPhiXSpinorF out_f(_fine_info);
+    auto r_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& r = *r_scratch;
+    auto out_f_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& out_f = *out_f_scratch;
 
     int level = _M_fine.GetLevel();
 
@@ -287,10 +481,14 @@ public:
     int iter = 0;
 
     bool continueP = true;
-    QPhiXSpinorF delta(_fine_info);
-    QPhiXSpinorF tmp(_fine_info);
-    CoarseSpinor coarse_in(_coarse_info);
-    CoarseSpinor coarse_delta(_coarse_info);
+    auto delta_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& delta = *delta_scratch;
+    auto tmp_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& tmp = *tmp_scratch;
+    auto coarse_in_scratch = _coarse_work.Get(_coarse_info);
+    CoarseSpinor& coarse_in = *coarse_in_scratch;
+    auto coarse_delta_scratch = _coarse_work.Get(_coarse_info);
+    CoarseSpinor& coarse_delta = *coarse_delta_scratch;
     double done = 1;
     double mone = -1;
 
@@ -384,7 +582,7 @@ public:
       continueP = ( iter < _param.MaxIter ) &&  toBool( norm_r > target );
     }
 
-    // Convert Back Up to DP only on the output subset.
+    // Convert back to the outer precision only on the output subset.
     ZeroVec(out,SUBSET_ALL);
     ConvertSpinor(out_f,out, _M_fine.GetSubset());
 
@@ -397,6 +595,7 @@ public:
     return res;
   }
 
+public:
   VCycleQPhiXCoarseEO2(const LatticeInfo& fine_info,
       const LatticeInfo& coarse_info,
       const std::vector<Block>& my_blocks,
@@ -429,15 +628,42 @@ private:
   const LinearSolverParamsBase& _param;
   const QPhiXTransfer<QPhiXSpinorF> _Transfer;
 
+  // Scratch spinors, so only the first call allocates the temporaries
+  mutable SpinorWorkspace<QPhiXSpinorF> _fine_work;
+  mutable SpinorWorkspace<CoarseSpinor> _coarse_work;
+
 };
 
 
 class VCycleQPhiXCoarseEO3 :
-    public LinearSolver<QPhiXSpinor, QPhiXGauge >
+    public LinearSolver<QPhiXSpinor, QPhiXGauge >,
+    public LinearSolver<QPhiXSpinorF, QPhiXGaugeF >
 {
 public:
   LinearSolverResults operator()(QPhiXSpinor& out,
-      const QPhiXSpinor& in, ResiduumType resid_type = RELATIVE ) const
+      const QPhiXSpinor& in, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return apply(out,in,resid_type);
+  }
+
+  // Single precision entry point: a float outer solver can use this
+  // without round tripping through double on every application
+  LinearSolverResults operator()(QPhiXSpinorF& out,
+      const QPhiXSpinorF& in, ResiduumType resid_type = RELATIVE ) const override
+  {
+    return apply(out,in,resid_type);
+  }
+
+  // Adaptive tolerances: the coarse solve goes by the residual of the outer solver
+  void SetOuterResidual(double rel_resid) const override
+  {
+    _bottom_solver.SetOuterResidual(rel_resid);
+  }
+
+private:
+  template<typename OuterSpinor>
+  LinearSolverResults apply(OuterSpinor& out,
+      const OuterSpinor& in, ResiduumType resid_type) const
   {
 	    int level = _M_fine.GetLevel();
 #ifdef MG_ENABLE_TIMERS
@@ -445,8 +671,10 @@ public:
 #endif
     LinearSolverResults res;
     auto& subset = _M_fine.GetSubset();
-    QPhiXSpinorF in_f(_fine_info);
-    QPhiXSpinorF tmp(_fine_info);
+    auto in_f_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& in_f = *in_f_scratch;
+    auto tmp_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& tmp = *tmp_scratch;
 
     ZeroVec(in_f, SUBSET_ALL);
 
@@ -455,8 +683,10 @@ public:
     // May want to do these in double later?
     // But this is just a preconditioner.
     // So try SP for now
-    QPhiXSpinorF r(_fine_info);
-    QPhiXSpinorF out_f(_fine_info);
+    auto r_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& r = *r_scratch;
+    auto out_f_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& out_f = *out_f_scratch;
 
 
 
@@ -500,10 +730,13 @@ public:
     int iter = 0;
 
     bool continueP = true;
-    QPhiXSpinorF delta(_fine_info);
+    auto delta_scratch = _fine_work.Get(_fine_info);
+    QPhiXSpinorF& delta = *delta_scratch;
 
-    CoarseSpinor coarse_in(_coarse_info);
-    CoarseSpinor coarse_delta(_coarse_info);
+    auto coarse_in_scratch = _coarse_work.Get(_coarse_info);
+    CoarseSpinor& coarse_in = *coarse_in_scratch;
+    auto coarse_delta_scratch = _coarse_work.Get(_coarse_info);
+    CoarseSpinor& coarse_delta = *coarse_delta_scratch;
     double done = 1;
     double mone = -1;
 
@@ -651,7 +884,7 @@ public:
       continueP = ( iter < _param.MaxIter ) &&  toBool( norm_r > target );
     }
 
-    // Convert Back Up to DP only on the output subset.
+    // Convert back to the outer precision only on the output subset.
     ZeroVec(out,SUBSET_ALL);
     ConvertSpinor(out_f,out, _M_fine.GetSubset());
 
@@ -667,6 +900,7 @@ public:
     return res;
   }
 
+public:
   VCycleQPhiXCoarseEO3(const LatticeInfo& fine_info,
       const LatticeInfo& coarse_info,
       const std::vector<Block>& my_blocks,
@@ -710,6 +944,10 @@ private:
   const LinearSolver<CoarseSpinor,CoarseGauge>& _bottom_solver;
   const LinearSolverParamsBase& _param;
   const QPhiXTransfer<QPhiXSpinorF> _Transfer;
+
+  // Scratch spinors, so only the first call allocates the temporaries
+  mutable SpinorWorkspace<QPhiXSpinorF> _fine_work;
+  mutable SpinorWorkspace<CoarseSpinor> _coarse_work;
 #ifdef MG_ENABLE_TIMERS
   std::shared_ptr<Timer::TimerAPI> timerAPI;
 #endif
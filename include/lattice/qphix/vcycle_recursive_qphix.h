@@ -10,19 +10,27 @@
 
 #include <vector>
 #include <memory>
+#include <type_traits>
 #include "lattice/solver.h"
 #include "lattice/qphix/vcycle_qphix_coarse.h"
 #include "lattice/coarse/vcycle_coarse.h"
+#include "lattice/coarse/vcycle_additive_coarse.h"
+#include "lattice/coarse/thread_team.h"
 #include "lattice/qphix/mg_level_qphix.h"
 #include "lattice/qphix/invmr_qphix.h"
 #include "lattice/qphix/invfgmres_qphix.h"
 #include "lattice/coarse/invmr_coarse.h"
+#include "lattice/coarse/invblockjacobi_coarse.h"
 #include "lattice/coarse/invfgmres_coarse.h"
+#include "lattice/coarse/invdirect_coarse.h"
+#include "lattice/coarse/coarse_correction.h"
+#include "lattice/adaptive_tolerance_solver.h"
 using namespace QDP;
 
 namespace MG {
 template<typename QPhiXMGLevelsT, typename Fine2CoarseVCycleT, typename Coarse2CoarseVCycleT, typename FineSmootherT, typename CoarseSmootherT, typename BottomSolverT>
-class VCycleRecursiveQPhiXT :  public LinearSolver<QPhiXSpinor, QPhiXGauge >
+class VCycleRecursiveQPhiXT :  public LinearSolver<QPhiXSpinor, QPhiXGauge >,
+							   public LinearSolver<QPhiXSpinorF, QPhiXGaugeF >
 {
 public:
 	VCycleRecursiveQPhiXT( const std::vector<VCycleParams>& vcycle_params,
@@ -41,6 +49,7 @@ public:
 		_coarse_presmoother.resize(n_levels -1); // No smoothers on bottom level
 		_coarse_postsmoother.resize(n_levels -1 );
 		_coarse_vcycle.resize(n_levels-1);
+		_adaptive_solver.resize(n_levels-1);
 
 
 
@@ -48,43 +57,104 @@ public:
 		MasterLog(INFO, "Entering Coarse Level Loop");
 		for(int coarse_idx=n_levels-2; coarse_idx >= 0; --coarse_idx) {
 			MasterLog(INFO, "Coarse_idx=%d",coarse_idx);
+			// Build the level with its own team, so its temporaries are first touched by it
+			ThreadTeamScope level_team(_mg_levels.coarse_levels[coarse_idx].n_threads);
 			auto this_level_linop = _mg_levels.coarse_levels[coarse_idx].M;
 
 			if( coarse_idx == n_levels-2) {
-				MasterLog(INFO, "Creating FGRMRES Solver Wrapper on Level %d", coarse_idx);
 
 				// Bottom level There is only a bottom solver.
-				_bottom_solver[coarse_idx] = std::make_shared< const BottomSolverT >(this_level_linop,_vcycle_params[coarse_idx].bottom_solver_params,nullptr);
-
+				if( _vcycle_params[coarse_idx].bottom_solver_direct ) {
+					MasterLog(INFO, "Creating Direct Solver on Level %d", coarse_idx);
+					_bottom_solver[coarse_idx] = std::make_shared< const CoarseDirectSolver >(this_level_linop,_vcycle_params[coarse_idx].bottom_solver_params,nullptr);
+				}
+				else {
+					MasterLog(INFO, "Creating FGRMRES Solver Wrapper on Level %d", coarse_idx);
+					_bottom_solver[coarse_idx] = std::make_shared< const BottomSolverT >(this_level_linop,_vcycle_params[coarse_idx].bottom_solver_params,nullptr);
+				}
 			}
 			else{
 
-				MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
-				// This becomes a wrapper
-				_coarse_presmoother[coarse_idx] = std::make_shared<const CoarseSmootherT>(this_level_linop,_vcycle_params[coarse_idx+1].pre_smoother_params);
-
-				MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
-				// This becomes a wrapper
-				_coarse_postsmoother[coarse_idx] = std::make_shared<const CoarseSmootherT>(this_level_linop, _vcycle_params[coarse_idx+1].post_smoother_params);
-
-				MasterLog(INFO, "Creating VCycle Between Levels: %d -> %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+2,coarse_idx+1);
-				_coarse_vcycle[coarse_idx] = std::make_shared< Coarse2CoarseVCycleT >(
-						(*(_mg_levels.coarse_levels[coarse_idx+1].info)),
-						(_mg_levels.coarse_levels[coarse_idx].blocklist),
-						(_mg_levels.coarse_levels[coarse_idx].null_vecs),
-						(*(_mg_levels.coarse_levels[coarse_idx].M)),
-						(*(_coarse_presmoother[coarse_idx])),
-						(*(_coarse_postsmoother[coarse_idx])),
-						(*(_bottom_solver[coarse_idx+1])),
-						(_vcycle_params[coarse_idx+1].cycle_params));
+				if( _vcycle_params[coarse_idx+1].block_jacobi_smoother ) {
+					// Needs the unpreconditioned operator: the constructor checks
+					MasterLog(INFO, "Creating Block Jacobi Pre- and PostSmoothers on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					_coarse_presmoother[coarse_idx] = std::make_shared<const BlockJacobiSmootherCoarse>(*this_level_linop,_vcycle_params[coarse_idx+1].pre_smoother_params);
+					_coarse_postsmoother[coarse_idx] = std::make_shared<const BlockJacobiSmootherCoarse>(*this_level_linop, _vcycle_params[coarse_idx+1].post_smoother_params);
+				}
+				else if( _vcycle_params[coarse_idx+1].persistent_smoother ) {
+					// Needs the unpreconditioned operator: the constructor checks
+					MasterLog(INFO, "Creating Persistent Pre- and PostSmoothers on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					_coarse_presmoother[coarse_idx] = std::make_shared<const PersistentMRSmootherCoarse>(*this_level_linop,_vcycle_params[coarse_idx+1].pre_smoother_params);
+					_coarse_postsmoother[coarse_idx] = std::make_shared<const PersistentMRSmootherCoarse>(*this_level_linop, _vcycle_params[coarse_idx+1].post_smoother_params);
+				}
+				else {
+					MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					// This becomes a wrapper
+					_coarse_presmoother[coarse_idx] = std::make_shared<const CoarseSmootherT>(this_level_linop,_vcycle_params[coarse_idx+1].pre_smoother_params);
+
+					MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					// This becomes a wrapper
+					_coarse_postsmoother[coarse_idx] = std::make_shared<const CoarseSmootherT>(this_level_linop, _vcycle_params[coarse_idx+1].post_smoother_params);
+				}
+
+				if( _vcycle_params[coarse_idx+1].additive_cycle ) {
+					// The additive cycle works with the unpreconditioned operator and residual
+					if( !std::is_same<Coarse2CoarseVCycleT,VCycleCoarse>::value ) {
+						MasterLog(ERROR, "Additive VCycle on level %d: only available for unpreconditioned coarse levels", coarse_idx+1);
+					}
+					MasterLog(INFO, "Creating Additive VCycle Between Levels: %d -> %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+2,coarse_idx+1);
+					_coarse_vcycle[coarse_idx] = std::make_shared< AdditiveVCycleCoarse >(
+							(*(_mg_levels.coarse_levels[coarse_idx+1].info)),
+							(_mg_levels.coarse_levels[coarse_idx].blocklist),
+							(_mg_levels.coarse_levels[coarse_idx].null_vecs),
+							(*(_mg_levels.coarse_levels[coarse_idx].M)),
+							(*(_coarse_presmoother[coarse_idx])),
+							(*(_coarse_postsmoother[coarse_idx])),
+							(*(_bottom_solver[coarse_idx+1])),
+							(_vcycle_params[coarse_idx+1].cycle_params),
+							_vcycle_params[coarse_idx+1].additive_smoother_threads);
+				}
+				else {
+					MasterLog(INFO, "Creating VCycle Between Levels: %d -> %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+2,coarse_idx+1);
+					_coarse_vcycle[coarse_idx] = std::make_shared< Coarse2CoarseVCycleT >(
+							(*(_mg_levels.coarse_levels[coarse_idx+1].info)),
+							(_mg_levels.coarse_levels[coarse_idx].blocklist),
+							(_mg_levels.coarse_levels[coarse_idx].null_vecs),
+							(*(_mg_levels.coarse_levels[coarse_idx].M)),
+							(*(_coarse_presmoother[coarse_idx])),
+							(*(_coarse_postsmoother[coarse_idx])),
+							(*(_bottom_solver[coarse_idx+1])),
+							(_vcycle_params[coarse_idx+1].cycle_params));
+				}
 
 				MasterLog(INFO, "Creating Bottom Solver For level: %d, using VCycle Preconditioner from level %d", coarse_idx+1, coarse_idx+1);
-				// This becomes a wrapper
-				_bottom_solver[coarse_idx] = std::make_shared<const BottomSolverT>(this_level_linop,vcycle_params[coarse_idx].bottom_solver_params,_coarse_vcycle[coarse_idx].get());
+
+				// W- and K-cycles, or nullptr for the default
+				_bottom_solver[coarse_idx] = MakeCoarseCorrection(this_level_linop,vcycle_params[coarse_idx],_coarse_vcycle[coarse_idx].get());
+				if( !_bottom_solver[coarse_idx] ) {
+					// This becomes a wrapper
+					_bottom_solver[coarse_idx] = std::make_shared<const BottomSolverT>(this_level_linop,vcycle_params[coarse_idx].bottom_solver_params,_coarse_vcycle[coarse_idx].get());
+				}
+
 
 
+			}
 
+			// The coarse solve of cycle coarse_idx follows the residual of the solver the cycle preconditions
+			if( _vcycle_params[coarse_idx].adaptive_tolerance ) {
+				MasterLog(INFO, "Adaptive tolerance for the Bottom Solver on Level %d", coarse_idx);
+				_adaptive_solver[coarse_idx] = std::make_shared< const AdaptiveToleranceSolver<CoarseSpinor,CoarseGauge> >(
+						_bottom_solver[coarse_idx], this_level_linop->GetLevel(),
+						_vcycle_params[coarse_idx].adaptive_safety_factor,
+						_vcycle_params[coarse_idx].bottom_solver_params.RsdTarget,
+						_vcycle_params[coarse_idx].adaptive_max_rsd_target,
+						_vcycle_params[coarse_idx].bottom_solver_params.VerboseP);
+				_bottom_solver[coarse_idx] = _adaptive_solver[coarse_idx];
 			}
+
+			// The level, its smoothers and its cycle run on the team of the level
+			_bottom_solver[coarse_idx] = std::make_shared< const ThreadTeamSolver<CoarseSpinor,CoarseGauge> >(
+					_bottom_solver[coarse_idx], _mg_levels.coarse_levels[coarse_idx].n_threads);
 		}
 
 		MasterLog(INFO,"Creating Toplevel Smoothers");
@@ -106,12 +176,49 @@ public:
 	}
 
 	LinearSolverResults operator()(QPhiXSpinor& out, const QPhiXSpinor& in,
-	    ResiduumType resid_type = RELATIVE ) const
+	    ResiduumType resid_type = RELATIVE ) const override
 		{
 			LinearSolverResults ret = (*_toplevel_vcycle )( out, in, resid_type );
 			return ret;
 		}
 
+	// For single precision outer solvers, e.g. MixedPrecisionSolverQPhiX
+	LinearSolverResults operator()(QPhiXSpinorF& out, const QPhiXSpinorF& in,
+	    ResiduumType resid_type = RELATIVE ) const override
+		{
+			LinearSolverResults ret = (*_toplevel_vcycle )( out, in, resid_type );
+			return ret;
+		}
+
+	// Several right hand sides through the cycle together, see VCycleQPhiXCoarse2::MultiSolve.
+	// The toplevel cycle has both a single and a double precision base, so pick one.
+	std::vector<LinearSolverResults> MultiSolve(SpinorSet<QPhiXSpinor>& out, const SpinorSet<QPhiXSpinor>& in,
+			int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+		{
+			const LinearSolver<QPhiXSpinor,QPhiXGauge>& toplevel = *_toplevel_vcycle;
+			return toplevel.MultiSolve(out, in, n_vecs, resid_type);
+		}
+
+	std::vector<LinearSolverResults> MultiSolve(SpinorSet<QPhiXSpinorF>& out, const SpinorSet<QPhiXSpinorF>& in,
+			int n_vecs, ResiduumType resid_type = RELATIVE ) const override
+		{
+			const LinearSolver<QPhiXSpinorF,QPhiXGaugeF>& toplevel = *_toplevel_vcycle;
+			return toplevel.MultiSolve(out, in, n_vecs, resid_type);
+		}
+
+	void SetOuterResidual(double rel_resid) const override
+	{
+		_toplevel_vcycle->SetOuterResidual(rel_resid);
+	}
+
+	//! Solves and iterations on each level with an adaptive tolerance, see AdaptiveToleranceSolver
+	void LogAdaptiveToleranceStats() const
+	{
+		for(const auto& solver : _adaptive_solver) {
+			if( solver ) solver->LogStats();
+		}
+	}
+
 private:
 
 	const std::vector<VCycleParams> _vcycle_params;
@@ -125,6 +232,7 @@ private:
 	std::vector< std::shared_ptr< const Smoother< CoarseSpinor, CoarseGauge > > >       _coarse_postsmoother;
 	std::vector< std::shared_ptr< const LinearSolver< CoarseSpinor, CoarseGauge > > >   _coarse_vcycle;
 	std::vector< std::shared_ptr< const LinearSolver< CoarseSpinor, CoarseGauge > > >   _bottom_solver;
+	std::vector< std::shared_ptr< const AdaptiveToleranceSolver< CoarseSpinor, CoarseGauge > > > _adaptive_solver;
 
 };
 
@@ -8,6 +8,9 @@
 #ifndef INCLUDE_LATTICE_SOLVER_H_
 #define INCLUDE_LATTICE_SOLVER_H_
 
+#include "lattice/spinor_set.h"
+#include <vector>
+
 namespace MG {
 	enum ResiduumType { ABSOLUTE, RELATIVE, INVALID};
 
@@ -21,6 +24,34 @@ namespace MG {
 	class LinearSolver {
 	public:
 		virtual LinearSolverResults operator()(Spinor& out, const Spinor& in, ResiduumType resid_type = RELATIVE ) const=0;
+
+		/** Solve for the first n_vecs vectors of in, e.g. a shared preconditioner in a
+		 *  block solver. Solvers which can do the right hand sides together override
+		 *  this. The default solves them one after the other.
+		 */
+		virtual std::vector<LinearSolverResults> MultiSolve(SpinorSet<Spinor>& out, const SpinorSet<Spinor>& in,
+				int n_vecs, ResiduumType resid_type = RELATIVE ) const
+		{
+			std::vector<LinearSolverResults> res(n_vecs);
+			for(int i=0; i < n_vecs; ++i) {
+				res[i] = (*this)(out[i], in[i], resid_type);
+			}
+			return res;
+		}
+
+		/** Called by a flexible outer solver on its preconditioner before each application,
+		 *  with the outer || r ||/|| b || at that point. Preconditioners pass it on to their
+		 *  coarse solver, which may loosen its target while the outer residual is large (see
+		 *  AdaptiveToleranceSolver). The default ignores it.
+		 */
+		virtual void SetOuterResidual(double rel_resid) const {}
+
+		/** Solve to rsd_target instead of the RsdTarget of the parameters, until the next
+		 *  call. rsd_target <= 0 goes back to the parameters. Solvers which do not support
+		 *  it ignore it.
+		 */
+		virtual void SetRsdTarget(double rsd_target) const {}
+
 		virtual ~LinearSolver(){}
 	};
 
@@ -37,6 +68,14 @@ namespace MG {
 		virtual Spinor& GetTmpSpinorIn() const = 0;
 		virtual Spinor& GetTmpSpinorOut() const = 0;
 
+		void SetOuterResidual(double rel_resid) const override {
+			GetEOSolver().SetOuterResidual(rel_resid);
+		}
+
+		void SetRsdTarget(double rsd_target) const override {
+			GetEOSolver().SetRsdTarget(rsd_target);
+		}
+
 		LinearSolverResults operator()(Spinor& out, const Spinor& in, ResiduumType resid_type = RELATIVE) const override {
 			LinearSolverResults ret_val;
 			Spinor& tmp_src = GetTmpSpinorIn();
@@ -87,6 +126,36 @@ namespace MG {
 	class Smoother {
 	public:
 		virtual void operator()(Spinor& out, const Spinor& in) const = 0;
+
+		/** Smooth, and update the residual with the one the smoother has at hand.
+		 *  Precondition: on entry r is the residual of out, r = b - A out for the right
+		 *  hand side b. The V-cycles zero out, so r is just b. Implementations rely on this
+		 *  and do not apply A to out to check it. On exit out is the smoothed solution and
+		 *  r = b - A out, so the caller saves applying A to out.
+		 *  Smoothers which can do this override it and return true. The default returns
+		 *  false without touching out or r: the caller then smooths and updates r itself.
+		 */
+		virtual bool SmoothAndUpdateResidual(Spinor& out, Spinor& r) const { return false; }
+
+		/** Smooth the first n_vecs vectors of in into those of out. Smoothers which can do
+		 *  the right hand sides together, e.g. with one MultiApply() of the operator per
+		 *  iteration, override this. The default smooths them one after the other.
+		 */
+		virtual void MultiSmooth(SpinorSet<Spinor>& out, const SpinorSet<Spinor>& in, int n_vecs) const
+		{
+			for(int i=0; i < n_vecs; ++i) {
+				(*this)(out[i], in[i]);
+			}
+		}
+
+		/** SmoothAndUpdateResidual() on the first n_vecs vectors of out and r together.
+		 *  The default returns false without touching them.
+		 */
+		virtual bool MultiSmoothAndUpdateResidual(SpinorSet<Spinor>& out, SpinorSet<Spinor>& r, int n_vecs) const
+		{
+			return false;
+		}
+
 		virtual ~Smoother(){}
 	};
 
@@ -0,0 +1,133 @@
+/*
+ * spinor_set.h
+ */
+
+#ifndef INCLUDE_LATTICE_SPINOR_SET_H_
+#define INCLUDE_LATTICE_SPINOR_SET_H_
+
+#include "lattice/constants.h"
+#include "lattice/lattice_info.h"
+#include "lattice/coarse/subset.h"
+#include <complex>
+#include <vector>
+#include <memory>
+
+namespace MG {
+
+	/** SpinorSet
+	 *  \param LatticeInfo
+	 *  \param n_vecs
+	 *
+	 *  A fixed size set of n_vecs spinors on the same lattice, e.g. a Krylov basis
+	 *  or a set of null vectors. The elements are accessed with operator[] and can
+	 *  be passed to anything that takes an ST&.
+	 *
+	 *  The generic version simply holds each spinor in its own allocation.
+	 *  Spinor types which can do better (e.g. CoarseSpinor, see coarse_spinor_set.h)
+	 *  specialize this to allocate all vectors in one slab and provide native
+	 *  block BLAS overloads.
+	 */
+	template<typename ST>
+	class SpinorSet {
+	public:
+		SpinorSet(const LatticeInfo& info, int n_vecs) : _info(info), _vecs(n_vecs)
+		{
+			for(int i=0; i < n_vecs; ++i) {
+				_vecs[i].reset( new ST(info) );
+			}
+		}
+
+		SpinorSet(const SpinorSet<ST>&) = delete;
+		SpinorSet<ST>& operator=(const SpinorSet<ST>&) = delete;
+
+		inline
+		ST& operator[](int i) { return *(_vecs[i]); }
+
+		inline
+		const ST& operator[](int i) const { return *(_vecs[i]); }
+
+		inline
+		int GetNumVecs() const { return static_cast<int>(_vecs.size()); }
+
+		inline
+		const LatticeInfo& GetInfo() const { return _info; }
+
+	private:
+		const LatticeInfo& _info;
+		std::vector<std::unique_ptr<ST>> _vecs;
+	};
+
+	/* Generic block BLAS, built out of the level 1 routines of ST: one sweep and
+	 * one global reduction per vector. The Krylov solvers lean on these, so the
+	 * spinor types they run on provide non-template overloads which do the work
+	 * in a single sweep and reduction (coarse_l1_blas.h, qphix_blas_wrappers.h).
+	 */
+
+	//! iprods[j] = < x_j | y > for j=0..n_vecs-1
+	template<typename ST>
+	void InnerProductMultiVec(const SpinorSet<ST>& x, int n_vecs, const ST& y,
+			std::complex<double>* iprods, const CBSubset& subset = SUBSET_ALL)
+	{
+		for(int j=0; j < n_vecs; ++j) {
+			iprods[j] = InnerProductVec(x[j], y, subset);
+		}
+	}
+
+	//! iprods[j] = < x_j | y > for j=0..n_vecs-1 and norm2_y = || y ||^2
+	template<typename ST>
+	void InnerProductNorm2MultiVec(const SpinorSet<ST>& x, int n_vecs, const ST& y,
+			std::complex<double>* iprods, double& norm2_y, const CBSubset& subset = SUBSET_ALL)
+	{
+		InnerProductMultiVec(x, n_vecs, y, iprods, subset);
+		norm2_y = Norm2Vec(y, subset);
+	}
+
+	//! y += sum_j alpha[j] x_j for j=0..n_vecs-1
+	template<typename ST>
+	void AxpyMultiVec(const std::complex<double>* alpha, const SpinorSet<ST>& x, int n_vecs, ST& y,
+			const CBSubset& subset = SUBSET_ALL)
+	{
+		for(int j=0; j < n_vecs; ++j) {
+			std::complex<float> a( std::real(alpha[j]), std::imag(alpha[j]) );
+			AxpyVec(a, x[j], y, subset);
+		}
+	}
+
+	//! iprods[i + n_x*j] = < x_i | y_j > for i=0..n_x-1, j=0..n_y-1 (column major)
+	template<typename ST>
+	void InnerProductBlockVec(const SpinorSet<ST>& x, int n_x, const SpinorSet<ST>& y, int n_y,
+			std::complex<double>* iprods, const CBSubset& subset = SUBSET_ALL)
+	{
+		for(int j=0; j < n_y; ++j) {
+			InnerProductMultiVec(x, n_x, y[j], iprods + n_x*j, subset);
+		}
+	}
+
+	//! y_j += sum_i alpha[i + n_x*j] x_i for j=0..n_y-1, i.e. Y += X alpha
+	template<typename ST>
+	void AxpyBlockVec(const std::complex<double>* alpha, const SpinorSet<ST>& x, int n_x,
+			SpinorSet<ST>& y, int n_y, const CBSubset& subset = SUBSET_ALL)
+	{
+		for(int j=0; j < n_y; ++j) {
+			AxpyMultiVec(alpha + n_x*j, x, n_x, y[j], subset);
+		}
+	}
+
+	//! G[i + n_vecs*j] = < x_i | x_j >, i.e. the Gram matrix in column major order
+	template<typename ST>
+	void GramMatrix(const SpinorSet<ST>& x, int n_vecs, std::complex<double>* G,
+			const CBSubset& subset = SUBSET_ALL)
+	{
+		for(int j=0; j < n_vecs; ++j) {
+			for(int i=0; i <= j; ++i) {
+				G[i + n_vecs*j] = InnerProductVec(x[i], x[j], subset);
+				G[j + n_vecs*i] = std::conj( G[i + n_vecs*j] );
+			}
+		}
+	}
+
+}
+
+
+
+#endif /* INCLUDE_LATTICE_SPINOR_SET_H_ */
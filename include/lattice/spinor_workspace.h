@@ -0,0 +1,120 @@
+/*
+ * spinor_workspace.h
+ */
+
+#ifndef INCLUDE_LATTICE_SPINOR_WORKSPACE_H_
+#define INCLUDE_LATTICE_SPINOR_WORKSPACE_H_
+
+#include "lattice/constants.h"
+#include "lattice/lattice_info.h"
+#include <vector>
+#include <memory>
+
+namespace MG {
+
+	/** SpinorWorkspace
+	 *
+	 *  A pool of scratch spinors for the temporaries of a solver or V-cycle.
+	 *  Get(info) returns a spinor from the free list, and allocates one only if none there
+	 *  is on a matching lattice. The returned Scratch handle puts the spinor back when it
+	 *  goes out of scope. So only the first call of a solver which takes its temporaries
+	 *  from here allocates, rather than every call going through MemoryAllocate() (an omp
+	 *  critical section and a map update) for every temporary.
+	 *
+	 *  Spinors match if their lattice dimensions, origin, colors and spins do. A spinor is
+	 *  created with the info passed to Get(), which must outlive the workspace: use the
+	 *  info of the level (e.g. of the operator), not of an argument. The contents of a scratch
+	 *  spinor are whatever its last user left. Get() is not thread safe: call it outside
+	 *  parallel regions, as the solvers do.
+	 */
+	template<typename ST>
+	class SpinorWorkspace {
+	public:
+
+		/** Scratch
+		 *
+		 *  Handle to a spinor from the workspace. Dereference it for the spinor.
+		 */
+		class Scratch {
+		public:
+			Scratch(SpinorWorkspace<ST>& ws, ST* s) : _ws(ws), _s(s) {}
+
+			Scratch(Scratch&& from) : _ws(from._ws), _s(from._s) {
+				from._s = nullptr;
+			}
+
+			Scratch(const Scratch&) = delete;
+			Scratch& operator=(const Scratch&) = delete;
+
+			~Scratch() {
+				if( _s != nullptr ) _ws.release(_s);
+			}
+
+			inline
+			ST& operator*() const { return *_s; }
+
+			inline
+			ST* operator->() const { return _s; }
+
+		private:
+			SpinorWorkspace<ST>& _ws;
+			ST* _s;
+		};
+
+		SpinorWorkspace() {}
+
+		SpinorWorkspace(const SpinorWorkspace<ST>&) = delete;
+		SpinorWorkspace<ST>& operator=(const SpinorWorkspace<ST>&) = delete;
+
+		Scratch Get(const LatticeInfo& info)
+		{
+			for(int i=0; i < static_cast<int>(_free.size()); ++i) {
+				if( sameLattice(_free[i]->GetInfo(), info) ) {
+					ST* s = _free[i];
+					_free[i] = _free.back();
+					_free.pop_back();
+					return Scratch(*this, s);
+				}
+			}
+
+			_all.emplace_back( new ST(info) );
+
+			// So that giving the spinors back never allocates
+			_free.reserve(_all.size());
+			return Scratch(*this, _all.back().get());
+		}
+
+		//! The number of spinors allocated so far
+		inline
+		int GetNumAllocated() const { return static_cast<int>(_all.size()); }
+
+		//! The number of spinors in the free list
+		inline
+		int GetNumFree() const { return static_cast<int>(_free.size()); }
+
+	private:
+		void release(ST* s) {
+			_free.push_back(s);
+		}
+
+		static bool sameLattice(const LatticeInfo& l, const LatticeInfo& r)
+		{
+			if( l.GetNumColors() != r.GetNumColors() || l.GetNumSpins() != r.GetNumSpins() ) {
+				return false;
+			}
+			for(int mu=0; mu < n_dim; ++mu) {
+				if( l.GetLatticeDimensions()[mu] != r.GetLatticeDimensions()[mu]
+					|| l.GetLatticeOrigin()[mu] != r.GetLatticeOrigin()[mu] ) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		std::vector<std::unique_ptr<ST>> _all;
+		std::vector<ST*> _free;
+	};
+
+}
+
+#endif /* INCLUDE_LATTICE_SPINOR_WORKSPACE_H_ */
@@ -11,6 +11,8 @@
 #include "lattice/coarse/coarse_l1_blas.h"
 #include "lattice/coarse/aggregate_block_coarse.h"
 #include "lattice/halo.h"
+#include "lattice/cholesky_qr.h"
+#include <vector>
 #include <cassert>
 
 #include<omp.h>
@@ -218,45 +220,92 @@ void extractAggregate(CoarseSpinor& target, const CoarseSpinor& src, int aggr )
 	}
 }
 
-//! Orthonormalize vecs over the spin aggregates within the sites
-void orthonormalizeBlockAggregates(std::vector<std::shared_ptr<CoarseSpinor>>& vecs,
-		const std::vector<Block>& block_list)
+/* Orthonormalize num_vecs vectors over the spin aggregates within the blocks.
+ * site_ptr(v, cbsite) returns the site data of vector v.
+ *
+ * For each (aggregate, block) the block-aggregate pieces of the vectors are packed
+ * into a dense (sites*colorspins) x num_vecs matrix which is orthonormalized with
+ * CholeskyQR2 and unpacked again. The (aggregate, block) pairs are independent, so
+ * we thread over them.
+ */
+template<typename SitePtrFunc>
+static
+void orthonormalizeBlockAggregatesT(int num_vecs, const LatticeInfo& info,
+		const std::vector<Block>& block_list, const SitePtrFunc& site_ptr)
 {
-	int num_blocks = block_list.size();
+	const int num_blocks = block_list.size();
+	const int num_color = info.GetNumColors();
+	const int n_per_chiral = ( info.GetNumSpins() == 4 ) ? 2*num_color : num_color;
 
-#pragma omp parallel for collapse(2)
+#pragma omp parallel for collapse(2) schedule(dynamic)
 	for(int aggr=0; aggr < 2; ++aggr) {
 		for(int block_id=0; block_id < num_blocks; block_id++) {
 
 			const Block& block = block_list[block_id];
-
-			// This will be over blocks...
-			// do vecs[0] ... vecs[N]
-			for(IndexType curr_vec=0; curr_vec < static_cast<IndexType>(vecs.size()); curr_vec++) {
-
-				// orthogonalize against previous vectors
-				// if curr_vec == 0 this will be skipped
-				for(int prev_vec=0; prev_vec < curr_vec; prev_vec++) {
-
-					std::complex<double> iprod = innerProductBlockAggr( *(vecs[prev_vec]), *(vecs[curr_vec]), block, aggr);
-					std::complex<double> minus_iprod=std::complex<double>(-real(iprod), -imag(iprod) );
-
-					// curr_vec <- curr_vec - <curr_vec|prev_vec>*prev_vec = -iprod*prev_vec + curr_vec
-					caxpyBlockAggr( minus_iprod, *(vecs[prev_vec]), *(vecs[curr_vec]), block, aggr);
+			auto block_sitelist = block.getCBSiteList();
+			const int num_sites = block.getNumSites();
+			const int min_cspin = aggr*n_per_chiral;
+			const int n_rows = num_sites*n_per_chiral;
+
+			// Column major: V[row + n_rows*vec]
+			std::vector<std::complex<double>> V(n_rows*num_vecs);
+
+			for(int vec=0; vec < num_vecs; ++vec) {
+				for(int site=0; site < num_sites; ++site) {
+					const float* v_site = site_ptr(vec, block_sitelist[site]);
+					for(int k=0; k < n_per_chiral; ++k) {
+						const int cspin = min_cspin + k;
+						V[ site*n_per_chiral + k + n_rows*vec ] =
+								std::complex<double>( v_site[RE + n_complex*cspin], v_site[IM + n_complex*cspin]);
+					}
 				}
+			}
 
-				// Normalize current vector
-				double inv_norm = ((double)1)/sqrt(norm2BlockAggr(*(vecs[curr_vec]), block, aggr));
+			CholeskyQR2(V.data(), n_rows, num_vecs);
 
-				// vecs[curr_vec] = inv_norm * vecs[curr_vec]
-				axBlockAggr(inv_norm, *(vecs[curr_vec]), block, aggr);
+			for(int vec=0; vec < num_vecs; ++vec) {
+				for(int site=0; site < num_sites; ++site) {
+					float* v_site = const_cast<float*>(site_ptr(vec, block_sitelist[site]));
+					for(int k=0; k < n_per_chiral; ++k) {
+						const int cspin = min_cspin + k;
+						const std::complex<double>& val = V[ site*n_per_chiral + k + n_rows*vec ];
+						v_site[RE + n_complex*cspin] = std::real(val);
+						v_site[IM + n_complex*cspin] = std::imag(val);
+					}
+				}
 			}
 
-
 		}	// block
 	}// aggregates
 }
 
+//! Orthonormalize vecs over the spin aggregates within the sites
+void orthonormalizeBlockAggregates(std::vector<std::shared_ptr<CoarseSpinor>>& vecs,
+		const std::vector<Block>& block_list)
+{
+	const int num_vecs = vecs.size();
+	if( num_vecs == 0 ) return;
+
+	orthonormalizeBlockAggregatesT(num_vecs, vecs[0]->GetInfo(), block_list,
+			[&vecs](int v, const CBSite& s) -> float* {
+		return vecs[v]->GetSiteDataPtr(s.cb, s.site);
+	});
+}
+
+//! Orthonormalize the vectors of a CoarseSpinorSet over the spin aggregates within the blocks
+void orthonormalizeBlockAggregates(CoarseSpinorSet& vecs,
+		const std::vector<Block>& block_list)
+{
+	// Within a site, vector v lives at v*vec_stride from vector 0
+	const IndexType vec_stride = vecs.GetVecStride();
+	CoarseSpinor& v0 = vecs[0];
+
+	orthonormalizeBlockAggregatesT(vecs.GetNumVecs(), vecs.GetInfo(), block_list,
+			[&v0,vec_stride](int v, const CBSite& s) -> float* {
+		return v0.GetSiteDataPtr(s.cb, s.site) + v*vec_stride;
+	});
+}
+
 //! 'Restrict' a QDP++ spinor to a CoarseSpinor with the same geometry
 void restrictSpinor( const std::vector<Block>& blocklist, const std::vector< std::shared_ptr<CoarseSpinor> >& fine_vecs,
 		const CoarseSpinor& fine_in, CoarseSpinor& coarse_out)
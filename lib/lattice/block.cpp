@@ -225,6 +225,36 @@ void CreateBlockList(std::vector<Block>& blocklist,  // vector of 'Block structu
 }
 
 
-}
+void CreateBlockNeighborTable(const Block& block, std::vector<int>& neighbors)
+{
+	const IndexArray& dims = block.getDimensions();
+	const IndexArray& origin = block.getOrigin();
+	const std::vector<CBSite>& sites = block.getCBSiteList();
+	const int num_sites = sites.size();
+
+	neighbors.resize(8*num_sites);
+
+	for(int i=0; i < num_sites; ++i) {
+		IndexArray in_block_coords;
+		for(int mu=0; mu < n_dim; ++mu) {
+			in_block_coords[mu] = sites[i].coords[mu] - origin[mu];
+		}
 
+		for(int mu=0; mu < n_dim; ++mu) {
+			for(int fb=0; fb < 2; ++fb) {
+				// fb=0 is forward, fb=1 is backward, as in the Dslash link order
+				IndexArray neigh_coords(in_block_coords);
+				neigh_coords[mu] += (fb == 0) ? 1 : -1;
+
+				int neigh = -1;
+				if( neigh_coords[mu] >= 0 && neigh_coords[mu] < dims[mu] ) {
+					// The site list is lexicographic in the in-block coordinates
+					neigh = CoordsToIndex(neigh_coords, dims);
+				}
+				neighbors[8*i + 2*mu + fb] = neigh;
+			}
+		}
+	}
+}
 
+}
@@ -0,0 +1,108 @@
+/*
+ * block_fgmres_dense.cpp
+ */
+
+#include "lattice/block_fgmres_dense.h"
+#include <cmath>
+
+// Eigen Dense header
+#include <Eigen/Dense>
+using namespace Eigen;
+
+namespace MG {
+
+	int BlockOrthonormalizeGram(const std::complex<double>* G_data, int n, double drop_tol,
+			std::complex<double>* T_data, std::complex<double>* R_data, double* cond)
+	{
+		Map< const MatrixXcd > G(G_data, n, n);
+		Map< MatrixXcd > T(T_data, n, n);
+		Map< MatrixXcd > R(R_data, n, n);
+
+		// Eigenvalues come in increasing order
+		SelfAdjointEigenSolver<MatrixXcd> eig(G);
+		const VectorXd& lambda = eig.eigenvalues();
+		const MatrixXcd& U = eig.eigenvectors();
+
+		T.setZero();
+		R.setZero();
+
+		if( cond != nullptr ) *cond = 1;
+
+		const double lambda_max = lambda(n-1);
+		if( !(lambda_max > 0) ) return 0;
+
+		int rank = 0;
+		for(int i=0; i < n; ++i) {
+			if( lambda(i) > drop_tol*lambda_max ) {
+				const double s = std::sqrt(lambda(i));
+				T.col(i) = U.col(i)/s;
+				R.row(i) = s*U.col(i).adjoint();
+				if( rank == 0 && cond != nullptr ) *cond = lambda_max/lambda(i);
+				++rank;
+			}
+		}
+		return rank;
+	}
+
+	void BlockLeastSquares(const std::complex<double>* H_data, int ld_H, int n_rows, int n_cols,
+			const std::complex<double>* E_data, int ld_E, int n_rhs,
+			std::complex<double>* Y_data, double* resid_norms)
+	{
+		Map< const MatrixXcd, 0, OuterStride<> > H(H_data, n_rows, n_cols, OuterStride<>(ld_H));
+		Map< const MatrixXcd, 0, OuterStride<> > E(E_data, n_rows, n_rhs, OuterStride<>(ld_E));
+		Map< MatrixXcd > Y(Y_data, n_cols, n_rhs);
+
+		CompleteOrthogonalDecomposition<MatrixXcd> cod(H);
+		Y = cod.solve(E);
+
+		for(int c=0; c < n_rhs; ++c) {
+			resid_norms[c] = (E.col(c) - H*Y.col(c)).norm();
+		}
+	}
+
+	void BlockHessenbergQR::reset(const std::complex<double>* S, int p)
+	{
+		_p = p;
+		_n_blocks = 0;
+		_reflectors.clear();
+		_coeffs.clear();
+
+		// Q^H E, column major, gains p rows with each block column
+		_QE.assign(S, S + p*p);
+	}
+
+	void BlockHessenbergQR::addBlockColumn(const std::complex<double>* H_col, int ld_H, double* resid_norms)
+	{
+		const int p = _p;
+		const int j = _n_blocks;
+		const int n_rows = (j+2)*p;
+
+		Map< const MatrixXcd, 0, OuterStride<> > H(H_col, n_rows, p, OuterStride<>(ld_H));
+		MatrixXcd C = H;
+
+		// The reflectors of block i act on rows i*p .. (i+2)p-1
+		for(int i=0; i < j; ++i) {
+			Map< const MatrixXcd > V(_reflectors[i].data(), 2*p, p);
+			Map< const VectorXcd > h(_coeffs[i].data(), p);
+			C.middleRows(i*p, 2*p).applyOnTheLeft( householderSequence(V, h).adjoint() );
+		}
+
+		HouseholderQR<MatrixXcd> qr( C.middleRows(j*p, 2*p) );
+		_reflectors.emplace_back( qr.matrixQR().data(), qr.matrixQR().data() + 2*p*p );
+		VectorXcd h = qr.hCoeffs().conjugate();
+		_coeffs.emplace_back( h.data(), h.data() + p );
+
+		// Q^H E gains p zero rows, then the new reflectors act on its last 2p rows
+		Map< const MatrixXcd > QE_old(_QE.data(), (j+1)*p, p);
+		MatrixXcd QE = MatrixXcd::Zero(n_rows, p);
+		QE.topRows((j+1)*p) = QE_old;
+		QE.middleRows(j*p, 2*p).applyOnTheLeft( qr.householderQ().adjoint() );
+		_QE.assign(QE.data(), QE.data() + n_rows*p);
+
+		for(int c=0; c < p; ++c) {
+			resid_norms[c] = QE.col(c).tail(p).norm();
+		}
+		++_n_blocks;
+	}
+
+}
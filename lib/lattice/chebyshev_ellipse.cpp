@@ -0,0 +1,40 @@
+/*
+ * chebyshev_ellipse.cpp
+ */
+
+#include "lattice/chebyshev_ellipse.h"
+#include <cmath>
+#include <algorithm>
+
+// Eigen Dense header
+#include <Eigen/Dense>
+using namespace Eigen;
+
+namespace MG {
+
+	void ChebyshevEllipse(const std::complex<double>* H_data, int ld_H, int m,
+			double lambda_ratio, double safety,
+			double& center, double& c2, double& lambda_max)
+	{
+		Map< const MatrixXcd, 0, OuterStride<> > H(H_data, m, m, OuterStride<>(ld_H));
+
+		ComplexEigenSolver<MatrixXcd> eig(H, false);
+		const VectorXcd& theta = eig.eigenvalues();
+
+		double re_max = 0;
+		double im_max = 0;
+		for(int i=0; i < m; ++i) {
+			re_max = std::max(re_max, std::real(theta(i)));
+			im_max = std::max(im_max, std::abs(std::imag(theta(i))));
+		}
+
+		lambda_max = safety*re_max;
+		const double lambda_min = lambda_max/lambda_ratio;
+		const double a = 0.5*(lambda_max - lambda_min);
+		const double b = safety*im_max;
+
+		center = 0.5*(lambda_max + lambda_min);
+		c2 = a*a - b*b;
+	}
+
+}
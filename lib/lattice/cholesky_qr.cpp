@@ -0,0 +1,51 @@
+/*
+ * cholesky_qr.cpp
+ */
+
+#include "lattice/cholesky_qr.h"
+#include <cmath>
+
+// Eigen Dense header
+#include <Eigen/Dense>
+using namespace Eigen;
+
+namespace MG {
+
+	bool CholeskyQR2(std::complex<double>* V_data, int n_rows, int n_cols)
+	{
+		Map< MatrixXcd > V(V_data, n_rows, n_cols);
+
+		bool success = true;
+		for(int pass=0; pass < 2 && success; ++pass) {
+
+			// Gram matrix: one GEMM like pass over V
+			MatrixXcd G = V.adjoint()*V;
+
+			LLT<MatrixXcd> llt(G);
+			if( llt.info() != Success ) {
+				success = false;
+			}
+			else {
+				// V <- V R^{-1}, with G = R^H R
+				llt.matrixU().solveInPlace<OnTheRight>(V);
+			}
+		}
+
+		if( !success ) {
+			// Householder QR. Rotate the phases of Q so the diagonal of R
+			// is real and positive, which makes Q identical to Gram-Schmidt
+			HouseholderQR<MatrixXcd> qr(V);
+			MatrixXcd Q = qr.householderQ()*MatrixXcd::Identity(n_rows, n_cols);
+			for(int j=0; j < n_cols; ++j) {
+				std::complex<double> r_jj = qr.matrixQR()(j,j);
+				if( std::abs(r_jj) > 0 ) {
+					Q.col(j) *= r_jj/std::abs(r_jj);
+				}
+			}
+			V = Q;
+		}
+
+		return success;
+	}
+
+}
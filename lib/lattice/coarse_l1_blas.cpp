@@ -8,6 +8,7 @@
 #include "lattice/constants.h"
 #include "lattice/lattice_info.h"
 #include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/coarse/thread_partition.h"
 
 #include "MG_config.h"
 
@@ -16,6 +17,8 @@
 #endif
 // for random numbers:
 #include <random>
+#include <vector>
+#include <algorithm>
 
 namespace MG
 {
@@ -50,6 +53,29 @@ void GlobalSum( double* array, int array_length ) {
 }
 
 
+/* The kernels below take their site ranges from the shared ThreadPartition of the
+ * lattice (see thread_partition.h), the same one CoarseDiracOp uses. Each thread
+ * streams over its own part of each checkerboard in the subset, which is a flat span
+ * of complex numbers with RE/IM interleaved. SUBSET_ALL is not treated as one span
+ * across the (contiguous) checkerboards: splitting that span over the threads would
+ * hand a thread sites it does not own, and lose the locality of the first touch.
+ */
+
+namespace {
+
+	// The floats [begin, begin+num) of each checkerboard of x belonging to the calling thread
+	inline
+	void GetMyCBSpan(const ThreadPartition& partition, const CoarseSpinor& x, IndexType& begin, IndexType& num)
+	{
+		IndexType min_site, max_site;
+		partition.GetMySiteRange(min_site, max_site);
+
+		const IndexType n_floats_per_site = n_complex*x.GetNumColorSpin();
+		begin = min_site*n_floats_per_site;
+		num = (max_site - min_site)*n_floats_per_site;
+	}
+}
+
 /** Performs:
  *  x <- x - y;
  *  returns: norm(x) after subtraction
@@ -71,35 +97,25 @@ double XmyNorm2Vec(CoarseSpinor& x, const CoarseSpinor& y, const CBSubset& subse
 	const LatticeInfo& y_info = y.GetInfo();
 	AssertCompatible(x_info, y_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-	// Loop over the sites and sum up the norm
-#pragma omp parallel for collapse(2) reduction(+:norm_diff)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
-
-			// Identify the site
-			float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			const float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
-
-			// Sum difference over the colorspins
-			double cspin_sum=0;
-#pragma omp simd reduction(+:cspin_sum)
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-				double diff_re = x_site_data[ RE + n_complex*cspin ] - y_site_data[ RE + n_complex*cspin ];
-				double diff_im = x_site_data[ IM + n_complex*cspin ] - y_site_data[ IM + n_complex*cspin ];
-				x_site_data[RE + n_complex * cspin] = diff_re;
-				x_site_data[IM + n_complex * cspin] = diff_im;
-
-				cspin_sum += diff_re*diff_re + diff_im*diff_im;
+#pragma omp parallel reduction(+:norm_diff)
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			float* x_data = x.GetCBDataPtr(cb) + begin;
+			const float* y_data = y.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd reduction(+:norm_diff)
+			for(IndexType i=0; i < num_floats; ++i) {
+				double diff = x_data[i] - y_data[i];
+				x_data[i] = diff;
+				norm_diff += diff*diff;
 			}
-			norm_diff += cspin_sum;
 		}
-	} // End of Parallel for reduction
+	} // End of Parallel reduction
 
 	// I would probably need some kind of global reduction here  over the nodes which for now I will ignore.
 	MG::GlobalComm::GlobalSum(norm_diff);
@@ -119,34 +135,23 @@ double Norm2Vec(const CoarseSpinor& x, const CBSubset& subset)
 {
 	double norm_sq = (double)0;
 
-	const LatticeInfo& x_info = x.GetInfo();
-
-
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-	// Loop over the sites and sum up the norm
-#pragma omp parallel for collapse(2) reduction(+:norm_sq)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
+	const ThreadPartition& partition = GetThreadPartition(x.GetInfo());
 
+#pragma omp parallel reduction(+:norm_sq)
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-
-			// Sum difference over the colorspins
-			double cspin_sum = 0;
-#pragma omp simd reduction(+:cspin_sum)
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-				double x_re = x_site_data[ RE + n_complex*cspin ];
-				double x_im = x_site_data[ IM + n_complex*cspin ];
-
-				cspin_sum += x_re*x_re + x_im*x_im;
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
 
+#pragma omp simd reduction(+:norm_sq)
+			for(IndexType i=0; i < num_floats; ++i) {
+				double x_i = x_data[i];
+				norm_sq += x_i*x_i;
 			}
-			norm_sq += cspin_sum;
 		}
-	} // End of Parallel for reduction
+	} // End of Parallel reduction
 
 	// I would probably need some kind of global reduction here  over the nodes which for now I will ignore.
 	MG::GlobalComm::GlobalSum(norm_sq);
@@ -167,41 +172,33 @@ std::complex<double> InnerProductVec(const CoarseSpinor& x, const CoarseSpinor&
 	const LatticeInfo& y_info = y.GetInfo();
 	AssertCompatible(x_info, y_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
 	double iprod_re=(double)0;
 	double iprod_im=(double)0;
 
-	// Loop over the sites and sum up the norm
-#pragma omp parallel for collapse(2) reduction(+:iprod_re) reduction(+:iprod_im)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
-
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			const float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
-
-			// Sum difference over the colorspins
-
-			double cspin_iprod_re=0;
-			double cspin_iprod_im=0;
-#pragma omp simd reduction(+:cspin_iprod_re,cspin_iprod_im)
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-				cspin_iprod_re += x_site_data[ RE + n_complex*cspin ]*y_site_data[ RE + n_complex*cspin ]
-																				   + x_site_data[ IM + n_complex*cspin ]*y_site_data[ IM + n_complex*cspin ];
-
-				cspin_iprod_im += x_site_data[ RE + n_complex*cspin ]*y_site_data[ IM + n_complex*cspin ]
-																				   - x_site_data[ IM + n_complex*cspin ]*y_site_data[ RE + n_complex*cspin ];
-
+#pragma omp parallel reduction(+:iprod_re,iprod_im)
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
+			const float* y_data = y.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd reduction(+:iprod_re,iprod_im)
+			for(IndexType i=0; i < num_complex; ++i) {
+				const double x_re = x_data[ RE + n_complex*i ];
+				const double x_im = x_data[ IM + n_complex*i ];
+				const double y_re = y_data[ RE + n_complex*i ];
+				const double y_im = y_data[ IM + n_complex*i ];
+
+				iprod_re += x_re*y_re + x_im*y_im;
+				iprod_im += x_re*y_im - x_im*y_re;
 			}
-			iprod_re += cspin_iprod_re;
-			iprod_im += cspin_iprod_im;
 		}
-	} // End of Parallel for reduction
+	} // End of Parallel reduction
 
 	// Global Reduce
 	double iprod_array[2] = { iprod_re, iprod_im };
@@ -215,30 +212,22 @@ std::complex<double> InnerProductVec(const CoarseSpinor& x, const CoarseSpinor&
 
 void ZeroVec(CoarseSpinor& x, const CBSubset& subset)
 {
-	const LatticeInfo& x_info = x.GetInfo();
-
-
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
+	const ThreadPartition& partition = GetThreadPartition(x.GetInfo());
 
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
-			// Identify the site
-			float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			float* x_data = x.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-				x_site_data[RE + n_complex*cspin] = 0;
-				x_site_data[IM + n_complex*cspin] = 0;
-
+			for(IndexType i=0; i < num_floats; ++i) {
+				x_data[i] = 0;
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 
 }
 
@@ -252,92 +241,79 @@ void CopyVec(CoarseSpinor& x, const CoarseSpinor& y, const CBSubset& subset)
 	const LatticeInfo& y_info = y.GetInfo();
 	AssertCompatible(x_info, y_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
-			// Identify the site
-			float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			const float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			float* x_data = x.GetCBDataPtr(cb) + begin;
+			const float* y_data = y.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-				x_site_data[RE + n_complex*cspin] = y_site_data[RE + n_complex*cspin];
-				x_site_data[IM + n_complex*cspin] = y_site_data[IM + n_complex*cspin];
-
+			for(IndexType i=0; i < num_floats; ++i) {
+				x_data[i] = y_data[i];
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 
 }
 
-
+void ConvertSpinor(const CoarseSpinor& in, CoarseSpinor& out, const CBSubset& subset)
+{
+	CopyVec(out,in,subset);
+}
 
 void ScaleVec(const float alpha, CoarseSpinor& x, const CBSubset& subset)
 {
+	const ThreadPartition& partition = GetThreadPartition(x.GetInfo());
 
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
-	const LatticeInfo& x_info = x.GetInfo();
-
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
-
-			// Identify the site
-			float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			float* x_data = x.GetCBDataPtr(cb) + begin;
 
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-				x_site_data[RE + n_complex*cspin] *= alpha;
-				x_site_data[IM + n_complex*cspin] *= alpha;
+			for(IndexType i=0; i < num_floats; ++i) {
+				x_data[i] *= alpha;
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 
 }
 
 
 void ScaleVec(const std::complex<float>& alpha, CoarseSpinor& x, const CBSubset& subset)
 {
+	const ThreadPartition& partition = GetThreadPartition(x.GetInfo());
 
+	const float a_re = std::real(alpha);
+	const float a_im = std::imag(alpha);
 
-	const LatticeInfo& x_info = x.GetInfo();
-
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
-			// Identify the site
-			float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			float* x_data = x.GetCBDataPtr(cb) + begin;
 
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-				std::complex<float> t( x_site_data[RE + n_complex*cspin],
-						x_site_data[IM + n_complex*cspin]);
+			for(IndexType i=0; i < num_complex; ++i) {
+				const float x_re = x_data[ RE + n_complex*i ];
+				const float x_im = x_data[ IM + n_complex*i ];
 
-				t *= alpha;
-				x_site_data[RE + n_complex*cspin] = std::real(t);
-				x_site_data[IM + n_complex*cspin] = imag(t);
+				x_data[ RE + n_complex*i ] = a_re*x_re - a_im*x_im;
+				x_data[ IM + n_complex*i ] = a_re*x_im + a_im*x_re;
 			}
-
 		}
-	} // End of Parallel for reduction
+	} // End of Parallel region
 
 }
 
@@ -348,41 +324,31 @@ void AxpyVec(const std::complex<float>& alpha, const CoarseSpinor& x, CoarseSpin
 	const LatticeInfo& y_info = y.GetInfo();
 	AssertCompatible(x_info, y_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
+	const float a_re = std::real(alpha);
+	const float a_im = std::imag(alpha);
 
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
+			float* y_data = y.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-
-				std::complex<float> c_x( x_site_data[RE + n_complex*cspin],
-						x_site_data[IM + n_complex*cspin]);
-
-				std::complex<float> c_y( y_site_data[RE + n_complex*cspin],
-						y_site_data[IM + n_complex*cspin]);
-
-
-				c_y += alpha*c_x;
-
-				y_site_data[ RE + n_complex*cspin] = std::real(c_y);
-				y_site_data[ IM + n_complex*cspin] = imag(c_y);
+			for(IndexType i=0; i < num_complex; ++i) {
+				const float x_re = x_data[ RE + n_complex*i ];
+				const float x_im = x_data[ IM + n_complex*i ];
 
+				y_data[ RE + n_complex*i ] += a_re*x_re - a_im*x_im;
+				y_data[ IM + n_complex*i ] += a_re*x_im + a_im*x_re;
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 }
 
 
@@ -392,33 +358,23 @@ void YpeqxVec(const CoarseSpinor& x, CoarseSpinor& y, const CBSubset& subset)
 	const LatticeInfo& y_info = y.GetInfo();
 	AssertCompatible(x_info, y_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
-
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
+			float* y_data = y.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-
-
-				y_site_data[ RE + n_complex*cspin] += x_site_data[ RE + n_complex*cspin ];
-				y_site_data[ IM + n_complex*cspin] += x_site_data[ IM + n_complex*cspin ];
-
+			for(IndexType i=0; i < num_floats; ++i) {
+				y_data[i] += x_data[i];
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 }
 
 void YmeqxVec(const CoarseSpinor& x, CoarseSpinor& y, const CBSubset& subset)
@@ -427,33 +383,23 @@ void YmeqxVec(const CoarseSpinor& x, CoarseSpinor& y, const CBSubset& subset)
 	const LatticeInfo& y_info = y.GetInfo();
 	AssertCompatible(x_info, y_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
-
-
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
 
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
+			float* y_data = y.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-
-
-				y_site_data[ RE + n_complex*cspin] -= x_site_data[ RE + n_complex*cspin ];
-				y_site_data[ IM + n_complex*cspin] -= x_site_data[ IM + n_complex*cspin ];
-
+			for(IndexType i=0; i < num_floats; ++i) {
+				y_data[i] -= x_data[i];
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 }
 
 
@@ -471,44 +417,35 @@ void BiCGStabPUpdate(const std::complex<float>& beta,
 	AssertCompatible(r_info, p_info);
 	AssertCompatible(v_info, r_info);
 
-	IndexType num_cbsites = p_info.GetNumCBSites();
-	IndexType num_colorspin = p.GetNumColorSpin();
-
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
+	const ThreadPartition& partition = GetThreadPartition(p_info);
 
+	const float b_re = std::real(beta);
+	const float b_im = std::imag(beta);
+	const float o_re = std::real(omega);
+	const float o_im = std::imag(omega);
 
+	// p = r + beta*(p - omega*v)
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, p, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
-			// Identify the site
-			const float* r_site_data = r.GetSiteDataPtr(cb,cbsite);
-			const float* v_site_data = v.GetSiteDataPtr(cb,cbsite);
-			float* p_site_data = p.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* r_data = r.GetCBDataPtr(cb) + begin;
+			const float* v_data = v.GetCBDataPtr(cb) + begin;
+			float* p_data = p.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
-
-
-				const std::complex<float> c_p( p_site_data[RE + n_complex*cspin],
-						p_site_data[IM + n_complex*cspin]);
-
-				const std::complex<float> c_r( r_site_data[RE + n_complex*cspin],
-						r_site_data[IM + n_complex*cspin]);
-
-				const std::complex<float> c_v( v_site_data[RE + n_complex*cspin],
-						v_site_data[IM + n_complex*cspin]);
-
-
-				std::complex<float> res = c_r + beta*(c_p - omega*c_v);
-
-				p_site_data[ RE + n_complex*cspin] = res.real();
-				p_site_data[ IM + n_complex*cspin] = res.imag();
+			for(IndexType i=0; i < num_complex; ++i) {
+				const float t_re = p_data[ RE + n_complex*i ] - (o_re*v_data[ RE + n_complex*i ] - o_im*v_data[ IM + n_complex*i ]);
+				const float t_im = p_data[ IM + n_complex*i ] - (o_re*v_data[ IM + n_complex*i ] + o_im*v_data[ RE + n_complex*i ]);
 
+				p_data[ RE + n_complex*i ] = r_data[ RE + n_complex*i ] + b_re*t_re - b_im*t_im;
+				p_data[ IM + n_complex*i ] = r_data[ IM + n_complex*i ] + b_re*t_im + b_im*t_re;
 			}
-
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 }
 
 
@@ -528,79 +465,453 @@ void BiCGStabXUpdate(const std::complex<float>& omega,
 	AssertCompatible(r_info, p_info);
 	AssertCompatible(x_info, r_info);
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
-
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
+	const ThreadPartition& partition = GetThreadPartition(x_info);
 
+	const float o_re = std::real(omega);
+	const float o_im = std::imag(omega);
+	const float a_re = std::real(alpha);
+	const float a_im = std::imag(alpha);
 
+	// x += omega*r + alpha*p
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
-			// Identify the site
-			const float* r_site_data = r.GetSiteDataPtr(cb,cbsite);
-			const float* p_site_data = p.GetSiteDataPtr(cb,cbsite);
-			float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* r_data = r.GetCBDataPtr(cb) + begin;
+			const float* p_data = p.GetCBDataPtr(cb) + begin;
+			float* x_data = x.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
+			for(IndexType i=0; i < num_complex; ++i) {
+				const float r_re = r_data[ RE + n_complex*i ];
+				const float r_im = r_data[ IM + n_complex*i ];
+				const float p_re = p_data[ RE + n_complex*i ];
+				const float p_im = p_data[ IM + n_complex*i ];
+
+				x_data[ RE + n_complex*i ] += o_re*r_re - o_im*r_im + a_re*p_re - a_im*p_im;
+				x_data[ IM + n_complex*i ] += o_re*r_im + o_im*r_re + a_re*p_im + a_im*p_re;
+			}
+		}
+	} // End of Parallel region
+}
 
 
-				const std::complex<float> c_p( p_site_data[RE + n_complex*cspin],
-						p_site_data[IM + n_complex*cspin]);
 
-				const std::complex<float> c_r( r_site_data[RE + n_complex*cspin],
-						r_site_data[IM + n_complex*cspin]);
 
-				const std::complex<float> res =  omega*c_r + alpha*c_p;
 
-				x_site_data[ RE + n_complex*cspin] += res.real();
-				x_site_data[ IM + n_complex*cspin] += res.imag();
 
+
+/* The two fused steps of pipelined BiCGStab (see invpipebicgstab_generic.h).
+ * Each is one sweep over the vectors with one global reduction at the end.
+ */
+void PipeBiCGStabDirUpdate(const std::complex<double>& alpha,
+		const std::complex<double>& beta,
+		const std::complex<double>& omega,
+		const CoarseSpinor& r,
+		const CoarseSpinor& w,
+		const CoarseSpinor& t,
+		const CoarseSpinor& v,
+		CoarseSpinor& p,
+		CoarseSpinor& s,
+		CoarseSpinor& z,
+		CoarseSpinor& q,
+		CoarseSpinor& y,
+		std::complex<double>& y_dot_q,
+		double& y_norm2,
+		const CBSubset& subset)
+{
+	const LatticeInfo& info = r.GetInfo();
+	AssertCompatible(info, w.GetInfo());
+	AssertCompatible(info, t.GetInfo());
+	AssertCompatible(info, v.GetInfo());
+	AssertCompatible(info, p.GetInfo());
+	AssertCompatible(info, s.GetInfo());
+	AssertCompatible(info, z.GetInfo());
+	AssertCompatible(info, q.GetInfo());
+	AssertCompatible(info, y.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(info);
+
+	const float a_re = std::real(alpha);
+	const float a_im = std::imag(alpha);
+	const float b_re = std::real(beta);
+	const float b_im = std::imag(beta);
+	const float o_re = std::real(omega);
+	const float o_im = std::imag(omega);
+
+	double yq_re = 0;
+	double yq_im = 0;
+	double yy = 0;
+
+	// p = r + beta (p - omega s)
+	// s = w + beta (s - omega z)
+	// z = t + beta (z - omega v)
+	// q = r - alpha s
+	// y = w - alpha z
+	// and < y | q >, || y ||^2
+#pragma omp parallel reduction(+:yq_re,yq_im,yy)
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, r, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* r_data = r.GetCBDataPtr(cb) + begin;
+			const float* w_data = w.GetCBDataPtr(cb) + begin;
+			const float* t_data = t.GetCBDataPtr(cb) + begin;
+			const float* v_data = v.GetCBDataPtr(cb) + begin;
+			float* p_data = p.GetCBDataPtr(cb) + begin;
+			float* s_data = s.GetCBDataPtr(cb) + begin;
+			float* z_data = z.GetCBDataPtr(cb) + begin;
+			float* q_data = q.GetCBDataPtr(cb) + begin;
+			float* y_data = y.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd reduction(+:yq_re,yq_im,yy)
+			for(IndexType i=0; i < num_complex; ++i) {
+				const IndexType ire = RE + n_complex*i;
+				const IndexType iim = IM + n_complex*i;
+
+				// The old s and z are needed for the new p and s
+				const float s_re = s_data[ire];
+				const float s_im = s_data[iim];
+				const float z_re = z_data[ire];
+				const float z_im = z_data[iim];
+
+				float d_re = p_data[ire] - (o_re*s_re - o_im*s_im);
+				float d_im = p_data[iim] - (o_re*s_im + o_im*s_re);
+				p_data[ire] = r_data[ire] + b_re*d_re - b_im*d_im;
+				p_data[iim] = r_data[iim] + b_re*d_im + b_im*d_re;
+
+				d_re = s_re - (o_re*z_re - o_im*z_im);
+				d_im = s_im - (o_re*z_im + o_im*z_re);
+				const float sn_re = w_data[ire] + b_re*d_re - b_im*d_im;
+				const float sn_im = w_data[iim] + b_re*d_im + b_im*d_re;
+				s_data[ire] = sn_re;
+				s_data[iim] = sn_im;
+
+				d_re = z_re - (o_re*v_data[ire] - o_im*v_data[iim]);
+				d_im = z_im - (o_re*v_data[iim] + o_im*v_data[ire]);
+				const float zn_re = t_data[ire] + b_re*d_re - b_im*d_im;
+				const float zn_im = t_data[iim] + b_re*d_im + b_im*d_re;
+				z_data[ire] = zn_re;
+				z_data[iim] = zn_im;
+
+				const float qn_re = r_data[ire] - (a_re*sn_re - a_im*sn_im);
+				const float qn_im = r_data[iim] - (a_re*sn_im + a_im*sn_re);
+				q_data[ire] = qn_re;
+				q_data[iim] = qn_im;
+
+				const float yn_re = w_data[ire] - (a_re*zn_re - a_im*zn_im);
+				const float yn_im = w_data[iim] - (a_re*zn_im + a_im*zn_re);
+				y_data[ire] = yn_re;
+				y_data[iim] = yn_im;
+
+				yq_re += (double)yn_re*(double)qn_re + (double)yn_im*(double)qn_im;
+				yq_im += (double)yn_re*(double)qn_im - (double)yn_im*(double)qn_re;
+				yy += (double)yn_re*(double)yn_re + (double)yn_im*(double)yn_im;
 			}
+		}
+	} // End of Parallel reduction
+
+	double sums[3] = { yq_re, yq_im, yy };
+	MG::GlobalComm::GlobalSum(sums,3);
+
+	y_dot_q = std::complex<double>(sums[0],sums[1]);
+	y_norm2 = sums[2];
+}
+
+void PipeBiCGStabSolUpdate(const std::complex<double>& alpha,
+		const std::complex<double>& omega,
+		const CoarseSpinor& p,
+		const CoarseSpinor& q,
+		const CoarseSpinor& y,
+		const CoarseSpinor& t,
+		const CoarseSpinor& v,
+		const CoarseSpinor& r0,
+		const CoarseSpinor& s,
+		const CoarseSpinor& z,
+		CoarseSpinor& x,
+		CoarseSpinor& r,
+		CoarseSpinor& w,
+		std::complex<double>* r0_dots,
+		double& r_norm2,
+		const CBSubset& subset)
+{
+	const LatticeInfo& info = r.GetInfo();
+	AssertCompatible(info, p.GetInfo());
+	AssertCompatible(info, q.GetInfo());
+	AssertCompatible(info, y.GetInfo());
+	AssertCompatible(info, t.GetInfo());
+	AssertCompatible(info, v.GetInfo());
+	AssertCompatible(info, r0.GetInfo());
+	AssertCompatible(info, s.GetInfo());
+	AssertCompatible(info, z.GetInfo());
+	AssertCompatible(info, x.GetInfo());
+	AssertCompatible(info, w.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(info);
+
+	const float a_re = std::real(alpha);
+	const float a_im = std::imag(alpha);
+	const float o_re = std::real(omega);
+	const float o_im = std::imag(omega);
+
+	double r0r_re = 0, r0r_im = 0;
+	double r0w_re = 0, r0w_im = 0;
+	double r0s_re = 0, r0s_im = 0;
+	double r0z_re = 0, r0z_im = 0;
+	double rr = 0;
+
+	// x += alpha p + omega q
+	// r  = q - omega y
+	// w  = y - omega (t - alpha v)
+	// and < r0 | r >, < r0 | w >, < r0 | s >, < r0 | z >, || r ||^2
+#pragma omp parallel reduction(+:r0r_re,r0r_im,r0w_re,r0w_im,r0s_re,r0s_im,r0z_re,r0z_im,rr)
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, r, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* p_data = p.GetCBDataPtr(cb) + begin;
+			const float* q_data = q.GetCBDataPtr(cb) + begin;
+			const float* y_data = y.GetCBDataPtr(cb) + begin;
+			const float* t_data = t.GetCBDataPtr(cb) + begin;
+			const float* v_data = v.GetCBDataPtr(cb) + begin;
+			const float* r0_data = r0.GetCBDataPtr(cb) + begin;
+			const float* s_data = s.GetCBDataPtr(cb) + begin;
+			const float* z_data = z.GetCBDataPtr(cb) + begin;
+			float* x_data = x.GetCBDataPtr(cb) + begin;
+			float* r_data = r.GetCBDataPtr(cb) + begin;
+			float* w_data = w.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd reduction(+:r0r_re,r0r_im,r0w_re,r0w_im,r0s_re,r0s_im,r0z_re,r0z_im,rr)
+			for(IndexType i=0; i < num_complex; ++i) {
+				const IndexType ire = RE + n_complex*i;
+				const IndexType iim = IM + n_complex*i;
+
+				const float q_re = q_data[ire];
+				const float q_im = q_data[iim];
+				const float y_re = y_data[ire];
+				const float y_im = y_data[iim];
+
+				x_data[ire] += a_re*p_data[ire] - a_im*p_data[iim] + o_re*q_re - o_im*q_im;
+				x_data[iim] += a_re*p_data[iim] + a_im*p_data[ire] + o_re*q_im + o_im*q_re;
+
+				const float rn_re = q_re - (o_re*y_re - o_im*y_im);
+				const float rn_im = q_im - (o_re*y_im + o_im*y_re);
+				r_data[ire] = rn_re;
+				r_data[iim] = rn_im;
+
+				const float d_re = t_data[ire] - (a_re*v_data[ire] - a_im*v_data[iim]);
+				const float d_im = t_data[iim] - (a_re*v_data[iim] + a_im*v_data[ire]);
+				const float wn_re = y_re - (o_re*d_re - o_im*d_im);
+				const float wn_im = y_im - (o_re*d_im + o_im*d_re);
+				w_data[ire] = wn_re;
+				w_data[iim] = wn_im;
+
+				const double h_re = r0_data[ire];
+				const double h_im = r0_data[iim];
+
+				r0r_re += h_re*rn_re + h_im*rn_im;
+				r0r_im += h_re*rn_im - h_im*rn_re;
+				r0w_re += h_re*wn_re + h_im*wn_im;
+				r0w_im += h_re*wn_im - h_im*wn_re;
+				r0s_re += h_re*s_data[ire] + h_im*s_data[iim];
+				r0s_im += h_re*s_data[iim] - h_im*s_data[ire];
+				r0z_re += h_re*z_data[ire] + h_im*z_data[iim];
+				r0z_im += h_re*z_data[iim] - h_im*z_data[ire];
+				rr += (double)rn_re*(double)rn_re + (double)rn_im*(double)rn_im;
+			}
 		}
-	} // End of Parallel for region
+	} // End of Parallel reduction
+
+	double sums[9] = { r0r_re, r0r_im, r0w_re, r0w_im, r0s_re, r0s_im, r0z_re, r0z_im, rr };
+	MG::GlobalComm::GlobalSum(sums,9);
+
+	for(int j=0; j < 4; ++j) {
+		r0_dots[j] = std::complex<double>(sums[RE + n_complex*j], sums[IM + n_complex*j]);
+	}
+	r_norm2 = sums[8];
 }
 
+void ChebyshevUpdate(const double a, const double b,
+		const CoarseSpinor& Ad,
+		CoarseSpinor& d,
+		CoarseSpinor& r,
+		CoarseSpinor& x,
+		const CBSubset& subset)
+{
+	const LatticeInfo& info = r.GetInfo();
+	AssertCompatible(info, Ad.GetInfo());
+	AssertCompatible(info, d.GetInfo());
+	AssertCompatible(info, x.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(info);
 
+	const float a_f = a;
+	const float b_f = b;
 
+	// x += d,  r -= Ad,  d = a d + b r
+	// The coefficients are real, so this can run over the floats
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, r, begin, num_floats);
 
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* Ad_data = Ad.GetCBDataPtr(cb) + begin;
+			float* d_data = d.GetCBDataPtr(cb) + begin;
+			float* r_data = r.GetCBDataPtr(cb) + begin;
+			float* x_data = x.GetCBDataPtr(cb) + begin;
 
+#pragma omp simd
+			for(IndexType i=0; i < num_floats; ++i) {
+				const float d_i = d_data[i];
+				const float r_i = r_data[i] - Ad_data[i];
+				x_data[i] += d_i;
+				r_data[i] = r_i;
+				d_data[i] = a_f*d_i + b_f*r_i;
+			}
+		}
+	} // End of Parallel region
+}
 
+/* The ...InTeam kernels: the loops of the kernels above, run by the calling thread
+ * of a team already in a parallel region. No reductions over the threads or nodes.
+ */
+void ZeroVecInTeam(const ThreadPartition& partition, CoarseSpinor& x, const CBSubset& subset)
+{
+	IndexType begin, num_floats;
+	GetMyCBSpan(partition, x, begin, num_floats);
 
-void AxpyVec(const float& alpha, const CoarseSpinor&x, CoarseSpinor& y, const CBSubset& subset) {
-	const LatticeInfo& x_info = x.GetInfo();
-	const LatticeInfo& y_info = y.GetInfo();
-	AssertCompatible(x_info, y_info);
+	for(int cb=subset.start; cb < subset.end; ++cb) {
+		float* x_data = x.GetCBDataPtr(cb) + begin;
 
+#pragma omp simd
+		for(IndexType i=0; i < num_floats; ++i) {
+			x_data[i] = 0;
+		}
+	}
+}
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
+void CopyVecInTeam(const ThreadPartition& partition, CoarseSpinor& x, const CoarseSpinor& y, const CBSubset& subset)
+{
+	IndexType begin, num_floats;
+	GetMyCBSpan(partition, x, begin, num_floats);
 
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
+	for(int cb=subset.start; cb < subset.end; ++cb) {
+		float* x_data = x.GetCBDataPtr(cb) + begin;
+		const float* y_data = y.GetCBDataPtr(cb) + begin;
 
+#pragma omp simd
+		for(IndexType i=0; i < num_floats; ++i) {
+			x_data[i] = y_data[i];
+		}
+	}
+}
 
+void AxpyVecInTeam(const ThreadPartition& partition, const std::complex<float>& alpha,
+		const CoarseSpinor& x, CoarseSpinor& y, const CBSubset& subset)
+{
+	const float a_re = std::real(alpha);
+	const float a_im = std::imag(alpha);
+
+	IndexType begin, num_floats;
+	GetMyCBSpan(partition, x, begin, num_floats);
+	const IndexType num_complex = num_floats/n_complex;
 
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
+	for(int cb=subset.start; cb < subset.end; ++cb) {
+		const float* x_data = x.GetCBDataPtr(cb) + begin;
+		float* y_data = y.GetCBDataPtr(cb) + begin;
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
+		for(IndexType i=0; i < num_complex; ++i) {
+			const float x_re = x_data[ RE + n_complex*i ];
+			const float x_im = x_data[ IM + n_complex*i ];
+
+			y_data[ RE + n_complex*i ] += a_re*x_re - a_im*x_im;
+			y_data[ IM + n_complex*i ] += a_re*x_im + a_im*x_re;
+		}
+	}
+}
 
+double Norm2VecInTeam(const ThreadPartition& partition, const CoarseSpinor& x, const CBSubset& subset)
+{
+	double norm_sq = 0;
 
-				y_site_data[ RE + n_complex*cspin] += alpha*x_site_data[ RE + n_complex*cspin];
-				y_site_data[ IM + n_complex*cspin] += alpha*x_site_data[ IM + n_complex*cspin];
+	IndexType begin, num_floats;
+	GetMyCBSpan(partition, x, begin, num_floats);
 
-			}
+	for(int cb=subset.start; cb < subset.end; ++cb) {
+		const float* x_data = x.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd reduction(+:norm_sq)
+		for(IndexType i=0; i < num_floats; ++i) {
+			double x_i = x_data[i];
+			norm_sq += x_i*x_i;
+		}
+	}
+	return norm_sq;
+}
+
+std::complex<double> InnerProductNorm2VecInTeam(const ThreadPartition& partition,
+		const CoarseSpinor& x, const CoarseSpinor& y, double& norm2_x, const CBSubset& subset)
+{
+	double iprod_re = 0;
+	double iprod_im = 0;
+	double norm_sq = 0;
+
+	IndexType begin, num_floats;
+	GetMyCBSpan(partition, x, begin, num_floats);
+	const IndexType num_complex = num_floats/n_complex;
+
+	for(int cb=subset.start; cb < subset.end; ++cb) {
+		const float* x_data = x.GetCBDataPtr(cb) + begin;
+		const float* y_data = y.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd reduction(+:iprod_re,iprod_im,norm_sq)
+		for(IndexType i=0; i < num_complex; ++i) {
+			const double x_re = x_data[ RE + n_complex*i ];
+			const double x_im = x_data[ IM + n_complex*i ];
+			const double y_re = y_data[ RE + n_complex*i ];
+			const double y_im = y_data[ IM + n_complex*i ];
+
+			iprod_re += x_re*y_re + x_im*y_im;
+			iprod_im += x_re*y_im - x_im*y_re;
+			norm_sq += x_re*x_re + x_im*x_im;
+		}
+	}
+
+	norm2_x = norm_sq;
+	return std::complex<double>(iprod_re, iprod_im);
+}
+
+void AxpyVec(const float& alpha, const CoarseSpinor&x, CoarseSpinor& y, const CBSubset& subset) {
+	const LatticeInfo& x_info = x.GetInfo();
+	const LatticeInfo& y_info = y.GetInfo();
+	AssertCompatible(x_info, y_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
+
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
+			float* y_data = y.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd
+			for(IndexType i=0; i < num_floats; ++i) {
+				y_data[i] += alpha*x_data[i];
+			}
 		}
-	} // End of Parallel for region
+	} // End of Parallel region
 }
 
 
@@ -613,33 +924,529 @@ void XmyzVec(const CoarseSpinor&x, const CoarseSpinor& y,
 	AssertCompatible(x_info, y_info);
 	AssertCompatible(z_info, x_info);
 
+	const ThreadPartition& partition = GetThreadPartition(x_info);
+
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x, begin, num_floats);
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x.GetCBDataPtr(cb) + begin;
+			const float* y_data = y.GetCBDataPtr(cb) + begin;
+			float* z_data = z.GetCBDataPtr(cb) + begin;
+
+#pragma omp simd
+			for(IndexType i=0; i < num_floats; ++i) {
+				z_data[i] = x_data[i] - y_data[i];
+			}
+		}
+	} // End of Parallel region
+}
+
+
+
+/* The multi-vector kernels work on tiles of each thread's span, so that
+ * the tile of the single vector stays in cache while all the
+ * vectors of the set stream past it.
+ */
+static const IndexType multivec_tile_complex = 256;
+
+/* iprods[j] = < x_j | y >, and if norm2_y is not null also *norm2_y = || y ||^2.
+ * The norm rides along in the same sweep and the same global reduction
+ * as the inner products.
+ */
+static
+void innerProductMultiVecImpl(const CoarseSpinorSet& x, int n_vecs, const CoarseSpinor& y,
+		std::complex<double>* iprods, double* norm2_y, const CBSubset& subset)
+{
+	AssertCompatible(x.GetInfo(), y.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(y.GetInfo());
+	const IndexType vec_stride = x.GetVecStride();
 
-	IndexType num_cbsites = x_info.GetNumCBSites();
-	IndexType num_colorspin = x.GetNumColorSpin();
+	// The norm goes in the last slot
+	const int n_sums = n_complex*n_vecs + 1;
+	std::vector<double> iprod_array(n_sums, 0);
 
-#pragma omp parallel for collapse(2)
-	for(int cb=subset.start; cb < subset.end; ++cb ) {
-		for(int cbsite = 0; cbsite < num_cbsites; ++cbsite ) {
+#pragma omp parallel
+	{
+		std::vector<double> my_iprod(n_sums, 0);
 
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, y, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
 
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x[0].GetCBDataPtr(cb) + begin;
+			const float* y_data = y.GetCBDataPtr(cb) + begin;
+
+			for(IndexType tile=0; tile < num_complex; tile += multivec_tile_complex) {
+				const IndexType tile_end = std::min(tile + multivec_tile_complex, num_complex);
+
+				if( norm2_y != nullptr ) {
+					double norm2=0;
+#pragma omp simd reduction(+:norm2)
+					for(IndexType i=tile; i < tile_end; ++i) {
+						const double y_re = y_data[ RE + n_complex*i ];
+						const double y_im = y_data[ IM + n_complex*i ];
+						norm2 += y_re*y_re + y_im*y_im;
+					}
+					my_iprod[n_sums-1] += norm2;
+				}
+
+				for(int j=0; j < n_vecs; ++j) {
+					const float* xj_data = x_data + j*vec_stride;
+
+					double iprod_re=0;
+					double iprod_im=0;
+#pragma omp simd reduction(+:iprod_re,iprod_im)
+					for(IndexType i=tile; i < tile_end; ++i) {
+						const double x_re = xj_data[ RE + n_complex*i ];
+						const double x_im = xj_data[ IM + n_complex*i ];
+						const double y_re = y_data[ RE + n_complex*i ];
+						const double y_im = y_data[ IM + n_complex*i ];
+
+						iprod_re += x_re*y_re + x_im*y_im;
+						iprod_im += x_re*y_im - x_im*y_re;
+					}
+					my_iprod[RE + n_complex*j] += iprod_re;
+					my_iprod[IM + n_complex*j] += iprod_im;
+				}
+			}
+		}
+
+#pragma omp critical
+		{
+			for(int k=0; k < n_sums; ++k) {
+				iprod_array[k] += my_iprod[k];
+			}
+		}
+	} // End of parallel region
 
-			// Identify the site
-			const float* x_site_data = x.GetSiteDataPtr(cb,cbsite);
-			const float* y_site_data = y.GetSiteDataPtr(cb,cbsite);
-			float* z_site_data = z.GetSiteDataPtr(cb,cbsite);
+	// One global reduction for all the inner products (and the norm)
+	MG::GlobalComm::GlobalSum(iprod_array.data(), n_sums);
+
+	for(int j=0; j < n_vecs; ++j) {
+		iprods[j] = std::complex<double>( iprod_array[RE + n_complex*j], iprod_array[IM + n_complex*j] );
+	}
+	if( norm2_y != nullptr ) {
+		*norm2_y = iprod_array[n_sums-1];
+	}
+}
+
+void InnerProductMultiVec(const CoarseSpinorSet& x, int n_vecs, const CoarseSpinor& y,
+		std::complex<double>* iprods, const CBSubset& subset)
+{
+	innerProductMultiVecImpl(x, n_vecs, y, iprods, nullptr, subset);
+}
+
+void InnerProductNorm2MultiVec(const CoarseSpinorSet& x, int n_vecs, const CoarseSpinor& y,
+		std::complex<double>* iprods, double& norm2_y, const CBSubset& subset)
+{
+	innerProductMultiVecImpl(x, n_vecs, y, iprods, &norm2_y, subset);
+}
+
+void AxpyMultiVec(const std::complex<double>* alpha, const CoarseSpinorSet& x, int n_vecs,
+		CoarseSpinor& y, const CBSubset& subset)
+{
+	AssertCompatible(x.GetInfo(), y.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(y.GetInfo());
+	const IndexType vec_stride = x.GetVecStride();
+
+	std::vector<float> a_re(n_vecs);
+	std::vector<float> a_im(n_vecs);
+	for(int j=0; j < n_vecs; ++j) {
+		a_re[j] = std::real(alpha[j]);
+		a_im[j] = std::imag(alpha[j]);
+	}
+
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, y, begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x[0].GetCBDataPtr(cb) + begin;
+			float* y_data = y.GetCBDataPtr(cb) + begin;
+
+			for(IndexType tile=0; tile < num_complex; tile += multivec_tile_complex) {
+				const IndexType tile_end = std::min(tile + multivec_tile_complex, num_complex);
+
+				for(int j=0; j < n_vecs; ++j) {
+					const float* xj_data = x_data + j*vec_stride;
+					const float ar = a_re[j];
+					const float ai = a_im[j];
 
-			// Sum difference over the colorspins
 #pragma omp simd
-			for(int cspin=0; cspin < num_colorspin; ++cspin) {
+					for(IndexType i=tile; i < tile_end; ++i) {
+						const float x_re = xj_data[ RE + n_complex*i ];
+						const float x_im = xj_data[ IM + n_complex*i ];
 
+						y_data[ RE + n_complex*i ] += ar*x_re - ai*x_im;
+						y_data[ IM + n_complex*i ] += ar*x_im + ai*x_re;
+					}
+				}
+			}
+		}
+	} // End of Parallel region
+}
+
+/* < x_i | y_j > for i=0,1 and j=0,1 over the complex numbers [begin,end), added to
+ * iprod_y0[0..3] (x_0 y_0, x_1 y_0) and iprod_y1[0..3] (x_0 y_1, x_1 y_1), re and im each
+ */
+static inline
+void innerProduct2x2(const float* x0_data, const float* x1_data, const float* y0_data, const float* y1_data,
+		IndexType begin, IndexType end, double* iprod_y0, double* iprod_y1)
+{
+	double re00=0, im00=0, re10=0, im10=0, re01=0, im01=0, re11=0, im11=0;
+
+#pragma omp simd reduction(+:re00,im00,re10,im10,re01,im01,re11,im11)
+	for(IndexType s=begin; s < end; ++s) {
+		const double x0_re = x0_data[ RE + n_complex*s ];
+		const double x0_im = x0_data[ IM + n_complex*s ];
+		const double x1_re = x1_data[ RE + n_complex*s ];
+		const double x1_im = x1_data[ IM + n_complex*s ];
+		const double y0_re = y0_data[ RE + n_complex*s ];
+		const double y0_im = y0_data[ IM + n_complex*s ];
+		const double y1_re = y1_data[ RE + n_complex*s ];
+		const double y1_im = y1_data[ IM + n_complex*s ];
+
+		re00 += x0_re*y0_re + x0_im*y0_im;
+		im00 += x0_re*y0_im - x0_im*y0_re;
+		re10 += x1_re*y0_re + x1_im*y0_im;
+		im10 += x1_re*y0_im - x1_im*y0_re;
+		re01 += x0_re*y1_re + x0_im*y1_im;
+		im01 += x0_re*y1_im - x0_im*y1_re;
+		re11 += x1_re*y1_re + x1_im*y1_im;
+		im11 += x1_re*y1_im - x1_im*y1_re;
+	}
+
+	iprod_y0[0] += re00; iprod_y0[1] += im00; iprod_y0[2] += re10; iprod_y0[3] += im10;
+	iprod_y1[0] += re01; iprod_y1[1] += im01; iprod_y1[2] += re11; iprod_y1[3] += im11;
+}
+
+void InnerProductBlockVec(const CoarseSpinorSet& x, int n_x, const CoarseSpinorSet& y, int n_y,
+		std::complex<double>* iprods, const CBSubset& subset)
+{
+	AssertCompatible(x.GetInfo(), y.GetInfo());
 
-				z_site_data[ RE + n_complex*cspin] = x_site_data[ RE + n_complex*cspin] - y_site_data[ RE + n_complex * cspin];
-				z_site_data[ IM + n_complex*cspin] = x_site_data[ IM + n_complex*cspin] - y_site_data[ IM + n_complex * cspin];
+	const ThreadPartition& partition = GetThreadPartition(y.GetInfo());
+	const IndexType x_stride = x.GetVecStride();
+	const IndexType y_stride = y.GetVecStride();
 
+	const int n_sums = n_complex*n_x*n_y;
+	std::vector<double> iprod_array(n_sums, 0);
+
+#pragma omp parallel
+	{
+		std::vector<double> my_iprod(n_sums, 0);
+
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, y[0], begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x[0].GetCBDataPtr(cb) + begin;
+			const float* y_data = y[0].GetCBDataPtr(cb) + begin;
+
+			// One tile of every vector stays in cache for all n_x*n_y products
+			for(IndexType tile=0; tile < num_complex; tile += multivec_tile_complex) {
+				const IndexType tile_end = std::min(tile + multivec_tile_complex, num_complex);
+
+				// 2 x 2 blocks of products, so each element loaded serves two of them
+				const int n_x2 = n_x - n_x % 2;
+				const int n_y2 = n_y - n_y % 2;
+				for(int j=0; j < n_y2; j += 2) {
+					for(int i=0; i < n_x2; i += 2) {
+						innerProduct2x2(x_data + i*x_stride, x_data + (i+1)*x_stride,
+								y_data + j*y_stride, y_data + (j+1)*y_stride, tile, tile_end,
+								&my_iprod[ n_complex*(i + n_x*j) ], &my_iprod[ n_complex*(i + n_x*(j+1)) ]);
+					}
+				}
+
+				// The odd row and column, if any
+				for(int j=0; j < n_y; ++j) {
+					const float* yj_data = y_data + j*y_stride;
+					for(int i = (j < n_y2) ? n_x2 : 0; i < n_x; ++i) {
+						const float* xi_data = x_data + i*x_stride;
+
+						double iprod_re=0;
+						double iprod_im=0;
+#pragma omp simd reduction(+:iprod_re,iprod_im)
+						for(IndexType s=tile; s < tile_end; ++s) {
+							const double x_re = xi_data[ RE + n_complex*s ];
+							const double x_im = xi_data[ IM + n_complex*s ];
+							const double y_re = yj_data[ RE + n_complex*s ];
+							const double y_im = yj_data[ IM + n_complex*s ];
+
+							iprod_re += x_re*y_re + x_im*y_im;
+							iprod_im += x_re*y_im - x_im*y_re;
+						}
+						my_iprod[ RE + n_complex*(i + n_x*j) ] += iprod_re;
+						my_iprod[ IM + n_complex*(i + n_x*j) ] += iprod_im;
+					}
+				}
 			}
+		}
 
+#pragma omp critical
+		{
+			for(int k=0; k < n_sums; ++k) {
+				iprod_array[k] += my_iprod[k];
+			}
 		}
-	} // End of Parallel for region
+	} // End of parallel region
+
+	MG::GlobalComm::GlobalSum(iprod_array.data(), n_sums);
+
+	for(int k=0; k < n_x*n_y; ++k) {
+		iprods[k] = std::complex<double>( iprod_array[RE + n_complex*k], iprod_array[IM + n_complex*k] );
+	}
+}
+
+void AxpyBlockVec(const std::complex<double>* alpha, const CoarseSpinorSet& x, int n_x,
+		CoarseSpinorSet& y, int n_y, const CBSubset& subset)
+{
+	AssertCompatible(x.GetInfo(), y.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(y.GetInfo());
+	const IndexType x_stride = x.GetVecStride();
+	const IndexType y_stride = y.GetVecStride();
+
+	std::vector<float> a_re(n_x*n_y);
+	std::vector<float> a_im(n_x*n_y);
+	for(int k=0; k < n_x*n_y; ++k) {
+		a_re[k] = std::real(alpha[k]);
+		a_im[k] = std::imag(alpha[k]);
+	}
+
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, y[0], begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x[0].GetCBDataPtr(cb) + begin;
+			float* y_data = y[0].GetCBDataPtr(cb) + begin;
+
+			for(IndexType tile=0; tile < num_complex; tile += multivec_tile_complex) {
+				const IndexType tile_end = std::min(tile + multivec_tile_complex, num_complex);
+
+				for(int j=0; j < n_y; ++j) {
+					float* yj_data = y_data + j*y_stride;
+					for(int i=0; i < n_x; ++i) {
+						const float* xi_data = x_data + i*x_stride;
+						const float ar = a_re[i + n_x*j];
+						const float ai = a_im[i + n_x*j];
+
+#pragma omp simd
+						for(IndexType s=tile; s < tile_end; ++s) {
+							const float x_re = xi_data[ RE + n_complex*s ];
+							const float x_im = xi_data[ IM + n_complex*s ];
+
+							yj_data[ RE + n_complex*s ] += ar*x_re - ai*x_im;
+							yj_data[ IM + n_complex*s ] += ar*x_im + ai*x_re;
+						}
+					}
+				}
+			}
+		}
+	} // End of Parallel region
+}
+
+void GramMatrix(const CoarseSpinorSet& x, int n_vecs, std::complex<double>* G, const CBSubset& subset)
+{
+	const ThreadPartition& partition = GetThreadPartition(x.GetInfo());
+	const IndexType vec_stride = x.GetVecStride();
+
+	// Upper triangle only, as G is hermitian
+	std::vector<double> G_array(n_complex*n_vecs*n_vecs, 0);
+
+#pragma omp parallel
+	{
+		std::vector<double> my_G(n_complex*n_vecs*n_vecs, 0);
+
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x[0], begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			const float* x_data = x[0].GetCBDataPtr(cb) + begin;
+
+			for(IndexType tile=0; tile < num_complex; tile += multivec_tile_complex) {
+				const IndexType tile_end = std::min(tile + multivec_tile_complex, num_complex);
+
+				for(int j=0; j < n_vecs; ++j) {
+					const float* xj_data = x_data + j*vec_stride;
+					for(int i=0; i <= j; ++i) {
+						const float* xi_data = x_data + i*vec_stride;
+
+						double g_re=0;
+						double g_im=0;
+#pragma omp simd reduction(+:g_re,g_im)
+						for(IndexType s=tile; s < tile_end; ++s) {
+							const double xi_re = xi_data[ RE + n_complex*s ];
+							const double xi_im = xi_data[ IM + n_complex*s ];
+							const double xj_re = xj_data[ RE + n_complex*s ];
+							const double xj_im = xj_data[ IM + n_complex*s ];
+
+							g_re += xi_re*xj_re + xi_im*xj_im;
+							g_im += xi_re*xj_im - xi_im*xj_re;
+						}
+						my_G[ RE + n_complex*(i + n_vecs*j) ] += g_re;
+						my_G[ IM + n_complex*(i + n_vecs*j) ] += g_im;
+					}
+				}
+			}
+		}
+
+#pragma omp critical
+		{
+			for(int k=0; k < n_complex*n_vecs*n_vecs; ++k) {
+				G_array[k] += my_G[k];
+			}
+		}
+	} // End of parallel region
+
+	MG::GlobalComm::GlobalSum(G_array.data(), n_complex*n_vecs*n_vecs);
+
+	for(int j=0; j < n_vecs; ++j) {
+		for(int i=0; i <= j; ++i) {
+			G[i + n_vecs*j] = std::complex<double>( G_array[ RE + n_complex*(i + n_vecs*j) ],
+													G_array[ IM + n_complex*(i + n_vecs*j) ] );
+			G[j + n_vecs*i] = std::conj( G[i + n_vecs*j] );
+		}
+	}
+}
+
+/* norm2_x[j] = || x_j ||^2, and if y is not null also iprods[j] = < x_j | y_j >,
+ * all in one sweep and one global reduction.
+ */
+static
+void innerProductNorm2EachVecImpl(const CoarseSpinorSet& x, const CoarseSpinorSet* y, int n_vecs,
+		std::complex<double>* iprods, double* norm2_x, const CBSubset& subset)
+{
+	const ThreadPartition& partition = GetThreadPartition(x.GetInfo());
+	const IndexType x_stride = x.GetVecStride();
+	const IndexType y_stride = (y != nullptr) ? y->GetVecStride() : 0;
+
+	// Vector j has slots n_sums_per_vec*j + { norm, re, im }
+	const int n_sums_per_vec = (y != nullptr) ? 3 : 1;
+	const int n_sums = n_sums_per_vec*n_vecs;
+	std::vector<double> sum_array(n_sums, 0);
+
+#pragma omp parallel
+	{
+		std::vector<double> my_sum(n_sums, 0);
+
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, x[0], begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			for(int j=0; j < n_vecs; ++j) {
+				const float* xj_data = x[0].GetCBDataPtr(cb) + begin + j*x_stride;
+
+				double norm2=0;
+				if( y == nullptr ) {
+#pragma omp simd reduction(+:norm2)
+					for(IndexType i=0; i < num_complex; ++i) {
+						const double x_re = xj_data[ RE + n_complex*i ];
+						const double x_im = xj_data[ IM + n_complex*i ];
+						norm2 += x_re*x_re + x_im*x_im;
+					}
+					my_sum[j] += norm2;
+				}
+				else {
+					const float* yj_data = (*y)[0].GetCBDataPtr(cb) + begin + j*y_stride;
+
+					double iprod_re=0;
+					double iprod_im=0;
+#pragma omp simd reduction(+:norm2,iprod_re,iprod_im)
+					for(IndexType i=0; i < num_complex; ++i) {
+						const double x_re = xj_data[ RE + n_complex*i ];
+						const double x_im = xj_data[ IM + n_complex*i ];
+						const double y_re = yj_data[ RE + n_complex*i ];
+						const double y_im = yj_data[ IM + n_complex*i ];
+
+						norm2 += x_re*x_re + x_im*x_im;
+						iprod_re += x_re*y_re + x_im*y_im;
+						iprod_im += x_re*y_im - x_im*y_re;
+					}
+					my_sum[3*j] += norm2;
+					my_sum[3*j+1] += iprod_re;
+					my_sum[3*j+2] += iprod_im;
+				}
+			}
+		}
+
+#pragma omp critical
+		{
+			for(int k=0; k < n_sums; ++k) {
+				sum_array[k] += my_sum[k];
+			}
+		}
+	} // End of parallel region
+
+	MG::GlobalComm::GlobalSum(sum_array.data(), n_sums);
+
+	for(int j=0; j < n_vecs; ++j) {
+		norm2_x[j] = sum_array[n_sums_per_vec*j];
+		if( y != nullptr ) {
+			iprods[j] = std::complex<double>( sum_array[3*j+1], sum_array[3*j+2] );
+		}
+	}
+}
+
+void Norm2EachVec(const CoarseSpinorSet& x, int n_vecs, double* norm2, const CBSubset& subset)
+{
+	innerProductNorm2EachVecImpl(x, nullptr, n_vecs, nullptr, norm2, subset);
+}
+
+void InnerProductNorm2EachVec(const CoarseSpinorSet& x, const CoarseSpinorSet& y, int n_vecs,
+		std::complex<double>* iprods, double* norm2_x, const CBSubset& subset)
+{
+	AssertCompatible(x.GetInfo(), y.GetInfo());
+	innerProductNorm2EachVecImpl(x, &y, n_vecs, iprods, norm2_x, subset);
+}
+
+void AxpyEachVec(const std::complex<double>* alpha, const CoarseSpinorSet& x,
+		CoarseSpinorSet& y, int n_vecs, const CBSubset& subset)
+{
+	AssertCompatible(x.GetInfo(), y.GetInfo());
+
+	const ThreadPartition& partition = GetThreadPartition(y.GetInfo());
+	const IndexType x_stride = x.GetVecStride();
+	const IndexType y_stride = y.GetVecStride();
+
+#pragma omp parallel
+	{
+		IndexType begin, num_floats;
+		GetMyCBSpan(partition, y[0], begin, num_floats);
+		const IndexType num_complex = num_floats/n_complex;
+
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			for(int j=0; j < n_vecs; ++j) {
+				const float* xj_data = x[0].GetCBDataPtr(cb) + begin + j*x_stride;
+				float* yj_data = y[0].GetCBDataPtr(cb) + begin + j*y_stride;
+				const float ar = std::real(alpha[j]);
+				const float ai = std::imag(alpha[j]);
+
+#pragma omp simd
+				for(IndexType i=0; i < num_complex; ++i) {
+					const float x_re = xj_data[ RE + n_complex*i ];
+					const float x_im = xj_data[ IM + n_complex*i ];
+
+					yj_data[ RE + n_complex*i ] += ar*x_re - ai*x_im;
+					yj_data[ IM + n_complex*i ] += ar*x_im + ai*x_re;
+				}
+			}
+		}
+	} // End of Parallel region
 }
 
 
@@ -649,7 +1456,7 @@ void Gaussian(CoarseSpinor& x, const CBSubset& subset)
 {
 	const LatticeInfo& info = x.GetInfo();
 	const IndexType num_colorspin = info.GetNumColors()*info.GetNumSpins();
-	const IndexType num_cbsites = info.GetNumCBSites();
+	const ThreadPartition& partition = GetThreadPartition(info);
 
 	/* FIXME: This is quick and dirty and nonreproducible. A better source of random
 	 * numbers which is reproducible, and can scale with the number of sites in the
@@ -666,9 +1473,11 @@ void Gaussian(CoarseSpinor& x, const CBSubset& subset)
 		// A normal distribution centred on 0, with width 1
 		std::normal_distribution<> normal_dist(0.0,1.0);
 
-#pragma omp for collapse(2)
+		IndexType min_site, max_site;
+		partition.GetMySiteRange(min_site, max_site);
+
 		for(int cb=subset.start; cb < subset.end; ++cb) {
-			for(int cbsite = 0; cbsite < num_cbsites; ++cbsite) {
+			for(int cbsite = min_site; cbsite < max_site; ++cbsite) {
 
 				float *x_site_data = x.GetSiteDataPtr(cb,cbsite);
 
@@ -692,77 +1501,43 @@ void Gaussian(CoarseSpinor& x, const CBSubset& subset)
 void ZeroGauge(CoarseGauge& gauge)
 {
 	const LatticeInfo& info = gauge.GetInfo();
-	const int num_cbsites=info.GetNumCBSites();
-	const int num_colorspins = gauge.GetNumColorSpin();
-
+	const ThreadPartition& partition = GetThreadPartition(info);
 
-	// diag_data
-#pragma omp parallel for collapse(2)
-	for(int cb=0; cb < n_checkerboard; ++cb ) {
-		for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
-			float* data = gauge.GetSiteDiagDataPtr(cb,cbsite);
+	const int link_offset = gauge.GetLinkOffset();
+	const int site_offset = gauge.GetSiteOffset();
 
-#pragma omp simd aligned(data:64)
-			for(int j=0; j < gauge.GetLinkOffset(); ++j) {
-				data[j] = 0;
-			}
-		}
-	}
-
-
-	// offdiag_data
-#pragma omp parallel for collapse(2)
-	for(int cb=0; cb < n_checkerboard; ++cb ) {
-		for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
-			float* data = gauge.GetSiteDirDataPtr(cb,cbsite,0);
-#pragma omp simd aligned(data:64)
-			for(int j=0; j < gauge.GetSiteOffset(); ++j) {
-				data[j] = 0;
-			}
-		}
-	}
-
-	// inv diag_data
-#pragma omp parallel for collapse(2)
-	for(int cb=0; cb < n_checkerboard; ++cb ) {
-		for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
-			float* data = gauge.GetSiteInvDiagDataPtr(cb,cbsite);
-
-#pragma omp simd aligned(data:64)
-			for(int j=0; j < gauge.GetLinkOffset(); ++j) {
-				data[j] = 0;
-			}
-		}
-	}
-
-
-	// AD_data
-#pragma omp parallel for collapse(2)
-	for(int cb=0; cb < n_checkerboard; ++cb ) {
-		for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
-			float* data = gauge.GetSiteDirADDataPtr(cb,cbsite,0);
-#pragma omp simd aligned(data:64)
-			for(int j=0; j < gauge.GetSiteOffset(); ++j) {
-				data[j] = 0;
-			}
-		}
-	}
+#pragma omp parallel
+	{
+		IndexType min_site, max_site;
+		partition.GetMySiteRange(min_site, max_site);
+
+		for(int cb=0; cb < n_checkerboard; ++cb ) {
+			for(int cbsite=min_site; cbsite < max_site; ++cbsite) {
+
+				// diag_data and inv diag_data
+				float* diag = gauge.GetSiteDiagDataPtr(cb,cbsite);
+				float* invdiag = gauge.GetSiteInvDiagDataPtr(cb,cbsite);
+#pragma omp simd aligned(diag,invdiag:64)
+				for(int j=0; j < link_offset; ++j) {
+					diag[j] = 0;
+					invdiag[j] = 0;
+				}
 
-	// DA_data
-#pragma omp parallel for collapse(2)
-	for(int cb=0; cb < n_checkerboard; ++cb ) {
-		for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
-			float* data = gauge.GetSiteDirDADataPtr(cb,cbsite,0);
-#pragma omp simd aligned(data:64)
-			for(int j=0; j < gauge.GetSiteOffset(); ++j) {
-				data[j] = 0;
+				// offdiag_data, AD_data and DA_data
+				float* offdiag = gauge.GetSiteDirDataPtr(cb,cbsite,0);
+				float* ad = gauge.GetSiteDirADDataPtr(cb,cbsite,0);
+				float* da = gauge.GetSiteDirDADataPtr(cb,cbsite,0);
+#pragma omp simd aligned(offdiag,ad,da:64)
+				for(int j=0; j < site_offset; ++j) {
+					offdiag[j] = 0;
+					ad[j] = 0;
+					da[j] = 0;
+				}
 			}
 		}
-	}
+	} // End of Parallel region
 
 }
 
 
 };
-
-
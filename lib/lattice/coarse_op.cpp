@@ -5,9 +5,12 @@
 
 #include "lattice/coarse/coarse_op.h"
 #include "lattice/cmat_mult.h"
+#include "lattice/coarse/coarse_precision.h"
 #include "utils/memory.h"
 #include "utils/print_utils.h"
 #include <complex>
+#include <cstdlib>
+#include <algorithm>
 
 // #include <immintrin.h>
 
@@ -15,6 +18,76 @@
 #include "lattice/geometry_utils.h"
 namespace MG {
 
+namespace {
+
+	/* Room for the 8 links of a site, for a thread to expand the links of a gauge
+	 * field with 16 bit links into. It lives as long as the thread and grows as needed.
+	 * Not from MemoryAllocate: that may be finalized before the master thread exits.
+	 */
+	class SiteLinkBuffer {
+	public:
+		~SiteLinkBuffer() { std::free(_data); }
+
+		float* get(IndexType n_floats)
+		{
+			if( n_floats > _n_floats ) {
+				std::free(_data);
+				void* ptr = nullptr;
+				if( posix_memalign(&ptr, MG::GetMemoryAlignment(), n_floats*sizeof(float)) != 0 ) {
+					MasterLog(ERROR, "SiteLinkBuffer: failed to allocate %d floats", n_floats);
+				}
+				_data = static_cast<float*>(ptr);
+				_n_floats = n_floats;
+			}
+			return _data;
+		}
+
+	private:
+		float* _data = nullptr;
+		IndexType _n_floats = 0;
+	};
+
+	thread_local SiteLinkBuffer site_link_buffer;
+
+	// The 8 links of a site in FP32: the FP32 links themselves, or the 16 bit
+	// links expanded into the buffer of the thread. Valid until the next call.
+	inline
+	const float* expandSiteLinks(const CoarseGauge& gauge, const uint16_t* half_links)
+	{
+		const IndexType n_floats = 8*gauge.GetLinkOffset();
+		float* buffer = site_link_buffer.get(n_floats);
+		ConvertFromHalf(buffer, half_links, n_floats, gauge.GetLinkPrecision());
+		return buffer;
+	}
+
+	inline
+	const float* getSiteLinks(const CoarseGauge& gauge, IndexType cb, IndexType site)
+	{
+		if( gauge.GetLinkPrecision() == COARSE_PREC_FP32 ) {
+			return gauge.GetSiteDirDataPtr(cb,site,0);
+		}
+		return expandSiteLinks(gauge, gauge.GetSiteDirHalfDataPtr(cb,site,0));
+	}
+
+	inline
+	const float* getSiteADLinks(const CoarseGauge& gauge, IndexType cb, IndexType site)
+	{
+		if( gauge.GetLinkPrecision() == COARSE_PREC_FP32 ) {
+			return gauge.GetSiteDirADDataPtr(cb,site,0);
+		}
+		return expandSiteLinks(gauge, gauge.GetSiteDirHalfADDataPtr(cb,site,0));
+	}
+
+	inline
+	const float* getSiteDALinks(const CoarseGauge& gauge, IndexType cb, IndexType site)
+	{
+		if( gauge.GetLinkPrecision() == COARSE_PREC_FP32 ) {
+			return gauge.GetSiteDirDADataPtr(cb,site,0);
+		}
+		return expandSiteLinks(gauge, gauge.GetSiteDirHalfDADataPtr(cb,site,0));
+	}
+}
+
 template<int N_colorspin, typename InitOp>
 void genericSiteOffDiagXPayz(float *output,
 		const float alpha,
@@ -75,6 +148,72 @@ void genericSiteGcOffDiagGcXPayz(float *output,
 }
 
 
+/* unprecOp at one site for a tile of up to multi_op_tile vectors. The 9 site
+ * matrices (clover, then the 8 links) are column major, as for CMatMult.
+ * The inputs of the tile are transposed to [colorspin][vector] so that each
+ * matrix element is loaded once per tile and the inner loop, over the vectors,
+ * vectorizes. For the dagger, Gc A Gc flips the sign of the off diagonal spin blocks.
+ */
+static constexpr int multi_op_tile = 8;
+
+template<int N_colorspin>
+void genericSiteUnprecOpMulti(float* const outputs[],
+		const float* const matrices[9],
+		const float* const inputs[][9],
+		const int n_vecs,
+		const IndexType dagger)
+{
+	constexpr int T = multi_op_tile;
+	constexpr int N_half = N_colorspin/2;
+
+	alignas(64) float y_re[N_colorspin][T];
+	alignas(64) float y_im[N_colorspin][T];
+	alignas(64) float x_re[N_colorspin][T];
+	alignas(64) float x_im[N_colorspin][T];
+
+	for(int row=0; row < N_colorspin; ++row) {
+		for(int v=0; v < T; ++v) {
+			y_re[row][v] = 0;
+			y_im[row][v] = 0;
+		}
+	}
+
+	for(int m=0; m < 9; ++m) {
+		for(int col=0; col < N_colorspin; ++col) {
+			for(int v=0; v < T; ++v) {
+				x_re[col][v] = (v < n_vecs) ? inputs[v][m][ RE + n_complex*col ] : 0;
+				x_im[col][v] = (v < n_vecs) ? inputs[v][m][ IM + n_complex*col ] : 0;
+			}
+		}
+
+		const float* A = matrices[m];
+		for(int col=0; col < N_colorspin; ++col) {
+			for(int row=0; row < N_colorspin; ++row) {
+				float a_re = A[ RE + n_complex*(row + N_colorspin*col) ];
+				float a_im = A[ IM + n_complex*(row + N_colorspin*col) ];
+				if( dagger != LINOP_OP && ( (row < N_half) != (col < N_half) ) ) {
+					a_re = -a_re;
+					a_im = -a_im;
+				}
+
+#pragma omp simd aligned(y_re,y_im,x_re,x_im:64)
+				for(int v=0; v < T; ++v) {
+					y_re[row][v] += a_re*x_re[col][v] - a_im*x_im[col][v];
+					y_im[row][v] += a_re*x_im[col][v] + a_im*x_re[col][v];
+				}
+			}
+		}
+	}
+
+	for(int v=0; v < n_vecs; ++v) {
+		for(int row=0; row < N_colorspin; ++row) {
+			outputs[v][ RE + n_complex*row ] = y_re[row][v];
+			outputs[v][ IM + n_complex*row ] = y_im[row][v];
+		}
+	}
+}
+
+
 void CoarseDiracOp::unprecOp(CoarseSpinor& spinor_out,
 			const CoarseGauge& gauge_clov_in,
 			const CoarseSpinor& spinor_in,
@@ -83,8 +222,8 @@ void CoarseDiracOp::unprecOp(CoarseSpinor& spinor_out,
 			const IndexType tid) const
 {
 
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// 	Synchronous for now -- maybe change to comms compute overlap later
 	// We are in an OMP region.
@@ -107,7 +246,7 @@ void CoarseDiracOp::unprecOp(CoarseSpinor& spinor_out,
 
 
 		float* output = spinor_out.GetSiteDataPtr(target_cb, site);
-		const float* gauge_base = gauge_clov_in.GetSiteDirDataPtr(target_cb,site,0);
+		const float* gauge_base = getSiteLinks(gauge_clov_in,target_cb,site);
 
 		const float* spinor_cb = spinor_in.GetSiteDataPtr(target_cb,site);
 		const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
@@ -171,6 +310,122 @@ void CoarseDiracOp::unprecOp(CoarseSpinor& spinor_out,
 
 
 
+void CoarseDiracOp::unprecOpMulti(CoarseSpinorSet& spinor_out,
+			const CoarseGauge& gauge_clov_in,
+			const CoarseSpinorSet& spinor_in,
+			const int n_vecs,
+			const IndexType target_cb,
+			const IndexType dagger,
+			const IndexType tid) const
+{
+	// There is one set of halo buffers. With comms, do the vectors one after the other
+	if( _halo.NumNonLocalDirs() > 0 ) {
+		for(int vec=0; vec < n_vecs; ++vec) {
+			unprecOp(spinor_out[vec], gauge_clov_in, spinor_in[vec], target_cb, dagger, tid);
+#pragma omp barrier
+		}
+		return;
+	}
+
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
+
+	// Site is output site
+	for(IndexType site=min_site; site < max_site;++site) {
+
+		IndexType tmp_yzt = site / _n_xh;
+		IndexType xcb = site - _n_xh * tmp_yzt;
+		IndexType tmp_zt = tmp_yzt / _n_y;
+		IndexType y = tmp_yzt - _n_y * tmp_zt;
+		IndexType t = tmp_zt / _n_z;
+		IndexType z = tmp_zt - _n_z * t;
+
+		const float* gauge_base = getSiteLinks(gauge_clov_in,target_cb,site);
+		const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
+		const float* clov = gauge_clov_in.GetSiteDiagDataPtr(target_cb,site);
+
+		const float *gauge_links[8]={ gauge_base,                    // X forward
+							gauge_base+gdir_offset,        // X backward
+							gauge_base+2*gdir_offset,      // Y forward
+							gauge_base+3*gdir_offset,      // Y backward
+							gauge_base+4*gdir_offset,      // Z forward
+							gauge_base+5*gdir_offset,      // Z backward
+							gauge_base+6*gdir_offset,      // T forward
+							gauge_base+7*gdir_offset };       // T backward
+
+		IndexType x = 2*xcb + ((target_cb+y+z+t)&0x1);  // Global X
+		const IndexType source_cb = 1 - target_cb;
+
+		const float* matrices[9] = { clov, gauge_links[0], gauge_links[1], gauge_links[2],
+				gauge_links[3], gauge_links[4], gauge_links[5], gauge_links[6], gauge_links[7] };
+
+		// The links of this site are loaded once per tile of vectors
+		for(int tile=0; tile < n_vecs; tile += multi_op_tile) {
+			const int n_tile = std::min(multi_op_tile, n_vecs - tile);
+
+			float* outputs[multi_op_tile];
+			const float* inputs[multi_op_tile][9];
+			for(int v=0; v < n_tile; ++v) {
+				const CoarseSpinor& in = spinor_in[tile+v];
+				outputs[v] = spinor_out[tile+v].GetSiteDataPtr(target_cb, site);
+
+				inputs[v][0] = in.GetSiteDataPtr(target_cb,site);
+				inputs[v][1] = GetNeighborXPlus<CoarseSpinor,CoarseAccessor>(_halo,in,x,y,z,t,source_cb);
+				inputs[v][2] = GetNeighborXMinus<CoarseSpinor,CoarseAccessor>(_halo,in,x,y,z,t,source_cb);
+				inputs[v][3] = GetNeighborYPlus<CoarseSpinor,CoarseAccessor>(_halo,in,xcb,y,z,t,source_cb);
+				inputs[v][4] = GetNeighborYMinus<CoarseSpinor,CoarseAccessor>(_halo,in,xcb,y,z,t,source_cb);
+				inputs[v][5] = GetNeighborZPlus<CoarseSpinor,CoarseAccessor>(_halo,in,xcb,y,z,t,source_cb);
+				inputs[v][6] = GetNeighborZMinus<CoarseSpinor,CoarseAccessor>(_halo,in,xcb,y,z,t,source_cb);
+				inputs[v][7] = GetNeighborTPlus<CoarseSpinor,CoarseAccessor>(_halo,in,xcb,y,z,t,source_cb);
+				inputs[v][8] = GetNeighborTMinus<CoarseSpinor,CoarseAccessor>(_halo,in,xcb,y,z,t,source_cb);
+			}
+
+			siteApplyMulti(outputs, matrices, inputs, n_tile, dagger);
+		}
+	}
+}
+
+void CoarseDiracOp::blockUnprecOp(float* block_out,
+			const CoarseGauge& gauge_clov_in,
+			const float* block_in,
+			const std::vector<CBSite>& sites,
+			const std::vector<int>& neighbors,
+			const IndexType dagger) const
+{
+	const int site_offset = n_complex*_n_colorspin;
+	const int num_sites = sites.size();
+	const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
+
+	// Site is output site, in block order. The links are those of the full
+	// lattice, but only the neighbours inside the block are coupled.
+	for(int i=0; i < num_sites; ++i) {
+		const IndexType cb = sites[i].cb;
+		const IndexType site = sites[i].site;
+
+		float* output = block_out + i*site_offset;
+		const float* spinor_cb = block_in + i*site_offset;
+		const float* gauge_base = getSiteLinks(gauge_clov_in,cb,site);
+		const float* clov = gauge_clov_in.GetSiteDiagDataPtr(cb,site);
+
+		const float *gauge_links[8];
+		const float *neigh_spinors[8];
+		for(int mu=0; mu < 8; ++mu) {
+			gauge_links[mu] = gauge_base + mu*gdir_offset;
+
+			const int neigh = neighbors[8*i + mu];
+			neigh_spinors[mu] = (neigh >= 0) ? block_in + neigh*site_offset : _zero_site;
+		}
+
+		siteApplyClover(output,clov,spinor_cb,dagger);
+		if( dagger == LINOP_OP) {
+			siteApplyDslash_xpayz(output, 1.0, gauge_links, output, neigh_spinors);
+		}
+		else {
+			siteApplyGcDslashGc_xpayz(output, 1.0, gauge_links, output, neigh_spinors);
+		}
+	}
+}
+
 void CoarseDiracOp::M_diag(CoarseSpinor& spinor_out,
 			const CoarseGauge& gauge_clov_in,
 			const CoarseSpinor& spinor_in,
@@ -178,8 +433,8 @@ void CoarseDiracOp::M_diag(CoarseSpinor& spinor_out,
 			const IndexType dagger,
 			const IndexType tid) const
 {
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// Site is output site
 	for(IndexType site=min_site; site < max_site;++site) {
@@ -200,8 +455,8 @@ void CoarseDiracOp::M_diagInv(CoarseSpinor& spinor_out,
 			const IndexType dagger,
 			const IndexType tid) const
 {
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// Site is output site
 	for(IndexType site=min_site; site < max_site;++site) {
@@ -225,8 +480,8 @@ void CoarseDiracOp::M_D_xpay(CoarseSpinor& spinor_out,
 			const IndexType tid) const
 {
 	const int N_colorspin = spinor_in.GetNumColorSpin();
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// 	Synchronous for now -- maybe change to comms compute overlap later
 	CommunicateHaloSyncInOMPParallel<CoarseSpinor,CoarseAccessor>(_halo,spinor_in,target_cb);
@@ -247,7 +502,7 @@ void CoarseDiracOp::M_D_xpay(CoarseSpinor& spinor_out,
 
 
 		float* output = spinor_out.GetSiteDataPtr(target_cb, site);
-		const float* gauge_base = gauge_clov_in.GetSiteDirDataPtr(target_cb,site,0);
+		const float* gauge_base = getSiteLinks(gauge_clov_in,target_cb,site);
 		const float* spinor_cb = spinor_in.GetSiteDataPtr(target_cb,site);
 		const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
 
@@ -316,8 +571,8 @@ void CoarseDiracOp::M_AD_xpayz(CoarseSpinor& spinor_out,
 			const IndexType tid) const
 {
 	const int N_colorspin = spinor_in_cb.GetNumColorSpin();
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// 	Synchronous for now -- maybe change to comms compute overlap later
 	CommunicateHaloSyncInOMPParallel<CoarseSpinor,CoarseAccessor>(_halo,spinor_in_od,target_cb);
@@ -339,8 +594,8 @@ void CoarseDiracOp::M_AD_xpayz(CoarseSpinor& spinor_out,
 
 		float* output = spinor_out.GetSiteDataPtr(target_cb, site);
 		const float* gauge_base = ((dagger == LINOP_OP) ?
-					gauge_in.GetSiteDirADDataPtr(target_cb,site,0)
-					: gauge_in.GetSiteDirDADataPtr(target_cb,site,0)) ;
+					getSiteADLinks(gauge_in,target_cb,site)
+					: getSiteDALinks(gauge_in,target_cb,site)) ;
 
 		const float* spinor_cb = spinor_in_cb.GetSiteDataPtr(target_cb,site);
 		const IndexType gdir_offset = gauge_in.GetLinkOffset();
@@ -410,8 +665,8 @@ void CoarseDiracOp::M_DA_xpayz(CoarseSpinor& spinor_out,
 			const IndexType tid) const
 {
 	const int N_colorspin = spinor_cb.GetNumColorSpin();
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// 	Synchronous for now -- maybe change to comms compute overlap later
 	CommunicateHaloSyncInOMPParallel<CoarseSpinor,CoarseAccessor>(_halo,spinor_in,target_cb);
@@ -432,8 +687,8 @@ void CoarseDiracOp::M_DA_xpayz(CoarseSpinor& spinor_out,
 
 
 		float* output = spinor_out.GetSiteDataPtr(target_cb, site);
-		const float* gauge_base = (dagger == LINOP_OP ) ? gauge_clov_in.GetSiteDirDADataPtr(target_cb,site,0) :
-				gauge_clov_in.GetSiteDirADDataPtr(target_cb,site,0);
+		const float* gauge_base = (dagger == LINOP_OP ) ? getSiteDALinks(gauge_clov_in,target_cb,site) :
+				getSiteADLinks(gauge_clov_in,target_cb,site);
 
 		const float* in_cb = spinor_cb.GetSiteDataPtr(target_cb,site);
 		const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
@@ -503,8 +758,8 @@ void CoarseDiracOp::M_AD(CoarseSpinor& spinor_out,
 			const IndexType tid) const
 {
 	const int N_colorspin = spinor_in.GetNumColorSpin();
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// 	Synchronous for now -- maybe change to comms compute overlap later
 	CommunicateHaloSyncInOMPParallel<CoarseSpinor,CoarseAccessor>(_halo,spinor_in,target_cb);
@@ -525,8 +780,8 @@ void CoarseDiracOp::M_AD(CoarseSpinor& spinor_out,
 
 
 		float* output = spinor_out.GetSiteDataPtr(target_cb, site);
-		const float* gauge_base =(dagger == LINOP_OP)? gauge_clov_in.GetSiteDirADDataPtr(target_cb,site,0)
-				: gauge_clov_in.GetSiteDirDADataPtr(target_cb,site,0);
+		const float* gauge_base =(dagger == LINOP_OP)? getSiteADLinks(gauge_clov_in,target_cb,site)
+				: getSiteDALinks(gauge_clov_in,target_cb,site);
 		const float* spinor_cb = spinor_in.GetSiteDataPtr(target_cb,site);
 		const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
 
@@ -593,8 +848,8 @@ void CoarseDiracOp::M_DA(CoarseSpinor& spinor_out,
 			const IndexType tid) const
 {
 	const int N_colorspin = spinor_in.GetNumColorSpin();
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 
 	// 	Synchronous for now -- maybe change to comms compute overlap later
 	CommunicateHaloSyncInOMPParallel<CoarseSpinor,CoarseAccessor>(_halo,spinor_in,target_cb);
@@ -615,8 +870,8 @@ void CoarseDiracOp::M_DA(CoarseSpinor& spinor_out,
 
 
 		float* output = spinor_out.GetSiteDataPtr(target_cb, site);
-		const float* gauge_base = (dagger == LINOP_OP) ? gauge_clov_in.GetSiteDirDADataPtr(target_cb,site,0)
-					: gauge_clov_in.GetSiteDirADDataPtr(target_cb,site,0);
+		const float* gauge_base = (dagger == LINOP_OP) ? getSiteDALinks(gauge_clov_in,target_cb,site)
+					: getSiteADLinks(gauge_clov_in,target_cb,site);
 		const float* spinor_cb = spinor_in.GetSiteDataPtr(target_cb,site);
 		const IndexType gdir_offset = gauge_clov_in.GetLinkOffset();
 
@@ -884,6 +1139,42 @@ void CoarseDiracOp::siteApplyClover( float* output,
 }
 
 
+inline
+void CoarseDiracOp::siteApplyMulti( float* const outputs[],
+					  const float* const matrices[9],
+					  const float* const inputs[][9],
+					  const int n_vecs,
+					  const IndexType dagger) const
+{
+	const int N_colorspin = GetNumColorSpin();
+
+	if (N_colorspin == 12 ) {
+		genericSiteUnprecOpMulti<12>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else if( N_colorspin == 16 ) {
+		genericSiteUnprecOpMulti<16>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else if( N_colorspin == 24 ) {
+		genericSiteUnprecOpMulti<24>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else if ( N_colorspin == 32 ) {
+		genericSiteUnprecOpMulti<32>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else if (N_colorspin == 48 ) {
+		genericSiteUnprecOpMulti<48>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else if (N_colorspin == 64 ) {
+		genericSiteUnprecOpMulti<64>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else if (N_colorspin == 96 ) {
+		genericSiteUnprecOpMulti<96>(outputs, matrices, inputs, n_vecs, dagger);
+	}
+	else {
+		MasterLog(ERROR, "N_colorspin = %d not supported in siteApplyMulti" , N_colorspin );
+	}
+}
+
+
 // Apply a single direction of Dslash -- used for coarsening
 void CoarseDiracOp::DslashDir(CoarseSpinor& spinor_out,
 			const CoarseGauge& gauge_in,
@@ -895,8 +1186,8 @@ void CoarseDiracOp::DslashDir(CoarseSpinor& spinor_out,
 
 	// This needs to be figured out.
 
-	IndexType min_site = _thread_limits[tid].min_site;
-	IndexType max_site = _thread_limits[tid].max_site;
+	IndexType min_site, max_site;
+	getSiteRange(tid, min_site, max_site);
 	const int N_colorspin = GetNumColorSpin();
 
 	int dir_4 = dir/2;
@@ -971,6 +1262,8 @@ CoarseDiracOp::CoarseDiracOp(const LatticeInfo& l_info, IndexType n_smt)
 	  _halo( l_info ),
 	  _tmpvec( l_info )
 {
+	const ThreadPartition& partition = GetThreadPartition(l_info);
+
 #pragma omp parallel
 	{
 #pragma omp master
@@ -1024,14 +1317,16 @@ CoarseDiracOp::CoarseDiracOp(const LatticeInfo& l_info, IndexType n_smt)
 		}
 #endif
 
-		// Find minimum and maximum site -- assume
-		// small lattice so no blocking at this point
-		// just linearly divide the sites
-		const int n_sites_cb = _lattice_info.GetNumCBSites();
-		int sites_per_core = n_sites_cb/n_cores;
-		if( n_sites_cb % n_cores != 0 ) sites_per_core++;
-		int min_site = core_id*sites_per_core;
-		int max_site = MinInt((core_id+1)*sites_per_core, n_sites_cb);
+		// Find minimum and maximum site from the shared ThreadPartition
+		// so the BLAS and the transfer operators work on the same sites as
+		// this thread. The SMT threads of a core share the sites of the core.
+		IndexType min_site, max_site;
+		if( partition.GetNumThreads() == _n_threads ) {
+			partition.GetCoreSiteRange(tid, _n_smt, min_site, max_site);
+		}
+		else {
+			ThreadPartition::SplitSites(_lattice_info.GetNumCBSites(), n_cores, core_id, min_site, max_site);
+		}
 		_thread_limits[tid].min_site = min_site;
 		_thread_limits[tid].max_site = max_site;
 
@@ -1039,6 +1334,17 @@ CoarseDiracOp::CoarseDiracOp(const LatticeInfo& l_info, IndexType n_smt)
 	} // omp parallel
 
 	Gaussian(_tmpvec);
+
+	// Stands in for the neighbours outside a block in blockUnprecOp()
+	_zero_site = (float*)MG::MemoryAllocate(n_complex*_n_colorspin*sizeof(float), MG::REGULAR);
+	for(int i=0; i < n_complex*_n_colorspin; ++i) {
+		_zero_site[i] = 0;
+	}
+}
+
+CoarseDiracOp::~CoarseDiracOp()
+{
+	MG::MemoryFree(_zero_site);
 }
 
 
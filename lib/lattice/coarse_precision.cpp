@@ -0,0 +1,152 @@
+/*
+ * coarse_precision.cpp
+ */
+
+#include "lattice/coarse/coarse_precision.h"
+#include "utils/print_utils.h"
+#include <cmath>
+#include <cstring>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace MG {
+
+namespace {
+
+	inline
+	uint32_t floatBits(float f)
+	{
+		uint32_t u;
+		std::memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	inline
+	float bitsFloat(uint32_t u)
+	{
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	inline
+	uint16_t floatToBF16(float f)
+	{
+		uint32_t x = floatBits(f);
+		if( (x & 0x7fffffff) > 0x7f800000 ) {
+			// NaN: keep it a (quiet) NaN after the truncation
+			return static_cast<uint16_t>((x >> 16) | 0x0040);
+		}
+		x += 0x7fff + ((x >> 16) & 1);
+		return static_cast<uint16_t>(x >> 16);
+	}
+
+	inline
+	uint16_t floatToFP16(float f)
+	{
+		const uint32_t x = floatBits(f);
+		const uint32_t sign = (x >> 16) & 0x8000;
+		uint32_t absx = x & 0x7fffffff;
+
+		if( absx >= 0x7f800000 ) {
+			// Inf or NaN
+			return static_cast<uint16_t>(sign | 0x7c00 | ( absx > 0x7f800000 ? 0x0200 : 0 ));
+		}
+		if( absx >= 0x477ff000 ) {
+			// Rounds to above 65504
+			return static_cast<uint16_t>(sign | 0x7c00);
+		}
+		if( absx < 0x38800000 ) {
+			// Below 2^-14: a subnormal in units of 2^-24, rounded to nearest even.
+			// A round up to 1024 gives the smallest normal, as it should.
+			const float scaled = bitsFloat(absx)*16777216.0f;
+			return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(scaled)));
+		}
+
+		// Normal: rebias the exponent from 127 to 15 and round the mantissa to 10 bits.
+		// A carry out of the mantissa correctly bumps the exponent.
+		const uint32_t mant_odd = (absx >> 13) & 1;
+		absx += 0xc8000fff + mant_odd;
+		return static_cast<uint16_t>(sign | (absx >> 13));
+	}
+
+	inline
+	float fp16ToFloat(uint16_t h)
+	{
+		const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		const uint32_t exponent = (h >> 10) & 0x1f;
+		const uint32_t mantissa = h & 0x3ff;
+
+		if( exponent == 0 ) {
+			// Zero or subnormal
+			const float value = static_cast<float>(mantissa)*(1.0f/16777216.0f);
+			return bitsFloat(floatBits(value) | sign);
+		}
+		if( exponent == 0x1f ) {
+			// Inf or NaN
+			return bitsFloat(sign | 0x7f800000 | (mantissa << 13));
+		}
+		return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+	}
+}
+
+const char* CoarsePrecisionName(CoarsePrecision prec)
+{
+	switch(prec) {
+	case COARSE_PREC_FP32:
+		return "FP32";
+	case COARSE_PREC_FP16:
+		return "FP16";
+	case COARSE_PREC_BF16:
+		return "BF16";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+void ConvertToHalf(uint16_t* out, const float* in, IndexType n, CoarsePrecision prec)
+{
+	if( prec == COARSE_PREC_BF16 ) {
+		for(IndexType i=0; i < n; ++i) {
+			out[i] = floatToBF16(in[i]);
+		}
+	}
+	else if ( prec == COARSE_PREC_FP16 ) {
+		for(IndexType i=0; i < n; ++i) {
+			out[i] = floatToFP16(in[i]);
+		}
+	}
+	else {
+		MasterLog(ERROR, "ConvertToHalf: precision %s is not a 16 bit format", CoarsePrecisionName(prec));
+	}
+}
+
+void ConvertFromHalf(float* out, const uint16_t* in, IndexType n, CoarsePrecision prec)
+{
+	if( prec == COARSE_PREC_BF16 ) {
+		// BF16 is the top half of the float
+#pragma omp simd
+		for(IndexType i=0; i < n; ++i) {
+			out[i] = bitsFloat(static_cast<uint32_t>(in[i]) << 16);
+		}
+	}
+	else if ( prec == COARSE_PREC_FP16 ) {
+		IndexType i=0;
+#ifdef __F16C__
+		for(; i+8 <= n; i+=8) {
+			const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in+i));
+			_mm256_storeu_ps(out+i, _mm256_cvtph_ps(h));
+		}
+#endif
+		for(; i < n; ++i) {
+			out[i] = fp16ToFloat(in[i]);
+		}
+	}
+	else {
+		MasterLog(ERROR, "ConvertFromHalf: precision %s is not a 16 bit format", CoarsePrecisionName(prec));
+	}
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+ * fgmresdr_restart.cpp
+ */
+
+#include "lattice/fgmresdr_restart.h"
+#include "utils/print_utils.h"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+// Eigen Dense header
+#include <Eigen/Dense>
+using namespace Eigen;
+
+namespace MG {
+
+	int FGMRESDRRestart(const std::complex<double>* Hbar_data,
+			const std::complex<double>* s_data,
+			int m,
+			int k,
+			std::complex<double>* Pz_data,
+			std::complex<double>* Pv_data,
+			std::complex<double>* R_data)
+	{
+		if( k <= 0 || k >= m ) return 0;
+
+		Map< const MatrixXcd > Hbar(Hbar_data, m+1, m);
+		Map< const VectorXcd > s(s_data, m+1);
+
+		// H_m + |h_{m+1,m}|^2 f e_m^H  with  H_m^H f = e_m
+		MatrixXcd Hm = Hbar.topRows(m);
+		VectorXcd e_m = VectorXcd::Zero(m);
+		e_m(m-1) = 1;
+
+		FullPivLU<MatrixXcd> lu( Hm.adjoint() );
+		if( ! lu.isInvertible() ) {
+			MasterLog(DEBUG, "FGMRESDRRestart: H_m is singular. Not deflating");
+			return 0;
+		}
+		VectorXcd f = lu.solve(e_m);
+
+		MatrixXcd Hharm = Hm;
+		Hharm.col(m-1) += std::norm( Hbar(m,m-1) )*f;
+
+		ComplexEigenSolver<MatrixXcd> eig(Hharm);
+		if( eig.info() != Success ) {
+			MasterLog(DEBUG, "FGMRESDRRestart: harmonic Ritz eigensolve failed. Not deflating");
+			return 0;
+		}
+
+		// The k harmonic Ritz values closest to the origin
+		std::vector<int> order(m);
+		for(int i=0; i < m; ++i) order[i] = i;
+		std::sort(order.begin(), order.end(), [&eig](int a, int b) {
+			return std::abs( eig.eigenvalues()(a) ) < std::abs( eig.eigenvalues()(b) );
+		});
+
+		// P_{k+1} = orth( [ [g_1 .. g_k; 0], s ] )
+		MatrixXcd P = MatrixXcd::Zero(m+1,k+1);
+		for(int i=0; i < k; ++i) {
+			P.col(i).head(m) = eig.eigenvectors().col( order[i] );
+		}
+		P.col(k) = s;
+
+		HouseholderQR<MatrixXcd> qr_p(P);
+		P = qr_p.householderQ()*MatrixXcd::Identity(m+1,k+1);
+
+		// Projected matrix and its QR with a real positive diagonal
+		MatrixXcd Hk = P.adjoint()*Hbar*P.topLeftCorner(m,k);
+		HouseholderQR<MatrixXcd> qr_h(Hk);
+		MatrixXcd Q = qr_h.householderQ()*MatrixXcd::Identity(k+1,k+1);
+		MatrixXcd Rk = qr_h.matrixQR().triangularView<Upper>();
+		for(int j=0; j < k; ++j) {
+			std::complex<double> r_jj = Rk(j,j);
+			if( std::abs(r_jj) == 0 ) {
+				MasterLog(DEBUG, "FGMRESDRRestart: projected H is rank deficient. Not deflating");
+				return 0;
+			}
+			std::complex<double> phase = r_jj/std::abs(r_jj);
+			Q.col(j) *= phase;
+			Rk.row(j) *= std::conj(phase);
+		}
+
+		Map< MatrixXcd > Pz(Pz_data, m, k);
+		Map< MatrixXcd > Pv(Pv_data, m+1, k+1);
+		Map< MatrixXcd > R(R_data, k+1, k);
+
+		Pz = P.topLeftCorner(m,k);
+		Pv = P*Q;
+		R = Rk;
+
+		return k;
+	}
+
+}
@@ -131,12 +131,22 @@ void SetupQDPXXToCoarseVecsIn(const SetupParams& p, std::shared_ptr<const QDPWil
                             blocked_lattice_dims,
                             2, num_vecs, NodeInfo());
 
-  coarse_level.gauge = std::make_shared<CoarseGauge>(*(coarse_level.info));
+  coarse_level.n_threads = GetLevelNumThreads(p, 1, *(coarse_level.info));
+  MasterLog(INFO, "Level 1: using %d threads", coarse_level.n_threads);
+  {
+    // First touch by the threads of the coarse level
+    ThreadTeamScope coarse_team(coarse_level.n_threads);
+    coarse_level.gauge = std::make_shared<CoarseGauge>(*(coarse_level.info));
+  }
 
 
   M_fine->generateCoarse(fine_level.blocklist, fine_level.null_vecs, *(coarse_level.gauge));
 
-  coarse_level.M = std::make_shared< const CoarseWilsonCloverLinearOperator>(coarse_level.gauge,1);
+  {
+    ThreadTeamScope coarse_team(coarse_level.n_threads);
+    SetLevelLinkPrecision(p, 1, *(coarse_level.gauge));
+    coarse_level.M = std::make_shared< const CoarseWilsonCloverLinearOperator>(coarse_level.gauge,1);
+  }
 
 }
 
@@ -1,5 +1,8 @@
 #include <lattice/coarse/invfgmres_coarse.h>
 #include <lattice/coarse/invmr_coarse.h>
+#include <lattice/coarse/invblockjacobi_coarse.h>
+#include <lattice/coarse/invdirect_coarse.h>
+#include <lattice/coarse/coarse_correction.h>
 #include <lattice/fine_qdpxx/invfgmres_qdpxx.h>
 #include <lattice/fine_qdpxx/invmr_qdpxx.h>
 #include "lattice/fine_qdpxx/mg_params_qdpxx.h"
@@ -8,6 +11,8 @@
 #include "lattice/solver.h"
 #include "lattice/fine_qdpxx/vcycle_qdpxx_coarse.h"
 #include "lattice/coarse/vcycle_coarse.h"
+#include "lattice/coarse/vcycle_additive_coarse.h"
+#include "lattice/coarse/thread_team.h"
 
 #include "utils/print_utils.h"
 
@@ -35,6 +40,7 @@ namespace MG
 		_coarse_presmoother.resize(n_levels -1); // No smoothers on bottom level
 		_coarse_postsmoother.resize(n_levels -1 );
 		_coarse_vcycle.resize(n_levels-1);
+		_adaptive_solver.resize(n_levels-1);
 
 
 
@@ -42,46 +48,109 @@ namespace MG
 		MasterLog(INFO, "Entering Coarse Level Loop");
 		for(int coarse_idx=n_levels-2; coarse_idx >= 0; --coarse_idx) {
 			MasterLog(INFO, "Coarse_idx=%d",coarse_idx);
+			// Build the level with its own team, so its temporaries are first touched by it
+			ThreadTeamScope level_team(_mg_levels.coarse_levels[coarse_idx].n_threads);
 
 			if( coarse_idx == n_levels-2) {
-				MasterLog(INFO, "Creating FGRMRES SOlver on Level %d", coarse_idx);
 
 				// Bottom level There is only a bottom solver.
-				_bottom_solver[coarse_idx] = std::make_shared< const FGMRESSolverCoarse >(
-						*(_mg_levels.coarse_levels[coarse_idx].M),
-											_vcycle_params[coarse_idx].bottom_solver_params,nullptr);
-
+				if( _vcycle_params[coarse_idx].bottom_solver_direct ) {
+					MasterLog(INFO, "Creating Direct Solver on Level %d", coarse_idx);
+					_bottom_solver[coarse_idx] = std::make_shared< const CoarseDirectSolver >(
+							*(_mg_levels.coarse_levels[coarse_idx].M),
+												_vcycle_params[coarse_idx].bottom_solver_params,nullptr);
+				}
+				else {
+					MasterLog(INFO, "Creating FGRMRES SOlver on Level %d", coarse_idx);
+					_bottom_solver[coarse_idx] = std::make_shared< const FGMRESSolverCoarse >(
+							*(_mg_levels.coarse_levels[coarse_idx].M),
+												_vcycle_params[coarse_idx].bottom_solver_params,nullptr);
+				}
 			}
 			else{
 
-				MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
-				_coarse_presmoother[coarse_idx] = std::make_shared<const MRSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
-							_vcycle_params[coarse_idx+1].pre_smoother_params);
-
-				MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
-				_coarse_postsmoother[coarse_idx] = std::make_shared<const MRSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
-						_vcycle_params[coarse_idx+1].post_smoother_params);
-
-				MasterLog(INFO, "Creating VCycle Between Levels: %d -> %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+2,coarse_idx+1);
-				_coarse_vcycle[coarse_idx] = std::make_shared< const VCycleCoarse >(
-						(*(_mg_levels.coarse_levels[coarse_idx+1].info)),
-						(_mg_levels.coarse_levels[coarse_idx].blocklist),
-						(_mg_levels.coarse_levels[coarse_idx].null_vecs),
-						(*(_mg_levels.coarse_levels[coarse_idx].M)),
-						(*(_coarse_presmoother[coarse_idx])),
-						(*(_coarse_postsmoother[coarse_idx])),
-						(*(_bottom_solver[coarse_idx+1])),
-						(_vcycle_params[coarse_idx+1].cycle_params));
+				if( _vcycle_params[coarse_idx+1].block_jacobi_smoother ) {
+					MasterLog(INFO, "Creating Block Jacobi Pre- and PostSmoothers on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					_coarse_presmoother[coarse_idx] = std::make_shared<const BlockJacobiSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
+								_vcycle_params[coarse_idx+1].pre_smoother_params);
+					_coarse_postsmoother[coarse_idx] = std::make_shared<const BlockJacobiSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
+							_vcycle_params[coarse_idx+1].post_smoother_params);
+				}
+				else if( _vcycle_params[coarse_idx+1].persistent_smoother ) {
+					MasterLog(INFO, "Creating Persistent Pre- and PostSmoothers on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					_coarse_presmoother[coarse_idx] = std::make_shared<const PersistentMRSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
+								_vcycle_params[coarse_idx+1].pre_smoother_params);
+					_coarse_postsmoother[coarse_idx] = std::make_shared<const PersistentMRSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
+							_vcycle_params[coarse_idx+1].post_smoother_params);
+				}
+				else {
+					MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					_coarse_presmoother[coarse_idx] = std::make_shared<const MRSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
+								_vcycle_params[coarse_idx+1].pre_smoother_params);
+
+					MasterLog(INFO, "Creating PreSmoother on Level %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+1);
+					_coarse_postsmoother[coarse_idx] = std::make_shared<const MRSmootherCoarse >(*(_mg_levels.coarse_levels[coarse_idx].M),
+							_vcycle_params[coarse_idx+1].post_smoother_params);
+				}
+
+				if( _vcycle_params[coarse_idx+1].additive_cycle ) {
+					MasterLog(INFO, "Creating Additive VCycle Between Levels: %d -> %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+2,coarse_idx+1);
+					_coarse_vcycle[coarse_idx] = std::make_shared< const AdditiveVCycleCoarse >(
+							(*(_mg_levels.coarse_levels[coarse_idx+1].info)),
+							(_mg_levels.coarse_levels[coarse_idx].blocklist),
+							(_mg_levels.coarse_levels[coarse_idx].null_vecs),
+							(*(_mg_levels.coarse_levels[coarse_idx].M)),
+							(*(_coarse_presmoother[coarse_idx])),
+							(*(_coarse_postsmoother[coarse_idx])),
+							(*(_bottom_solver[coarse_idx+1])),
+							(_vcycle_params[coarse_idx+1].cycle_params),
+							_vcycle_params[coarse_idx+1].additive_smoother_threads);
+				}
+				else {
+					MasterLog(INFO, "Creating VCycle Between Levels: %d -> %d using VCycleParams[%d]", coarse_idx+1, coarse_idx+2,coarse_idx+1);
+					_coarse_vcycle[coarse_idx] = std::make_shared< const VCycleCoarse >(
+							(*(_mg_levels.coarse_levels[coarse_idx+1].info)),
+							(_mg_levels.coarse_levels[coarse_idx].blocklist),
+							(_mg_levels.coarse_levels[coarse_idx].null_vecs),
+							(*(_mg_levels.coarse_levels[coarse_idx].M)),
+							(*(_coarse_presmoother[coarse_idx])),
+							(*(_coarse_postsmoother[coarse_idx])),
+							(*(_bottom_solver[coarse_idx+1])),
+							(_vcycle_params[coarse_idx+1].cycle_params));
+				}
 
 				MasterLog(INFO, "Creating Bottom Solver For level: %d, using VCycle Preconditioner from level %d", coarse_idx+1, coarse_idx+1);
-				_bottom_solver[coarse_idx] = std::make_shared< const FGMRESSolverCoarse >(
+
+				// W- and K-cycles, or nullptr for the default
+				_bottom_solver[coarse_idx] = MakeCoarseCorrection(_mg_levels.coarse_levels[coarse_idx].M,
+							vcycle_params[coarse_idx],
+							_coarse_vcycle[coarse_idx].get());
+				if( !_bottom_solver[coarse_idx] ) {
+					_bottom_solver[coarse_idx] = std::make_shared< const FGMRESSolverCoarse >(
 							*(_mg_levels.coarse_levels[coarse_idx].M),
 							vcycle_params[coarse_idx].bottom_solver_params,
 							_coarse_vcycle[coarse_idx].get());
+				}
+
 
 
+			}
 
+			// The coarse solve of cycle coarse_idx follows the residual of the solver the cycle preconditions
+			if( _vcycle_params[coarse_idx].adaptive_tolerance ) {
+				MasterLog(INFO, "Adaptive tolerance for the Bottom Solver on Level %d", coarse_idx);
+				_adaptive_solver[coarse_idx] = std::make_shared< const AdaptiveToleranceSolver<CoarseSpinor,CoarseGauge> >(
+						_bottom_solver[coarse_idx], _mg_levels.coarse_levels[coarse_idx].M->GetLevel(),
+						_vcycle_params[coarse_idx].adaptive_safety_factor,
+						_vcycle_params[coarse_idx].bottom_solver_params.RsdTarget,
+						_vcycle_params[coarse_idx].adaptive_max_rsd_target,
+						_vcycle_params[coarse_idx].bottom_solver_params.VerboseP);
+				_bottom_solver[coarse_idx] = _adaptive_solver[coarse_idx];
 			}
+
+			// The level, its smoothers and its cycle run on the team of the level
+			_bottom_solver[coarse_idx] = std::make_shared< const ThreadTeamSolver<CoarseSpinor,CoarseGauge> >(
+					_bottom_solver[coarse_idx], _mg_levels.coarse_levels[coarse_idx].n_threads);
 		}
 
 		MasterLog(INFO,"Creating Toplevel Smoothers");
@@ -108,4 +177,18 @@ namespace MG
 		return ret;
 	}
 
+	void
+	VCycleRecursiveQDPXX::SetOuterResidual(double rel_resid) const
+	{
+		_toplevel_vcycle->SetOuterResidual(rel_resid);
+	}
+
+	void
+	VCycleRecursiveQDPXX::LogAdaptiveToleranceStats() const
+	{
+		for(const auto& solver : _adaptive_solver) {
+			if( solver ) solver->LogStats();
+		}
+	}
+
 }
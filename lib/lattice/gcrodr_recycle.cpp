@@ -0,0 +1,47 @@
+/*
+ * gcrodr_recycle.cpp
+ */
+
+#include "lattice/gcrodr_recycle.h"
+#include "utils/print_utils.h"
+#include <algorithm>
+#include <vector>
+
+// Eigen Dense header
+#include <Eigen/Dense>
+using namespace Eigen;
+
+namespace MG {
+
+	int GCRODRRecycle(const std::complex<double>* M_data, int n, int k, std::complex<double>* G_data)
+	{
+		if( k <= 0 || k > n ) return 0;
+
+		Map< const MatrixXcd > M(M_data, n, n);
+
+		ComplexEigenSolver<MatrixXcd> eig(M);
+		if( eig.info() != Success ) {
+			MasterLog(DEBUG, "GCRODRRecycle: eigensolve failed. Not recycling");
+			return 0;
+		}
+
+		// Largest |1/theta| first
+		std::vector<int> order(n);
+		for(int i=0; i < n; ++i) order[i] = i;
+		std::sort(order.begin(), order.end(), [&eig](int a, int b) {
+			return std::abs( eig.eigenvalues()(a) ) > std::abs( eig.eigenvalues()(b) );
+		});
+
+		MatrixXcd G(n,k);
+		for(int i=0; i < k; ++i) {
+			G.col(i) = eig.eigenvectors().col( order[i] );
+		}
+
+		HouseholderQR<MatrixXcd> qr(G);
+		Map< MatrixXcd > G_out(G_data, n, k);
+		G_out = qr.householderQ()*MatrixXcd::Identity(n,k);
+
+		return k;
+	}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * invblockjacobi_coarse.cpp
+ */
+
+#include "lattice/coarse/invblockjacobi_coarse.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/coarse/thread_partition.h"
+#include "utils/print_utils.h"
+#include <omp.h>
+#include <complex>
+
+namespace MG {
+
+namespace {
+	const CoarseWilsonCloverLinearOperator& asUnprecOp(const LinearOperator<CoarseSpinor,CoarseGauge>& M)
+	{
+		const CoarseWilsonCloverLinearOperator* M_unprec = dynamic_cast<const CoarseWilsonCloverLinearOperator*>(&M);
+		if( M_unprec == nullptr ) {
+			MasterLog(ERROR, "BlockJacobiSmootherCoarse: level=%d needs a CoarseWilsonCloverLinearOperator", M.GetLevel());
+		}
+		return *M_unprec;
+	}
+}
+
+BlockJacobiSmootherCoarse::BlockJacobiSmootherCoarse(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
+		const LinearSolverParamsBase& params) : _M(asUnprecOp(M)), _params(static_cast<const MRSolverParams&>(params)),
+		_partition(GetThreadPartition(_M.GetInfo())) {}
+
+BlockJacobiSmootherCoarse::BlockJacobiSmootherCoarse(const std::shared_ptr<const LinearOperator<CoarseSpinor,CoarseGauge>> M_ptr,
+		const LinearSolverParamsBase& params) : _M(asUnprecOp(*M_ptr)), _params(static_cast<const MRSolverParams&>(params)),
+		_partition(GetThreadPartition(_M.GetInfo())) {}
+
+void
+BlockJacobiSmootherCoarse::operator()(CoarseSpinor& out, const CoarseSpinor& in) const
+{
+	const int level = _M.GetLevel();
+	const int n_sweeps = _params.MaxIter;
+	const float omega = _params.Omega;
+
+	if( n_sweeps < 0 ) {
+		MasterLog(ERROR,"BLOCK JACOBI: level=%d Invalid Value: MaxIter < 0 ",level);
+	}
+
+	const LatticeInfo& info = _M.GetInfo();
+	AssertCompatible(out.GetInfo(), info);
+	AssertCompatible(in.GetInfo(), info);
+
+	const CoarseDiracOp& D_op = _M.GetDiracOp();
+	const CoarseGauge& u = _M.GetGauge();
+
+	auto Ainv_in_scratch = _work.Get(info);
+	CoarseSpinor& Ainv_in = *Ainv_in_scratch;
+	auto t_scratch = _work.Get(info);
+	CoarseSpinor& t = *t_scratch;
+
+#pragma omp parallel
+	{
+		const int tid = omp_get_thread_num();
+
+		// A^{-1} b, site by site: M_AD_xpayz() below reads it on the same sites
+		D_op.M_diagInv(Ainv_in, u, in, EVEN, LINOP_OP, tid);
+		D_op.M_diagInv(Ainv_in, u, in, ODD, LINOP_OP, tid);
+
+		for(int sweep=0; sweep < n_sweeps; ++sweep) {
+			for(int cb=EVEN; cb <= ODD; ++cb) {
+				if( omega == 1.0f ) {
+					// x_cb = A^{-1} b_cb - A^{-1} D x_{1-cb}: reads only the other checkerboard
+					D_op.M_AD_xpayz(out, -1.0, u, Ainv_in, out, cb, LINOP_OP, tid);
+				}
+				else {
+					D_op.M_AD_xpayz(t, -1.0, u, Ainv_in, out, cb, LINOP_OP, tid);
+
+					// The BLAS partition need not be the sites of the operator
+#pragma omp barrier
+					// x_cb += omega ( t_cb - x_cb )
+					AxpyVecInTeam(_partition, std::complex<float>(-1,0), out, t, RB[cb]);
+					AxpyVecInTeam(_partition, std::complex<float>(omega,0), t, out, RB[cb]);
+				}
+
+				// The next half sweep reads the sites of the other threads
+#pragma omp barrier
+			}
+		}
+	} // omp parallel
+
+	if( _params.VerboseP ) {
+		CoarseSpinor& r = t;
+		_M(r, out, LINOP_OP);
+		const double norm_r = sqrt(XmyNorm2Vec(r, in));
+		const double norm_in = sqrt(Norm2Vec(in));
+		MasterLog(INFO, "BLOCK JACOBI: level=%d sweeps=%d omega=%g || r ||/|| b ||=%16.8e",
+				level, n_sweeps, _params.Omega, norm_r/norm_in);
+	}
+}
+
+}
@@ -0,0 +1,228 @@
+/*
+ * invdirect_coarse.cpp
+ */
+
+#include "lattice/coarse/invdirect_coarse.h"
+#include "lattice/geometry_utils.h"
+#include "utils/print_utils.h"
+#include "MG_config.h"
+
+#ifdef MG_QMP_COMMS
+#include <qmp.h>
+#endif
+
+#include <omp.h>
+#include <complex>
+#include <vector>
+
+// Eigen Sparse LU
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
+
+namespace MG {
+
+using DComplex = std::complex<double>;
+using SparseMatrixCD = Eigen::SparseMatrix<DComplex>;
+using VectorCD = Eigen::Matrix<DComplex, Eigen::Dynamic, 1>;
+
+struct CoarseDirectSolver::Factorization {
+	SparseMatrixCD A;
+	Eigen::SparseLU< SparseMatrixCD, Eigen::COLAMDOrdering<int> > lu;
+};
+
+CoarseDirectSolver::CoarseDirectSolver(const CoarseWilsonCloverLinearOperator& M,
+		const LinearSolverParamsBase& params,
+		const LinearSolver<CoarseSpinor,CoarseGauge>* M_prec) : _info(M.GetInfo()), _params(params), _level(M.GetLevel())
+{
+	factorize(M.GetGauge());
+}
+
+CoarseDirectSolver::CoarseDirectSolver(const std::shared_ptr<const CoarseWilsonCloverLinearOperator> M_ptr,
+		const LinearSolverParamsBase& params,
+		const LinearSolver<CoarseSpinor,CoarseGauge>* M_prec) : _info(M_ptr->GetInfo()), _params(params), _level(M_ptr->GetLevel())
+{
+	factorize(M_ptr->GetGauge());
+}
+
+CoarseDirectSolver::CoarseDirectSolver(const std::shared_ptr<const CoarseEOWilsonCloverLinearOperator> M_ptr,
+		const LinearSolverParamsBase& params,
+		const LinearSolver<CoarseSpinor,CoarseGauge>* M_prec) : _info(M_ptr->GetInfo()), _params(params), _level(M_ptr->GetLevel())
+{
+	factorize(M_ptr->GetGauge());
+}
+
+// Out of line, where Factorization is complete
+CoarseDirectSolver::~CoarseDirectSolver() {}
+
+void
+CoarseDirectSolver::allGather(const std::vector<double>& local, int n_per_site, std::vector<double>& global) const
+{
+	const int num_local_sites = _global_site.size();
+
+	// Each node fills in its own sites, so the sum over the nodes is the gather
+	global.assign(_n_global_sites*n_per_site, 0);
+#pragma omp parallel for
+	for(int s=0; s < num_local_sites; ++s) {
+		const int offset = _global_site[s]*n_per_site;
+		for(int j=0; j < n_per_site; ++j) {
+			global[offset + j] = local[s*n_per_site + j];
+		}
+	}
+
+#ifdef MG_QMP_COMMS
+	QMP_sum_double_array(global.data(), global.size());
+#endif
+}
+
+void
+CoarseDirectSolver::factorize(const CoarseGauge& u)
+{
+	const IndexArray& local_dims = _info.GetLatticeDimensions();
+	const IndexArray& origin = _info.GetLatticeOrigin();
+	const IndexArray& node_dims = _info.GetNodeInfo().NodeDims();
+	const int num_cb_sites = _info.GetNumCBSites();
+	const int N = _info.GetNumColorSpins();
+
+	IndexArray global_dims;
+	_n_global_sites = 1;
+	for(int mu=0; mu < n_dim; ++mu) {
+		global_dims[mu] = local_dims[mu]*node_dims[mu];
+		_n_global_sites *= global_dims[mu];
+	}
+
+	// The local sites in the global lattice. The local checkerboarding is the
+	// one of CoarseDiracOp, i.e. by the local coordinates
+	_global_site.resize(n_checkerboard*num_cb_sites);
+	for(int cb=0; cb < n_checkerboard; ++cb) {
+		for(int site=0; site < num_cb_sites; ++site) {
+			IndexArray coords;
+			CBIndexToCoords(site, cb, local_dims, coords);
+			for(int mu=0; mu < n_dim; ++mu) {
+				coords[mu] += origin[mu];
+			}
+			_global_site[cb*num_cb_sites + site] = CoordsToIndex(coords, global_dims);
+		}
+	}
+
+	// Row block of site s: the clover term at (s,s), and the link mu at (s, neighbor(s,mu)),
+	// with the link directions ordered as in CoarseGauge::GetSiteDirDataPtr()
+	const int num_local_sites = _global_site.size();
+	const int n_matrix = n_complex*N*N;
+	std::vector<double> local(num_local_sites*n_matrix);
+	std::vector<double> global;
+
+	std::vector< Eigen::Triplet<DComplex> > entries;
+	entries.reserve( (2*n_dim+1)*_n_global_sites*N*N );
+
+	for(int mu=0; mu <= 2*n_dim; ++mu) {
+#pragma omp parallel for
+		for(int s=0; s < num_local_sites; ++s) {
+			const int cb = s/num_cb_sites;
+			const int site = s%num_cb_sites;
+			const float* mat = ( mu < 2*n_dim ) ? u.GetSiteDirDataPtr(cb,site,mu) : u.GetSiteDiagDataPtr(cb,site);
+			for(int j=0; j < n_matrix; ++j) {
+				local[s*n_matrix + j] = mat[j];
+			}
+		}
+		allGather(local, n_matrix, global);
+
+		for(int s=0; s < _n_global_sites; ++s) {
+			IndexArray coords;
+			IndexToCoords(s, global_dims, coords);
+			if( mu < 2*n_dim ) {
+				const int dir = mu/2;
+				const int step = (mu % 2 == 0) ? 1 : global_dims[dir]-1;
+				coords[dir] = (coords[dir] + step) % global_dims[dir];
+			}
+			const int s_col = CoordsToIndex(coords, global_dims);
+
+			// The site matrices are column major
+			const double* mat = &global[s*n_matrix];
+			for(int col=0; col < N; ++col) {
+				for(int row=0; row < N; ++row) {
+					const int ij = n_complex*(row + N*col);
+					entries.emplace_back(s*N + row, s_col*N + col, DComplex(mat[ij+RE], mat[ij+IM]));
+				}
+			}
+		}
+	}
+
+	// Duplicates are summed, as the operator sums the contributions when a
+	// dimension is too short for the forward and backward neighbours to differ
+	const int n_rows = _n_global_sites*N;
+	_lu.reset(new Factorization);
+	_lu->A.resize(n_rows, n_rows);
+	_lu->A.setFromTriplets(entries.begin(), entries.end());
+	_lu->A.makeCompressed();
+
+	_lu->lu.analyzePattern(_lu->A);
+	_lu->lu.factorize(_lu->A);
+	if( _lu->lu.info() != Eigen::Success ) {
+		MasterLog(ERROR, "CoarseDirectSolver: level=%d Sparse LU factorization failed: %s",
+				_level, _lu->lu.lastErrorMessage().c_str());
+	}
+
+	if( _params.VerboseP ) {
+		MasterLog(INFO, "CoarseDirectSolver: level=%d Factorized global matrix: rows=%d nonzeros=%d nonzeros(L+U)=%d",
+				_level, n_rows, (int)_lu->A.nonZeros(),
+				(int)(_lu->lu.nnzL() + _lu->lu.nnzU()));
+	}
+}
+
+LinearSolverResults
+CoarseDirectSolver::operator()(CoarseSpinor& out, const CoarseSpinor& in, ResiduumType resid_type) const
+{
+	LinearSolverResults ret;
+	ret.resid_type = resid_type;
+
+	const int num_cb_sites = _info.GetNumCBSites();
+	const int num_local_sites = _global_site.size();
+	const int N = _info.GetNumColorSpins();
+	const int n_spinor = n_complex*N;
+
+	// Gather the right hand side onto every node
+	std::vector<double> local(num_local_sites*n_spinor);
+	std::vector<double> global;
+#pragma omp parallel for
+	for(int s=0; s < num_local_sites; ++s) {
+		const float* in_site = in.GetSiteDataPtr(s/num_cb_sites, s%num_cb_sites);
+		for(int j=0; j < n_spinor; ++j) {
+			local[s*n_spinor + j] = in_site[j];
+		}
+	}
+	allGather(local, n_spinor, global);
+
+	Eigen::Map<const VectorCD> b(reinterpret_cast<const DComplex*>(global.data()), _n_global_sites*N);
+	VectorCD x = _lu->lu.solve(b);
+	if( _lu->lu.info() != Eigen::Success ) {
+		MasterLog(ERROR, "CoarseDirectSolver: level=%d Sparse LU solve failed", _level);
+	}
+
+	// Keep the local part
+#pragma omp parallel for
+	for(int s=0; s < num_local_sites; ++s) {
+		float* out_site = out.GetSiteDataPtr(s/num_cb_sites, s%num_cb_sites);
+		const DComplex* x_site = &x(_global_site[s]*N);
+		for(int i=0; i < N; ++i) {
+			out_site[RE + n_complex*i] = x_site[i].real();
+			out_site[IM + n_complex*i] = x_site[i].imag();
+		}
+	}
+
+	// Every node has all of b and x, so no reduction is needed
+	ret.n_count = 1;
+	ret.resid = (b - _lu->A*x).norm();
+	if( resid_type == RELATIVE ) {
+		const double b_norm = b.norm();
+		if( b_norm > 0 ) ret.resid /= b_norm;
+	}
+
+	if( _params.VerboseP ) {
+		MasterLog(INFO, "CoarseDirectSolver: level=%d Done. || r ||=%16.8e (%s)",
+				_level, ret.resid, resid_type == RELATIVE ? "relative" : "absolute");
+	}
+
+	return ret;
+}
+
+}
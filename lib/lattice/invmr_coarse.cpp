@@ -12,10 +12,13 @@
 #include "lattice/mr_params.h"
 #include "lattice/coarse/coarse_types.h"
 #include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/coarse/thread_partition.h"
 
 #include "utils/print_utils.h"
 
 #include <complex>
+#include <vector>
+#include <memory>
 
 namespace MG
 {
@@ -69,6 +72,11 @@ namespace MG
  *
  *  M           Apply matrix to std::vector
  *
+ * If r_inout is given, it must hold the residual of psi on entry (chi - M psi, which is
+ * chi itself when psi is zero). The application of M to the initial guess is then skipped
+ * and the iteration works on r_inout in place, so on exit it holds the recurred residual.
+ * Chi is then only used for the residual norms when TerminateOnResidua is set.
+ *
  * @{
  */
 
@@ -83,7 +91,8 @@ InvMR_T(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
 		IndexType OpType,
 		ResiduumType resid_type,
 		bool VerboseP,
-		bool TerminateOnResidua)
+		bool TerminateOnResidua,
+		CoarseSpinor* r_inout = nullptr)
 {
 	const int level = M.GetLevel();
 	const CBSubset& subset = M.GetSubset();
@@ -124,13 +133,20 @@ InvMR_T(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
 	// ZeroVec(chi_internal);
 	CopyVec(chi_internal, chi, subset);
 
-	/*  r[0]  :=  Chi - M . Psi[0] */
-	/*  r  :=  M . Psi  */
-	M(Mr, psi, OpType);
+	std::unique_ptr<CoarseSpinor> r_own;
+	if( r_inout == nullptr ) {
+		r_own.reset(new CoarseSpinor(info));
+
+		/*  r[0]  :=  Chi - M . Psi[0] */
+		/*  r  :=  M . Psi  */
+		M(Mr, psi, OpType);
+
+		// r[s]= chi_internal - Mr;
+		XmyzVec(chi_internal,Mr,*r_own,subset);
+	}
 
-	CoarseSpinor r(info);
-	// r[s]= chi_internal - Mr;
-	XmyzVec(chi_internal,Mr,r,subset);
+	// r_inout already holds r[0] = Chi - M . Psi[0]
+	CoarseSpinor& r = ( r_inout != nullptr ) ? *r_inout : *r_own;
 
 
 	double norm_chi_internal;
@@ -289,8 +305,193 @@ MRSmootherCoarse::operator()(CoarseSpinor& out, const CoarseSpinor& in) const {
 			_params.MaxIter, LINOP_OP,  ABSOLUTE, _params.VerboseP , false );
 }
 
-}; // Namespace
+/* r is the residual of out on entry (see Smoother::SmoothAndUpdateResidual), which is
+ * what InvMR_T needs of r_inout. Chi is only used for the residual norms, which the smoother
+ * does not terminate on. */
+bool
+MRSmootherCoarse::SmoothAndUpdateResidual(CoarseSpinor& out, CoarseSpinor& r) const {
+	InvMR_T(_M, r, out, _params.Omega, _params.RsdTarget,
+			_params.MaxIter, LINOP_OP,  ABSOLUTE, _params.VerboseP , false, &r );
+	return true;
+}
+
+/* The MR smoother of InvMR_T (a fixed number of iterations) on the first n_vecs
+ * vectors of psi at once, with r_j the residual of psi_j on entry and on exit. Each
+ * iteration does one MultiApply of M and one global reduction for all the vectors,
+ * and each vector takes its own step a_j = Omega < M r_j, r_j > / || M r_j ||^2.
+ * Mr is scratch of at least n_vecs vectors.
+ */
+static
+void InvMRMultiSmooth(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
+		CoarseSpinorSet& r,
+		CoarseSpinorSet& psi,
+		CoarseSpinorSet& Mr,
+		int n_vecs,
+		const double OmegaRelax,
+		int MaxIter,
+		bool VerboseP)
+{
+	const int level = M.GetLevel();
+	const CBSubset& subset = M.GetSubset();
+
+	if( MaxIter < 0 ) {
+		MasterLog(ERROR,"MR: level=%d Invalid Value: MaxIter < 0 ",level);
+	}
+
+	const LatticeInfo& info = M.GetInfo();
+	AssertCompatible( info, r.GetInfo() );
+	AssertCompatible( info, psi.GetInfo() );
+	AssertCompatible( info, Mr.GetInfo() );
+
+	std::vector<std::complex<double>> c(n_vecs);
+	std::vector<std::complex<double>> a(n_vecs);
+	std::vector<double> d(n_vecs);
+
+	for(int k=1; k <= MaxIter; ++k) {
+		M.MultiApply(Mr, r, n_vecs, LINOP_OP);
+
+		/*  c_j = < M.r_j, r_j >,  d_j = | M.r_j |^2  */
+		InnerProductNorm2EachVec(Mr, r, n_vecs, c.data(), d.data(), subset);
+
+		// A zero residual (e.g. a zero right hand side) stays put
+		for(int j=0; j < n_vecs; ++j) {
+			a[j] = ( d[j] > 0 ) ? OmegaRelax*c[j]/d[j] : std::complex<double>(0,0);
+		}
+
+		/*  psi_j += a_j r_j,  r_j -= a_j M r_j */
+		AxpyEachVec(a.data(), r, psi, n_vecs, subset);
+		for(int j=0; j < n_vecs; ++j) {
+			a[j] = -a[j];
+		}
+		AxpyEachVec(a.data(), Mr, r, n_vecs, subset);
+
+		if( VerboseP ) {
+			MasterLog(INFO, "MR (MULTI): level=%d iter=%d n_vecs=%d",level, k, n_vecs);
+		}
+	}
+}
+
+void
+MRSmootherCoarse::MultiSmooth(CoarseSpinorSet& out, const CoarseSpinorSet& in, int n_vecs) const {
+	// r_j = in_j - M out_j, as out is the initial guess
+	const CBSubset& subset = _M.GetSubset();
+	CoarseSpinorSet& r = GetScratchSet(_multi_r, _M.GetInfo(), n_vecs);
+	CoarseSpinorSet& Mr = GetScratchSet(_multi_Mr, _M.GetInfo(), n_vecs);
+
+	// M out goes in the Mr scratch, which the MR iterations overwrite
+	_M.MultiApply(Mr, out, n_vecs, LINOP_OP);
+	for(int j=0; j < n_vecs; ++j) {
+		XmyzVec(in[j], Mr[j], r[j], subset);
+	}
+	InvMRMultiSmooth(_M, r, out, Mr, n_vecs, _params.Omega, _params.MaxIter, _params.VerboseP);
+}
+
+bool
+MRSmootherCoarse::MultiSmoothAndUpdateResidual(CoarseSpinorSet& out, CoarseSpinorSet& r, int n_vecs) const {
+	CoarseSpinorSet& Mr = GetScratchSet(_multi_Mr, _M.GetInfo(), n_vecs);
+	InvMRMultiSmooth(_M, r, out, Mr, n_vecs, _params.Omega, _params.MaxIter, _params.VerboseP);
+	return true;
+}
+
+namespace {
+	const CoarseWilsonCloverLinearOperator& asUnprecOp(const LinearOperator<CoarseSpinor,CoarseGauge>& M)
+	{
+		const CoarseWilsonCloverLinearOperator* M_unprec = dynamic_cast<const CoarseWilsonCloverLinearOperator*>(&M);
+		if( M_unprec == nullptr ) {
+			MasterLog(ERROR, "PersistentMRSmootherCoarse: level=%d needs a CoarseWilsonCloverLinearOperator", M.GetLevel());
+		}
+		return *M_unprec;
+	}
+}
+
+PersistentMRSmootherCoarse::PersistentMRSmootherCoarse(const LinearOperator<CoarseSpinor,CoarseGauge>& M,
+		const MG::LinearSolverParamsBase& params) : _M(asUnprecOp(M)), _params(static_cast<const MRSolverParams&>(params)),
+		_partition(GetThreadPartition(_M.GetInfo())) {}
+
+PersistentMRSmootherCoarse::PersistentMRSmootherCoarse(const std::shared_ptr<const LinearOperator<CoarseSpinor,CoarseGauge>> M_ptr,
+		const MG::LinearSolverParamsBase& params) : _M(asUnprecOp(*M_ptr)), _params(static_cast<const MRSolverParams&>(params)),
+		_partition(GetThreadPartition(_M.GetInfo())) {}
+
+void
+PersistentMRSmootherCoarse::operator()(CoarseSpinor& out, const CoarseSpinor& in) const {
+	const LatticeInfo& info = _M.GetInfo();
+	auto r_scratch = _work.Get(info);
+	auto Mout_scratch = _work.Get(info);
+
+	// r = in - M out
+	_M(*Mout_scratch, out, LINOP_OP);
+	XmyzVec(in, *Mout_scratch, *r_scratch);
+	smooth(out, *r_scratch);
+}
 
+bool
+PersistentMRSmootherCoarse::SmoothAndUpdateResidual(CoarseSpinor& out, CoarseSpinor& r) const {
+	smooth(out, r);
+	return true;
+}
 
+void
+PersistentMRSmootherCoarse::smooth(CoarseSpinor& out, CoarseSpinor& r) const {
+	const int level = _M.GetLevel();
+	const int n_iter = _params.MaxIter;
+	const double omega = _params.Omega;
+	const bool verboseP = _params.VerboseP;
 
+	if( n_iter < 0 ) {
+		MasterLog(ERROR,"MR: level=%d Invalid Value: MaxIter < 0 ",level);
+	}
+
+	const LatticeInfo& info = _M.GetInfo();
+	AssertCompatible(out.GetInfo(), info);
+	AssertCompatible(r.GetInfo(), info);
 
+	const ThreadPartition& partition = _partition;
+	auto Mr_scratch = _work.Get(info);
+	CoarseSpinor& Mr = *Mr_scratch;
+
+#pragma omp parallel
+	{
+#pragma omp single
+		{
+			const int n_threads = omp_get_num_threads();
+			if( !_team || _team->GetNumThreads() != n_threads ) {
+				_team.reset(new SpinTeam(n_threads));
+			}
+		} // implied barrier
+
+		SpinTeam& team = *_team;
+		const int tid = omp_get_thread_num();
+
+		for(int k=1; k <= n_iter; ++k) {
+
+			// The operator reads r on the sites of the neighbouring threads
+			if( k > 1 ) team.Barrier(tid);
+
+			/*  Mr = M * r */
+			_M.ApplyInTeam(Mr, r, LINOP_OP, tid);
+
+			/*  c = < M.r, r >,  d = | M.r | ** 2 : one reduction */
+			double sums[3];
+			std::complex<double> c = InnerProductNorm2VecInTeam(partition, Mr, r, sums[2]);
+			sums[0] = std::real(c);
+			sums[1] = std::imag(c);
+			team.Sum(tid, sums, 3);
+
+			/*  a = MRovpar * c / d, the same on every thread */
+			// A zero residual (e.g. a zero right hand side) stays put
+			std::complex<double> a = ( sums[2] > 0 ) ?
+					omega*std::complex<double>(sums[0], sums[1])/sums[2] : std::complex<double>(0,0);
+			std::complex<float> af( (float)a.real(), (float)a.imag() );
+
+			/*  Psi += a r,  r -= a M.r : the sites of this thread only */
+			AxpyVecInTeam(partition, af, r, out);
+			AxpyVecInTeam(partition, -af, Mr, r);
+
+			if( verboseP && tid == 0 ) {
+				MasterLog(INFO, "MR: level=%d iter=%d",level, k);
+			}
+		}
+	}
+}
+
+}; // Namespace
@@ -0,0 +1,197 @@
+/*
+ * invsap_coarse.cpp
+ */
+
+#include "lattice/coarse/invsap_coarse.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "utils/memory.h"
+#include "utils/print_utils.h"
+#include <omp.h>
+#include <complex>
+#include <algorithm>
+
+namespace MG {
+
+SAPSmootherCoarse::SAPSmootherCoarse(const CoarseWilsonCloverLinearOperator& M,
+		const LinearSolverParamsBase& params) : _M(M), _params(static_cast<const SAPSmootherParams&>(params))
+{
+	init();
+}
+
+SAPSmootherCoarse::SAPSmootherCoarse(const std::shared_ptr<const CoarseWilsonCloverLinearOperator> M_ptr,
+		const LinearSolverParamsBase& params) : _M(*M_ptr), _params(static_cast<const SAPSmootherParams&>(params))
+{
+	init();
+}
+
+void
+SAPSmootherCoarse::init()
+{
+	const LatticeInfo& info = _M.GetInfo();
+	const int level = _M.GetLevel();
+
+	if( _params.MaxIter <= 0 || _params.BlockMRIters <= 0 ) {
+		MasterLog(ERROR,"SAP: level=%d Invalid Value: MaxIter=%d BlockMRIters=%d",
+				level, _params.MaxIter, _params.BlockMRIters);
+	}
+
+	IndexArray block_lattice_dims;
+	IndexArray block_lattice_origin;
+	CreateBlockList(_blocklist, block_lattice_dims, block_lattice_origin,
+			info.GetLatticeDimensions(), _params.BlockDims, info.GetLatticeOrigin());
+
+	// Red-black colouring by the global block coordinates. Blocks of a colour do not
+	// touch, so their solves are independent
+	const int num_blocks = _blocklist.size();
+	_neighbors.resize(num_blocks);
+	int max_block_sites = 0;
+	for(int b=0; b < num_blocks; ++b) {
+		const IndexArray& origin = _blocklist[b].getOrigin();
+		int parity = 0;
+		for(int mu=0; mu < n_dim; ++mu) {
+			parity += origin[mu]/_params.BlockDims[mu] + block_lattice_origin[mu];
+		}
+		_colour_blocks[ parity & 1 ].push_back(b);
+
+		CreateBlockNeighborTable(_blocklist[b], _neighbors[b]);
+		max_block_sites = std::max(max_block_sites, (int)_blocklist[b].getNumSites());
+	}
+
+	_block_floats = n_complex*info.GetNumColorSpins()*max_block_sites;
+	_n_threads = omp_get_max_threads();
+	_block_r.resize(_n_threads);
+	_block_x.resize(_n_threads);
+	_block_Mr.resize(_n_threads);
+	for(int tid=0; tid < _n_threads; ++tid) {
+		_block_r[tid] = (float*)MemoryAllocate(_block_floats*sizeof(float), REGULAR);
+		_block_x[tid] = (float*)MemoryAllocate(_block_floats*sizeof(float), REGULAR);
+		_block_Mr[tid] = (float*)MemoryAllocate(_block_floats*sizeof(float), REGULAR);
+	}
+
+	if( _params.VerboseP ) {
+		MasterLog(INFO,"SAP: level=%d blocks=%d (%d red, %d black) block sites=%d",
+				level, num_blocks, GetNumBlocks(0), GetNumBlocks(1), max_block_sites);
+	}
+}
+
+SAPSmootherCoarse::~SAPSmootherCoarse()
+{
+	for(int tid=0; tid < _n_threads; ++tid) {
+		MemoryFree(_block_r[tid]);
+		MemoryFree(_block_x[tid]);
+		MemoryFree(_block_Mr[tid]);
+	}
+}
+
+void
+SAPSmootherCoarse::blockSolve(int block_idx, const CoarseSpinor& r, CoarseSpinor& out, int tid) const
+{
+	const std::vector<CBSite>& sites = _blocklist[block_idx].getCBSiteList();
+	const std::vector<int>& neighbors = _neighbors[block_idx];
+	const int num_sites = sites.size();
+	const int site_floats = n_complex*r.GetNumColorSpin();
+	const int num_floats = num_sites*site_floats;
+	const int num_complex = num_floats/n_complex;
+
+	float* res = _block_r[tid];
+	float* x = _block_x[tid];
+	float* Mr = _block_Mr[tid];
+
+	// Gather r_B, and start from x_B = 0
+	for(int i=0; i < num_sites; ++i) {
+		const float* r_site = r.GetSiteDataPtr(sites[i].cb, sites[i].site);
+#pragma omp simd
+		for(int j=0; j < site_floats; ++j) {
+			res[i*site_floats + j] = r_site[j];
+		}
+	}
+	for(int j=0; j < num_floats; ++j) {
+		x[j] = 0;
+	}
+
+	// MR on the block. The inner products are over the block only
+	for(int k=0; k < _params.BlockMRIters; ++k) {
+		_M.GetDiracOp().blockUnprecOp(Mr, _M.GetGauge(), res, sites, neighbors, LINOP_OP);
+
+		double cdot_re = 0;
+		double cdot_im = 0;
+		double norm2 = 0;
+#pragma omp simd reduction(+:cdot_re,cdot_im,norm2)
+		for(int i=0; i < num_complex; ++i) {
+			const double a_re = Mr[RE + n_complex*i];
+			const double a_im = Mr[IM + n_complex*i];
+			const double b_re = res[RE + n_complex*i];
+			const double b_im = res[IM + n_complex*i];
+			cdot_re += a_re*b_re + a_im*b_im;
+			cdot_im += a_re*b_im - a_im*b_re;
+			norm2 += a_re*a_re + a_im*a_im;
+		}
+		if( norm2 == 0 ) break;
+
+		// a = omega < M r | r > / || M r ||^2,  x += a r,  r -= a M r
+		const float a_re = _params.BlockOmega*cdot_re/norm2;
+		const float a_im = _params.BlockOmega*cdot_im/norm2;
+
+#pragma omp simd
+		for(int i=0; i < num_complex; ++i) {
+			const float r_re = res[RE + n_complex*i];
+			const float r_im = res[IM + n_complex*i];
+			const float m_re = Mr[RE + n_complex*i];
+			const float m_im = Mr[IM + n_complex*i];
+			x[RE + n_complex*i] += a_re*r_re - a_im*r_im;
+			x[IM + n_complex*i] += a_re*r_im + a_im*r_re;
+			res[RE + n_complex*i] = r_re - (a_re*m_re - a_im*m_im);
+			res[IM + n_complex*i] = r_im - (a_re*m_im + a_im*m_re);
+		}
+	}
+
+	// Scatter: out_B += x_B
+	for(int i=0; i < num_sites; ++i) {
+		float* out_site = out.GetSiteDataPtr(sites[i].cb, sites[i].site);
+#pragma omp simd
+		for(int j=0; j < site_floats; ++j) {
+			out_site[j] += x[i*site_floats + j];
+		}
+	}
+}
+
+void
+SAPSmootherCoarse::operator()(CoarseSpinor& out, const CoarseSpinor& in) const
+{
+	const LatticeInfo& info = _M.GetInfo();
+
+	CoarseSpinor r(info);
+	CoarseSpinor tmp(info);
+
+	// r = b - M x
+	_M(tmp, out, LINOP_OP);
+	XmyzVec(in, tmp, r);
+
+	for(int cycle=0; cycle < _params.MaxIter; ++cycle) {
+		for(int colour=0; colour < 2; ++colour) {
+
+			const std::vector<int>& blocks = _colour_blocks[colour];
+			const int num_blocks = blocks.size();
+
+			// Each block writes only its own sites of out, and r is only read
+#pragma omp parallel for schedule(static)
+			for(int b=0; b < num_blocks; ++b) {
+				blockSolve(blocks[b], r, out, omp_get_thread_num());
+			}
+
+			// The exchange between the colours. Not needed after the last sweep
+			if( cycle < _params.MaxIter - 1 || colour == 0 ) {
+				_M(tmp, out, LINOP_OP);
+				XmyzVec(in, tmp, r);
+			}
+		}
+
+		if( _params.VerboseP ) {
+			_M(tmp, out, LINOP_OP);
+			XmyzVec(in, tmp, r);
+			MasterLog(INFO,"SAP: level=%d cycle=%d || r ||=%16.8e", _M.GetLevel(), cycle+1, sqrt(Norm2Vec(r)));
+		}
+	}
+}
+
+}
@@ -5,10 +5,28 @@
  *      Author: bjoo
  */
 #include "lattice/mg_level_coarse.h"
+#include <algorithm>
 
 namespace MG
 {
 
+  int GetLevelNumThreads(const SetupParams& p, int level_id, const LatticeInfo& info)
+  {
+	  if( level_id < static_cast<int>(p.level_threads.size()) && p.level_threads[level_id] > 0 ) {
+		  return std::min(p.level_threads[level_id], omp_get_max_threads());
+	  }
+	  return GetAutoNumThreads(info);
+  }
+
+  void SetLevelLinkPrecision(const SetupParams& p, int level_id, CoarseGauge& u)
+  {
+	  if( level_id < static_cast<int>(p.level_link_precision.size()) ) {
+		  const CoarsePrecision prec = p.level_link_precision[level_id];
+		  MasterLog(INFO, "Level %d: storing the links in %s", level_id, CoarsePrecisionName(prec));
+		  u.SetLinkPrecision(prec);
+	  }
+  }
+
 // These need to be moved into a .cc file. Right now they are with QDPXX (shriek!!!)
   void SetupCoarseToCoarse(const SetupParams& p, std::shared_ptr< const CoarseWilsonCloverLinearOperator > M_fine, int fine_level_id,
               MGLevelCoarse& fine_level, MGLevelCoarse& coarse_level)
@@ -12,7 +12,10 @@
 #include "lattice/geometry_utils.h"
 #include "lattice/coarse/coarse_l1_blas.h"
 #include "lattice/coarse/aggregate_block_coarse.h"
+#include "lattice/cholesky_qr.h"
+#include <vector>
 #include <cassert>
+#include <algorithm>
 #include<omp.h>
 
 
@@ -20,32 +23,102 @@
 namespace MG {
 
 
-// Implementation -- where possible call the site versions
+// Implementation
+//
+// QPhiX spinors are stored as arrays of FourSpinorBlocks: FT[color][spin][cmpx][QPHIX_SOALEN]
+// where checkerboarded site 'site' lives in block site/QPHIX_SOALEN at lane site % QPHIX_SOALEN.
+// The kernels below take a pointer to each FourSpinorBlock and run SIMD over the lanes.
+//
+// The sites of a Block are generally not aligned to the SOA blocks, so for the block kernels
+// we first sort the sites of the block into SOA chunks, each with a mask of the lanes belonging
+// to the block, and work on the masked lanes only. Lanes outside the mask are never written,
+// since they may belong to a block being worked on by another thread.
+
+namespace {
+
+  // Offset of a (spin,color,cmpx) component within a FourSpinorBlock
+  inline
+  int soaOffset(int spin, int color, int cmpx)
+  {
+    return ((color*4 + spin)*n_complex + cmpx)*QPHIX_SOALEN;
+  }
+
+  template<typename FT>
+  inline
+  FT* soaBlockPtr(QPhiXSpinorT<FT>& v, int cb, int osite)
+  {
+    return &v(cb, osite*QPHIX_SOALEN, 0, 0, RE);
+  }
+
+  template<typename FT>
+  inline
+  const FT* soaBlockPtr(const QPhiXSpinorT<FT>& v, int cb, int osite)
+  {
+    return &v(cb, osite*QPHIX_SOALEN, 0, 0, RE);
+  }
+
+  // An SOA block touched by a Block: lane isite belongs to the Block iff mask[isite]==1
+  struct SOAChunk {
+    int cb;
+    int osite;
+    int mask[QPHIX_SOALEN];
+  };
+
+  // Sort the sites of a block into SOA chunks
+  std::vector<SOAChunk> getSOAChunks(const Block& block)
+  {
+    std::vector<CBSite> sites = block.getCBSiteList();
+    std::sort(sites.begin(), sites.end(), [](const CBSite& l, const CBSite& r) {
+      return (l.cb < r.cb) || ( (l.cb == r.cb) && (l.site < r.site) );
+    });
+
+    std::vector<SOAChunk> chunks;
+    for(const CBSite& s : sites) {
+      const int osite = s.site / QPHIX_SOALEN;
+      if( chunks.empty() || chunks.back().cb != s.cb || chunks.back().osite != osite ) {
+        SOAChunk c;
+        c.cb = s.cb;
+        c.osite = osite;
+        for(int i=0; i < QPHIX_SOALEN; ++i) c.mask[i] = 0;
+        chunks.push_back(c);
+      }
+      chunks.back().mask[ s.site % QPHIX_SOALEN ] = 1;
+    }
+    return chunks;
+  }
+}
+
 //! v *= alpha (alpha is real) over and aggregate in a block, v is a QDP++ Lattice Fermion
-template<typename QT>
+template<typename FT>
 inline
-void axBlockAggrT(const double alpha, QT& v, const Block& block, int aggr)
+void axBlockAggrT(const double alpha, QPhiXSpinorT<FT>& v, const Block& block, int aggr)
 {
-  auto block_sitelist = block.getCBSiteList();
-  int num_sites = block.getNumSites();
-  const LatticeInfo& info = v.GetInfo();
-
-  const int num_color = info.GetNumColors();
+  const std::vector<SOAChunk> chunks = getSOAChunks(block);
+  const int num_chunks = chunks.size();
 
   const int min_spin = 2*aggr;
   const int max_spin = min_spin + 2;
+  const FT a = alpha;
 
-//#pragma omp parallel for
-  for(int site=0; site < num_sites; ++site) {
+#pragma omp parallel for
+  for(int chunk=0; chunk < num_chunks; ++chunk) {
+    const SOAChunk& c = chunks[chunk];
+    FT* v_block = soaBlockPtr(v, c.cb, c.osite);
 
-    const CBSite& cbsite = block_sitelist[site];
     for(int spin=min_spin; spin < max_spin; ++spin) {
       for(int color=0; color < 3; color++) {
-        v(cbsite.cb, cbsite.site, spin,color, RE) *= alpha;
-        v(cbsite.cb, cbsite.site, spin,color, IM) *= alpha;
+        FT* vr = v_block + soaOffset(spin,color,RE);
+        FT* vi = v_block + soaOffset(spin,color,IM);
+#pragma omp simd
+        for(int isite=0; isite < QPHIX_SOALEN; ++isite) {
+          if( c.mask[isite] ) {
+            vr[isite] *= a;
+            vi[isite] *= a;
+          }
+        }
       } // color
     } // spin
-  } // site
+  } // chunk
 }
 
 
@@ -61,33 +134,39 @@ void axBlockAggr(const double alpha, QPhiXSpinorF& v, const Block& block, int ag
 
 
 //! y += alpha * x (alpha is complex) over aggregate in a block, x, y are QDP++ LatticeFermions;
-template<typename QS>
+template<typename FT>
 inline
-void caxpyBlockAggrT(const std::complex<double>& alpha, const QS& x, QS& y,  const Block& block, int aggr)
+void caxpyBlockAggrT(const std::complex<double>& alpha, const QPhiXSpinorT<FT>& x, QPhiXSpinorT<FT>& y,  const Block& block, int aggr)
 {
-
-  auto block_sitelist = block.getCBSiteList();
-  int num_sites = block.getNumSites();
-
   AssertCompatible( x.GetInfo(), y.GetInfo() );
 
-  const LatticeInfo& info = y.GetInfo();
+  const std::vector<SOAChunk> chunks = getSOAChunks(block);
+  const int num_chunks = chunks.size();
 
   const int min_spin = 2*aggr;
   const int max_spin = min_spin + 2;
+  const FT ar = real(alpha);
+  const FT ai = imag(alpha);
 
-// #pragma omp parallel for
-  for(int site=0; site < num_sites; ++site) {
-    const CBSite& cbsite = block_sitelist[site];
+#pragma omp parallel for
+  for(int chunk=0; chunk < num_chunks; ++chunk) {
+    const SOAChunk& c = chunks[chunk];
+    const FT* x_block = soaBlockPtr(x, c.cb, c.osite);
+    FT* y_block = soaBlockPtr(y, c.cb, c.osite);
 
     for(int spin = min_spin; spin < max_spin; ++spin) {
       for(int color=0; color < 3; ++color ) {
-        double ar = real(alpha);
-        double ai = imag(alpha);
-        double xr = x(cbsite.cb, cbsite.site, spin,color, RE);
-        double xi = x(cbsite.cb, cbsite.site, spin,color, IM);
-        y(cbsite.cb, cbsite.site, spin, color, RE) += ar*xr - ai*xi;
-        y(cbsite.cb, cbsite.site, spin, color, IM) += ar*xi + ai*xr;
+        const FT* xr = x_block + soaOffset(spin,color,RE);
+        const FT* xi = x_block + soaOffset(spin,color,IM);
+        FT* yr = y_block + soaOffset(spin,color,RE);
+        FT* yi = y_block + soaOffset(spin,color,IM);
+#pragma omp simd
+        for(int isite=0; isite < QPHIX_SOALEN; ++isite) {
+          if( c.mask[isite] ) {
+            yr[isite] += ar*xr[isite] - ai*xi[isite];
+            yi[isite] += ar*xi[isite] + ai*xr[isite];
+          }
+        }
       }
     }
   }
@@ -104,29 +183,32 @@ void caxpyBlockAggr(const std::complex<double>& alpha, const QPhiXSpinor& x, QPh
 }
 
 //! return || v ||^2 over an aggregate in a block, v is a QDP++ LatticeFermion
-template<typename QS>
+template<typename FT>
 inline
-double norm2BlockAggrT(const QS& v, const Block& block, int aggr)
+double norm2BlockAggrT(const QPhiXSpinorT<FT>& v, const Block& block, int aggr)
 {
-  auto block_sitelist = block.getCBSiteList();
-  int num_sites = block.getNumSites();
+  const std::vector<SOAChunk> chunks = getSOAChunks(block);
+  const int num_chunks = chunks.size();
 
-  const LatticeInfo& info = v.GetInfo();
   const int min_spin = 2*aggr;
   const int max_spin = min_spin+2;
 
   double block_sum=0;
 
+#pragma omp parallel for reduction(+:block_sum)
+  for(int chunk=0; chunk < num_chunks; ++chunk) {
+    const SOAChunk& c = chunks[chunk];
+    const FT* v_block = soaBlockPtr(v, c.cb, c.osite);
 
-//#pragma omp parallel for reduction(+:block_sum)
-  for(int site=0; site < num_sites; ++site) {
-    const CBSite& cbsite = block_sitelist[site];
     for(int spin=min_spin; spin < max_spin; ++spin) {
       for(int color=0; color < 3; ++color) {
-        double vr = v(cbsite.cb, cbsite.site, spin, color, RE);
-        double vi = v(cbsite.cb, cbsite.site, spin, color, IM);
-
-        block_sum += vr*vr + vi*vi;
+        const FT* vr = v_block + soaOffset(spin,color,RE);
+        const FT* vi = v_block + soaOffset(spin,color,IM);
+#pragma omp simd reduction(+:block_sum)
+        for(int isite=0; isite < QPHIX_SOALEN; ++isite) {
+          const double m = c.mask[isite];
+          block_sum += m*( (double)vr[isite]*(double)vr[isite] + (double)vi[isite]*(double)vi[isite] );
+        }
       }
     }
   }
@@ -145,40 +227,47 @@ double norm2BlockAggr(const QPhiXSpinorF& v, const Block& block, int aggr)
 }
 
 //! return < left | right > = sum left^\dagger_i * right_i for an aggregate, over a block
-template<typename QS>
+template<typename FT>
 inline
 std::complex<double>
-innerProductBlockAggrT(const QS& left, const QS& right, const Block& block, int aggr)
+innerProductBlockAggrT(const QPhiXSpinorT<FT>& left, const QPhiXSpinorT<FT>& right, const Block& block, int aggr)
 {
-
-  auto block_sitelist = block.getCBSiteList();
-  int num_sites = block.getNumSites();
-
   AssertCompatible( left.GetInfo(), right.GetInfo() );
 
-  const LatticeInfo& info = right.GetInfo();
+  const std::vector<SOAChunk> chunks = getSOAChunks(block);
+  const int num_chunks = chunks.size();
+
   const int min_spin = 2*aggr;
   const int max_spin = min_spin + 2;
 
   double real_part=0;
   double imag_part=0;
 
-//#pragma omp parallel for reduction(+:real_part) reduction(+:imag_part)
-  for(int site=0; site < num_sites; ++site) {
+#pragma omp parallel for reduction(+:real_part) reduction(+:imag_part)
+  for(int chunk=0; chunk < num_chunks; ++chunk) {
+    const SOAChunk& c = chunks[chunk];
+    const FT* l_block = soaBlockPtr(left, c.cb, c.osite);
+    const FT* r_block = soaBlockPtr(right, c.cb, c.osite);
 
-    const CBSite& cbsite = block_sitelist[site];
     for(int spin=min_spin; spin < max_spin; ++spin) {
-       for(int color=0; color < 3; ++color ) {
-
-         double left_r = left(cbsite.cb, cbsite.site, spin, color, RE);
-         double left_i = left(cbsite.cb, cbsite.site, spin, color, IM);
-
-         double right_r = right(cbsite.cb, cbsite.site, spin, color, RE);
-         double right_i = right(cbsite.cb, cbsite.site, spin, color, IM);
-
-         real_part +=  (left_r*right_r) + (left_i*right_i);
-         imag_part +=  (left_r*right_i) - (left_i*right_r);
-       }
+      for(int color=0; color < 3; ++color ) {
+        const FT* lr = l_block + soaOffset(spin,color,RE);
+        const FT* li = l_block + soaOffset(spin,color,IM);
+        const FT* rr = r_block + soaOffset(spin,color,RE);
+        const FT* ri = r_block + soaOffset(spin,color,IM);
+
+#pragma omp simd reduction(+:real_part) reduction(+:imag_part)
+        for(int isite=0; isite < QPHIX_SOALEN; ++isite) {
+          const double m = c.mask[isite];
+          const double left_r = lr[isite];
+          const double left_i = li[isite];
+          const double right_r = rr[isite];
+          const double right_i = ri[isite];
+
+          real_part += m*( (left_r*right_r) + (left_i*right_i) );
+          imag_part += m*( (left_r*right_i) - (left_i*right_r) );
+        }
+      }
     }
   }
 
@@ -198,29 +287,35 @@ innerProductBlockAggr(const QPhiXSpinorF& left, const QPhiXSpinorF& right, const
 }
 
 //! Extract the spins belonging to a given aggregate from QDP++ source vector src, into QDP++ target vector target
-template<typename QS>
+template<typename FT>
 inline
-void extractAggregateBlockT(QS& target, const QS& src, const Block& block, int aggr )
+void extractAggregateBlockT(QPhiXSpinorT<FT>& target, const QPhiXSpinorT<FT>& src, const Block& block, int aggr )
 {
-
-  auto block_sitelist = block.getCBSiteList();
-  int num_sites = block.getNumSites();
-
-
   const LatticeInfo& info = src.GetInfo();
   AssertCompatible( info, target.GetInfo() );
 
+  const std::vector<SOAChunk> chunks = getSOAChunks(block);
+  const int num_chunks = chunks.size();
+
   const int min_spin = 2*aggr;
   const int max_spin = min_spin + 2;
 
-//#pragma omp parallel for
-  for(int site=0; site < num_sites; ++site) {
-    const CBSite& cbsite = block_sitelist[site];
+#pragma omp parallel for
+  for(int chunk=0; chunk < num_chunks; ++chunk) {
+    const SOAChunk& c = chunks[chunk];
+    const FT* s_block = soaBlockPtr(src, c.cb, c.osite);
+    FT* t_block = soaBlockPtr(target, c.cb, c.osite);
+
     for(int spin=min_spin; spin < max_spin; ++spin) {
       for(int color=0; color < 3; ++color ) {
-        target(cbsite.cb, cbsite.site, spin, color, RE) = src(cbsite.cb, cbsite.site, spin, color, RE);
-        target(cbsite.cb, cbsite.site, spin, color, IM) = src(cbsite.cb, cbsite.site, spin, color, IM);
-
+        for(int cmpx=0; cmpx < n_complex; ++cmpx) {
+          const FT* s = s_block + soaOffset(spin,color,cmpx);
+          FT* t = t_block + soaOffset(spin,color,cmpx);
+#pragma omp simd
+          for(int isite=0; isite < QPHIX_SOALEN; ++isite) {
+            if( c.mask[isite] ) t[isite] = s[isite];
+          }
+        }
       }
     }
   }
@@ -236,27 +331,32 @@ void extractAggregateBlock(QPhiXSpinorF& target, const QPhiXSpinorF& src, const
 }
 
 //! Extract the spins belonging to a given aggregate from QDP++ source vector src, into QDP++ target vector target
-template<typename QS>
+template<typename FT>
 inline
-void extractAggregateT(QS& target, const QS& src, int aggr )
+void extractAggregateT(QPhiXSpinorT<FT>& target, const QPhiXSpinorT<FT>& src, int aggr )
 {
-
-
   const LatticeInfo& info = src.GetInfo();
   AssertCompatible( info, target.GetInfo() );
   const int min_spin = 2*aggr;
   const int max_spin = min_spin + 2;
 
-  const int num_cbsites = info.GetNumCBSites();
+  const int num_soa = info.GetNumCBSites()/QPHIX_SOALEN;
 
-//#pragma omp parallel for collapse(2)
+#pragma omp parallel for collapse(2)
   for(int cb =0; cb < n_checkerboard; ++cb) {
-    for(int site=0; site < num_cbsites; ++site) {
+    for(int osite=0; osite < num_soa; ++osite) {
+      const FT* s_block = soaBlockPtr(src, cb, osite);
+      FT* t_block = soaBlockPtr(target, cb, osite);
 
       for(int spin=min_spin; spin < max_spin; ++spin) {
         for(int color=0; color < 3; ++color ) {
-          target(cb,site,spin,color,RE) = src(cb,site,spin,color,RE);
-          target(cb,site,spin,color,IM) = src(cb,site,spin,color,IM);
+          // RE and IM are adjacent in the block so copy both in one go
+          const FT* s = s_block + soaOffset(spin,color,RE);
+          FT* t = t_block + soaOffset(spin,color,RE);
+#pragma omp simd
+          for(int i=0; i < n_complex*QPHIX_SOALEN; ++i) {
+            t[i] = s[i];
+          }
         }
       }
     }
@@ -276,43 +376,60 @@ void extractAggregate(QPhiXSpinorF& target, const QPhiXSpinorF& src, int aggr )
 
 
 //! Orthonormalize vecs over the spin aggregates within the sites
+//! Each (aggregate, block) is packed into a dense (sites*6) x N matrix
+//! and orthonormalized with CholeskyQR2 (see lattice/cholesky_qr.h)
 template<typename QS>
 inline
 void orthonormalizeBlockAggregatesT(std::vector<std::shared_ptr<QS>>& vecs,
     const std::vector<Block>& block_list)
 {
-  int num_blocks = block_list.size();
+  const int num_blocks = block_list.size();
+  const int num_vecs = vecs.size();
+  const int n_per_chiral = 2*3;
 
-#pragma omp parallel for collapse(2)
+#pragma omp parallel for collapse(2) schedule(dynamic)
   for(int aggr=0; aggr < 2; ++aggr) {
 
     for(int block_id=0; block_id < num_blocks; block_id++) {
 
       const Block& block = block_list[block_id];
-
-      // This will be over blocks...
-      // do vecs[0] ... vecs[N]
-      for(IndexType curr_vec=0; curr_vec < static_cast<IndexType>(vecs.size()); curr_vec++) {
-
-        // orthogonalize against previous vectors
-        // if curr_vec == 0 this will be skipped
-        for(int prev_vec=0; prev_vec < curr_vec; prev_vec++) {
-
-          std::complex<double> iprod = innerProductBlockAggr( *(vecs[prev_vec]), *(vecs[curr_vec]), block, aggr);
-          std::complex<double> minus_iprod=std::complex<double>(-real(iprod), -imag(iprod) );
-
-          // curr_vec <- curr_vec - <curr_vec|prev_vec>*prev_vec = -iprod*prev_vec + curr_vec
-          caxpyBlockAggr( minus_iprod, *(vecs[prev_vec]), *(vecs[curr_vec]), block, aggr);
-
+      auto block_sitelist = block.getCBSiteList();
+      const int num_sites = block.getNumSites();
+      const int min_spin = 2*aggr;
+      const int n_rows = num_sites*n_per_chiral;
+
+      // Column major: V[row + n_rows*vec]
+      std::vector<std::complex<double>> V(n_rows*num_vecs);
+
+      for(int vec=0; vec < num_vecs; ++vec) {
+        const QS& v = *(vecs[vec]);
+        for(int site=0; site < num_sites; ++site) {
+          const CBSite& cbsite = block_sitelist[site];
+          for(int spin=0; spin < 2; ++spin) {
+            for(int color=0; color < 3; ++color) {
+              V[ site*n_per_chiral + 3*spin + color + n_rows*vec ] =
+                  std::complex<double>( v(cbsite.cb, cbsite.site, min_spin+spin, color, RE),
+                                        v(cbsite.cb, cbsite.site, min_spin+spin, color, IM));
+            }
+          }
         }
-
-        // Normalize current vector
-        double inv_norm = ((double)1)/sqrt(norm2BlockAggr(*(vecs[curr_vec]), block, aggr));
-
-        // vecs[curr_vec] = inv_norm * vecs[curr_vec]
-        axBlockAggr(inv_norm, *(vecs[curr_vec]), block, aggr);
       }
 
+      CholeskyQR2(V.data(), n_rows, num_vecs);
+
+      for(int vec=0; vec < num_vecs; ++vec) {
+        QS& v = *(vecs[vec]);
+        for(int site=0; site < num_sites; ++site) {
+          const CBSite& cbsite = block_sitelist[site];
+          for(int spin=0; spin < 2; ++spin) {
+            for(int color=0; color < 3; ++color) {
+              const std::complex<double>& val = V[ site*n_per_chiral + 3*spin + color + n_rows*vec ];
+              v(cbsite.cb, cbsite.site, min_spin+spin, color, RE) = std::real(val);
+              v(cbsite.cb, cbsite.site, min_spin+spin, color, IM) = std::imag(val);
+            }
+          }
+        }
+      }
 
     } // block
   }// aggregates
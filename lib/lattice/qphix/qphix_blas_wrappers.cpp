@@ -10,6 +10,8 @@
 #include "lattice/qphix/qphix_blas_wrappers.h"
 #include <qphix/blas_full_spinor.h>
 #include "lattice/coarse/subset.h"
+#include <vector>
+#include <omp.h>
 
 using namespace QPhiX;
 
@@ -235,6 +237,16 @@ void ConvertSpinor(const QPhiXSpinorF& in, QPhiXSpinor& out, const CBSubset& sub
   ConvertSpinorT(in,out,subset);
 }
 
+void ConvertSpinor(const QPhiXSpinor& in, QPhiXSpinor& out, const CBSubset& subset)
+{
+  CopyVec(out,in,subset);
+}
+
+void ConvertSpinor(const QPhiXSpinorF& in, QPhiXSpinorF& out, const CBSubset& subset)
+{
+  CopyVec(out,in,subset);
+}
+
 
 template<typename ST>
 inline
@@ -276,4 +288,454 @@ void YmeqXVec(const QPhiXSpinorF& x, QPhiXSpinorF& y,const CBSubset& subset )
 
 
 
+/* The fused steps of pipelined BiCGStab. QPhiX has no kernels for these, so they
+ * work on the SOA blocks directly: checkerboarded site 'site' is in FourSpinorBlock
+ * site/QPHIX_SOALEN, which is FT[color][spin][cmpx][QPHIX_SOALEN], and the RE and IM rows
+ * of each color-spin component are QPHIX_SOALEN apart. The reductions are summed over
+ * the threads and then over the nodes in one call.
+ */
+namespace {
+  const int n_soa_colorspin = 3*4;
+
+  template<typename FT>
+  inline
+  FT* soaBlockPtr(QPhiXSpinorT<FT>& v, int cb, int osite)
+  {
+    return &v(cb, osite*QPHIX_SOALEN, 0, 0, 0);
+  }
+
+  template<typename FT>
+  inline
+  const FT* soaBlockPtr(const QPhiXSpinorT<FT>& v, int cb, int osite)
+  {
+    return &v(cb, osite*QPHIX_SOALEN, 0, 0, 0);
+  }
+}
+
+template<typename FT>
+void PipeBiCGStabDirUpdateT(const std::complex<double>& alpha,
+    const std::complex<double>& beta,
+    const std::complex<double>& omega,
+    const QPhiXSpinorT<FT>& r, const QPhiXSpinorT<FT>& w,
+    const QPhiXSpinorT<FT>& t, const QPhiXSpinorT<FT>& v,
+    QPhiXSpinorT<FT>& p, QPhiXSpinorT<FT>& s, QPhiXSpinorT<FT>& z,
+    QPhiXSpinorT<FT>& q, QPhiXSpinorT<FT>& y,
+    std::complex<double>& y_dot_q, double& y_norm2,
+    const CBSubset& subset)
+{
+  const int num_osites = r.GetInfo().GetNumCBSites()/QPHIX_SOALEN;
+
+  const FT a_re = std::real(alpha);
+  const FT a_im = std::imag(alpha);
+  const FT b_re = std::real(beta);
+  const FT b_im = std::imag(beta);
+  const FT o_re = std::real(omega);
+  const FT o_im = std::imag(omega);
+
+  double yq_re = 0;
+  double yq_im = 0;
+  double yy = 0;
+
+  for(int cb=subset.start; cb < subset.end; ++cb) {
+#pragma omp parallel for reduction(+:yq_re,yq_im,yy)
+    for(int osite=0; osite < num_osites; ++osite) {
+      const FT* r_b = soaBlockPtr(r,cb,osite);
+      const FT* w_b = soaBlockPtr(w,cb,osite);
+      const FT* t_b = soaBlockPtr(t,cb,osite);
+      const FT* v_b = soaBlockPtr(v,cb,osite);
+      FT* p_b = soaBlockPtr(p,cb,osite);
+      FT* s_b = soaBlockPtr(s,cb,osite);
+      FT* z_b = soaBlockPtr(z,cb,osite);
+      FT* q_b = soaBlockPtr(q,cb,osite);
+      FT* y_b = soaBlockPtr(y,cb,osite);
+
+      for(int cs=0; cs < n_soa_colorspin; ++cs) {
+        const int ore = 2*cs*QPHIX_SOALEN;
+        const int oim = ore + QPHIX_SOALEN;
+
+#pragma omp simd reduction(+:yq_re,yq_im,yy)
+        for(int i=0; i < QPHIX_SOALEN; ++i) {
+          const FT s_re = s_b[ore+i];
+          const FT s_im = s_b[oim+i];
+          const FT z_re = z_b[ore+i];
+          const FT z_im = z_b[oim+i];
+
+          // p = r + beta (p - omega s)
+          FT d_re = p_b[ore+i] - (o_re*s_re - o_im*s_im);
+          FT d_im = p_b[oim+i] - (o_re*s_im + o_im*s_re);
+          p_b[ore+i] = r_b[ore+i] + b_re*d_re - b_im*d_im;
+          p_b[oim+i] = r_b[oim+i] + b_re*d_im + b_im*d_re;
+
+          // s = w + beta (s - omega z)
+          d_re = s_re - (o_re*z_re - o_im*z_im);
+          d_im = s_im - (o_re*z_im + o_im*z_re);
+          const FT sn_re = w_b[ore+i] + b_re*d_re - b_im*d_im;
+          const FT sn_im = w_b[oim+i] + b_re*d_im + b_im*d_re;
+          s_b[ore+i] = sn_re;
+          s_b[oim+i] = sn_im;
+
+          // z = t + beta (z - omega v)
+          d_re = z_re - (o_re*v_b[ore+i] - o_im*v_b[oim+i]);
+          d_im = z_im - (o_re*v_b[oim+i] + o_im*v_b[ore+i]);
+          const FT zn_re = t_b[ore+i] + b_re*d_re - b_im*d_im;
+          const FT zn_im = t_b[oim+i] + b_re*d_im + b_im*d_re;
+          z_b[ore+i] = zn_re;
+          z_b[oim+i] = zn_im;
+
+          // q = r - alpha s,  y = w - alpha z
+          const FT qn_re = r_b[ore+i] - (a_re*sn_re - a_im*sn_im);
+          const FT qn_im = r_b[oim+i] - (a_re*sn_im + a_im*sn_re);
+          q_b[ore+i] = qn_re;
+          q_b[oim+i] = qn_im;
+
+          const FT yn_re = w_b[ore+i] - (a_re*zn_re - a_im*zn_im);
+          const FT yn_im = w_b[oim+i] - (a_re*zn_im + a_im*zn_re);
+          y_b[ore+i] = yn_re;
+          y_b[oim+i] = yn_im;
+
+          yq_re += (double)yn_re*(double)qn_re + (double)yn_im*(double)qn_im;
+          yq_im += (double)yn_re*(double)qn_im - (double)yn_im*(double)qn_re;
+          yy += (double)yn_re*(double)yn_re + (double)yn_im*(double)yn_im;
+        }
+      }
+    }
+  }
+
+  double sums[3] = { yq_re, yq_im, yy };
+  QDPInternal::globalSumArray(sums,3);
+
+  y_dot_q = std::complex<double>(sums[0],sums[1]);
+  y_norm2 = sums[2];
+}
+
+template<typename FT>
+void PipeBiCGStabSolUpdateT(const std::complex<double>& alpha,
+    const std::complex<double>& omega,
+    const QPhiXSpinorT<FT>& p, const QPhiXSpinorT<FT>& q, const QPhiXSpinorT<FT>& y,
+    const QPhiXSpinorT<FT>& t, const QPhiXSpinorT<FT>& v,
+    const QPhiXSpinorT<FT>& r0, const QPhiXSpinorT<FT>& s, const QPhiXSpinorT<FT>& z,
+    QPhiXSpinorT<FT>& x, QPhiXSpinorT<FT>& r, QPhiXSpinorT<FT>& w,
+    std::complex<double>* r0_dots, double& r_norm2,
+    const CBSubset& subset)
+{
+  const int num_osites = r.GetInfo().GetNumCBSites()/QPHIX_SOALEN;
+
+  const FT a_re = std::real(alpha);
+  const FT a_im = std::imag(alpha);
+  const FT o_re = std::real(omega);
+  const FT o_im = std::imag(omega);
+
+  double r0r_re = 0, r0r_im = 0;
+  double r0w_re = 0, r0w_im = 0;
+  double r0s_re = 0, r0s_im = 0;
+  double r0z_re = 0, r0z_im = 0;
+  double rr = 0;
+
+  for(int cb=subset.start; cb < subset.end; ++cb) {
+#pragma omp parallel for reduction(+:r0r_re,r0r_im,r0w_re,r0w_im,r0s_re,r0s_im,r0z_re,r0z_im,rr)
+    for(int osite=0; osite < num_osites; ++osite) {
+      const FT* p_b = soaBlockPtr(p,cb,osite);
+      const FT* q_b = soaBlockPtr(q,cb,osite);
+      const FT* y_b = soaBlockPtr(y,cb,osite);
+      const FT* t_b = soaBlockPtr(t,cb,osite);
+      const FT* v_b = soaBlockPtr(v,cb,osite);
+      const FT* r0_b = soaBlockPtr(r0,cb,osite);
+      const FT* s_b = soaBlockPtr(s,cb,osite);
+      const FT* z_b = soaBlockPtr(z,cb,osite);
+      FT* x_b = soaBlockPtr(x,cb,osite);
+      FT* r_b = soaBlockPtr(r,cb,osite);
+      FT* w_b = soaBlockPtr(w,cb,osite);
+
+      for(int cs=0; cs < n_soa_colorspin; ++cs) {
+        const int ore = 2*cs*QPHIX_SOALEN;
+        const int oim = ore + QPHIX_SOALEN;
+
+#pragma omp simd reduction(+:r0r_re,r0r_im,r0w_re,r0w_im,r0s_re,r0s_im,r0z_re,r0z_im,rr)
+        for(int i=0; i < QPHIX_SOALEN; ++i) {
+          const FT q_re = q_b[ore+i];
+          const FT q_im = q_b[oim+i];
+          const FT y_re = y_b[ore+i];
+          const FT y_im = y_b[oim+i];
+
+          // x += alpha p + omega q
+          x_b[ore+i] += a_re*p_b[ore+i] - a_im*p_b[oim+i] + o_re*q_re - o_im*q_im;
+          x_b[oim+i] += a_re*p_b[oim+i] + a_im*p_b[ore+i] + o_re*q_im + o_im*q_re;
+
+          // r = q - omega y
+          const FT rn_re = q_re - (o_re*y_re - o_im*y_im);
+          const FT rn_im = q_im - (o_re*y_im + o_im*y_re);
+          r_b[ore+i] = rn_re;
+          r_b[oim+i] = rn_im;
+
+          // w = y - omega (t - alpha v)
+          const FT d_re = t_b[ore+i] - (a_re*v_b[ore+i] - a_im*v_b[oim+i]);
+          const FT d_im = t_b[oim+i] - (a_re*v_b[oim+i] + a_im*v_b[ore+i]);
+          const FT wn_re = y_re - (o_re*d_re - o_im*d_im);
+          const FT wn_im = y_im - (o_re*d_im + o_im*d_re);
+          w_b[ore+i] = wn_re;
+          w_b[oim+i] = wn_im;
+
+          const double h_re = r0_b[ore+i];
+          const double h_im = r0_b[oim+i];
+
+          r0r_re += h_re*rn_re + h_im*rn_im;
+          r0r_im += h_re*rn_im - h_im*rn_re;
+          r0w_re += h_re*wn_re + h_im*wn_im;
+          r0w_im += h_re*wn_im - h_im*wn_re;
+          r0s_re += h_re*s_b[ore+i] + h_im*s_b[oim+i];
+          r0s_im += h_re*s_b[oim+i] - h_im*s_b[ore+i];
+          r0z_re += h_re*z_b[ore+i] + h_im*z_b[oim+i];
+          r0z_im += h_re*z_b[oim+i] - h_im*z_b[ore+i];
+          rr += (double)rn_re*(double)rn_re + (double)rn_im*(double)rn_im;
+        }
+      }
+    }
+  }
+
+  double sums[9] = { r0r_re, r0r_im, r0w_re, r0w_im, r0s_re, r0s_im, r0z_re, r0z_im, rr };
+  QDPInternal::globalSumArray(sums,9);
+
+  for(int j=0; j < 4; ++j) {
+    r0_dots[j] = std::complex<double>(sums[2*j], sums[2*j+1]);
+  }
+  r_norm2 = sums[8];
+}
+
+template<typename FT>
+void ChebyshevUpdateT(const double a, const double b, const QPhiXSpinorT<FT>& Ad,
+    QPhiXSpinorT<FT>& d, QPhiXSpinorT<FT>& r, QPhiXSpinorT<FT>& x,
+    const CBSubset& subset)
+{
+  const int num_osites = r.GetInfo().GetNumCBSites()/QPHIX_SOALEN;
+
+  // The coefficients are real, so the RE and IM rows are treated alike
+  const int n_block_floats = 2*n_soa_colorspin*QPHIX_SOALEN;
+  const FT a_ft = a;
+  const FT b_ft = b;
+
+  for(int cb=subset.start; cb < subset.end; ++cb) {
+#pragma omp parallel for
+    for(int osite=0; osite < num_osites; ++osite) {
+      const FT* Ad_b = soaBlockPtr(Ad,cb,osite);
+      FT* d_b = soaBlockPtr(d,cb,osite);
+      FT* r_b = soaBlockPtr(r,cb,osite);
+      FT* x_b = soaBlockPtr(x,cb,osite);
+
+      // x += d,  r -= Ad,  d = a d + b r
+#pragma omp simd
+      for(int i=0; i < n_block_floats; ++i) {
+        const FT d_i = d_b[i];
+        const FT r_i = r_b[i] - Ad_b[i];
+        x_b[i] += d_i;
+        r_b[i] = r_i;
+        d_b[i] = a_ft*d_i + b_ft*r_i;
+      }
+    }
+  }
+}
+
+void PipeBiCGStabDirUpdate(const std::complex<double>& alpha, const std::complex<double>& beta,
+    const std::complex<double>& omega,
+    const QPhiXSpinor& r, const QPhiXSpinor& w, const QPhiXSpinor& t, const QPhiXSpinor& v,
+    QPhiXSpinor& p, QPhiXSpinor& s, QPhiXSpinor& z, QPhiXSpinor& q, QPhiXSpinor& y,
+    std::complex<double>& y_dot_q, double& y_norm2, const CBSubset& subset)
+{
+  PipeBiCGStabDirUpdateT(alpha,beta,omega,r,w,t,v,p,s,z,q,y,y_dot_q,y_norm2,subset);
+}
+
+void PipeBiCGStabDirUpdate(const std::complex<double>& alpha, const std::complex<double>& beta,
+    const std::complex<double>& omega,
+    const QPhiXSpinorF& r, const QPhiXSpinorF& w, const QPhiXSpinorF& t, const QPhiXSpinorF& v,
+    QPhiXSpinorF& p, QPhiXSpinorF& s, QPhiXSpinorF& z, QPhiXSpinorF& q, QPhiXSpinorF& y,
+    std::complex<double>& y_dot_q, double& y_norm2, const CBSubset& subset)
+{
+  PipeBiCGStabDirUpdateT(alpha,beta,omega,r,w,t,v,p,s,z,q,y,y_dot_q,y_norm2,subset);
+}
+
+void PipeBiCGStabSolUpdate(const std::complex<double>& alpha, const std::complex<double>& omega,
+    const QPhiXSpinor& p, const QPhiXSpinor& q, const QPhiXSpinor& y,
+    const QPhiXSpinor& t, const QPhiXSpinor& v,
+    const QPhiXSpinor& r0, const QPhiXSpinor& s, const QPhiXSpinor& z,
+    QPhiXSpinor& x, QPhiXSpinor& r, QPhiXSpinor& w,
+    std::complex<double>* r0_dots, double& r_norm2, const CBSubset& subset)
+{
+  PipeBiCGStabSolUpdateT(alpha,omega,p,q,y,t,v,r0,s,z,x,r,w,r0_dots,r_norm2,subset);
+}
+
+void PipeBiCGStabSolUpdate(const std::complex<double>& alpha, const std::complex<double>& omega,
+    const QPhiXSpinorF& p, const QPhiXSpinorF& q, const QPhiXSpinorF& y,
+    const QPhiXSpinorF& t, const QPhiXSpinorF& v,
+    const QPhiXSpinorF& r0, const QPhiXSpinorF& s, const QPhiXSpinorF& z,
+    QPhiXSpinorF& x, QPhiXSpinorF& r, QPhiXSpinorF& w,
+    std::complex<double>* r0_dots, double& r_norm2, const CBSubset& subset)
+{
+  PipeBiCGStabSolUpdateT(alpha,omega,p,q,y,t,v,r0,s,z,x,r,w,r0_dots,r_norm2,subset);
+}
+
+void ChebyshevUpdate(const double a, const double b, const QPhiXSpinor& Ad,
+    QPhiXSpinor& d, QPhiXSpinor& r, QPhiXSpinor& x, const CBSubset& subset)
+{
+  ChebyshevUpdateT(a,b,Ad,d,r,x,subset);
+}
+
+void ChebyshevUpdate(const double a, const double b, const QPhiXSpinorF& Ad,
+    QPhiXSpinorF& d, QPhiXSpinorF& r, QPhiXSpinorF& x, const CBSubset& subset)
+{
+  ChebyshevUpdateT(a,b,Ad,d,r,x,subset);
+}
+
+/* The block BLAS of the Krylov solvers, on the SOA blocks like the fused steps above.
+ * A thread takes a site block of y and runs over the blocks of all the x_j there, so y
+ * is read once from memory. Each thread keeps its own partial sums; they are added up
+ * in thread order (so the result does not depend on the timing) and then over the
+ * nodes in one call. With norm2_y non null || y ||^2 goes in the same reduction.
+ */
+template<typename FT>
+void InnerProductMultiVecT(const SpinorSet<QPhiXSpinorT<FT>>& x, int n_vecs,
+    const QPhiXSpinorT<FT>& y, std::complex<double>* iprods, double* norm2_y,
+    const CBSubset& subset)
+{
+  const int num_osites = y.GetInfo().GetNumCBSites()/QPHIX_SOALEN;
+  const int n_sums = 2*n_vecs + ( norm2_y != nullptr ? 1 : 0 );
+  std::vector<double> thread_sums(omp_get_max_threads()*n_sums, 0.0);
+
+#pragma omp parallel
+  {
+    std::vector<double> my_sums(n_sums, 0.0);
+
+    for(int cb=subset.start; cb < subset.end; ++cb) {
+#pragma omp for
+      for(int osite=0; osite < num_osites; ++osite) {
+        const FT* y_b = soaBlockPtr(y,cb,osite);
+
+        for(int j=0; j < n_vecs; ++j) {
+          const FT* x_b = soaBlockPtr(x[j],cb,osite);
+          double ip_re = 0;
+          double ip_im = 0;
+
+          for(int cs=0; cs < n_soa_colorspin; ++cs) {
+            const int ore = 2*cs*QPHIX_SOALEN;
+            const int oim = ore + QPHIX_SOALEN;
+
+#pragma omp simd reduction(+:ip_re,ip_im)
+            for(int i=0; i < QPHIX_SOALEN; ++i) {
+              const double h_re = x_b[ore+i];
+              const double h_im = x_b[oim+i];
+              ip_re += h_re*y_b[ore+i] + h_im*y_b[oim+i];
+              ip_im += h_re*y_b[oim+i] - h_im*y_b[ore+i];
+            }
+          }
+          my_sums[2*j] += ip_re;
+          my_sums[2*j+1] += ip_im;
+        }
+
+        if( norm2_y != nullptr ) {
+          double yy = 0;
+#pragma omp simd reduction(+:yy)
+          for(int i=0; i < 2*n_soa_colorspin*QPHIX_SOALEN; ++i) {
+            yy += (double)y_b[i]*(double)y_b[i];
+          }
+          my_sums[2*n_vecs] += yy;
+        }
+      }
+    }
+
+    const int tid = omp_get_thread_num();
+    for(int k=0; k < n_sums; ++k) {
+      thread_sums[tid*n_sums + k] = my_sums[k];
+    }
+  }
+
+  std::vector<double> sums(n_sums, 0.0);
+  for(int t=0; t < omp_get_max_threads(); ++t) {
+    for(int k=0; k < n_sums; ++k) {
+      sums[k] += thread_sums[t*n_sums + k];
+    }
+  }
+  QDPInternal::globalSumArray(sums.data(), n_sums);
+
+  for(int j=0; j < n_vecs; ++j) {
+    iprods[j] = std::complex<double>(sums[2*j], sums[2*j+1]);
+  }
+  if( norm2_y != nullptr ) {
+    *norm2_y = sums[2*n_vecs];
+  }
+}
+
+template<typename FT>
+void AxpyMultiVecT(const std::complex<double>* alpha, const SpinorSet<QPhiXSpinorT<FT>>& x,
+    int n_vecs, QPhiXSpinorT<FT>& y, const CBSubset& subset)
+{
+  const int num_osites = y.GetInfo().GetNumCBSites()/QPHIX_SOALEN;
+
+  std::vector<FT> a_re(n_vecs);
+  std::vector<FT> a_im(n_vecs);
+  for(int j=0; j < n_vecs; ++j) {
+    a_re[j] = std::real(alpha[j]);
+    a_im[j] = std::imag(alpha[j]);
+  }
+
+  for(int cb=subset.start; cb < subset.end; ++cb) {
+#pragma omp parallel for
+    for(int osite=0; osite < num_osites; ++osite) {
+      FT* y_b = soaBlockPtr(y,cb,osite);
+
+      for(int j=0; j < n_vecs; ++j) {
+        const FT* x_b = soaBlockPtr(x[j],cb,osite);
+        const FT ar = a_re[j];
+        const FT ai = a_im[j];
+
+        for(int cs=0; cs < n_soa_colorspin; ++cs) {
+          const int ore = 2*cs*QPHIX_SOALEN;
+          const int oim = ore + QPHIX_SOALEN;
+
+#pragma omp simd
+          for(int i=0; i < QPHIX_SOALEN; ++i) {
+            const FT x_re = x_b[ore+i];
+            const FT x_im = x_b[oim+i];
+            y_b[ore+i] += ar*x_re - ai*x_im;
+            y_b[oim+i] += ar*x_im + ai*x_re;
+          }
+        }
+      }
+    }
+  }
+}
+
+void InnerProductMultiVec(const SpinorSet<QPhiXSpinor>& x, int n_vecs, const QPhiXSpinor& y,
+    std::complex<double>* iprods, const CBSubset& subset)
+{
+  InnerProductMultiVecT(x,n_vecs,y,iprods,nullptr,subset);
+}
+
+void InnerProductMultiVec(const SpinorSet<QPhiXSpinorF>& x, int n_vecs, const QPhiXSpinorF& y,
+    std::complex<double>* iprods, const CBSubset& subset)
+{
+  InnerProductMultiVecT(x,n_vecs,y,iprods,nullptr,subset);
+}
+
+void InnerProductNorm2MultiVec(const SpinorSet<QPhiXSpinor>& x, int n_vecs, const QPhiXSpinor& y,
+    std::complex<double>* iprods, double& norm2_y, const CBSubset& subset)
+{
+  InnerProductMultiVecT(x,n_vecs,y,iprods,&norm2_y,subset);
+}
+
+void InnerProductNorm2MultiVec(const SpinorSet<QPhiXSpinorF>& x, int n_vecs, const QPhiXSpinorF& y,
+    std::complex<double>* iprods, double& norm2_y, const CBSubset& subset)
+{
+  InnerProductMultiVecT(x,n_vecs,y,iprods,&norm2_y,subset);
+}
+
+void AxpyMultiVec(const std::complex<double>* alpha, const SpinorSet<QPhiXSpinor>& x, int n_vecs,
+    QPhiXSpinor& y, const CBSubset& subset)
+{
+  AxpyMultiVecT(alpha,x,n_vecs,y,subset);
+}
+
+void AxpyMultiVec(const std::complex<double>* alpha, const SpinorSet<QPhiXSpinorF>& x, int n_vecs,
+    QPhiXSpinorF& y, const CBSubset& subset)
+{
+  AxpyMultiVecT(alpha,x,n_vecs,y,subset);
+}
+
 } // namespace
@@ -0,0 +1,78 @@
+/*
+ * thread_partition.cpp
+ */
+
+#include "lattice/coarse/thread_partition.h"
+#include "utils/print_utils.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace MG {
+
+ThreadPartition::ThreadPartition(IndexType num_cbsites, int n_threads) : _num_cbsites(num_cbsites),
+		_n_threads(n_threads), _thread_limits(n_threads > 0 ? n_threads : 0)
+{
+	if( n_threads <= 0 ) {
+		MasterLog(ERROR, "Attempting to create ThreadPartition with n_threads=%d", n_threads);
+	}
+
+	for(int tid=0; tid < _n_threads; ++tid) {
+		IndexType min_site, max_site;
+		SplitSites(_num_cbsites, _n_threads, tid, min_site, max_site);
+		_thread_limits[tid].min_site = min_site;
+		_thread_limits[tid].max_site = max_site;
+
+		// Rows of the matvec are not split by the partition
+		_thread_limits[tid].min_vrow = 0;
+		_thread_limits[tid].max_vrow = 0;
+	}
+}
+
+void ThreadPartition::GetCoreSiteRange(int tid, int n_smt, IndexType& min_site, IndexType& max_site) const
+{
+	const int core_id = tid/n_smt;
+	const int first_tid = core_id*n_smt;
+	int last_tid = first_tid + n_smt - 1;
+	if( last_tid >= _n_threads ) last_tid = _n_threads - 1;
+
+	min_site = _thread_limits[first_tid].min_site;
+	max_site = _thread_limits[last_tid].max_site;
+}
+
+const ThreadPartition& GetThreadPartition(const LatticeInfo& info)
+{
+	const IndexType num_cbsites = info.GetNumCBSites();
+	const int n_threads = omp_get_max_threads();
+	const std::pair<IndexType,int> key = std::make_pair(num_cbsites, n_threads);
+
+	// Each thread remembers the partitions it has looked up. There are a handful
+	// (one per level and team size) so a linear search is fine, and the BLAS
+	// kernels which call this on every entry do not take the lock
+	static thread_local std::vector< std::pair< std::pair<IndexType,int>, const ThreadPartition*> > my_partitions;
+	for(const auto& entry : my_partitions) {
+		if( entry.first == key ) return *(entry.second);
+	}
+
+	// Keyed on (num_cbsites, num_threads). Entries live until the end of the program,
+	// which is fine since there is a handful of lattice sizes (one per level).
+	// The lock is only taken the first time a thread looks a partition up.
+	static std::map< std::pair<IndexType,int>, std::unique_ptr<ThreadPartition> > partitions;
+	const ThreadPartition* ret_val = nullptr;
+
+#pragma omp critical(mg_thread_partition)
+	{
+		std::unique_ptr<ThreadPartition>& p = partitions[ key ];
+		if( ! p ) {
+			p.reset( new ThreadPartition(num_cbsites, n_threads) );
+		}
+		ret_val = p.get();
+	}
+
+	my_partitions.push_back( std::make_pair(key, ret_val) );
+	return *ret_val;
+}
+
+}
@@ -0,0 +1,130 @@
+/*
+ * thread_team.cpp
+ */
+
+#include "lattice/coarse/thread_team.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/nodeinfo.h"
+#include "utils/print_utils.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace MG {
+
+int GetAutoNumThreads(const LatticeInfo& info)
+{
+	const IndexType n_colorspin = info.GetNumColorSpins();
+	const IndexType work = info.GetNumSites()*n_colorspin*n_colorspin;
+
+	IndexType n_threads = work / MinCoarseWorkPerThread;
+	n_threads = std::min(n_threads, static_cast<IndexType>(omp_get_max_threads()));
+	return static_cast<int>( std::max(n_threads, static_cast<IndexType>(1)) );
+}
+
+namespace {
+	// Pauses before a waiting thread yields, a few microseconds
+	constexpr int MaxSpins = 4096;
+
+	// Tell the core we are spinning, so it frees resources for its other SMT threads
+	inline
+	void cpuRelax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#endif
+	}
+}
+
+SpinTeam::SpinTeam(int n_threads) : _n_threads(n_threads), _num_nodes(NodeInfo().NumNodes()),
+		_my_sense(n_threads > 0 ? n_threads : 0), _my_phase(n_threads > 0 ? n_threads : 0)
+{
+	if( n_threads <= 0 ) {
+		MasterLog(ERROR, "Attempting to create SpinTeam with n_threads=%d", n_threads);
+	}
+
+	_count.count.store(n_threads);
+	_sense.sense.store(false);
+	for(int tid=0; tid < _n_threads; ++tid) {
+		_my_sense[tid].value = false;
+		_my_phase[tid].value = false;
+	}
+	_slots[0].resize(_n_threads);
+	_slots[1].resize(_n_threads);
+}
+
+void SpinTeam::Barrier(int tid)
+{
+	const bool my_sense = !_my_sense[tid].value;
+	_my_sense[tid].value = my_sense;
+
+	// The last one in resets the count and releases the others
+	if( _count.count.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+		_count.count.store(_n_threads, std::memory_order_relaxed);
+		_sense.sense.store(my_sense, std::memory_order_release);
+	}
+	else {
+		// Spin for a while, then start yielding: if the team has more threads than there
+		// are cores free, the thread we wait for may need ours
+		int n_spins = 0;
+		while( _sense.sense.load(std::memory_order_acquire) != my_sense ) {
+			if( n_spins < MaxSpins ) {
+				cpuRelax();
+				++n_spins;
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	}
+}
+
+void SpinTeam::Sum(int tid, double* values, int n)
+{
+	if( n > MaxSumLength ) {
+		MasterLog(ERROR, "SpinTeam::Sum: n=%d is more than MaxSumLength=%d", n, MaxSumLength);
+	}
+
+	const int phase = _my_phase[tid].value ? 1 : 0;
+	_my_phase[tid].value = !_my_phase[tid].value;
+
+	auto& slots = _slots[phase];
+	for(int i=0; i < n; ++i) {
+		slots[tid].values[i] = values[i];
+	}
+	Barrier(tid);
+
+	if( _num_nodes == 1 ) {
+		// Every thread adds up the slots, in the same order
+		for(int i=0; i < n; ++i) {
+			double sum = 0;
+			for(int t=0; t < _n_threads; ++t) {
+				sum += slots[t].values[i];
+			}
+			values[i] = sum;
+		}
+		return;
+	}
+
+	// One thread does the global sum for the node
+	if( tid == 0 ) {
+		for(int i=0; i < n; ++i) {
+			double sum = 0;
+			for(int t=0; t < _n_threads; ++t) {
+				sum += slots[t].values[i];
+			}
+			_node_sum[phase].values[i] = sum;
+		}
+		GlobalComm::GlobalSum(_node_sum[phase].values, n);
+	}
+	Barrier(tid);
+	for(int i=0; i < n; ++i) {
+		values[i] = _node_sum[phase].values[i];
+	}
+}
+
+}
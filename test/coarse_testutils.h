@@ -0,0 +1,62 @@
+/*
+ * coarse_testutils.h
+ */
+
+#ifndef TEST_COARSE_TESTUTILS_H_
+#define TEST_COARSE_TESTUTILS_H_
+
+#include "lattice/constants.h"
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/aggregate_block_coarse.h"
+#include <random>
+
+namespace MGTesting {
+
+	/* Fill a CoarseGauge with a diagonally dominant random operator:
+	 * the clover term is diag_val * identity and the hopping links
+	 * are gaussian random numbers scaled by hop_scale. The inverse
+	 * clover and the A^{-1}D, DA^{-1} links are set up too, so the field
+	 * can be used by both the unpreconditioned and the even-odd operators.
+	 * The seed is fixed so tests are reproducible.
+	 */
+	inline
+	void FillRandomCoarseGauge(MG::CoarseGauge& u, float diag_val, float hop_scale, unsigned int seed = 1234)
+	{
+		using namespace MG;
+
+		const LatticeInfo& info = u.GetInfo();
+		const int num_cbsites = info.GetNumCBSites();
+		const int num_colorspin = u.GetNumColorSpin();
+
+		std::mt19937 engine(seed);
+		std::normal_distribution<float> normal_dist(0.0,1.0);
+
+		for(int cb=0; cb < n_checkerboard; ++cb) {
+			for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
+
+				float* diag = u.GetSiteDiagDataPtr(cb,cbsite);
+				for(int j=0; j < u.GetLinkOffset(); ++j) {
+					diag[j] = 0;
+				}
+				for(int cspin=0; cspin < num_colorspin; ++cspin) {
+					diag[ RE + n_complex*(cspin + num_colorspin*cspin) ] = diag_val;
+				}
+
+				for(int mu=0; mu < 8; ++mu) {
+					float* link = u.GetSiteDirDataPtr(cb,cbsite,mu);
+					for(int j=0; j < u.GetLinkOffset(); ++j) {
+						link[j] = hop_scale*normal_dist(engine);
+					}
+				}
+			}
+		}
+
+		invertCloverDiag(u);
+		multInvClovOffDiagLeft(u);
+		multInvClovOffDiagRight(u);
+	}
+
+}
+
+
+#endif /* TEST_COARSE_TESTUTILS_H_ */
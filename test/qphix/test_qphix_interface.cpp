@@ -600,6 +600,102 @@ TEST(QPhiXIntegration, TestQPhiXBiCGStabRelativeF)
   DiffSpinorRelative(source,Ax_qdp,1.0e-6);
 }
 
+TEST(QPhiXIntegration, TestQPhiXPipeBiCGStabRelativeF)
+{
+  // Init the lattice
+  IndexArray latdims={{8,8,8,8}};
+  initQDPXXLattice(latdims);
+  LatticeInfo info(latdims);
+
+  int t_bc = +1;
+  double m_q = 0.01;
+  double c_sw = 1.2;
+
+  multi1d<LatticeColorMatrix> u(Nd);
+  for(int mu=0; mu < Nd; ++mu) {
+    gaussian(u[mu]);
+    reunit(u[mu]);
+  }
+
+  MG::QPhiXWilsonCloverLinearOperatorF D_qphix(info, m_q,c_sw,t_bc,u);
+
+  LatticeFermion source;
+  gaussian(source);
+
+  QPhiXSpinorF source_full(info);
+  QPhiXSpinorF solution_full(info);
+  QDPSpinorToQPhiXSpinor(source,source_full);
+  ZeroVec(solution_full);
+
+  LinearSolverParamsBase params;
+  params.MaxIter = 5000;
+  params.RsdTarget= 1.0e-6;
+  params.VerboseP = true;
+
+  // The plain BiCGStab for reference
+  QPhiXSpinorF ref_solution(info);
+  ZeroVec(ref_solution);
+  BiCGStabSolverQPhiXF ref_solver(D_qphix,params);
+  LinearSolverResults ref_res = ref_solver(ref_solution, source_full);
+
+  PipeBiCGStabSolverQPhiXF solver(D_qphix,params);
+  LinearSolverResults res = solver(solution_full, source_full);
+
+  MasterLog(INFO, "BiCGStab iters=%d Pipelined BiCGStab iters=%d", ref_res.n_count, res.n_count);
+  ASSERT_LT( res.n_count, params.MaxIter );
+  EXPECT_LT( res.resid, 2*params.RsdTarget );
+
+  QPhiXSpinorF Ax(info);
+  D_qphix(Ax,solution_full,LINOP_OP);
+  LatticeFermion Ax_qdp;
+  QPhiXSpinorToQDPSpinor(Ax,Ax_qdp);
+  DiffSpinorRelative(source,Ax_qdp,2.0e-6);
+}
+
+TEST(QPhiXIntegration, TestQPhiXChebyshevSmootherF)
+{
+  // Init the lattice
+  IndexArray latdims={{8,8,8,8}};
+  initQDPXXLattice(latdims);
+  LatticeInfo info(latdims);
+
+  int t_bc = +1;
+  double m_q = 0.01;
+  double c_sw = 1.2;
+
+  multi1d<LatticeColorMatrix> u(Nd);
+  for(int mu=0; mu < Nd; ++mu) {
+    gaussian(u[mu]);
+    reunit(u[mu]);
+  }
+
+  MG::QPhiXWilsonCloverLinearOperatorF D_qphix(info, m_q,c_sw,t_bc,u);
+
+  LatticeFermion source;
+  gaussian(source);
+
+  QPhiXSpinorF source_full(info);
+  QPhiXSpinorF solution_full(info);
+  QDPSpinorToQPhiXSpinor(source,source_full);
+  ZeroVec(solution_full);
+
+  ChebyshevSmootherParams params;
+  params.MaxIter = 4;
+  params.VerboseP = true;
+  ChebyshevSmootherQPhiXF smoother(D_qphix,params);
+
+  smoother(solution_full, source_full);
+
+  // A smoother only has to reduce the residual
+  QPhiXSpinorF Ax(info);
+  QPhiXSpinorF r(info);
+  D_qphix(Ax,solution_full,LINOP_OP);
+  CopyVec(r,source_full);
+  double rel_resid = sqrt(XmyNorm2Vec(r,Ax)/Norm2Vec(source_full));
+  MasterLog(INFO, "Chebyshev smoother: || r ||/|| b ||=%16.8e", rel_resid);
+  EXPECT_LT( rel_resid, 1.0 );
+}
+
 TEST(QPhiXIntegration, QPhiXFGMRESUnprecOp)
 {
   IndexArray latdims={{8,8,8,8}};
@@ -172,6 +172,196 @@ TEST(QPhiXTestRecursiveVCycle, TestLevelSetup2Level)
 
 }
 
+TEST(QPhiXTestRecursiveVCycle, TestAdditiveCoarseVCycle)
+{
+	IndexArray latdims={{8,8,8,8}};
+	initQDPXXLattice(latdims);
+
+	IndexArray node_orig=NodeInfo().NodeCoords();
+	for(int mu=0; mu < n_dim; ++mu) node_orig[mu]*=latdims[mu];
+
+	float m_q = 0.01;
+	float c_sw = 1.25;
+	int t_bc=-1; // Antiperiodic t BCs
+
+	multi1d<LatticeColorMatrix> u(Nd);
+	for(int mu=0; mu < Nd; ++mu) {
+		gaussian(u[mu]);
+		reunit(u[mu]);
+	}
+	LatticeInfo fine_info(node_orig,latdims,4,3,NodeInfo());
+
+	std::shared_ptr<QPhiXWilsonCloverLinearOperatorF> M_f=
+			std::make_shared<QPhiXWilsonCloverLinearOperatorF>(fine_info, m_q, c_sw, t_bc,u);
+	QPhiXWilsonCloverLinearOperator M(fine_info,m_q, c_sw, t_bc,u);
+
+	SetupParams level_setup_params = {
+		3,       // Number of levels
+		{8,16},   // Null vecs on L0, L1
+		{
+				{2,2,2,2},  // Block Size from L0->L1
+				{2,2,2,2}   // Block Size from L1->L2
+		},
+		{500,500},          // Max Nullspace Iters
+		{5e-6,5e-6},        // Nullspace Target Resid
+		{false,false}
+	};
+
+	QPhiXMultigridLevels mg_levels;
+	SetupQPhiXMGLevels(level_setup_params, mg_levels, M_f);
+
+	std::vector<VCycleParams> v_params(2);
+	for(int level=0; level < mg_levels.n_levels-1; level++) {
+		v_params[level].pre_smoother_params.MaxIter=4;
+		v_params[level].pre_smoother_params.RsdTarget = 0.1;
+		v_params[level].pre_smoother_params.VerboseP = false;
+		v_params[level].pre_smoother_params.Omega = 1.1;
+
+		v_params[level].post_smoother_params.MaxIter=3;
+		v_params[level].post_smoother_params.RsdTarget = 0.1;
+		v_params[level].post_smoother_params.VerboseP = false;
+		v_params[level].post_smoother_params.Omega = 1.1;
+
+		v_params[level].bottom_solver_params.MaxIter=25;
+		v_params[level].bottom_solver_params.NKrylov = 6;
+		v_params[level].bottom_solver_params.RsdTarget= 0.1;
+		v_params[level].bottom_solver_params.VerboseP = false;
+
+		v_params[level].cycle_params.MaxIter=1;
+		v_params[level].cycle_params.RsdTarget=0.1;
+		v_params[level].cycle_params.VerboseP = true;
+	}
+
+	// Level 1 -> 2: smoothing and coarse correction on separate thread teams
+	v_params[1].additive_cycle = true;
+
+	VCycleRecursiveQPhiX v_cycle(v_params,mg_levels);
+
+	FGMRESParams fine_solve_params;
+	fine_solve_params.MaxIter=200;
+	fine_solve_params.RsdTarget=1.0e-13;
+	fine_solve_params.VerboseP = true;
+	fine_solve_params.NKrylov = 5;
+	FGMRESSolverQPhiX FGMRESOuter(M,fine_solve_params, &v_cycle);
+
+	QPhiXSpinor psi_in(fine_info);
+	QPhiXSpinor chi_out(fine_info);
+	Gaussian(psi_in);
+	ZeroVec(chi_out);
+	double psi_norm = sqrt(Norm2Vec(psi_in));
+
+	LinearSolverResults res=FGMRESOuter(chi_out, psi_in);
+
+	QPhiXSpinor Ax(fine_info);
+	M(Ax,chi_out,LINOP_OP);
+	double diff_rel = sqrt(XmyNorm2Vec(psi_in,Ax))/psi_norm;
+	MasterLog(INFO,"|| b - A x ||/ || b || = %16.8e",diff_rel);
+
+	ASSERT_EQ( res.resid_type, RELATIVE);
+	ASSERT_LT( res.resid, 1.0e-13);
+	ASSERT_LT( toDouble(diff_rel), 1.0e-13);
+}
+
+TEST(QPhiXTestRecursiveVCycle, TestAdaptiveTolerance)
+{
+	IndexArray latdims={{8,8,8,8}};
+	initQDPXXLattice(latdims);
+
+	IndexArray node_orig=NodeInfo().NodeCoords();
+	for(int mu=0; mu < n_dim; ++mu) node_orig[mu]*=latdims[mu];
+
+	float m_q = 0.01;
+	float c_sw = 1.25;
+	int t_bc=-1; // Antiperiodic t BCs
+
+	multi1d<LatticeColorMatrix> u(Nd);
+	for(int mu=0; mu < Nd; ++mu) {
+		gaussian(u[mu]);
+		reunit(u[mu]);
+	}
+	LatticeInfo fine_info(node_orig,latdims,4,3,NodeInfo());
+
+	std::shared_ptr<QPhiXWilsonCloverLinearOperatorF> M_f=
+			std::make_shared<QPhiXWilsonCloverLinearOperatorF>(fine_info, m_q, c_sw, t_bc,u);
+	QPhiXWilsonCloverLinearOperator M(fine_info,m_q, c_sw, t_bc,u);
+
+	SetupParams level_setup_params = {
+		3,       // Number of levels
+		{8,16},   // Null vecs on L0, L1
+		{
+				{2,2,2,2},  // Block Size from L0->L1
+				{2,2,2,2}   // Block Size from L1->L2
+		},
+		{500,500},          // Max Nullspace Iters
+		{5e-6,5e-6},        // Nullspace Target Resid
+		{false,false}
+	};
+
+	QPhiXMultigridLevels mg_levels;
+	SetupQPhiXMGLevels(level_setup_params, mg_levels, M_f);
+
+	std::vector<VCycleParams> v_params(2);
+	for(int level=0; level < mg_levels.n_levels-1; level++) {
+		v_params[level].pre_smoother_params.MaxIter=4;
+		v_params[level].pre_smoother_params.RsdTarget = 0.1;
+		v_params[level].pre_smoother_params.VerboseP = false;
+		v_params[level].pre_smoother_params.Omega = 1.1;
+
+		v_params[level].post_smoother_params.MaxIter=3;
+		v_params[level].post_smoother_params.RsdTarget = 0.1;
+		v_params[level].post_smoother_params.VerboseP = false;
+		v_params[level].post_smoother_params.Omega = 1.1;
+
+		v_params[level].bottom_solver_params.MaxIter=100;
+		v_params[level].bottom_solver_params.NKrylov = 6;
+		v_params[level].bottom_solver_params.RsdTarget= 1.0e-3;
+		v_params[level].bottom_solver_params.VerboseP = false;
+
+		v_params[level].cycle_params.MaxIter=1;
+		v_params[level].cycle_params.RsdTarget=0.1;
+		v_params[level].cycle_params.VerboseP = false;
+
+		v_params[level].adaptive_tolerance = true;
+		v_params[level].adaptive_safety_factor = 0.5;
+	}
+
+	FGMRESParams fine_solve_params;
+	fine_solve_params.MaxIter=200;
+	fine_solve_params.RsdTarget=1.0e-13;
+	fine_solve_params.VerboseP = true;
+	fine_solve_params.NKrylov = 5;
+
+	QPhiXSpinor psi_in(fine_info);
+	Gaussian(psi_in);
+	double psi_norm = sqrt(Norm2Vec(psi_in));
+
+	// With the largest target equal to the smallest the tolerance stays fixed: the
+	// iterations logged per level for the two runs give the saving
+	for(double max_rsd_target : {1.0e-3, 0.5}) {
+		for(int level=0; level < mg_levels.n_levels-1; level++) {
+			v_params[level].adaptive_max_rsd_target = max_rsd_target;
+		}
+		VCycleRecursiveQPhiX v_cycle(v_params,mg_levels);
+		FGMRESSolverQPhiX FGMRESOuter(M,fine_solve_params, &v_cycle);
+
+		QPhiXSpinor chi_out(fine_info);
+		ZeroVec(chi_out);
+		LinearSolverResults res=FGMRESOuter(chi_out, psi_in);
+
+		MasterLog(INFO, "Largest coarse target %g: %d outer iterations", max_rsd_target, res.n_count);
+		v_cycle.LogAdaptiveToleranceStats();
+
+		QPhiXSpinor Ax(fine_info);
+		M(Ax,chi_out,LINOP_OP);
+		double diff_rel = sqrt(XmyNorm2Vec(psi_in,Ax))/psi_norm;
+		MasterLog(INFO,"|| b - A x ||/ || b || = %16.8e",diff_rel);
+
+		ASSERT_EQ( res.resid_type, RELATIVE);
+		ASSERT_LT( res.resid, 1.0e-13);
+		ASSERT_LT( toDouble(diff_rel), 1.0e-13);
+	}
+}
+
 int main(int argc, char *argv[]) 
 {
 	return MGTesting::TestMain(&argc, argv);
@@ -689,6 +689,113 @@ TEST(TestQPhiXVCycle, TestVCycle2Level)
 
 }
 
+TEST(TestQPhiXVCycle, TestVCycleCoarseMultiSolve)
+{
+	IndexArray latdims={{8,8,8,8}};
+
+	initQDPXXLattice(latdims);
+
+	IndexArray node_orig=NodeInfo().NodeCoords();
+		for(int mu=0; mu < n_dim; ++mu) node_orig[mu]*=latdims[mu];
+
+	float m_q = 0.1;
+	float c_sw = 1.25;
+	int t_bc=-1; // Antiperiodic t BCs
+
+	multi1d<LatticeColorMatrix> u(Nd);
+	for(int mu=0; mu < Nd; ++mu) {
+		gaussian(u[mu]);
+		reunit(u[mu]);
+	}
+
+	LatticeInfo fine_info(node_orig,latdims,4,3,NodeInfo());
+	std::shared_ptr<QPhiXWilsonCloverLinearOperatorF> M_f =
+			std::make_shared<QPhiXWilsonCloverLinearOperatorF>(fine_info, m_q, c_sw,t_bc, u);
+
+	SetupParams level_setup_params = {
+			3,       // Number of levels
+			{8,8},   // Null vecs on L0, L1
+			{
+					{2,2,2,2},
+					{2,2,2,2}
+			},
+			{500,500},          // Max Nullspace Iters
+			{5e-6,5e-6},        // Nullspace Target Resid
+			{false,false}
+	};
+
+	QPhiXMultigridLevels mg_levels;
+	SetupQPhiXMGLevels(level_setup_params, mg_levels, M_f);
+
+	const MGLevelCoarse& l1 = mg_levels.coarse_levels[0];
+	const MGLevelCoarse& l2 = mg_levels.coarse_levels[1];
+	const int n_rhs = 3;
+
+	// Batched transfers vs one vector at a time
+	CoarseTransfer transfer(l1.blocklist, l1.null_vecs);
+	CoarseSpinorSet fine_set(*(l1.info), n_rhs);
+	CoarseSpinorSet coarse_set(*(l2.info), n_rhs);
+	CoarseSpinorSet prolong_set(*(l1.info), n_rhs);
+	for(int j=0; j < n_rhs; ++j) {
+		Gaussian(fine_set[j]);
+	}
+	transfer.RMulti(fine_set, n_rhs, coarse_set);
+	transfer.PMulti(coarse_set, n_rhs, prolong_set);
+	for(int j=0; j < n_rhs; ++j) {
+		CoarseSpinor c_ref(*(l2.info));
+		transfer.R(fine_set[j], c_ref);
+		double c_norm = sqrt(Norm2Vec(c_ref));
+		EXPECT_LT( sqrt(XmyNorm2Vec(c_ref,coarse_set[j]))/c_norm, 1.0e-6 );
+
+		CoarseSpinor f_ref(*(l1.info));
+		transfer.P(coarse_set[j], f_ref);
+		double f_norm = sqrt(Norm2Vec(f_ref));
+		EXPECT_LT( sqrt(XmyNorm2Vec(f_ref,prolong_set[j]))/f_norm, 1.0e-6 );
+	}
+
+	// Batched L1 -> L2 cycle vs one right hand side at a time
+	MRSolverParams smooth_params;
+	smooth_params.MaxIter=4;
+	smooth_params.RsdTarget = 0.1;
+	smooth_params.Omega = 1.1;
+	smooth_params.VerboseP = false;
+	MRSmootherCoarse smoother(*(l1.M), smooth_params);
+
+	FGMRESParams l2_solve_params;
+	l2_solve_params.MaxIter=200;
+	l2_solve_params.RsdTarget=0.1;
+	l2_solve_params.VerboseP = false;
+	l2_solve_params.NKrylov = 10;
+	FGMRESSolverCoarse l2_solver(*(l2.M), l2_solve_params, nullptr);
+
+	LinearSolverParamsBase vcycle_params;
+	vcycle_params.MaxIter=4;
+	vcycle_params.RsdTarget = 1.0e-3;
+	vcycle_params.VerboseP = true;
+	VCycleCoarse vcycle12( *(l2.info), l1.blocklist, l1.null_vecs, *(l1.M),
+			smoother, smoother, l2_solver, vcycle_params);
+
+	CoarseSpinorSet x(*(l1.info), n_rhs);
+	std::vector<LinearSolverResults> res = vcycle12.MultiSolve(x, fine_set, n_rhs);
+	ASSERT_EQ( static_cast<int>(res.size()), n_rhs );
+
+	for(int j=0; j < n_rhs; ++j) {
+		CoarseSpinor x_ref(*(l1.info));
+		LinearSolverResults res_ref = vcycle12(x_ref, fine_set[j]);
+		MasterLog(INFO, "rhs=%d: multi iters=%d resid=%16.8e single iters=%d resid=%16.8e",
+				j, res[j].n_count, res[j].resid, res_ref.n_count, res_ref.resid);
+
+		// The batch runs until all have converged, so compare the true residua
+		CoarseSpinor Ax(*(l1.info));
+		(*(l1.M))(Ax, x[j], LINOP_OP);
+		CoarseSpinor r(*(l1.info));
+		CopyVec(r, fine_set[j]);
+		double rel_resid = sqrt(XmyNorm2Vec(r,Ax)/Norm2Vec(fine_set[j]));
+		EXPECT_LT( rel_resid, 1.1*res[j].resid + 1.0e-6 );
+		EXPECT_LE( res[j].resid, std::max(res_ref.resid, vcycle_params.RsdTarget) );
+	}
+}
+
 int main(int argc, char *argv[]) 
 {
 	return MGTesting::TestMain(&argc, argv);
@@ -9,6 +9,7 @@
 #include <lattice/coarse/invmr_coarse.h>
 #include <lattice/qphix/invbicgstab_qphix.h>
 #include <lattice/qphix/invfgmres_qphix.h>
+#include <lattice/qphix/invmixed_qphix.h>
 
 
 
@@ -799,6 +800,91 @@ TEST_F(VCycleEOTesting, TestLevelSetup2LevelEO2)
 
 }
 
+TEST_F(VCycleEOTesting, TestMixedPrecisionEO2)
+{
+	std::vector<VCycleParams> v_params(2);
+
+	for(int level=0; level < mg_levels.n_levels-1; level++) {
+		v_params[level].pre_smoother_params.MaxIter=0;
+		v_params[level].pre_smoother_params.RsdTarget = 0.1;
+		v_params[level].pre_smoother_params.VerboseP = false;
+		v_params[level].pre_smoother_params.Omega = 1.1;
+
+		v_params[level].post_smoother_params.MaxIter=9;
+		v_params[level].post_smoother_params.RsdTarget = 0.1;
+		v_params[level].post_smoother_params.VerboseP = false;
+		v_params[level].post_smoother_params.Omega = 1.1;
+
+		v_params[level].bottom_solver_params.MaxIter=25;
+		v_params[level].bottom_solver_params.NKrylov = 12;
+		v_params[level].bottom_solver_params.RsdTarget= 0.1;
+		v_params[level].bottom_solver_params.VerboseP = false;
+
+		v_params[level].cycle_params.MaxIter=1;
+		v_params[level].cycle_params.RsdTarget=0.1;
+		v_params[level].cycle_params.VerboseP = false;
+	}
+
+	VCycleRecursiveQPhiXEO2 v_cycle(v_params,mg_levels);
+
+	// Double precision FGMRES for reference
+	FGMRESParams fine_solve_params;
+	fine_solve_params.MaxIter=2000;
+	fine_solve_params.RsdTarget=1.0e-13;
+	fine_solve_params.VerboseP = false;
+	fine_solve_params.NKrylov = 12;
+	UnprecFGMRESSolverQPhiXWrapper fgmres_wrapper(M_fine_prec,fine_solve_params, &v_cycle);
+
+	// Single precision FGMRES on the float operator, using the float
+	// entry point of the VCycle. Its target is the reliable update threshold
+	FGMRESParams inner_params;
+	inner_params.MaxIter=200;
+	inner_params.RsdTarget=1.0e-4;
+	inner_params.VerboseP = false;
+	inner_params.NKrylov = 12;
+	FGMRESSolverQPhiXF inner_solver(*M_fine, inner_params, &v_cycle);
+
+	LinearSolverParamsBase mixed_params;
+	mixed_params.MaxIter=20;
+	mixed_params.RsdTarget=1.0e-13;
+	mixed_params.VerboseP = true;
+	UnprecMixedPrecisionSolverQPhiXWrapper mixed_wrapper(
+			std::make_shared<const MixedPrecisionSolverQPhiX>(*M_fine_prec, inner_solver, mixed_params),
+			M_fine_prec);
+
+	const LatticeInfo& fine_info = getFineInfo();
+	QPhiXSpinor psi_in(fine_info);
+	QPhiXSpinor chi_out(fine_info);
+	QPhiXSpinor chi_out_mixed(fine_info);
+	Gaussian(psi_in);
+	ZeroVec(chi_out);
+	ZeroVec(chi_out_mixed);
+	double psi_norm = sqrt(Norm2Vec(psi_in));
+
+	double stime_double = omp_get_wtime();
+	LinearSolverResults res=fgmres_wrapper(chi_out, psi_in);
+	double etime_double = omp_get_wtime();
+
+	double stime_mixed = omp_get_wtime();
+	LinearSolverResults res_mixed=mixed_wrapper(chi_out_mixed, psi_in);
+	double etime_mixed = omp_get_wtime();
+
+	QPhiXSpinor Ax(fine_info);
+	{
+		(*M_fine_unprec_full)(Ax,chi_out_mixed,LINOP_OP);
+		double diff = sqrt(XmyNorm2Vec(Ax,psi_in));
+		double diff_rel = diff/psi_norm;
+		MasterLog(INFO,"Mixed Solution: || b - A x ||/ || b || = %16.8e",diff_rel);
+
+		ASSERT_EQ( res_mixed.resid_type, RELATIVE);
+		ASSERT_LT( res_mixed.resid, 1.0e-13);
+		ASSERT_LT( toDouble(diff_rel), 1.0e-12);
+	}
+
+	MasterLog(INFO, "Double FGMRES: iters=%d took %16.8e sec", res.n_count, etime_double-stime_double);
+	MasterLog(INFO, "Mixed FGMRES: inner iters=%d took %16.8e sec", res_mixed.n_count, etime_mixed-stime_mixed);
+}
+
 int main(int argc, char *argv[]) 
 {
 	return MGTesting::TestMain(&argc, argv);
@@ -0,0 +1,482 @@
+/*
+ * test_coarse_blas.cpp
+ */
+
+
+#include "gtest/gtest.h"
+#include "utils/memory.h"
+#include "utils/print_utils.h"
+#include "MG_config.h"
+#include "test_env.h"
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/coarse/coarse_spinor_set.h"
+#include "lattice/spinor_workspace.h"
+#include "lattice/coarse/aggregate_block_coarse.h"
+#include "lattice/coarse/block.h"
+#include "lattice/coarse/thread_partition.h"
+#include "lattice/coarse/thread_team.h"
+
+using namespace MG;
+
+namespace {
+
+	// Reference inner product, site by site over the checkerboards in subset
+	std::complex<double> refInnerProduct(const CoarseSpinor& x, const CoarseSpinor& y, const CBSubset& subset)
+	{
+		std::complex<double> sum(0,0);
+		const int num_cbsites = x.GetInfo().GetNumCBSites();
+		const int num_colorspin = x.GetNumColorSpin();
+		for(int cb=subset.start; cb < subset.end; ++cb) {
+			for(int cbsite=0; cbsite < num_cbsites; ++cbsite) {
+				const float* x_site = x.GetSiteDataPtr(cb,cbsite);
+				const float* y_site = y.GetSiteDataPtr(cb,cbsite);
+				for(int cspin=0; cspin < num_colorspin; ++cspin) {
+					std::complex<double> cx(x_site[RE+n_complex*cspin],x_site[IM+n_complex*cspin]);
+					std::complex<double> cy(y_site[RE+n_complex*cspin],y_site[IM+n_complex*cspin]);
+					sum += std::conj(cx)*cy;
+				}
+			}
+		}
+		return sum;
+	}
+}
+
+TEST(CoarseSpinorLayout, TestContiguousCheckerboards)
+{
+	// 6 cb sites with 6 colorspins: 72 floats per cb, so the pad is non trivial
+	IndexArray latdims={2,2,3,1};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+
+	CoarseSpinor x(linfo);
+
+	const IndexType n_floats_per_cb = linfo.GetNumCBSites()*n_complex*x.GetNumColorSpin();
+	const IndexType align_floats = GetMemoryAlignment()/sizeof(float);
+
+	EXPECT_GE( x.GetCBOffset(), n_floats_per_cb );
+	EXPECT_EQ( x.GetCBOffset() % align_floats, 0 );
+	EXPECT_EQ( x.GetCBDataPtr(ODD), x.GetCBDataPtr(EVEN) + x.GetCBOffset() );
+
+	// The pad between the checkerboards is zeroed
+	const float* base = x.GetCBDataPtr(EVEN);
+	for(IndexType i=n_floats_per_cb; i < x.GetCBOffset(); ++i) {
+		ASSERT_EQ( base[i], 0 );
+	}
+}
+
+TEST(CoarseBLAS, TestSubsetsAgainstSiteLoops)
+{
+	IndexArray latdims={2,2,3,1};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+
+	CoarseSpinor x(linfo);
+	CoarseSpinor y(linfo);
+	CoarseSpinor z(linfo);
+
+	Gaussian(x);
+	Gaussian(y);
+
+	for(const CBSubset& subset : { SUBSET_EVEN, SUBSET_ODD, SUBSET_ALL } ) {
+		std::complex<double> ref = refInnerProduct(x,y,subset);
+		std::complex<double> iprod = InnerProductVec(x,y,subset);
+		EXPECT_NEAR( std::real(iprod), std::real(ref), 1.0e-5*std::abs(ref) );
+		EXPECT_NEAR( std::imag(iprod), std::imag(ref), 1.0e-5*std::abs(ref) );
+
+		double ref_norm = std::real(refInnerProduct(x,x,subset));
+		EXPECT_NEAR( Norm2Vec(x,subset), ref_norm, 1.0e-5*ref_norm);
+	}
+
+	// z = x on all sites, then overwrite the even part only
+	CopyVec(z,x);
+	ZeroVec(z,SUBSET_EVEN);
+	EXPECT_EQ( Norm2Vec(z,SUBSET_EVEN), 0 );
+	EXPECT_DOUBLE_EQ( Norm2Vec(z,SUBSET_ODD), Norm2Vec(x,SUBSET_ODD) );
+
+	// z = x - y, then z += y must give back x
+	XmyzVec(x,y,z);
+	const std::complex<float> one(1,0);
+	AxpyVec(one,y,z);
+	double diff = XmyNorm2Vec(z,x);
+	EXPECT_LT( diff, 1.0e-10*Norm2Vec(x) );
+
+	// Complex scaling: i*(i*x) = -x
+	CopyVec(z,x);
+	const std::complex<float> i_unit(0,1);
+	ScaleVec(i_unit,z,SUBSET_ODD);
+	ScaleVec(i_unit,z,SUBSET_ODD);
+	YpeqxVec(x,z,SUBSET_ODD);
+	EXPECT_LT( Norm2Vec(z,SUBSET_ODD), 1.0e-10*Norm2Vec(x) );
+	EXPECT_DOUBLE_EQ( Norm2Vec(z,SUBSET_EVEN), Norm2Vec(x,SUBSET_EVEN));
+}
+
+TEST(CoarseSpinorSet, TestViewsAndBlockBLAS)
+{
+	IndexArray latdims={2,2,3,1};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+
+	const int n_vecs = 5;
+	CoarseSpinorSet x(linfo, n_vecs);
+	CoarseSpinor y(linfo);
+
+	ASSERT_EQ( x.GetNumVecs(), n_vecs );
+	ASSERT_EQ( x.GetVecStride(), CoarseSpinor::GetNumFloatsAllocated(linfo));
+	for(int j=0; j < n_vecs; ++j) {
+		EXPECT_EQ( x[j].GetCBDataPtr(EVEN), x.GetVecDataPtr(j) );
+		Gaussian(x[j]);
+	}
+	Gaussian(y);
+
+	for(const CBSubset& subset : { SUBSET_ODD, SUBSET_ALL } ) {
+
+		// Multi-dot vs individual inner products
+		std::complex<double> iprods[n_vecs];
+		InnerProductMultiVec(x, n_vecs, y, iprods, subset);
+		for(int j=0; j < n_vecs; ++j) {
+			std::complex<double> ref = InnerProductVec(x[j], y, subset);
+			EXPECT_NEAR( std::abs(iprods[j]-ref), 0, 1.0e-5*std::abs(ref) );
+		}
+
+		// Fused multi-dot and norm
+		double norm2_y = 0;
+		InnerProductNorm2MultiVec(x, n_vecs, y, iprods, norm2_y, subset);
+		for(int j=0; j < n_vecs; ++j) {
+			std::complex<double> ref = InnerProductVec(x[j], y, subset);
+			EXPECT_NEAR( std::abs(iprods[j]-ref), 0, 1.0e-5*std::abs(ref) );
+		}
+		EXPECT_NEAR( norm2_y, Norm2Vec(y, subset), 1.0e-5*norm2_y );
+
+		// Gram matrix vs individual inner products
+		std::complex<double> G[n_vecs*n_vecs];
+		GramMatrix(x, n_vecs, G, subset);
+		for(int j=0; j < n_vecs; ++j) {
+			for(int i=0; i < n_vecs; ++i) {
+				std::complex<double> ref = InnerProductVec(x[i], x[j], subset);
+				EXPECT_NEAR( std::abs(G[i+n_vecs*j]-ref), 0, 1.0e-5*std::abs(G[j+n_vecs*j]) );
+			}
+		}
+
+		// Block AXPY on the first 3 vectors vs individual AXPYs
+		std::complex<double> alpha[3] = { {0.5,0.25}, {-1,0}, {0,2} };
+		CoarseSpinor z(linfo);
+		CoarseSpinor z_ref(linfo);
+		CopyVec(z,y);
+		CopyVec(z_ref,y);
+		AxpyMultiVec(alpha, x, 3, z, subset);
+		for(int j=0; j < 3; ++j) {
+			AxpyVec(std::complex<float>(std::real(alpha[j]),std::imag(alpha[j])), x[j], z_ref, subset);
+		}
+		EXPECT_LT( XmyNorm2Vec(z,z_ref), 1.0e-10*Norm2Vec(y) );
+
+		// Block dot of 5 x 3 vectors vs individual inner products (odd sizes both ways)
+		CoarseSpinorSet w(linfo, 3);
+		Gaussian(w[0]);
+		Gaussian(w[1]);
+		Gaussian(w[2]);
+		std::complex<double> block_iprods[n_vecs*3];
+		InnerProductBlockVec(x, n_vecs, w, 3, block_iprods, subset);
+		for(int j=0; j < 3; ++j) {
+			for(int i=0; i < n_vecs; ++i) {
+				std::complex<double> ref = InnerProductVec(x[i], w[j], subset);
+				EXPECT_NEAR( std::abs(block_iprods[i+n_vecs*j]-ref), 0, 1.0e-5*std::abs(ref) );
+			}
+		}
+
+		// Block AXPY, W += X(:,0:2) alpha(3x2), vs individual AXPYs
+		std::complex<double> block_alpha[6] = { {0.5,0.25}, {-1,0}, {0,2}, {1,1}, {0.1,0}, {0,-0.3} };
+		CoarseSpinorSet w_ref(linfo, 2);
+		for(int j=0; j < 2; ++j) {
+			CopyVec(w_ref[j], w[j]);
+			for(int i=0; i < 3; ++i) {
+				const std::complex<double>& a = block_alpha[i+3*j];
+				AxpyVec(std::complex<float>(std::real(a),std::imag(a)), x[i], w_ref[j], subset);
+			}
+		}
+		AxpyBlockVec(block_alpha, x, 3, w, 2, subset);
+		for(int j=0; j < 2; ++j) {
+			EXPECT_LT( XmyNorm2Vec(w_ref[j],w[j]), 1.0e-10*Norm2Vec(w[j]) );
+		}
+
+		// Per vector kernels on the first 2 vectors: norms, <x_j|w_j> and w_j += alpha_j x_j
+		double norm2_each[2];
+		Norm2EachVec(x, 2, norm2_each, subset);
+		std::complex<double> iprods_each[2];
+		double norm2_x_each[2];
+		InnerProductNorm2EachVec(x, w, 2, iprods_each, norm2_x_each, subset);
+		for(int j=0; j < 2; ++j) {
+			double norm2_ref = Norm2Vec(x[j], subset);
+			std::complex<double> iprod_ref = InnerProductVec(x[j], w[j], subset);
+			EXPECT_NEAR( norm2_each[j], norm2_ref, 1.0e-5*norm2_ref );
+			EXPECT_NEAR( norm2_x_each[j], norm2_ref, 1.0e-5*norm2_ref );
+			EXPECT_NEAR( std::abs(iprods_each[j]-iprod_ref), 0, 1.0e-5*std::abs(iprod_ref) );
+		}
+
+		for(int j=0; j < 2; ++j) {
+			CopyVec(w_ref[j], w[j]);
+			AxpyVec(std::complex<float>(std::real(alpha[j]),std::imag(alpha[j])), x[j], w_ref[j], subset);
+		}
+		AxpyEachVec(alpha, x, w, 2, subset);
+		for(int j=0; j < 2; ++j) {
+			EXPECT_LT( XmyNorm2Vec(w_ref[j],w[j]), 1.0e-10*Norm2Vec(w[j]) );
+		}
+	}
+}
+
+TEST(CoarseSpinorSet, TestOrthonormalizeBlockAggregates)
+{
+	IndexArray latdims={4,4,4,4};
+	IndexArray block_size={2,2,2,2};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 4, node);
+
+	std::vector<Block> blocklist;
+	IndexArray blocked_dims;
+	IndexArray blocked_origin;
+	CreateBlockList(blocklist, blocked_dims, blocked_origin, latdims, block_size, linfo.GetLatticeOrigin());
+
+	const int n_vecs = 6;
+	CoarseSpinorSet vecs(linfo, n_vecs);
+	for(int j=0; j < n_vecs; ++j) {
+		Gaussian(vecs[j]);
+	}
+
+	orthonormalizeBlockAggregates(vecs, blocklist);
+
+	for(const Block& block : blocklist) {
+		for(int aggr=0; aggr < 2; ++aggr) {
+			for(int j=0; j < n_vecs; ++j) {
+				for(int i=0; i <= j; ++i) {
+					std::complex<double> iprod = innerProductBlockAggr(vecs[i], vecs[j], block, aggr);
+					double expected = (i == j) ? 1 : 0;
+					ASSERT_NEAR( std::real(iprod), expected, 1.0e-5 );
+					ASSERT_NEAR( std::imag(iprod), 0, 1.0e-5 );
+				}
+			}
+		}
+	}
+}
+
+TEST(CoarseSpinorSet, TestOrthonormalizeIllConditioned)
+{
+	// 24 vectors, all close to the first one, so plain Cholesky QR would lose orthogonality
+	IndexArray latdims={4,4,4,4};
+	IndexArray block_size={2,2,2,2};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 4, node);
+
+	std::vector<Block> blocklist;
+	IndexArray blocked_dims;
+	IndexArray blocked_origin;
+	CreateBlockList(blocklist, blocked_dims, blocked_origin, latdims, block_size, linfo.GetLatticeOrigin());
+
+	const int n_vecs = 24;
+	std::vector<std::shared_ptr<CoarseSpinor>> vecs(n_vecs);
+	for(int j=0; j < n_vecs; ++j) {
+		vecs[j] = std::make_shared<CoarseSpinor>(linfo);
+		Gaussian(*(vecs[j]));
+		if( j > 0 ) {
+			ScaleVec(1.0e-4f, *(vecs[j]));
+			AxpyVec(std::complex<float>(1,0), *(vecs[0]), *(vecs[j]));
+		}
+	}
+
+	orthonormalizeBlockAggregates(vecs, blocklist);
+
+	for(const Block& block : blocklist) {
+		for(int aggr=0; aggr < 2; ++aggr) {
+			for(int j=0; j < n_vecs; ++j) {
+				for(int i=0; i <= j; ++i) {
+					std::complex<double> iprod = innerProductBlockAggr(*(vecs[i]), *(vecs[j]), block, aggr);
+					double expected = (i == j) ? 1 : 0;
+					ASSERT_NEAR( std::real(iprod), expected, 1.0e-5 );
+					ASSERT_NEAR( std::imag(iprod), 0, 1.0e-5 );
+				}
+			}
+		}
+	}
+}
+
+TEST(ThreadPartition, TestCoverage)
+{
+	IndexArray latdims={4,2,3,1};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+
+	const ThreadPartition& partition = GetThreadPartition(linfo);
+	ASSERT_EQ( partition.GetNumCBSites(), linfo.GetNumCBSites() );
+	ASSERT_EQ( partition.GetNumThreads(), omp_get_max_threads() );
+
+	// The same object is handed out for the same lattice size
+	EXPECT_EQ( &partition, &GetThreadPartition(linfo) );
+
+	// Ranges are contiguous, ordered by thread and cover all the sites
+	IndexType next_site = 0;
+	for(int tid=0; tid < partition.GetNumThreads(); ++tid) {
+		IndexType min_site, max_site;
+		partition.GetSiteRange(tid, min_site, max_site);
+		EXPECT_EQ( min_site, next_site );
+		EXPECT_LE( min_site, max_site );
+		next_site = max_site;
+	}
+	EXPECT_EQ( next_site, linfo.GetNumCBSites() );
+
+	// A core with 2 SMT threads owns the sites of both
+	if( partition.GetNumThreads() >= 2 ) {
+		IndexType min_site, max_site, min0, max0, min1, max1;
+		partition.GetCoreSiteRange(1, 2, min_site, max_site);
+		partition.GetSiteRange(0, min0, max0);
+		partition.GetSiteRange(1, min1, max1);
+		EXPECT_EQ( min_site, min0 );
+		EXPECT_EQ( max_site, max1 );
+	}
+}
+
+TEST(ThreadTeam, TestScopeAndAutoSize)
+{
+	IndexArray latdims={4,4,4,4};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+
+	const int n_threads = omp_get_max_threads();
+
+	// A tiny lattice gets a single thread, a big one all of them
+	IndexArray small_latdims={2,2,2,2};
+	IndexArray big_latdims={16,16,16,16};
+	EXPECT_EQ( GetAutoNumThreads(LatticeInfo(small_latdims, 2, 3, node)), 1 );
+	EXPECT_EQ( GetAutoNumThreads(LatticeInfo(big_latdims, 2, 24, node)), n_threads );
+
+	CoarseSpinor x(linfo);
+	CoarseSpinor y(linfo);
+	Gaussian(x);
+	CopyVec(y,x);
+	const double norm_all = Norm2Vec(x);
+
+	{
+		ThreadTeamScope team(1);
+		EXPECT_EQ( omp_get_max_threads(), 1 );
+		EXPECT_EQ( GetThreadPartition(linfo).GetNumThreads(), 1 );
+
+		// The kernels run on the smaller team over all the sites
+		EXPECT_NEAR( Norm2Vec(x), norm_all, 1.0e-5*norm_all );
+		AxpyVec(-1.0, x, y);
+
+		// Nested scopes restore the enclosing one
+		{
+			ThreadTeamScope inner(n_threads);
+			EXPECT_EQ( omp_get_max_threads(), n_threads );
+		}
+		EXPECT_EQ( omp_get_max_threads(), 1 );
+
+		// A scope of 0 threads changes nothing
+		ThreadTeamScope none(0);
+		EXPECT_EQ( omp_get_max_threads(), 1 );
+	}
+	EXPECT_EQ( omp_get_max_threads(), n_threads );
+	EXPECT_EQ( Norm2Vec(y), 0 );
+}
+
+TEST(ThreadTeam, TestSpinTeam)
+{
+	IndexArray latdims={4,4,4,4};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+
+	CoarseSpinor x(linfo);
+	CoarseSpinor y(linfo);
+	Gaussian(x);
+	Gaussian(y);
+	const std::complex<double> iprod = InnerProductVec(x,y);
+	const double norm_x = Norm2Vec(x);
+	const ThreadPartition& partition = GetThreadPartition(linfo);
+
+	const int n_threads = omp_get_max_threads();
+	// On the heap, as the persistent smoother keeps it, at the padded alignment
+	std::unique_ptr<SpinTeam> heap_team(new SpinTeam(n_threads));
+	EXPECT_EQ( reinterpret_cast<std::uintptr_t>(heap_team.get()) % alignof(SpinTeam), 0u );
+	SpinTeam& team = *heap_team;
+	std::vector<int> counts(n_threads, 0);
+	int n_bad = 0;
+
+#pragma omp parallel num_threads(n_threads) reduction(+:n_bad)
+	{
+		const int tid = omp_get_thread_num();
+		for(int iter=0; iter < 100; ++iter) {
+			// Everyone sees all the counts of the round after the barrier
+			counts[tid] = iter+1;
+			team.Barrier(tid);
+			for(int t=0; t < n_threads; ++t) {
+				if( counts[t] != iter+1 ) ++n_bad;
+			}
+			team.Barrier(tid);
+
+			// Back to back sums reuse the slots
+			double sums[3];
+			std::complex<double> c = InnerProductNorm2VecInTeam(partition, x, y, sums[2]);
+			sums[0] = std::real(c);
+			sums[1] = std::imag(c);
+			team.Sum(tid, sums, 3);
+			if( std::abs(std::complex<double>(sums[0],sums[1]) - iprod) > 1.0e-9*std::abs(iprod) ) ++n_bad;
+			if( std::abs(sums[2] - norm_x) > 1.0e-9*norm_x ) ++n_bad;
+
+			double one = 1;
+			team.Sum(tid, &one, 1);
+			if( one != n_threads ) ++n_bad;
+		}
+	}
+	EXPECT_EQ( n_bad, 0 );
+}
+
+TEST(SpinorWorkspace, TestReuse)
+{
+	IndexArray latdims={2,2,4,4};
+	IndexArray coarse_latdims={2,2,2,2};
+	NodeInfo node;
+	LatticeInfo linfo(latdims, 2, 3, node);
+	LatticeInfo linfo2(latdims, 2, 3, node);
+	LatticeInfo coarse_linfo(coarse_latdims, 2, 3, node);
+
+	SpinorWorkspace<CoarseSpinor> work;
+	const CoarseSpinor* first;
+	{
+		auto x = work.Get(linfo);
+		auto y = work.Get(linfo);
+		first = &(*x);
+		ASSERT_NE( first, &(*y) );
+		EXPECT_EQ( work.GetNumAllocated(), 2 );
+		EXPECT_EQ( work.GetNumFree(), 0 );
+	}
+	EXPECT_EQ( work.GetNumFree(), 2 );
+
+	// An equal lattice reuses the spinors, another one does not
+	{
+		auto x = work.Get(linfo2);
+		auto y = work.Get(linfo);
+		auto z = work.Get(coarse_linfo);
+		EXPECT_EQ( work.GetNumAllocated(), 3 );
+		EXPECT_EQ( z->GetInfo().GetNumCBSites(), coarse_linfo.GetNumCBSites() );
+		EXPECT_TRUE( &(*x) == first || &(*y) == first );
+	}
+	EXPECT_EQ( work.GetNumFree(), 3 );
+
+	// Handles can be moved, and give the spinor back once
+	{
+		auto x = work.Get(linfo);
+		auto y = std::move(x);
+		ZeroVec(*y);
+		EXPECT_EQ( work.GetNumFree(), 2 );
+	}
+	EXPECT_EQ( work.GetNumFree(), 3 );
+	EXPECT_EQ( work.GetNumAllocated(), 3 );
+}
+
+int main(int argc, char *argv[])
+{
+	return MGTesting::TestMain(&argc, argv);
+}
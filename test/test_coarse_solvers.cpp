@@ -0,0 +1,937 @@
+/*
+ * test_coarse_solvers.cpp
+ */
+
+
+#include "gtest/gtest.h"
+#include "utils/memory.h"
+#include "utils/print_utils.h"
+#include "MG_config.h"
+#include "test_env.h"
+#include "coarse_testutils.h"
+
+#include <memory>
+#include <algorithm>
+#include <omp.h>
+
+#include "lattice/coarse/coarse_types.h"
+#include "lattice/coarse/coarse_l1_blas.h"
+#include "lattice/coarse/coarse_wilson_clover_linear_operator.h"
+#include "lattice/coarse/coarse_eo_wilson_clover_linear_operator.h"
+#include "lattice/coarse/invfgmres_coarse.h"
+#include "lattice/coarse/invgcr_coarse.h"
+#include "lattice/coarse/invmr_coarse.h"
+#include "lattice/coarse/invbicgstab_coarse.h"
+#include "lattice/coarse/invdirect_coarse.h"
+#include "lattice/coarse/invsap_coarse.h"
+#include "lattice/coarse/invblockjacobi_coarse.h"
+#include "lattice/coarse/coarse_correction.h"
+#include "lattice/adaptive_tolerance_solver.h"
+#include "lattice/invmixed_generic.h"
+
+using namespace MG;
+using namespace MGTesting;
+
+namespace {
+	// 4^4 lattice with 6 colors, i.e. 12 colorspins per site
+	const IndexArray latdims={4,4,4,4};
+	const int n_color = 6;
+
+	// Returns || b - M x || / || b ||
+	double relResidual(const LinearOperator<CoarseSpinor,CoarseGauge>& M, const CoarseSpinor& x, const CoarseSpinor& b)
+	{
+		CoarseSpinor r(b.GetInfo());
+		CoarseSpinor Mx(b.GetInfo());
+		CopyVec(r,b);
+		M(Mx,x,LINOP_OP);
+		return sqrt( XmyNorm2Vec(r,Mx)/Norm2Vec(b) );
+	}
+
+	// Forwards to an operator, counting the sweeps over the links and the vectors they served
+	class CountingCoarseOp : public LinearOperator<CoarseSpinor,CoarseGauge> {
+	public:
+		CountingCoarseOp(const LinearOperator<CoarseSpinor,CoarseGauge>& M) : _M(M), n_sweeps(0), n_vecs(0) {}
+
+		void operator()(CoarseSpinor& out, const CoarseSpinor& in, IndexType type = LINOP_OP) const override
+		{
+			++n_sweeps;
+			++n_vecs;
+			_M(out, in, type);
+		}
+
+		void MultiApply(CoarseSpinorSet& out, const CoarseSpinorSet& in, int n,
+				IndexType type = LINOP_OP) const override
+		{
+			++n_sweeps;
+			n_vecs += n;
+			_M.MultiApply(out, in, n, type);
+		}
+
+		int GetLevel() const override { return _M.GetLevel(); }
+		const LatticeInfo& GetInfo() const override { return _M.GetInfo(); }
+		const CBSubset& GetSubset() const override { return _M.GetSubset(); }
+
+	private:
+		const LinearOperator<CoarseSpinor,CoarseGauge>& _M;
+	public:
+		mutable int n_sweeps;
+		mutable int n_vecs;
+	};
+}
+
+// The setup of every test: a random operator M (unit diagonal, gaussian hopping
+// links, see FillRandomCoarseGauge()), a gaussian right hand side b and x = 0
+class CoarseSolvers : public ::testing::Test {
+protected:
+	CoarseSolvers() : linfo(latdims, 2, n_color, node),
+		u(std::make_shared<CoarseGauge>(linfo)),
+		M_ptr(std::make_shared<const CoarseWilsonCloverLinearOperator>(u,1)),
+		M(*M_ptr), b(linfo), x(linfo)
+	{
+		SetHopping(0.05);
+		Gaussian(b);
+		ZeroVec(x);
+	}
+
+	// Refills the links of M with hopping strength hop_scale
+	void SetHopping(float hop_scale)
+	{
+		FillRandomCoarseGauge(*u, 1.0, hop_scale);
+	}
+
+	NodeInfo node;
+	LatticeInfo linfo;
+	std::shared_ptr<CoarseGauge> u;
+	std::shared_ptr<const CoarseWilsonCloverLinearOperator> M_ptr;
+	const CoarseWilsonCloverLinearOperator& M;
+	CoarseSpinor b;
+	CoarseSpinor x;
+};
+
+TEST_F(CoarseSolvers, TestFGMRES)
+{
+	FGMRESParams params;
+	params.MaxIter = 200;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = true;
+	params.NKrylov = 8;
+
+	FGMRESSolverCoarse solver(M,params);
+
+	LinearSolverResults res = solver(x,b);
+	EXPECT_LE( res.resid, params.RsdTarget );
+	EXPECT_LT( res.n_count, params.MaxIter );
+	EXPECT_LT( relResidual(M,x,b), 2*params.RsdTarget );
+}
+
+TEST_F(CoarseSolvers, TestPipelinedFGMRES)
+{
+	FGMRESParams params;
+	params.MaxIter = 200;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = true;
+	params.NKrylov = 8;
+
+	// Classical for reference
+	CoarseSpinor x_ref(linfo);
+	ZeroVec(x_ref);
+	FGMRESSolverCoarse ref_solver(M,params);
+	LinearSolverResults ref_res = ref_solver(x_ref,b);
+
+	params.Pipelined = true;
+	FGMRESSolverCoarse solver(M,params);
+
+	// Solve twice, so the second solve runs on the
+	// bases left behind by the first
+	for(int solve=0; solve < 2; ++solve) {
+		ZeroVec(x);
+
+		LinearSolverResults res = solver(x,b);
+		EXPECT_LE( res.resid, params.RsdTarget );
+		EXPECT_LT( res.n_count, params.MaxIter );
+		EXPECT_LT( relResidual(M,x,b), 2*params.RsdTarget );
+
+		// Same Krylov space in exact arithmetic, so about the same iteration count
+		EXPECT_LE( res.n_count, ref_res.n_count + params.NKrylov );
+	}
+}
+
+TEST_F(CoarseSolvers, TestFGMRESDR)
+{
+	// Stronger hopping: small eigenvalues which plain restarts keep throwing away
+	SetHopping(0.07);
+
+	FGMRESParams params;
+	params.MaxIter = 2000;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = false;
+	params.NKrylov = 20;
+
+	CoarseSpinor x_ref(linfo);
+	ZeroVec(x_ref);
+	FGMRESSolverCoarse ref_solver(M,params);
+	LinearSolverResults ref_res = ref_solver(x_ref,b);
+
+	params.NDefl = 8;
+	FGMRESSolverCoarse solver(M,params);
+
+	LinearSolverResults res = solver(x,b);
+
+	MasterLog(INFO, "FGMRES iters=%d FGMRES-DR iters=%d", ref_res.n_count, res.n_count);
+	EXPECT_LE( res.resid, params.RsdTarget );
+	EXPECT_LT( relResidual(M,x,b), 2*params.RsdTarget );
+	EXPECT_LT( res.n_count, ref_res.n_count );
+}
+
+TEST_F(CoarseSolvers, TestGCR)
+{
+	// A few MR steps as a (non-linear) preconditioner
+	MRSolverParams mr_params;
+	mr_params.MaxIter = 4;
+	mr_params.RsdTarget = 0.1;
+	mr_params.Omega = 1.0;
+	mr_params.VerboseP = false;
+	MRSolverCoarse mr(M, mr_params);
+
+	// Full, truncated, and truncated + preconditioned
+	for(int variant=0; variant < 3; ++variant) {
+		GCRParams params;
+		params.MaxIter = 200;
+		params.RsdTarget = 1.0e-5;
+		params.VerboseP = false;
+		params.NKrylov = 16;
+		params.NTrunc = (variant == 0) ? 0 : 4;
+
+		GCRSolverCoarse solver(M, params, variant == 2 ? &mr : nullptr);
+
+		ZeroVec(x);
+		LinearSolverResults res = solver(x,b);
+
+		MasterLog(INFO, "GCR variant=%d iters=%d", variant, res.n_count);
+		EXPECT_LE( res.resid, params.RsdTarget );
+		EXPECT_LT( res.n_count, params.MaxIter );
+		EXPECT_LT( relResidual(M,x,b), 2*params.RsdTarget );
+	}
+}
+
+TEST_F(CoarseSolvers, TestGCRODRRecycling)
+{
+	SetHopping(0.07);
+
+	GCRParams params;
+	params.MaxIter = 2000;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = false;
+	params.NKrylov = 16;
+	params.NRecycle = 8;
+
+	GCRSolverCoarse solver(M_ptr, params);
+
+	// A sequence of right hand sides with the same operator
+	const int n_rhs = 4;
+	std::vector<int> iters(n_rhs);
+	std::vector<std::shared_ptr<CoarseSpinor>> rhs(n_rhs);
+	for(int i=0; i < n_rhs; ++i) {
+		rhs[i] = std::make_shared<CoarseSpinor>(linfo);
+		Gaussian(*rhs[i]);
+
+		ZeroVec(x);
+		LinearSolverResults res = solver(x,*rhs[i]);
+		iters[i] = res.n_count;
+
+		MasterLog(INFO, "GCRO-DR rhs=%d iters=%d", i, res.n_count);
+		EXPECT_LE( res.resid, params.RsdTarget );
+		EXPECT_LT( relResidual(M,x,*rhs[i]), 2*params.RsdTarget );
+		EXPECT_EQ( solver.GetNumRecycle(), params.NRecycle );
+	}
+
+	// Later sources start deflated
+	EXPECT_LT( iters[n_rhs-1], iters[0] );
+
+	// After invalidating we are back to where we started
+	solver.InvalidateRecycleSpace();
+	EXPECT_EQ( solver.GetNumRecycle(), 0 );
+	ZeroVec(x);
+	LinearSolverResults res = solver(x,*rhs[0]);
+	EXPECT_EQ( res.n_count, iters[0] );
+}
+
+TEST_F(CoarseSolvers, TestMultiApply)
+{
+	// More than one tile of 8 vectors in the site kernel
+	const int n_vecs = 10;
+	CoarseSpinorSet in(linfo, n_vecs);
+	CoarseSpinorSet out(linfo, n_vecs);
+	for(int i=0; i < n_vecs; ++i) {
+		Gaussian(in[i]);
+	}
+
+	for(IndexType type : { LINOP_OP, LINOP_DAGGER } ) {
+		// One fewer than the set holds
+		M.MultiApply(out, in, n_vecs-1, type);
+
+		CoarseSpinor ref(linfo);
+		for(int i=0; i < n_vecs-1; ++i) {
+			M(ref, in[i], type);
+			EXPECT_LT( XmyNorm2Vec(ref, out[i]), 1.0e-10*Norm2Vec(out[i]) );
+		}
+	}
+}
+
+TEST_F(CoarseSolvers, TestBlockFGMRES)
+{
+	FGMRESParams params;
+	params.MaxIter = 200;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = false;
+	params.NKrylov = 8;
+
+	const int n_rhs = 12;
+	CoarseSpinorSet b_set(linfo, n_rhs);
+	for(int i=0; i < n_rhs; ++i) {
+		Gaussian(b_set[i]);
+	}
+
+	// One at a time
+	CountingCoarseOp M_single(M);
+	FGMRESSolverCoarse solver(M_single,params);
+	int total_iters = 0;
+	double start_time = omp_get_wtime();
+	for(int i=0; i < n_rhs; ++i) {
+		ZeroVec(x);
+		LinearSolverResults res = solver(x,b_set[i]);
+		total_iters += res.n_count;
+	}
+	double single_time = omp_get_wtime() - start_time;
+
+	// All together
+	CountingCoarseOp M_block(M);
+	BlockFGMRESSolverCoarse block_solver(M_block,params);
+	CoarseSpinorSet x_set(linfo, n_rhs);
+	for(int i=0; i < n_rhs; ++i) {
+		ZeroVec(x_set[i]);
+	}
+	start_time = omp_get_wtime();
+	std::vector<LinearSolverResults> res = block_solver.MultiSolve(x_set, b_set, n_rhs);
+	double block_time = omp_get_wtime() - start_time;
+
+	MasterLog(INFO, "FGMRES: %d rhs, %d iters total, %16.8e sec per rhs", n_rhs, total_iters, single_time/n_rhs);
+	MasterLog(INFO, "Block FGMRES: %d rhs, %d block steps, %16.8e sec per rhs", n_rhs, res[0].n_count, block_time/n_rhs);
+	MasterLog(INFO, "Operator sweeps over the links per rhs: FGMRES %g, Block FGMRES %g",
+			static_cast<double>(M_single.n_sweeps)/n_rhs, static_cast<double>(M_block.n_sweeps)/n_rhs);
+
+	ASSERT_EQ( res.size(), static_cast<size_t>(n_rhs) );
+	int max_steps = 0;
+	for(int i=0; i < n_rhs; ++i) {
+		EXPECT_LE( res[i].resid, params.RsdTarget );
+		EXPECT_LT( relResidual(M,x_set[i],b_set[i]), 2*params.RsdTarget );
+		max_steps = std::max(max_steps, res[i].n_count);
+	}
+
+	// Each block step serves all the right hand sides: no more block steps than
+	// a single solve takes (up to a cycle), for one operator sweep per step
+	EXPECT_LE( max_steps, total_iters/n_rhs + params.NKrylov );
+
+	// So the whole batch sweeps the links no more often than one single solve does,
+	// i.e. the sweeps per rhs are down by a factor of n_rhs, without applying the
+	// operator to more vectors in total
+	EXPECT_LE( M_block.n_sweeps, M_single.n_sweeps/n_rhs + params.NKrylov );
+	EXPECT_LE( M_block.n_vecs, M_single.n_vecs + n_rhs*params.NKrylov );
+
+	// A single right hand side through the block solver
+	ZeroVec(x);
+	LinearSolverResults res1 = block_solver(x, b_set[0]);
+	EXPECT_LE( res1.resid, params.RsdTarget );
+	EXPECT_LT( relResidual(M,x,b_set[0]), 2*params.RsdTarget );
+}
+
+TEST_F(CoarseSolvers, TestMixedPrecisionReliableUpdates)
+{
+	// There is one coarse precision, but this exercises the reliable updates:
+	// the inner solver only reduces the residual by 0.1 per update
+	FGMRESParams inner_params;
+	inner_params.MaxIter = 200;
+	inner_params.RsdTarget = 0.1;
+	inner_params.VerboseP = false;
+	inner_params.NKrylov = 8;
+	FGMRESSolverCoarse inner_solver(M,inner_params);
+
+	LinearSolverParamsBase params;
+	params.MaxIter = 20;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = true;
+	MixedPrecisionSolver<CoarseSpinor,CoarseGauge,CoarseSpinor,CoarseGauge> solver(M, inner_solver, params);
+
+	LinearSolverResults res = solver(x,b);
+	EXPECT_LE( res.resid, params.RsdTarget );
+	EXPECT_GT( res.n_count, 0 );
+	EXPECT_LT( relResidual(M,x,b), 2*params.RsdTarget );
+
+	// A converged initial guess needs no more updates
+	LinearSolverResults res2 = solver(x,b);
+	EXPECT_EQ( res2.n_count, 0 );
+	EXPECT_LE( res2.resid, params.RsdTarget );
+}
+
+TEST_F(CoarseSolvers, TestPipeBiCGStab)
+{
+	LinearSolverParamsBase params;
+	params.MaxIter = 200;
+	params.RsdTarget = 1.0e-5;
+	params.VerboseP = false;
+
+	CoarseSpinor x_ref(linfo);
+	ZeroVec(x_ref);
+	BiCGStabSolverCoarse ref_solver(M,params);
+	LinearSolverResults ref_res = ref_solver(x_ref,b);
+
+	PipeBiCGStabSolverCoarse solver(M,params);
+	LinearSolverResults res = solver(x,b);
+
+	MasterLog(INFO, "BiCGStab iters=%d Pipelined BiCGStab iters=%d", ref_res.n_count, res.n_count);
+	EXPECT_LT( res.n_count, params.MaxIter );
+	EXPECT_LT( res.resid, 2*params.RsdTarget );
+	EXPECT_LT( relResidual(M,x,b), 2*params.RsdTarget );
+
+	// The same iteration in exact arithmetic, up to a restart on residual drift
+	EXPECT_LE( abs(res.n_count - ref_res.n_count), 4 + ref_res.n_count/5 );
+
+	// Setup style: fixed number of iterations on A x = 0, absolute residual
+	CoarseSpinor zero(linfo);
+	ZeroVec(zero);
+	Gaussian(x);
+	params.MaxIter = 10;
+	params.RsdTarget = 1.0e-20;
+	PipeBiCGStabSolverCoarse null_solver(M,params);
+	const double norm_before = sqrt(Norm2Vec(x));
+	LinearSolverResults null_res = null_solver(x, zero, ABSOLUTE);
+	EXPECT_EQ( null_res.n_count, params.MaxIter );
+	EXPECT_LT( null_res.resid, norm_before );
+}
+
+TEST_F(CoarseSolvers, TestChebyshevSmoother)
+{
+	ChebyshevSmootherParams params;
+	params.MaxIter = 4;
+	params.VerboseP = true;
+	ChebyshevSmootherCoarse smoother(M,params);
+
+	// The diagonal is 1, so the spectrum is around 1
+	EXPECT_GT( smoother.GetLambdaMax(), 1.0 );
+
+	// One smoothing from a zero guess, against MR with the same number of iterations
+	smoother(x,b);
+	const double cheby_resid = relResidual(M,x,b);
+
+	MRSolverParams mr_params;
+	mr_params.MaxIter = params.MaxIter;
+	mr_params.RsdTarget = 1.0e-20;
+	mr_params.Omega = 1.0;
+	mr_params.VerboseP = false;
+	MRSmootherCoarse mr_smoother(M,mr_params);
+	CoarseSpinor x_mr(linfo);
+	ZeroVec(x_mr);
+	mr_smoother(x_mr,b);
+
+	MasterLog(INFO,"After one smoothing: Chebyshev || r ||/|| b ||=%16.8e MR || r ||/|| b ||=%16.8e",
+			cheby_resid, relResidual(M,x_mr,b));
+	EXPECT_LT( cheby_resid, 0.6 );
+
+	// The smoother takes out as the initial guess, so applying it again is
+	// a stationary iteration, which should converge
+	for(int i=0; i < 20; ++i) {
+		smoother(x,b);
+	}
+	const double final_resid = relResidual(M,x,b);
+	MasterLog(INFO,"After 21 smoothings: Chebyshev || r ||/|| b ||=%16.8e", final_resid);
+	EXPECT_LT( final_resid, 1.0e-3 );
+}
+
+TEST_F(CoarseSolvers, TestMRSmootherUpdatesResidual)
+{
+	MRSolverParams mr_params;
+	mr_params.MaxIter = 4;
+	mr_params.RsdTarget = 1.0e-20;
+	mr_params.Omega = 1.1;
+	mr_params.VerboseP = false;
+	MRSmootherCoarse smoother(M,mr_params);
+
+	smoother(x,b);
+
+	// Same iteration, but r is updated in place
+	CoarseSpinor x_r(linfo);
+	CoarseSpinor r(linfo);
+	ZeroVec(x_r);
+	CopyVec(r,b);
+	ASSERT_TRUE( smoother.SmoothAndUpdateResidual(x_r,r) );
+
+	CoarseSpinor diff(linfo);
+	CopyVec(diff,x);
+	EXPECT_LT( sqrt(XmyNorm2Vec(diff,x_r)/Norm2Vec(x)), 1.0e-6 );
+
+	// The returned residual is b - M x
+	CoarseSpinor Mx(linfo);
+	M(Mx,x_r,LINOP_OP);
+	CoarseSpinor r_true(linfo);
+	CopyVec(r_true,b);
+	const double r_true_norm = sqrt(XmyNorm2Vec(r_true,Mx));
+	EXPECT_LT( sqrt(XmyNorm2Vec(r_true,r))/r_true_norm, 1.0e-5 );
+}
+
+TEST_F(CoarseSolvers, TestMultiMRSmoother)
+{
+	MRSolverParams mr_params;
+	mr_params.MaxIter = 4;
+	mr_params.RsdTarget = 1.0e-20;
+	mr_params.Omega = 1.1;
+	mr_params.VerboseP = false;
+	MRSmootherCoarse smoother(M,mr_params);
+
+	const int n_rhs = 3;
+	CoarseSpinorSet b_set(linfo, n_rhs);
+	CoarseSpinorSet x_set(linfo, n_rhs);
+	CoarseSpinorSet x_r(linfo, n_rhs);
+	CoarseSpinorSet r(linfo, n_rhs);
+	for(int j=0; j < n_rhs; ++j) {
+		Gaussian(b_set[j]);
+		Gaussian(x_set[j]);   // MultiSmooth must start from the given guess
+		ZeroVec(x_r[j]);
+		CopyVec(r[j],b_set[j]);
+	}
+
+	CoarseSpinorSet x_ref(linfo, n_rhs);
+	for(int j=0; j < n_rhs; ++j) {
+		CopyVec(x_ref[j],x_set[j]);
+		smoother(x_ref[j],b_set[j]);
+	}
+	// One vector first: the smoother's scratch then has to grow for n_rhs
+	CoarseSpinorSet x_one(linfo, 1);
+	CopyVec(x_one[0],x_set[0]);
+	smoother.MultiSmooth(x_one, b_set, 1);
+	smoother.MultiSmooth(x_set, b_set, n_rhs);
+	ASSERT_TRUE( smoother.MultiSmoothAndUpdateResidual(x_r, r, n_rhs) );
+
+	{
+		CoarseSpinor diff(linfo);
+		CopyVec(diff,x_ref[0]);
+		EXPECT_LT( sqrt(XmyNorm2Vec(diff,x_one[0])/Norm2Vec(x_ref[0])), 1.0e-5 );
+	}
+	for(int j=0; j < n_rhs; ++j) {
+		// Each vector takes its own MR steps
+		CoarseSpinor diff(linfo);
+		CopyVec(diff,x_ref[j]);
+		EXPECT_LT( sqrt(XmyNorm2Vec(diff,x_set[j])/Norm2Vec(x_ref[j])), 1.0e-5 );
+
+		// The returned residual is b - M x
+		CoarseSpinor Mx(linfo);
+		M(Mx,x_r[j],LINOP_OP);
+		CoarseSpinor r_true(linfo);
+		CopyVec(r_true,b_set[j]);
+		const double r_true_norm = sqrt(XmyNorm2Vec(r_true,Mx));
+		EXPECT_LT( sqrt(XmyNorm2Vec(r_true,r[j]))/r_true_norm, 1.0e-5 );
+	}
+}
+
+TEST_F(CoarseSolvers, TestPersistentMRSmoother)
+{
+	MRSolverParams mr_params;
+	mr_params.MaxIter = 4;
+	mr_params.RsdTarget = 1.0e-20;
+	mr_params.Omega = 1.1;
+	mr_params.VerboseP = false;
+	MRSmootherCoarse smoother(M,mr_params);
+	PersistentMRSmootherCoarse persistent_smoother(M,mr_params);
+
+	// The same iteration as the MR smoother, up to the order of the sums
+	CoarseSpinor x_p(linfo);
+	ZeroVec(x_p);
+	smoother(x,b);
+	persistent_smoother(x_p,b);
+
+	CoarseSpinor diff(linfo);
+	CopyVec(diff,x);
+	EXPECT_LT( sqrt(XmyNorm2Vec(diff,x_p)/Norm2Vec(x)), 1.0e-5 );
+
+	// From a nonzero initial guess: starts from its residual
+	CoarseSpinor x_p2(linfo);
+	CopyVec(x_p2,x_p);
+	persistent_smoother(x_p2,b);
+	CoarseSpinor Mx(linfo);
+	CoarseSpinor r(linfo);
+	M(Mx,x_p,LINOP_OP);
+	XmyzVec(b,Mx,r);
+	const double norm_r = sqrt(Norm2Vec(r));
+	M(Mx,x_p2,LINOP_OP);
+	XmyzVec(b,Mx,r);
+	EXPECT_LT( sqrt(Norm2Vec(r)), norm_r );
+
+	// The returned residual is b - M x
+	CoarseSpinor x_r(linfo);
+	ZeroVec(x_r);
+	CopyVec(r,b);
+	ASSERT_TRUE( persistent_smoother.SmoothAndUpdateResidual(x_r,r) );
+	M(Mx,x_r,LINOP_OP);
+	CoarseSpinor r_true(linfo);
+	CopyVec(r_true,b);
+	const double r_true_norm = sqrt(XmyNorm2Vec(r_true,Mx));
+	EXPECT_LT( sqrt(XmyNorm2Vec(r_true,r))/r_true_norm, 1.0e-5 );
+}
+
+TEST_F(CoarseSolvers, TestBlockUnprecOp)
+{
+	std::vector<Block> blocklist;
+	IndexArray block_lattice_dims;
+	IndexArray block_lattice_origin;
+	IndexArray block_dims = {{2,2,2,2}};
+	CreateBlockList(blocklist, block_lattice_dims, block_lattice_origin,
+			linfo.GetLatticeDimensions(), block_dims, linfo.GetLatticeOrigin());
+
+	const int site_floats = n_complex*linfo.GetNumColorSpins();
+
+	for(int b : { 0, 5, (int)blocklist.size()-1 }) {
+		const std::vector<CBSite>& sites = blocklist[b].getCBSiteList();
+		const int num_sites = sites.size();
+		std::vector<int> neighbors;
+		CreateBlockNeighborTable(blocklist[b], neighbors);
+
+		// A vector living on the block only
+		CoarseSpinor v(linfo);
+		Gaussian(v);
+		std::vector<float> v_block(num_sites*site_floats);
+		for(int i=0; i < num_sites; ++i) {
+			const float* v_site = v.GetSiteDataPtr(sites[i].cb, sites[i].site);
+			for(int j=0; j < site_floats; ++j) v_block[i*site_floats+j] = v_site[j];
+		}
+		ZeroVec(v);
+		for(int i=0; i < num_sites; ++i) {
+			float* v_site = v.GetSiteDataPtr(sites[i].cb, sites[i].site);
+			for(int j=0; j < site_floats; ++j) v_site[j] = v_block[i*site_floats+j];
+		}
+
+		// On the block, the block operator is the full one
+		CoarseSpinor Mv(linfo);
+		for(IndexType dagger : { LINOP_OP, LINOP_DAGGER }) {
+			M(Mv,v,dagger);
+			std::vector<float> Mv_block(num_sites*site_floats);
+			M.GetDiracOp().blockUnprecOp(Mv_block.data(), M.GetGauge(), v_block.data(), sites, neighbors, dagger);
+
+			for(int i=0; i < num_sites; ++i) {
+				const float* Mv_site = Mv.GetSiteDataPtr(sites[i].cb, sites[i].site);
+				for(int j=0; j < site_floats; ++j) {
+					ASSERT_NEAR( Mv_block[i*site_floats+j], Mv_site[j], 1.0e-5 );
+				}
+			}
+		}
+	}
+}
+
+TEST_F(CoarseSolvers, TestSAPSmoother)
+{
+	SAPSmootherParams params;
+	params.MaxIter = 1;
+	params.BlockDims = {{2,2,2,2}};
+	params.BlockMRIters = 4;
+	params.VerboseP = true;
+	SAPSmootherCoarse smoother(M,params);
+
+	// 4^4 in 2^4 blocks: 16 blocks, half of each colour
+	EXPECT_EQ( smoother.GetNumBlocks(0), 8 );
+	EXPECT_EQ( smoother.GetNumBlocks(1), 8 );
+
+	smoother(x,b);
+	const double sap_resid = relResidual(M,x,b);
+	MasterLog(INFO,"After one SAP cycle || r ||/|| b ||=%16.8e", sap_resid);
+	EXPECT_LT( sap_resid, 0.5 );
+
+	// x is the initial guess, so applying the smoother again iterates
+	for(int i=0; i < 10; ++i) {
+		smoother(x,b);
+	}
+	const double final_resid = relResidual(M,x,b);
+	MasterLog(INFO,"After 11 SAP cycles || r ||/|| b ||=%16.8e", final_resid);
+	EXPECT_LT( final_resid, 1.0e-4 );
+}
+
+TEST_F(CoarseSolvers, TestBlockJacobiSmoother)
+{
+	for(double omega : { 1.0, 0.8 } ) {
+		MRSolverParams params;
+		params.MaxIter = 2;
+		params.Omega = omega;
+		params.VerboseP = true;
+		BlockJacobiSmootherCoarse smoother(M,params);
+
+		ZeroVec(x);
+		smoother(x,b);
+		const double resid = relResidual(M,x,b);
+		MasterLog(INFO,"omega=%g: after 2 sweeps || r ||/|| b ||=%16.8e", omega, resid);
+		EXPECT_LT( resid, 0.5 );
+
+		// x is the initial guess, so applying the smoother again iterates
+		for(int i=0; i < 15; ++i) {
+			smoother(x,b);
+		}
+		const double final_resid = relResidual(M,x,b);
+		MasterLog(INFO,"omega=%g: after 32 sweeps || r ||/|| b ||=%16.8e", omega, final_resid);
+		EXPECT_LT( final_resid, 1.0e-4 );
+
+		// The solution is a fixed point
+		CoarseSpinor x_fixed(linfo);
+		CopyVec(x_fixed,x);
+		smoother(x_fixed,b);
+		CoarseSpinor diff(linfo);
+		CopyVec(diff,x);
+		EXPECT_LT( sqrt(XmyNorm2Vec(diff,x_fixed)/Norm2Vec(x)), 1.0e-4 );
+	}
+}
+
+TEST_F(CoarseSolvers, TestNestedTeams)
+{
+	// AdditiveVCycleCoarse runs its smoother and its coarse correction in two nested
+	// subteams (num_threads(2) proc_bind(spread)). The same split on kernels without
+	// the QPhiX transfer: subteams not the size of the thread partition, so the
+	// operator and the BLAS split their sites over the subteam instead
+	MRSolverParams mr_params;
+	mr_params.MaxIter = 4;
+	mr_params.RsdTarget = 1.0e-20;
+	mr_params.Omega = 1.1;
+	mr_params.VerboseP = false;
+	MRSmootherCoarse smoother(M,mr_params);
+
+	// References from the whole team
+	CoarseSpinor Mb_ref(linfo);
+	M(Mb_ref,b,LINOP_OP);
+	const double norm2_ref = Norm2Vec(b);
+	CoarseSpinor x_ref(linfo);
+	ZeroVec(x_ref);
+	smoother(x_ref,b);
+
+	const int team_sizes[2] = { 1, 3 };
+	int seen_sizes[2] = { 0, 0 };
+	CoarseSpinor Mb(linfo);
+	double norm2_b = 0;
+
+	const int saved_max_active_levels = omp_get_max_active_levels();
+	omp_set_max_active_levels( std::max(saved_max_active_levels, 2) );
+
+#pragma omp parallel num_threads(2) proc_bind(spread)
+	{
+		const int team = omp_get_thread_num();
+		omp_set_num_threads(team_sizes[team]);
+#pragma omp parallel
+		{
+#pragma omp master
+			seen_sizes[team] = omp_get_num_threads();
+		}
+
+		if( team == 0 ) {
+			M(Mb,b,LINOP_OP);
+			norm2_b = Norm2Vec(b);
+		}
+		else {
+			smoother(x,b);
+		}
+	}
+
+	omp_set_max_active_levels(saved_max_active_levels);
+
+	// The kernels really ran on the subteams
+	EXPECT_EQ( seen_sizes[0], team_sizes[0] );
+	EXPECT_EQ( seen_sizes[1], team_sizes[1] );
+
+	// Every site was done once: the same results, up to the order of the sums
+	const double norm2_Mb = Norm2Vec(Mb_ref);
+	EXPECT_LT( XmyNorm2Vec(Mb,Mb_ref), 1.0e-10*norm2_Mb );
+	EXPECT_NEAR( norm2_b, norm2_ref, 1.0e-10*norm2_ref );
+	CoarseSpinor diff(linfo);
+	CopyVec(diff,x_ref);
+	EXPECT_LT( sqrt(XmyNorm2Vec(diff,x)/Norm2Vec(x_ref)), 1.0e-5 );
+}
+
+TEST_F(CoarseSolvers, TestDirectSolver)
+{
+	// The 2-s check the assembly when the forward and backward neighbours coincide
+	const IndexArray dims[2] = { latdims, {{2,4,2,4}} };
+
+	for(int l=0; l < 2; ++l) {
+		NodeInfo node_l;
+		LatticeInfo info_l(dims[l], 2, n_color, node_l);
+
+		std::shared_ptr<CoarseGauge> u_l = std::make_shared<CoarseGauge>(info_l);
+		FillRandomCoarseGauge(*u_l, 1.0, 0.05);
+		CoarseWilsonCloverLinearOperator M_l(u_l,1);
+
+		LinearSolverParamsBase params;
+		params.VerboseP = true;
+		CoarseDirectSolver solver(M_l,params);
+		EXPECT_EQ( solver.GetGlobalSize(), n_checkerboard*info_l.GetNumCBSites()*info_l.GetNumColorSpins() );
+
+		CoarseSpinor b_l(info_l);
+		CoarseSpinor x_l(info_l);
+		Gaussian(b_l);
+		Gaussian(x_l); // The guess is ignored
+
+		LinearSolverResults res = solver(x_l,b_l);
+		EXPECT_EQ( res.n_count, 1 );
+		EXPECT_LT( res.resid, 1.0e-12 );
+
+		// Limited by the single precision spinors
+		const double resid = relResidual(M_l,x_l,b_l);
+		MasterLog(INFO,"Direct solve: || r ||/|| b ||=%16.8e", resid);
+		EXPECT_LT( resid, 1.0e-5 );
+	}
+}
+
+TEST_F(CoarseSolvers, TestWAndKCycleCorrections)
+{
+	// Stands in for the cycle of the next level: reduces the residual by 0.1
+	FGMRESParams cycle_params;
+	cycle_params.MaxIter = 50;
+	cycle_params.RsdTarget = 0.1;
+	cycle_params.NKrylov = 8;
+	FGMRESSolverCoarse next_cycle(M, cycle_params);
+
+	VCycleParams p;
+	p.bottom_solver_params.VerboseP = true;
+	EXPECT_EQ( MakeCoarseCorrection(M_ptr, p, &next_cycle), nullptr );
+
+	// W: gamma visits of the next cycle, whatever the residual
+	p.cycle_shape = CYCLE_W;
+	p.w_cycle_gamma = 3;
+	auto w_cycle = MakeCoarseCorrection(M_ptr, p, &next_cycle);
+	ASSERT_NE( w_cycle, nullptr );
+	LinearSolverResults res = (*w_cycle)(x,b);
+	EXPECT_EQ( res.n_count, 3 );
+	EXPECT_NEAR( res.resid, relResidual(M,x,b), 1.0e-5 );
+	EXPECT_LT( res.resid, 2.0e-3 );
+
+	// K: the first step is good enough for a loose target, not for a tight one
+	p.cycle_shape = CYCLE_K;
+	p.k_cycle_rsd_target = 0.25;
+	auto k_cycle = MakeCoarseCorrection(M_ptr, p, &next_cycle);
+	ASSERT_NE( k_cycle, nullptr );
+	ZeroVec(x);
+	res = (*k_cycle)(x,b);
+	EXPECT_EQ( res.n_count, 1 );
+	EXPECT_LT( relResidual(M,x,b), 0.25 );
+
+	p.k_cycle_rsd_target = 1.0e-3;
+	k_cycle = MakeCoarseCorrection(M_ptr, p, &next_cycle);
+	ZeroVec(x);
+	res = (*k_cycle)(x,b);
+	EXPECT_EQ( res.n_count, 2 );
+	EXPECT_LT( relResidual(M,x,b), 0.1 );
+}
+
+TEST_F(CoarseSolvers, TestAdaptiveTolerance)
+{
+	// Stands in for the coarse solve of a cycle
+	FGMRESParams inner_params;
+	inner_params.MaxIter = 200;
+	inner_params.RsdTarget = 1.0e-4;
+	inner_params.NKrylov = 4;
+	auto inner = std::make_shared<const FGMRESSolverCoarse>(M, inner_params);
+
+	// With min = max target this is the fixed tolerance, with the iterations counted
+	AdaptiveToleranceSolver<CoarseSpinor,CoarseGauge> fixed(inner, M.GetLevel(), 0.1, 1.0e-4, 1.0e-4);
+	AdaptiveToleranceSolver<CoarseSpinor,CoarseGauge> adaptive(inner, M.GetLevel(), 0.1, 1.0e-4, 0.5);
+
+	adaptive.SetOuterResidual(10.0);
+	EXPECT_DOUBLE_EQ( adaptive.GetRsdTarget(), 0.5 );
+	adaptive.SetOuterResidual(0.1);
+	EXPECT_DOUBLE_EQ( adaptive.GetRsdTarget(), 0.01 );
+	adaptive.SetOuterResidual(1.0e-6);
+	EXPECT_DOUBLE_EQ( adaptive.GetRsdTarget(), 1.0e-4 );
+
+	FGMRESParams outer_params;
+	outer_params.MaxIter = 50;
+	outer_params.RsdTarget = 1.0e-5;
+	outer_params.VerboseP = true;
+	outer_params.NKrylov = 10;
+	FGMRESSolverCoarse outer_fixed(M, outer_params, &fixed);
+	FGMRESSolverCoarse outer_adaptive(M, outer_params, &adaptive);
+
+	ZeroVec(x);
+	outer_fixed(x,b);
+	EXPECT_LT( relResidual(M,x,b), 2*outer_params.RsdTarget );
+
+	adaptive.ResetStats();
+	ZeroVec(x);
+	outer_adaptive(x,b);
+	EXPECT_LT( relResidual(M,x,b), 2*outer_params.RsdTarget );
+
+	fixed.LogStats();
+	adaptive.LogStats();
+
+	// FGMRES passed its residual on: the first solve was loose, the later ones tighter
+	EXPECT_GT( adaptive.GetNumSolves(), 1 );
+	EXPECT_LT( adaptive.GetRsdTarget(), 0.5 );
+	EXPECT_LT( adaptive.GetNumIters(), fixed.GetNumIters() );
+}
+
+TEST_F(CoarseSolvers, TestLinkPrecision)
+{
+	CoarseEOWilsonCloverLinearOperator M_eo(u,1);
+
+	Gaussian(x);
+
+	// FP32 references, unpreconditioned and even-odd, and their daggers
+	const IndexType types[2] = { LINOP_OP, LINOP_DAGGER };
+	std::vector<std::shared_ptr<CoarseSpinor>> ref(4);
+	for(int i=0; i < 2; ++i) {
+		ref[i] = std::make_shared<CoarseSpinor>(linfo);
+		ref[2+i] = std::make_shared<CoarseSpinor>(linfo);
+		M(*ref[i],x,types[i]);
+		M_eo(*ref[2+i],x,types[i]);
+	}
+
+	// The mantissas have 11 and 8 bits
+	const CoarsePrecision precs[2] = { COARSE_PREC_FP16, COARSE_PREC_BF16 };
+	const double tols[2] = { 1.0e-3, 5.0e-3 };
+	for(int p=0; p < 2; ++p) {
+		u->SetLinkPrecision(precs[p]);
+		EXPECT_EQ( u->GetLinkPrecision(), precs[p] );
+
+		CoarseSpinor y(linfo);
+		for(int i=0; i < 2; ++i) {
+			M(y,x,types[i]);
+			double rel_diff = sqrt( XmyNorm2Vec(y,*ref[i])/Norm2Vec(*ref[i]) );
+			MasterLog(INFO, "%s links: unprec type=%d || y - y_fp32 ||/|| y_fp32 ||=%16.8e",
+					CoarsePrecisionName(precs[p]), types[i], rel_diff);
+			EXPECT_GT( rel_diff, 0 );
+			EXPECT_LT( rel_diff, tols[p] );
+
+			M_eo(y,x,types[i]);
+			rel_diff = sqrt( XmyNorm2Vec(y,*ref[2+i],SUBSET_ODD)/Norm2Vec(*ref[2+i],SUBSET_ODD) );
+			MasterLog(INFO, "%s links: eo type=%d || y - y_fp32 ||/|| y_fp32 ||=%16.8e",
+					CoarsePrecisionName(precs[p]), types[i], rel_diff);
+			EXPECT_GT( rel_diff, 0 );
+			EXPECT_LT( rel_diff, tols[p] );
+		}
+
+		// The solver converges on the operator with the 16 bit links
+		FGMRESParams params;
+		params.MaxIter = 200;
+		params.RsdTarget = 1.0e-5;
+		params.VerboseP = false;
+		params.NKrylov = 8;
+		FGMRESSolverCoarse solver(M,params);
+
+		CoarseSpinor z(linfo);
+		ZeroVec(z);
+		LinearSolverResults res = solver(z,b);
+		EXPECT_LE( res.resid, params.RsdTarget );
+		EXPECT_LT( relResidual(M,z,b), 2*params.RsdTarget );
+	}
+
+	// Back to FP32 gives the reference again
+	u->SetLinkPrecision(COARSE_PREC_FP32);
+	CoarseSpinor y(linfo);
+	M(y,x,LINOP_OP);
+	EXPECT_EQ( XmyNorm2Vec(y,*ref[0]), 0 );
+}
+
+int main(int argc, char *argv[])
+{
+	return MGTesting::TestMain(&argc, argv);
+}